@@ -595,6 +595,11 @@ PFNGLGETUNIFORMBLOCKINDEXPROC glad_glGetUniformBlockIndex;
 PFNGLTEXIMAGE2DMULTISAMPLEPROC glad_glTexImage2DMultisample;
 PFNGLGETACTIVEUNIFORMPROC glad_glGetActiveUniform;
 PFNGLFRONTFACEPROC glad_glFrontFace;
+int GLAD_GL_ARB_buffer_storage;
+PFNGLBUFFERSTORAGEPROC glad_glBufferStorage;
+int GLAD_GL_ARB_get_program_binary;
+int GLAD_GL_ARB_parallel_shader_compile;
+PFNGLMAXSHADERCOMPILERTHREADSARBPROC glad_glMaxShaderCompilerThreadsARB;
 int GLAD_GL_KHR_debug;
 PFNGLDEBUGMESSAGECONTROLPROC glad_glDebugMessageControl;
 PFNGLDEBUGMESSAGEINSERTPROC glad_glDebugMessageInsert;
@@ -1031,6 +1036,20 @@ static void load_GL_VERSION_3_3(GLADloadproc load) {
 	glad_glSecondaryColorP3ui = (PFNGLSECONDARYCOLORP3UIPROC)load("glSecondaryColorP3ui");
 	glad_glSecondaryColorP3uiv = (PFNGLSECONDARYCOLORP3UIVPROC)load("glSecondaryColorP3uiv");
 }
+static void load_GL_ARB_buffer_storage(GLADloadproc load) {
+	if(!GLAD_GL_ARB_buffer_storage) return;
+	glad_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+}
+static void load_GL_ARB_get_program_binary(GLADloadproc load) {
+	if(!GLAD_GL_ARB_get_program_binary) return;
+	glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+	glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+	glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+}
+static void load_GL_ARB_parallel_shader_compile(GLADloadproc load) {
+	if(!GLAD_GL_ARB_parallel_shader_compile) return;
+	glad_glMaxShaderCompilerThreadsARB = (PFNGLMAXSHADERCOMPILERTHREADSARBPROC)load("glMaxShaderCompilerThreadsARB");
+}
 static void load_GL_KHR_debug(GLADloadproc load) {
 	if(!GLAD_GL_KHR_debug) return;
 	glad_glDebugMessageControl = (PFNGLDEBUGMESSAGECONTROLPROC)load("glDebugMessageControl");
@@ -1058,6 +1077,9 @@ static void load_GL_KHR_debug(GLADloadproc load) {
 }
 static void find_extensionsGL(void) {
 	get_exts();
+	GLAD_GL_ARB_buffer_storage = has_ext("GL_ARB_buffer_storage");
+	GLAD_GL_ARB_get_program_binary = has_ext("GL_ARB_get_program_binary");
+	GLAD_GL_ARB_parallel_shader_compile = has_ext("GL_ARB_parallel_shader_compile");
 	GLAD_GL_KHR_debug = has_ext("GL_KHR_debug");
 }
 
@@ -1135,6 +1157,9 @@ int gladLoadGLLoader(GLADloadproc load) {
 	load_GL_VERSION_3_3(load);
 
 	find_extensionsGL();
+	load_GL_ARB_buffer_storage(load);
+	load_GL_ARB_get_program_binary(load);
+	load_GL_ARB_parallel_shader_compile(load);
 	load_GL_KHR_debug(load);
 	return GLVersion.major != 0 || GLVersion.minor != 0;
 }
@@ -53,6 +53,14 @@ void EnableStretching(bool enable) {
     DSP::HLE::EnableStretching(enable);
 }
 
+void EnableParallelSources(bool enable) {
+    DSP::HLE::EnableParallelSources(enable);
+}
+
+void EnableOfflineRendering(bool enable) {
+    DSP::HLE::EnableOfflineRendering(enable);
+}
+
 void Shutdown() {
     CoreTiming::UnscheduleEvent(tick_event, 0);
     DSP::HLE::Shutdown();
@@ -25,6 +25,12 @@ void SelectSink(std::string sink_id);
 /// Enable/Disable stretching.
 void EnableStretching(bool enable);
 
+/// Enable/Disable processing the audio sources in parallel.
+void EnableParallelSources(bool enable);
+
+/// Enable/Disable outputting every frame as is, without pacing the audio against the wall clock.
+void EnableOfflineRendering(bool enable);
+
 /// Shutdown Audio Core
 void Shutdown();
 
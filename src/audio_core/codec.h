@@ -5,13 +5,13 @@
 #pragma once
 
 #include <array>
-#include <vector>
+#include "audio_core/counting_allocator.h"
 #include "common/common_types.h"
 
 namespace Codec {
 
 /// A variable length buffer of signed PCM16 stereo samples.
-using StereoBuffer16 = std::vector<std::array<s16, 2>>;
+using StereoBuffer16 = AudioCore::CountedVector<std::array<s16, 2>>;
 
 /// See: Codec::DecodeADPCM
 struct ADPCMState {
@@ -26,26 +26,30 @@ struct ADPCMState {
  * @param sample_count Length of buffer in terms of number of samples
  * @param adpcm_coeff ADPCM coefficients
  * @param state ADPCM state, this is updated with new state
- * @return Decoded stereo signed PCM16 data, sample_count in length
+ * @param output Receives the decoded stereo signed PCM16 data, sample_count in length rounded up
+ *               to a multiple of two. Its storage is reused.
  */
-StereoBuffer16 DecodeADPCM(const u8* const data, const size_t sample_count,
-                           const std::array<s16, 16>& adpcm_coeff, ADPCMState& state);
+void DecodeADPCM(const u8* const data, const size_t sample_count,
+                 const std::array<s16, 16>& adpcm_coeff, ADPCMState& state,
+                 StereoBuffer16& output);
 
 /**
  * @param num_channels Number of channels
  * @param data Pointer to buffer that contains PCM8 data to decode
  * @param sample_count Length of buffer in terms of number of samples
- * @return Decoded stereo signed PCM16 data, sample_count in length
+ * @param output Receives the decoded stereo signed PCM16 data, sample_count in length. Its storage
+ *               is reused.
  */
-StereoBuffer16 DecodePCM8(const unsigned num_channels, const u8* const data,
-                          const size_t sample_count);
+void DecodePCM8(const unsigned num_channels, const u8* const data, const size_t sample_count,
+                StereoBuffer16& output);
 
 /**
  * @param num_channels Number of channels
  * @param data Pointer to buffer that contains PCM16 data to decode
  * @param sample_count Length of buffer in terms of number of samples
- * @return Decoded stereo signed PCM16 data, sample_count in length
+ * @param output Receives the decoded stereo signed PCM16 data, sample_count in length. Its storage
+ *               is reused.
  */
-StereoBuffer16 DecodePCM16(const unsigned num_channels, const u8* const data,
-                           const size_t sample_count);
+void DecodePCM16(const unsigned num_channels, const u8* const data, const size_t sample_count,
+                 StereoBuffer16& output);
 };
@@ -0,0 +1,22 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <atomic>
+#include "audio_core/counting_allocator.h"
+
+namespace AudioCore {
+
+static std::atomic<size_t> allocation_count{0};
+
+size_t GetAllocationCount() {
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+namespace detail {
+void CountAllocation() {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+}
+} // namespace detail
+
+} // namespace AudioCore
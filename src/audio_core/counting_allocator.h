@@ -0,0 +1,47 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace AudioCore {
+
+/// Returns the number of allocations made by every CountingAllocator so far
+size_t GetAllocationCount();
+
+namespace detail {
+void CountAllocation();
+} // namespace detail
+
+/**
+ * Standard allocator counting its allocations. It is used by the buffers of the DSP HLE whose
+ * storage is reused, so that tests can check that steady-state playback doesn't allocate.
+ */
+template <typename T>
+class CountingAllocator : public std::allocator<T> {
+public:
+    template <typename U>
+    struct rebind {
+        using other = CountingAllocator<U>;
+    };
+
+    CountingAllocator() = default;
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        detail::CountAllocation();
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+/// Vector whose allocations are counted
+template <typename T>
+using CountedVector = std::vector<T, CountingAllocator<T>>;
+
+} // namespace AudioCore
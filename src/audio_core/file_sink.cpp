@@ -0,0 +1,100 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <cstdio>
+#include "audio_core/audio_core.h"
+#include "audio_core/file_sink.h"
+#include "common/logging/log.h"
+#include "common/string_util.h"
+#include "common/swap.h"
+
+namespace AudioCore {
+
+struct WavHeader {
+    std::array<char, 4> riff_id;
+    u32_le riff_size;
+    std::array<char, 4> wave_id;
+
+    std::array<char, 4> fmt_id;
+    u32_le fmt_size;
+    u16_le format;
+    u16_le num_channels;
+    u32_le sample_rate;
+    u32_le byte_rate;
+    u16_le block_align;
+    u16_le bits_per_sample;
+
+    std::array<char, 4> data_id;
+    u32_le data_size;
+};
+static_assert(sizeof(WavHeader) == 44, "WavHeader has incorrect size");
+
+constexpr u32 bytes_per_sample = 2 * sizeof(s16);
+
+static bool IsWavPath(const std::string& path) {
+    std::string extension;
+    Common::SplitPath(path, nullptr, nullptr, &extension);
+    return Common::ToLower(extension) == ".wav";
+}
+
+FileSink::FileSink(const std::string& path) : file(path, "wb"), is_wav(IsWavPath(path)) {
+    if (!file.IsOpen()) {
+        LOG_CRITICAL(Audio_Sink, "Could not open %s for writing", path.c_str());
+        return;
+    }
+
+    if (is_wav) {
+        WriteWavHeader();
+    }
+}
+
+FileSink::~FileSink() {
+    if (is_wav && file.IsOpen()) {
+        file.Seek(0, SEEK_SET);
+        WriteWavHeader();
+    }
+}
+
+unsigned int FileSink::GetNativeSampleRate() const {
+    return native_sample_rate;
+}
+
+void FileSink::EnqueueSamples(const s16* samples, size_t sample_count) {
+    file.WriteArray(samples, sample_count * 2);
+    samples_written += static_cast<u32>(sample_count);
+}
+
+size_t FileSink::SamplesInQueue() const {
+    // Samples are written out right away
+    return 0;
+}
+
+std::vector<std::string> FileSink::GetDeviceList() const {
+    return {};
+}
+
+void FileSink::SetDevice(int device_id) {}
+
+void FileSink::WriteWavHeader() {
+    const u32 data_size = samples_written * bytes_per_sample;
+
+    WavHeader header;
+    header.riff_id = {{'R', 'I', 'F', 'F'}};
+    header.riff_size = static_cast<u32>(sizeof(WavHeader) - 8 + data_size);
+    header.wave_id = {{'W', 'A', 'V', 'E'}};
+    header.fmt_id = {{'f', 'm', 't', ' '}};
+    header.fmt_size = 16;
+    header.format = 1; // PCM
+    header.num_channels = 2;
+    header.sample_rate = native_sample_rate;
+    header.byte_rate = native_sample_rate * bytes_per_sample;
+    header.block_align = bytes_per_sample;
+    header.bits_per_sample = 16;
+    header.data_id = {{'d', 'a', 't', 'a'}};
+    header.data_size = data_size;
+    file.WriteObject(header);
+}
+
+} // namespace AudioCore
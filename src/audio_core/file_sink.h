@@ -0,0 +1,44 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "audio_core/sink.h"
+#include "common/common_types.h"
+#include "common/file_util.h"
+
+namespace AudioCore {
+
+/**
+ * Sink writing the samples to a file at the native sample rate, as a WAV file if its name ends
+ * with ".wav" and as raw interleaved stereo PCM16 samples otherwise. The samples are written as
+ * they are enqueued, so together with offline rendering this captures the exact output of the DSP.
+ */
+class FileSink final : public Sink {
+public:
+    explicit FileSink(const std::string& path);
+    ~FileSink() override;
+
+    unsigned int GetNativeSampleRate() const override;
+
+    void EnqueueSamples(const s16* samples, size_t sample_count) override;
+
+    size_t SamplesInQueue() const override;
+
+    std::vector<std::string> GetDeviceList() const override;
+    void SetDevice(int device_id) override;
+
+private:
+    /// Writes the WAV header at the beginning of the file, for the samples written so far
+    void WriteWavHeader();
+
+    FileUtil::IOFile file;
+    bool is_wav;
+    u32 samples_written = 0;
+};
+
+} // namespace AudioCore
@@ -20,15 +20,5 @@ using StereoFrame16 = std::array<std::array<s16, 2>, samples_per_frame>;
 /// The DSP is quadraphonic internally.
 using QuadFrame32 = std::array<std::array<s32, 4>, samples_per_frame>;
 
-/**
- * This performs the filter operation defined by FilterT::ProcessSample on the frame in-place.
- * FilterT::ProcessSample is called sequentially on the samples.
- */
-template <typename FrameT, typename FilterT>
-void FilterFrame(FrameT& frame, FilterT& filter) {
-    std::transform(frame.begin(), frame.end(), frame.begin(),
-                   [&filter](const auto& sample) { return filter.ProcessSample(sample); });
-}
-
 } // namespace HLE
 } // namespace DSP
@@ -3,13 +3,22 @@
 // Refer to the license.txt file included.
 
 #include <array>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "audio_core/audio_core.h"
 #include "audio_core/hle/dsp.h"
 #include "audio_core/hle/mixers.h"
 #include "audio_core/hle/pipe.h"
 #include "audio_core/hle/source.h"
+#include "audio_core/resampler.h"
 #include "audio_core/sink.h"
 #include "audio_core/time_stretch.h"
+#include "common/math_util.h"
+#include "common/thread.h"
+#include "common/thread_pool.h"
 
 namespace DSP {
 namespace HLE {
@@ -37,14 +46,6 @@ static size_t CurrentRegionIndex() {
     return (frame_counter_0 > frame_counter_1) ? 0 : 1;
 }
 
-static SharedMemory& ReadRegion() {
-    return CurrentRegionIndex() == 0 ? g_dsp_memory.region_0 : g_dsp_memory.region_1;
-}
-
-static SharedMemory& WriteRegion() {
-    return CurrentRegionIndex() != 0 ? g_dsp_memory.region_0 : g_dsp_memory.region_1;
-}
-
 // Audio processing and mixing
 
 static std::array<Source, num_sources> sources = {
@@ -54,31 +55,78 @@ static std::array<Source, num_sources> sources = {
 };
 static Mixers mixers;
 
-static StereoFrame16 GenerateCurrentFrame() {
-    SharedMemory& read = ReadRegion();
-    SharedMemory& write = WriteRegion();
+/// Worker pool processing the sources in parallel, or nullptr to process them sequentially
+static std::unique_ptr<Common::ThreadPool> source_pool;
+/// Intermediate mixes of each source on its own, when processing the sources in parallel
+static std::array<std::array<QuadFrame32, 3>, num_sources> source_mixes;
+
+/// Guest-visible output of a frame, which is written to the shared memory on the next tick
+struct FrameOutput {
+    DspStatus dsp_status;
+    FinalMixSamples final_samples;
+    SourceStatus source_statuses;
+    IntermediateMixSamples intermediate_mix_samples;
+    /// Whether the mixes of intermediate_mix_samples were written, see Mixers::IsAuxSendEnabled
+    bool mix1_sent;
+    bool mix2_sent;
+};
+
+/// Input of the frame being processed, read from the shared memory when it was started
+static IntermediateMixSamples frame_input;
+static FrameOutput frame_output;
+/// Whether frame_output holds the output of a frame which hasn't been written out yet
+static bool frame_output_pending = false;
 
+static void TickSource(size_t i, std::array<QuadFrame32, 3>& mixes) {
+    frame_output.source_statuses.status[i] = sources[i].Tick();
+    for (size_t mix = 0; mix < 3; mix++) {
+        sources[i].MixInto(mixes[mix], mix);
+    }
+}
+
+static StereoFrame16 GenerateCurrentFrame() {
     std::array<QuadFrame32, 3> intermediate_mixes = {};
 
     // Generate intermediate mixes
-    for (size_t i = 0; i < num_sources; i++) {
-        write.source_statuses.status[i] =
-            sources[i].Tick(read.source_configurations.config[i], read.adpcm_coefficients.coeff[i]);
-        for (size_t mix = 0; mix < 3; mix++) {
-            sources[i].MixInto(intermediate_mixes[mix], mix);
+    if (source_pool) {
+        // Sources are independent of each other, so each of them can be processed on any thread
+        // into its own mixes. The mixes are then summed in source order. The contributions of the
+        // sources being integers, this gives the same result as the sequential path.
+        source_pool->ParallelFor(num_sources, [](size_t i) {
+            for (auto& mix : source_mixes[i]) {
+                mix.fill({});
+            }
+            TickSource(i, source_mixes[i]);
+        });
+        for (size_t i = 0; i < num_sources; i++) {
+            for (size_t mix = 0; mix < 3; mix++) {
+                for (size_t samplei = 0; samplei < samples_per_frame; samplei++) {
+                    for (size_t channeli = 0; channeli < 4; channeli++) {
+                        intermediate_mixes[mix][samplei][channeli] +=
+                            source_mixes[i][mix][samplei][channeli];
+                    }
+                }
+            }
+        }
+    } else {
+        for (size_t i = 0; i < num_sources; i++) {
+            TickSource(i, intermediate_mixes);
         }
     }
 
     // Generate final mix
-    write.dsp_status = mixers.Tick(read.dsp_configuration, read.intermediate_mix_samples,
-                                   write.intermediate_mix_samples, intermediate_mixes);
+    frame_output.dsp_status = mixers.Tick(frame_input, frame_output.intermediate_mix_samples,
+                                          intermediate_mixes);
+    frame_output.mix1_sent = mixers.IsAuxSendEnabled(1);
+    frame_output.mix2_sent = mixers.IsAuxSendEnabled(2);
 
     StereoFrame16 output_frame = mixers.GetOutput();
 
-    // Write current output frame to the shared memory region
+    // Write current output frame for the shared memory region
     for (size_t samplei = 0; samplei < output_frame.size(); samplei++) {
         for (size_t channeli = 0; channeli < output_frame[0].size(); channeli++) {
-            write.final_samples.pcm16[samplei][channeli] = s16_le(output_frame[samplei][channeli]);
+            frame_output.final_samples.pcm16[samplei][channeli] =
+                s16_le(output_frame[samplei][channeli]);
         }
     }
 
@@ -88,23 +136,44 @@ static StereoFrame16 GenerateCurrentFrame() {
 // Audio output
 
 static bool perform_time_stretching = true;
+static bool offline_rendering = false;
 static std::unique_ptr<AudioCore::Sink> sink;
 static AudioCore::TimeStretcher time_stretcher;
+/// Output of the time stretcher, whose storage is reused from frame to frame
+static std::vector<s16> stretched_samples;
+/// Converts the output to the sample rate of the sink when it isn't stretched
+static AudioCore::Resampler resampler{AudioCore::native_sample_rate,
+                                      AudioCore::native_sample_rate};
+/// Output of the resampler, whose storage is reused from frame to frame
+static std::vector<s16> resampled_samples;
 
 static void FlushResidualStretcherAudio() {
     time_stretcher.Flush();
     while (true) {
-        std::vector<s16> residual_audio = time_stretcher.Process(sink->SamplesInQueue());
-        if (residual_audio.empty())
+        time_stretcher.Process(sink->SamplesInQueue(), stretched_samples);
+        if (stretched_samples.empty())
             break;
-        sink->EnqueueSamples(residual_audio.data(), residual_audio.size() / 2);
+        sink->EnqueueSamples(stretched_samples.data(), stretched_samples.size() / 2);
+    }
+}
+
+/// Enqueues a frame to the sink, bypassing the time stretcher
+static void EnqueueFrame(const StereoFrame16& frame) {
+    if (resampler.GetOutputRate() == resampler.GetInputRate()) {
+        sink->EnqueueSamples(&frame[0][0], frame.size());
+        return;
     }
+
+    resampler.Process(&frame[0][0], frame.size(), resampled_samples);
+    sink->EnqueueSamples(resampled_samples.data(), resampled_samples.size() / 2);
 }
 
 static void OutputCurrentFrame(const StereoFrame16& frame) {
-    if (perform_time_stretching) {
+    if (offline_rendering) {
+        EnqueueFrame(frame);
+    } else if (perform_time_stretching) {
         time_stretcher.AddSamples(&frame[0][0], frame.size());
-        std::vector<s16> stretched_samples = time_stretcher.Process(sink->SamplesInQueue());
+        time_stretcher.Process(sink->SamplesInQueue(), stretched_samples);
         sink->EnqueueSamples(stretched_samples.data(), stretched_samples.size() / 2);
     } else {
         constexpr size_t maximum_sample_latency = 2048; // about 64 miliseconds
@@ -114,23 +183,149 @@ static void OutputCurrentFrame(const StereoFrame16& frame) {
             return;
         }
 
-        sink->EnqueueSamples(&frame[0][0], frame.size());
+        EnqueueFrame(frame);
     }
 }
 
+// Audio thread
+
+static void ProcessFrame() {
+    OutputCurrentFrame(GenerateCurrentFrame());
+}
+
+/**
+ * Thread processing the frames started by Tick, while the emulation goes on until the next tick.
+ * The sources and mixers are only accessed by one of the threads at a time: by Tick to parse the
+ * configuration while no frame is being processed, then by this thread to generate the frame and
+ * output it. The sources copy the samples of their buffers when Tick queues them, so this thread
+ * doesn't access the guest memory, which the emulated application may change in the meantime.
+ */
+class AudioThread final {
+public:
+    ~AudioThread() {
+        Stop();
+    }
+
+    void Start() {
+        if (thread.joinable())
+            return;
+        stop = false;
+        thread = std::thread(&AudioThread::Loop, this);
+    }
+
+    /// Stops the thread once the frame being processed, if any, is done
+    void Stop() {
+        if (!thread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        condition.notify_all();
+        thread.join();
+    }
+
+    /// Starts processing a frame, or processes it right away if the thread isn't running
+    void StartFrame() {
+        if (!thread.joinable()) {
+            std::lock_guard<std::mutex> lock(processing_mutex);
+            ProcessFrame();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            frame_pending = true;
+        }
+        condition.notify_all();
+    }
+
+    /// Waits for the frame being processed, if any, to be done
+    void WaitForFrame() {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return !frame_pending; });
+    }
+
+    /// Held while processing a frame, to change the configuration of the output between frames
+    /// from any thread
+    std::mutex processing_mutex;
+
+private:
+    void Loop() {
+        Common::SetCurrentThreadName("AudioCore");
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            condition.wait(lock, [this] { return stop || frame_pending; });
+            if (!frame_pending)
+                return;
+
+            lock.unlock();
+            {
+                std::lock_guard<std::mutex> processing_lock(processing_mutex);
+                ProcessFrame();
+            }
+            lock.lock();
+
+            frame_pending = false;
+            condition.notify_all();
+        }
+    }
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool frame_pending = false;
+    bool stop = false;
+};
+
+// Destroyed before the state it processes, which is defined above
+static AudioThread audio_thread;
+
 void EnableStretching(bool enable) {
+    std::lock_guard<std::mutex> lock(audio_thread.processing_mutex);
     if (perform_time_stretching == enable)
         return;
 
-    if (!enable) {
+    if (!enable && !offline_rendering) {
         FlushResidualStretcherAudio();
+        resampler.Reset();
     }
     perform_time_stretching = enable;
 }
 
+void EnableParallelSources(bool enable) {
+    std::lock_guard<std::mutex> lock(audio_thread.processing_mutex);
+    if (static_cast<bool>(source_pool) == enable)
+        return;
+
+    if (enable) {
+        // A few workers are enough for the 24 sources, and they share the host with the CPU and
+        // GPU emulation
+        const size_t num_threads = std::thread::hardware_concurrency();
+        const size_t num_workers = MathUtil::Clamp<size_t>(num_threads - 1, 1, 3);
+        source_pool = std::make_unique<Common::ThreadPool>(num_workers, "AudioSources");
+    } else {
+        source_pool.reset();
+    }
+}
+
+void EnableOfflineRendering(bool enable) {
+    std::lock_guard<std::mutex> lock(audio_thread.processing_mutex);
+    if (offline_rendering == enable)
+        return;
+
+    if (enable && perform_time_stretching) {
+        FlushResidualStretcherAudio();
+        resampler.Reset();
+    }
+    offline_rendering = enable;
+}
+
 // Public Interface
 
 void Init() {
+    audio_thread.WaitForFrame();
+
     DSP::HLE::ResetPipes();
 
     for (auto& source : sources) {
@@ -138,34 +333,71 @@ void Init() {
     }
 
     mixers.Reset();
+    frame_output_pending = false;
 
     time_stretcher.Reset();
+    resampler.Reset();
     if (sink) {
         time_stretcher.SetOutputSampleRate(sink->GetNativeSampleRate());
     }
+
+    audio_thread.Start();
 }
 
 void Shutdown() {
-    if (perform_time_stretching) {
+    audio_thread.Stop();
+
+    std::lock_guard<std::mutex> lock(audio_thread.processing_mutex);
+    if (perform_time_stretching && !offline_rendering) {
         FlushResidualStretcherAudio();
     }
 }
 
 bool Tick() {
-    StereoFrame16 current_frame = {};
+    // The sources and mixers are left alone by the audio thread until the next frame is started
+    audio_thread.WaitForFrame();
+
+    const bool region_0_is_current = CurrentRegionIndex() == 0;
+    SharedMemory& read = region_0_is_current ? g_dsp_memory.region_0 : g_dsp_memory.region_1;
+    SharedMemory& write = region_0_is_current ? g_dsp_memory.region_1 : g_dsp_memory.region_0;
+
+    // Write out the output of the previous frame
+    if (frame_output_pending) {
+        write.dsp_status = frame_output.dsp_status;
+        write.final_samples = frame_output.final_samples;
+        write.source_statuses = frame_output.source_statuses;
+        if (frame_output.mix1_sent) {
+            write.intermediate_mix_samples.mix1 = frame_output.intermediate_mix_samples.mix1;
+        }
+        if (frame_output.mix2_sent) {
+            write.intermediate_mix_samples.mix2 = frame_output.intermediate_mix_samples.mix2;
+        }
+    }
 
     // TODO: Check dsp::DSP semaphore (which indicates emulated application has finished writing to
     // shared memory region)
-    current_frame = GenerateCurrentFrame();
+    for (size_t i = 0; i < num_sources; i++) {
+        sources[i].ParseConfig(read.source_configurations.config[i],
+                               read.adpcm_coefficients.coeff[i]);
+    }
+    mixers.ParseConfig(read.dsp_configuration);
+    frame_input = read.intermediate_mix_samples;
 
-    OutputCurrentFrame(current_frame);
+    // The frame is generated and output while the emulation goes on, and its output is written to
+    // the shared memory on the next tick
+    frame_output_pending = true;
+    audio_thread.StartFrame();
 
     return true;
 }
 
 void SetSink(std::unique_ptr<AudioCore::Sink> sink_) {
+    // The frame being processed, if any, is output to the previous sink
+    audio_thread.WaitForFrame();
+    std::lock_guard<std::mutex> lock(audio_thread.processing_mutex);
     sink = std::move(sink_);
     time_stretcher.SetOutputSampleRate(sink->GetNativeSampleRate());
+    resampler.SetRates(AudioCore::native_sample_rate, sink->GetNativeSampleRate());
 }
 
 } // namespace HLE
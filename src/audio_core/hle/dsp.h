@@ -572,7 +572,9 @@ void Shutdown();
 
 /**
  * Perform processing and updates state of current shared memory buffer.
- * This function is called every audio tick before triggering the audio interrupt.
+ * This function is called every audio tick before triggering the audio interrupt. It parses the
+ * configuration and starts processing the frame on the audio thread, pipelined one frame behind:
+ * the state written to the shared memory is the output of the frame started by the previous tick.
  * @return Whether an audio interrupt should be triggered this frame.
  */
 bool Tick();
@@ -591,5 +593,21 @@ void SetSink(std::unique_ptr<AudioCore::Sink> sink);
  */
 void EnableStretching(bool enable);
 
+/**
+ * Enables/Disables processing the sources in parallel on a pool of worker threads.
+ * The output is the same as when processing them sequentially.
+ * @param enable true to enable, false to disable.
+ */
+void EnableParallelSources(bool enable);
+
+/**
+ * Enables/Disables offline rendering.
+ * When rendering offline, every frame is output to the sink as is, regardless of how many samples
+ * the sink has queued: time stretching, which paces the audio against the wall clock, is bypassed
+ * and no frame is dropped. Together with a sink writing to a file, this captures the exact output.
+ * @param enable true to enable, false to disable.
+ */
+void EnableOfflineRendering(bool enable);
+
 } // namespace HLE
 } // namespace DSP
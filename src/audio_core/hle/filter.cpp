@@ -7,8 +7,8 @@
 #include "audio_core/hle/common.h"
 #include "audio_core/hle/dsp.h"
 #include "audio_core/hle/filter.h"
+#include "audio_core/kernels.h"
 #include "common/common_types.h"
-#include "common/math_util.h"
 
 namespace DSP {
 namespace HLE {
@@ -40,77 +40,58 @@ void SourceFilters::ProcessFrame(StereoFrame16& frame) {
         return;
 
     if (simple_filter_enabled) {
-        FilterFrame(frame, simple_filter);
+        simple_filter.ProcessFrame(frame);
     }
 
     if (biquad_filter_enabled) {
-        FilterFrame(frame, biquad_filter);
+        biquad_filter.ProcessFrame(frame);
     }
 }
 
 // SimpleFilter
 
 void SourceFilters::SimpleFilter::Reset() {
-    y1.fill(0);
+    state.y1.fill(0);
     // Configure as passthrough.
-    a1 = 0;
-    b0 = 1 << 15;
+    state.a1 = 0;
+    state.b0 = 1 << 15;
 }
 
 void SourceFilters::SimpleFilter::Configure(
     SourceConfiguration::Configuration::SimpleFilter config) {
 
-    a1 = config.a1;
-    b0 = config.b0;
+    state.a1 = config.a1;
+    state.b0 = config.b0;
 }
 
-std::array<s16, 2> SourceFilters::SimpleFilter::ProcessSample(const std::array<s16, 2>& x0) {
-    std::array<s16, 2> y0;
-    for (size_t i = 0; i < 2; i++) {
-        const s32 tmp = (b0 * x0[i] + a1 * y1[i]) >> 15;
-        y0[i] = MathUtil::Clamp(tmp, -32768, 32767);
-    }
-
-    y1 = y0;
-
-    return y0;
+void SourceFilters::SimpleFilter::ProcessFrame(StereoFrame16& frame) {
+    AudioCore::Kernels::SimpleFilter(state, frame.data(), frame.size());
 }
 
 // BiquadFilter
 
 void SourceFilters::BiquadFilter::Reset() {
-    x1.fill(0);
-    x2.fill(0);
-    y1.fill(0);
-    y2.fill(0);
+    state.x1.fill(0);
+    state.x2.fill(0);
+    state.y1.fill(0);
+    state.y2.fill(0);
     // Configure as passthrough.
-    a1 = a2 = b1 = b2 = 0;
-    b0 = 1 << 14;
+    state.a1 = state.a2 = state.b1 = state.b2 = 0;
+    state.b0 = 1 << 14;
 }
 
 void SourceFilters::BiquadFilter::Configure(
     SourceConfiguration::Configuration::BiquadFilter config) {
 
-    a1 = config.a1;
-    a2 = config.a2;
-    b0 = config.b0;
-    b1 = config.b1;
-    b2 = config.b2;
+    state.a1 = config.a1;
+    state.a2 = config.a2;
+    state.b0 = config.b0;
+    state.b1 = config.b1;
+    state.b2 = config.b2;
 }
 
-std::array<s16, 2> SourceFilters::BiquadFilter::ProcessSample(const std::array<s16, 2>& x0) {
-    std::array<s16, 2> y0;
-    for (size_t i = 0; i < 2; i++) {
-        const s32 tmp = (b0 * x0[i] + b1 * x1[i] + b2 * x2[i] + a1 * y1[i] + a2 * y2[i]) >> 14;
-        y0[i] = MathUtil::Clamp(tmp, -32768, 32767);
-    }
-
-    x2 = x1;
-    x1 = x0;
-    y2 = y1;
-    y1 = y0;
-
-    return y0;
+void SourceFilters::BiquadFilter::ProcessFrame(StereoFrame16& frame) {
+    AudioCore::Kernels::BiquadFilter(state, frame.data(), frame.size());
 }
 
 } // namespace HLE
@@ -7,6 +7,7 @@
 #include <array>
 #include "audio_core/hle/common.h"
 #include "audio_core/hle/dsp.h"
+#include "audio_core/kernels.h"
 #include "common/common_types.h"
 
 namespace DSP {
@@ -68,17 +69,14 @@ private:
         void Configure(SourceConfiguration::Configuration::SimpleFilter config);
 
         /**
-         * Processes a single stereo PCM16 sample.
-         * @param x0 Input sample
-         * @return Output sample
+         * Processes a frame in-place.
+         * @param frame Audio samples to process. Modified in-place.
          */
-        std::array<s16, 2> ProcessSample(const std::array<s16, 2>& x0);
+        void ProcessFrame(StereoFrame16& frame);
 
     private:
-        // Configuration
-        s32 a1, b0;
-        // Internal state
-        std::array<s16, 2> y1;
+        // Configuration and internal state
+        AudioCore::Kernels::SimpleFilterState state;
     } simple_filter;
 
     struct BiquadFilter {
@@ -96,20 +94,14 @@ private:
         void Configure(SourceConfiguration::Configuration::BiquadFilter config);
 
         /**
-         * Processes a single stereo PCM16 sample.
-         * @param x0 Input sample
-         * @return Output sample
+         * Processes a frame in-place.
+         * @param frame Audio samples to process. Modified in-place.
          */
-        std::array<s16, 2> ProcessSample(const std::array<s16, 2>& x0);
+        void ProcessFrame(StereoFrame16& frame);
 
     private:
-        // Configuration
-        s32 a1, a2, b0, b1, b2;
-        // Internal state
-        std::array<s16, 2> x1;
-        std::array<s16, 2> x2;
-        std::array<s16, 2> y1;
-        std::array<s16, 2> y2;
+        // Configuration and internal state
+        AudioCore::Kernels::BiquadFilterState state;
     } biquad_filter;
 };
 
@@ -7,9 +7,9 @@
 #include "audio_core/hle/common.h"
 #include "audio_core/hle/dsp.h"
 #include "audio_core/hle/mixers.h"
+#include "audio_core/kernels.h"
 #include "common/assert.h"
 #include "common/logging/log.h"
-#include "common/math_util.h"
 
 namespace DSP {
 namespace HLE {
@@ -19,11 +19,9 @@ void Mixers::Reset() {
     state = {};
 }
 
-DspStatus Mixers::Tick(DspConfiguration& config, const IntermediateMixSamples& read_samples,
+DspStatus Mixers::Tick(const IntermediateMixSamples& read_samples,
                        IntermediateMixSamples& write_samples,
                        const std::array<QuadFrame32, 3>& input) {
-    ParseConfig(config);
-
     AuxReturn(read_samples);
     AuxSend(write_samples, input);
 
@@ -88,32 +86,13 @@ void Mixers::ParseConfig(DspConfiguration& config) {
     config.dirty_raw = 0;
 }
 
-static s16 ClampToS16(s32 value) {
-    return static_cast<s16>(MathUtil::Clamp(value, -32768, 32767));
-}
-
-static std::array<s16, 2> AddAndClampToS16(const std::array<s16, 2>& a,
-                                           const std::array<s16, 2>& b) {
-    return {ClampToS16(static_cast<s32>(a[0]) + static_cast<s32>(b[0])),
-            ClampToS16(static_cast<s32>(a[1]) + static_cast<s32>(b[1]))};
-}
-
 void Mixers::DownmixAndMixIntoCurrentFrame(float gain, const QuadFrame32& samples) {
     // TODO(merry): Limiter. (Currently we're performing final mixing assuming a disabled limiter.)
 
     switch (state.output_format) {
     case OutputFormat::Mono:
-        std::transform(
-            current_frame.begin(), current_frame.end(), samples.begin(), current_frame.begin(),
-            [gain](const std::array<s16, 2>& accumulator,
-                   const std::array<s32, 4>& sample) -> std::array<s16, 2> {
-                // Downmix to mono
-                s16 mono = ClampToS16(static_cast<s32>(
-                    (gain * sample[0] + gain * sample[1] + gain * sample[2] + gain * sample[3]) /
-                    2));
-                // Mix into current frame
-                return AddAndClampToS16(accumulator, {mono, mono});
-            });
+        AudioCore::Kernels::DownmixQuadToMono(current_frame.data(), samples.data(),
+                                              samples_per_frame, gain);
         return;
 
     case OutputFormat::Surround:
@@ -121,16 +100,8 @@ void Mixers::DownmixAndMixIntoCurrentFrame(float gain, const QuadFrame32& sample
     // fallthrough
 
     case OutputFormat::Stereo:
-        std::transform(
-            current_frame.begin(), current_frame.end(), samples.begin(), current_frame.begin(),
-            [gain](const std::array<s16, 2>& accumulator,
-                   const std::array<s32, 4>& sample) -> std::array<s16, 2> {
-                // Downmix to stereo
-                s16 left = ClampToS16(static_cast<s32>(gain * sample[0] + gain * sample[2]));
-                s16 right = ClampToS16(static_cast<s32>(gain * sample[1] + gain * sample[3]));
-                // Mix into current frame
-                return AddAndClampToS16(accumulator, {left, right});
-            });
+        AudioCore::Kernels::DownmixQuadToStereo(current_frame.data(), samples.data(),
+                                                samples_per_frame, gain);
         return;
     }
 
@@ -19,13 +19,22 @@ public:
 
     void Reset();
 
-    DspStatus Tick(DspConfiguration& config, const IntermediateMixSamples& read_samples,
+    /// Updates our internal state based on the current config, and clears its dirty flags. This is
+    /// called once every audio frame, before Tick.
+    void ParseConfig(DspConfiguration& config);
+
+    DspStatus Tick(const IntermediateMixSamples& read_samples,
                    IntermediateMixSamples& write_samples, const std::array<QuadFrame32, 3>& input);
 
     StereoFrame16 GetOutput() const {
         return current_frame;
     }
 
+    /// Whether Tick writes the output of intermediate mixer 1 or 2 to shared memory for the ARM11
+    bool IsAuxSendEnabled(size_t mix) const {
+        return mix == 1 ? state.mixer1_enabled : state.mixer2_enabled;
+    }
+
 private:
     StereoFrame16 current_frame = {};
 
@@ -42,8 +51,6 @@ private:
 
     } state;
 
-    /// INTERNAL: Update our internal state based on the current config.
-    void ParseConfig(DspConfiguration& config);
     /// INTERNAL: Read samples from shared memory that have been modified by the ARM11.
     void AuxReturn(const IntermediateMixSamples& read_samples);
     /// INTERNAL: Write samples to shared memory for the ARM11 to modify.
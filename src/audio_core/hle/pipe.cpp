@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <array>
+#include <cstring>
 #include <vector>
 #include "audio_core/hle/dsp.h"
 #include "audio_core/hle/pipe.h"
@@ -10,50 +11,101 @@
 #include "common/common_types.h"
 #include "common/logging/log.h"
 #include "core/hle/service/dsp_dsp.h"
+#include "core/memory.h"
 
 namespace DSP {
 namespace HLE {
 
 static DspState dsp_state = DspState::Off;
 
-static std::array<std::vector<u8>, NUM_DSP_PIPE> pipe_data;
+/// Data written to a pipe and not read yet. Reads advance through the data, whose storage is
+/// reused once it has all been read.
+struct PipeBuffer {
+    std::vector<u8> data;
+    size_t read_position = 0;
 
-void ResetPipes() {
-    for (auto& data : pipe_data) {
+    size_t Size() const {
+        return data.size() - read_position;
+    }
+
+    const u8* ReadPointer() const {
+        return data.data() + read_position;
+    }
+
+    void Consume(size_t length) {
+        read_position += length;
+        if (read_position == data.size()) {
+            data.clear();
+            read_position = 0;
+        }
+    }
+
+    void Clear() {
         data.clear();
+        read_position = 0;
+    }
+};
+
+static std::array<PipeBuffer, NUM_DSP_PIPE> pipe_data;
+
+void ResetPipes() {
+    for (auto& pipe : pipe_data) {
+        pipe.Clear();
     }
     dsp_state = DspState::Off;
 }
 
-std::vector<u8> PipeRead(DspPipe pipe_number, u32 length) {
+/**
+ * Validates a read from a pipe, limiting its length to the data available.
+ * @returns the pipe to read from, or nullptr if there is nothing to read.
+ */
+static PipeBuffer* GetPipeToRead(DspPipe pipe_number, u32& length) {
     const size_t pipe_index = static_cast<size_t>(pipe_number);
 
     if (pipe_index >= NUM_DSP_PIPE) {
         LOG_ERROR(Audio_DSP, "pipe_number = %zu invalid", pipe_index);
-        return {};
+        return nullptr;
     }
 
     if (length > UINT16_MAX) { // Can only read at most UINT16_MAX from the pipe
         LOG_ERROR(Audio_DSP, "length of %u greater than max of %u", length, UINT16_MAX);
-        return {};
+        return nullptr;
     }
 
-    std::vector<u8>& data = pipe_data[pipe_index];
+    PipeBuffer& pipe = pipe_data[pipe_index];
 
-    if (length > data.size()) {
+    if (length > pipe.Size()) {
         LOG_WARNING(
             Audio_DSP,
             "pipe_number = %zu is out of data, application requested read of %u but %zu remain",
-            pipe_index, length, data.size());
-        length = static_cast<u32>(data.size());
+            pipe_index, length, pipe.Size());
+        length = static_cast<u32>(pipe.Size());
     }
 
     if (length == 0)
-        return {};
+        return nullptr;
+
+    return &pipe;
+}
+
+size_t PipeRead(DspPipe pipe_number, u8* buffer, u32 length) {
+    PipeBuffer* pipe = GetPipeToRead(pipe_number, length);
+    if (!pipe)
+        return 0;
+
+    std::memcpy(buffer, pipe->ReadPointer(), length);
+    pipe->Consume(length);
+    return length;
+}
+
+size_t PipeReadToMemory(DspPipe pipe_number, VAddr address, u32 length) {
+    PipeBuffer* pipe = GetPipeToRead(pipe_number, length);
+    if (!pipe)
+        return 0;
 
-    std::vector<u8> ret(data.begin(), data.begin() + length);
-    data.erase(data.begin(), data.begin() + length);
-    return ret;
+    Memory::WriteBlock(address, pipe->ReadPointer(), length);
+    pipe->Consume(length);
+    return length;
 }
 
 size_t GetPipeReadableSize(DspPipe pipe_number) {
@@ -64,13 +116,13 @@ size_t GetPipeReadableSize(DspPipe pipe_number) {
         return 0;
     }
 
-    return pipe_data[pipe_index].size();
+    return pipe_data[pipe_index].Size();
 }
 
 static void WriteU16(DspPipe pipe_number, u16 value) {
     const size_t pipe_index = static_cast<size_t>(pipe_number);
 
-    std::vector<u8>& data = pipe_data.at(pipe_index);
+    std::vector<u8>& data = pipe_data.at(pipe_index).data;
     // Little endian
     data.emplace_back(value & 0xFF);
     data.emplace_back(value >> 8);
@@ -107,12 +159,12 @@ static void AudioPipeWriteStructAddresses() {
     Service::DSP_DSP::SignalPipeInterrupt(DspPipe::Audio);
 }
 
-void PipeWrite(DspPipe pipe_number, const std::vector<u8>& buffer) {
+void PipeWrite(DspPipe pipe_number, const u8* buffer, size_t length) {
     switch (pipe_number) {
     case DspPipe::Audio: {
-        if (buffer.size() != 4) {
+        if (length != 4) {
             LOG_ERROR(Audio_DSP, "DspPipe::Audio: Unexpected buffer length %zu was written",
-                      buffer.size());
+                      length);
             return;
         }
 
@@ -8,6 +8,7 @@
 #include "audio_core/hle/common.h"
 #include "audio_core/hle/source.h"
 #include "audio_core/interpolate.h"
+#include "audio_core/kernels.h"
 #include "common/assert.h"
 #include "common/logging/log.h"
 #include "core/memory.h"
@@ -15,10 +16,7 @@
 namespace DSP {
 namespace HLE {
 
-SourceStatus::Status Source::Tick(SourceConfiguration::Configuration& config,
-                                  const s16_le (&adpcm_coeffs)[16]) {
-    ParseConfig(config, adpcm_coeffs);
-
+SourceStatus::Status Source::Tick() {
     if (state.enabled) {
         GenerateFrame();
     }
@@ -30,19 +28,21 @@ void Source::MixInto(QuadFrame32& dest, size_t intermediate_mix_id) const {
     if (!state.enabled)
         return;
 
-    const std::array<float, 4>& gains = state.gain.at(intermediate_mix_id);
-    for (size_t samplei = 0; samplei < samples_per_frame; samplei++) {
-        // Conversion from stereo (current_frame) to quadraphonic (dest) occurs here.
-        dest[samplei][0] += static_cast<s32>(gains[0] * current_frame[samplei][0]);
-        dest[samplei][1] += static_cast<s32>(gains[1] * current_frame[samplei][1]);
-        dest[samplei][2] += static_cast<s32>(gains[2] * current_frame[samplei][0]);
-        dest[samplei][3] += static_cast<s32>(gains[3] * current_frame[samplei][1]);
-    }
+    // Conversion from stereo (current_frame) to quadraphonic (dest) occurs here.
+    AudioCore::Kernels::MixStereoIntoQuad(dest.data(), current_frame.data(), samples_per_frame,
+                                          state.gain.at(intermediate_mix_id));
 }
 
 void Source::Reset() {
     current_frame.fill({});
+
+    // Keep the storage of the buffer queue for the buffers to come
+    ClearQueue();
+    AudioCore::CountedVector<Buffer> input_queue = std::move(state.input_queue);
     state = {};
+    state.input_queue = std::move(input_queue);
+
+    current_buffer.clear();
 }
 
 void Source::ParseConfig(SourceConfiguration::Configuration& config,
@@ -59,7 +59,7 @@ void Source::ParseConfig(SourceConfiguration::Configuration& config,
 
     if (config.partial_reset_flag) {
         config.partial_reset_flag.Assign(0);
-        state.input_queue = std::priority_queue<Buffer, std::vector<Buffer>, BufferOrder>{};
+        ClearQueue();
         LOG_TRACE(Audio_DSP, "source_id=%zu partial_reset", source_id);
     }
 
@@ -168,8 +168,10 @@ void Source::ParseConfig(SourceConfiguration::Configuration& config,
 
     if (config.embedded_buffer_dirty) {
         config.embedded_buffer_dirty.Assign(0);
-        state.input_queue.emplace(Buffer{
+        EnqueueBuffer(Buffer{
             config.physical_address,
+            {},
+            false,
             config.length,
             static_cast<u8>(config.adpcm_ps),
             {config.adpcm_yn[0], config.adpcm_yn[1]},
@@ -198,8 +200,10 @@ void Source::ParseConfig(SourceConfiguration::Configuration& config,
         for (size_t i = 0; i < 4; i++) {
             if (config.buffers_dirty & (1 << i)) {
                 const auto& b = config.buffers[i];
-                state.input_queue.emplace(Buffer{
+                EnqueueBuffer(Buffer{
                     b.physical_address,
+                    {},
+                    false,
                     b.length,
                     static_cast<u8>(b.adpcm_ps),
                     {b.adpcm_yn[0], b.adpcm_yn[1]},
@@ -226,10 +230,60 @@ void Source::ParseConfig(SourceConfiguration::Configuration& config,
     config.dirty_raw = 0;
 }
 
+/// Size in bytes of the samples of a buffer
+static size_t GetBufferSize(SourceConfiguration::Configuration::Format format,
+                            SourceConfiguration::Configuration::MonoOrStereo mono_or_stereo,
+                            u32 length) {
+    using Format = SourceConfiguration::Configuration::Format;
+    using MonoOrStereo = SourceConfiguration::Configuration::MonoOrStereo;
+
+    const size_t num_channels = mono_or_stereo == MonoOrStereo::Stereo ? 2 : 1;
+    switch (format) {
+    case Format::PCM8:
+        return length * num_channels;
+    case Format::PCM16:
+        return length * num_channels * sizeof(s16);
+    case Format::ADPCM: {
+        // Frames of 14 samples are 8 bytes long, a header byte followed by two samples per byte.
+        // The last frame may be incomplete.
+        const size_t remaining_samples = length % 14;
+        return length / 14 * 8 + (remaining_samples != 0 ? 1 + (remaining_samples + 1) / 2 : 0);
+    }
+    default:
+        return 0;
+    }
+}
+
+void Source::EnqueueBuffer(Buffer buffer) {
+    // The samples are copied while the emulated application waits for the DSP, as it may reuse the
+    // memory of the buffer before the frames playing it are generated on the audio thread
+    const u8* const memory = Memory::GetPhysicalPointer(buffer.physical_address);
+    if (memory) {
+        if (!free_buffer_data.empty()) {
+            buffer.data = std::move(free_buffer_data.back());
+            free_buffer_data.pop_back();
+        }
+        const size_t size = GetBufferSize(buffer.format, buffer.mono_or_stereo, buffer.length);
+        buffer.data.assign(memory, memory + size);
+        buffer.is_valid = true;
+    }
+
+    state.input_queue.push_back(std::move(buffer));
+    std::push_heap(state.input_queue.begin(), state.input_queue.end(), BufferOrder{});
+}
+
+void Source::ClearQueue() {
+    for (Buffer& buffer : state.input_queue) {
+        if (buffer.data.capacity() != 0)
+            free_buffer_data.push_back(std::move(buffer.data));
+    }
+    state.input_queue.clear();
+}
+
 void Source::GenerateFrame() {
     current_frame.fill({});
 
-    if (state.current_buffer.empty() && !DequeueBuffer()) {
+    if (state.current_buffer_position == current_buffer.size() && !DequeueBuffer()) {
         state.enabled = false;
         state.buffer_update = true;
         state.current_buffer_id = 0;
@@ -240,17 +294,16 @@ void Source::GenerateFrame() {
 
     state.current_sample_number = state.next_sample_number;
     while (frame_position < current_frame.size()) {
-        if (state.current_buffer.empty() && !DequeueBuffer()) {
+        if (state.current_buffer_position == current_buffer.size() && !DequeueBuffer()) {
             break;
         }
 
-        const size_t size_to_copy =
-            std::min(state.current_buffer.size(), current_frame.size() - frame_position);
+        const size_t size_to_copy = std::min(current_buffer.size() - state.current_buffer_position,
+                                             current_frame.size() - frame_position);
 
-        std::copy(state.current_buffer.begin(), state.current_buffer.begin() + size_to_copy,
-                  current_frame.begin() + frame_position);
-        state.current_buffer.erase(state.current_buffer.begin(),
-                                   state.current_buffer.begin() + size_to_copy);
+        const auto begin = current_buffer.begin() + state.current_buffer_position;
+        std::copy(begin, begin + size_to_copy, current_frame.begin() + frame_position);
+        state.current_buffer_position += size_to_copy;
 
         frame_position += size_to_copy;
         state.next_sample_number += static_cast<u32>(size_to_copy);
@@ -260,64 +313,71 @@ void Source::GenerateFrame() {
 }
 
 bool Source::DequeueBuffer() {
-    ASSERT_MSG(state.current_buffer.empty(),
+    ASSERT_MSG(state.current_buffer_position == current_buffer.size(),
                "Shouldn't dequeue; we still have data in current_buffer");
 
     if (state.input_queue.empty())
         return false;
 
-    Buffer buf = state.input_queue.top();
-
     // if we're in a loop, the current sound keeps playing afterwards, so leave the queue alone
-    if (!buf.is_looping) {
-        state.input_queue.pop();
+    const bool is_looping = state.input_queue.front().is_looping;
+    if (!is_looping) {
+        std::pop_heap(state.input_queue.begin(), state.input_queue.end(), BufferOrder{});
+        if (dequeued_buffer.data.capacity() != 0)
+            free_buffer_data.push_back(std::move(dequeued_buffer.data));
+        dequeued_buffer = std::move(state.input_queue.back());
+        state.input_queue.pop_back();
     }
+    const Buffer& buf = is_looping ? state.input_queue.front() : dequeued_buffer;
+
+    current_buffer.clear();
+    state.current_buffer_position = 0;
 
     if (buf.adpcm_dirty) {
         state.adpcm_state.yn1 = buf.adpcm_yn[0];
         state.adpcm_state.yn2 = buf.adpcm_yn[1];
     }
 
-    const u8* const memory = Memory::GetPhysicalPointer(buf.physical_address);
-    if (memory) {
+    if (buf.is_valid) {
+        const u8* const memory = buf.data.data();
         const unsigned num_channels = buf.mono_or_stereo == MonoOrStereo::Stereo ? 2 : 1;
         switch (buf.format) {
         case Format::PCM8:
-            state.current_buffer = Codec::DecodePCM8(num_channels, memory, buf.length);
+            Codec::DecodePCM8(num_channels, memory, buf.length, decode_buffer);
             break;
         case Format::PCM16:
-            state.current_buffer = Codec::DecodePCM16(num_channels, memory, buf.length);
+            Codec::DecodePCM16(num_channels, memory, buf.length, decode_buffer);
             break;
         case Format::ADPCM:
             DEBUG_ASSERT(num_channels == 1);
-            state.current_buffer =
-                Codec::DecodeADPCM(memory, buf.length, state.adpcm_coeffs, state.adpcm_state);
+            Codec::DecodeADPCM(memory, buf.length, state.adpcm_coeffs, state.adpcm_state,
+                               decode_buffer);
             break;
         default:
             UNIMPLEMENTED();
+            decode_buffer.clear();
             break;
         }
     } else {
         LOG_WARNING(Audio_DSP,
                     "source_id=%zu buffer_id=%hu length=%u: Invalid physical address 0x%08X",
                     source_id, buf.buffer_id, buf.length, buf.physical_address);
-        state.current_buffer.clear();
         return true;
     }
 
     switch (state.interpolation_mode) {
     case InterpolationMode::None:
-        state.current_buffer =
-            AudioInterp::None(state.interp_state, state.current_buffer, state.rate_multiplier);
+        AudioInterp::None(state.interp_state, decode_buffer, state.rate_multiplier,
+                          current_buffer);
         break;
     case InterpolationMode::Linear:
-        state.current_buffer =
-            AudioInterp::Linear(state.interp_state, state.current_buffer, state.rate_multiplier);
+        AudioInterp::Linear(state.interp_state, decode_buffer, state.rate_multiplier,
+                            current_buffer);
         break;
     case InterpolationMode::Polyphase:
         // TODO(merry): Implement polyphase interpolation
-        state.current_buffer =
-            AudioInterp::Linear(state.interp_state, state.current_buffer, state.rate_multiplier);
+        AudioInterp::Linear(state.interp_state, decode_buffer, state.rate_multiplier,
+                            current_buffer);
         break;
     default:
         UNIMPLEMENTED();
@@ -330,11 +390,9 @@ bool Source::DequeueBuffer() {
     state.current_buffer_id = buf.buffer_id;
     state.buffer_update = buf.from_queue && !buf.has_played;
 
-    buf.has_played = true;
-
     LOG_TRACE(Audio_DSP, "source_id=%zu buffer_id=%hu from_queue=%s current_buffer.size()=%zu",
               source_id, buf.buffer_id, buf.from_queue ? "true" : "false",
-              state.current_buffer.size());
+              current_buffer.size());
     return true;
 }
 
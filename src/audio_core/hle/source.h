@@ -5,9 +5,8 @@
 #pragma once
 
 #include <array>
-#include <queue>
-#include <vector>
 #include "audio_core/codec.h"
+#include "audio_core/counting_allocator.h"
 #include "audio_core/hle/common.h"
 #include "audio_core/hle/dsp.h"
 #include "audio_core/hle/filter.h"
@@ -36,15 +35,23 @@ public:
     void Reset();
 
     /**
-     * This is called once every audio frame. This performs per-source processing every frame.
-     * @param config The new configuration we've got for this Source from the application.
+     * Updates the state of this Source from the configuration given by the application. This is
+     * called once every audio frame, before Tick.
+     * @param config The new configuration we've got for this Source from the application. Its
+     * dirty flags are cleared.
      * @param adpcm_coeffs ADPCM coefficients to use if config tells us to use them (may contain
      * invalid values otherwise).
+     */
+    void ParseConfig(SourceConfiguration::Configuration& config, const s16_le (&adpcm_coeffs)[16]);
+
+    /**
+     * This is called once every audio frame. This performs per-source processing every frame.
+     * It only accesses the state of this Source, the samples of its buffers having been copied
+     * out of the guest memory when they were queued.
      * @return The current status of this Source. This is given back to the emulated application via
      * SharedMemory.
      */
-    SourceStatus::Status Tick(SourceConfiguration::Configuration& config,
-                              const s16_le (&adpcm_coeffs)[16]);
+    SourceStatus::Status Tick();
 
     /**
      * Mix this source's output into dest, using the gains for the `intermediate_mix_id`-th
@@ -65,6 +72,10 @@ private:
     /// Internal representation of a buffer for our buffer queue
     struct Buffer {
         PAddr physical_address;
+        /// Samples of the buffer, copied from the guest memory when it was queued
+        AudioCore::CountedVector<u8> data;
+        /// False if physical_address isn't valid, leaving data empty
+        bool is_valid;
         u32 length;
         u8 adpcm_ps;
         std::array<u16, 2> adpcm_yn;
@@ -100,7 +111,8 @@ private:
 
         // Buffer queue
 
-        std::priority_queue<Buffer, std::vector<Buffer>, BufferOrder> input_queue;
+        /// Heap ordered by BufferOrder, whose storage is kept across resets.
+        AudioCore::CountedVector<Buffer> input_queue;
         MonoOrStereo mono_or_stereo = MonoOrStereo::Mono;
         Format format = Format::ADPCM;
 
@@ -108,7 +120,8 @@ private:
 
         u32 current_sample_number = 0;
         u32 next_sample_number = 0;
-        std::vector<std::array<s16, 2>> current_buffer;
+        /// Samples of current_buffer before this position have already been played.
+        size_t current_buffer_position = 0;
 
         // buffer_id state
 
@@ -132,10 +145,25 @@ private:
 
     } state;
 
+    // Buffers whose storage is reused from buffer to buffer, so that steady-state playback does
+    // not allocate. They are not part of the state above because resetting it would free them.
+
+    /// Decoded and resampled samples of the current buffer.
+    AudioInterp::StereoBuffer16 current_buffer;
+    /// Decoded samples of the current buffer before resampling.
+    Codec::StereoBuffer16 decode_buffer;
+    /// The non-looping buffer dequeued last.
+    Buffer dequeued_buffer;
+    /// Storage of the data of buffers which aren't queued anymore.
+    AudioCore::CountedVector<AudioCore::CountedVector<u8>> free_buffer_data;
+
     // Internal functions
 
-    /// INTERNAL: Update our internal state based on the current config.
-    void ParseConfig(SourceConfiguration::Configuration& config, const s16_le (&adpcm_coeffs)[16]);
+    /// INTERNAL: Queues a buffer, copying its samples out of the guest memory.
+    void EnqueueBuffer(Buffer buffer);
+    /// INTERNAL: Empties the buffer queue, keeping the storage of the buffers.
+    void ClearQueue();
+
     /// INTERNAL: Generate the current audio output for this frame based on our internal state.
     void GenerateFrame();
     /// INTERNAL: Dequeues a buffer and does preprocessing on it (decoding, resampling). Puts it
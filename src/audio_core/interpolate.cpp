@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include "audio_core/interpolate.h"
+#include "audio_core/kernels.h"
 #include "common/assert.h"
 #include "common/math_util.h"
 
@@ -14,16 +15,19 @@ constexpr u64 scale_factor = 1 << 24;
 constexpr u64 scale_mask = scale_factor - 1;
 
 /// Here we step over the input in steps of rate_multiplier, until we consume all of the input.
-/// Three adjacent samples are passed to fn each step.
-template <typename Function>
-static StereoBuffer16 StepOverSamples(State& state, const StereoBuffer16& input,
-                                      float rate_multiplier, Function fn) {
+/// Three adjacent samples are passed to fn each step, until the samples of the previous frame are
+/// consumed. The rest of the output is then produced at once by
+/// bulk_fn(input, position, step, output, count), interpolating between input[index - 2] and
+/// input[index - 1].
+template <typename Function, typename BulkFunction>
+static void StepOverSamples(State& state, const StereoBuffer16& input, float rate_multiplier,
+                            StereoBuffer16& output, Function fn, BulkFunction bulk_fn) {
     ASSERT(rate_multiplier > 0);
 
+    output.clear();
     if (input.size() < 2)
-        return {};
+        return;
 
-    StereoBuffer16 output;
     output.reserve(static_cast<size_t>(input.size() / rate_multiplier));
 
     u64 step_size = static_cast<u64>(rate_multiplier * scale_factor);
@@ -47,40 +51,45 @@ static StereoBuffer16 StepOverSamples(State& state, const StereoBuffer16& input,
         fposition += step_size;
     }
 
-    while (fposition < max_fposition) {
-        u64 fraction = fposition & scale_mask;
-
-        size_t index = static_cast<size_t>(fposition / scale_factor);
-        output.push_back(fn(fraction, input[index - 2], input[index - 1], input[index]));
-
-        fposition += step_size;
+    if (fposition < max_fposition) {
+        const size_t count =
+            static_cast<size_t>((max_fposition - fposition + step_size - 1) / step_size);
+        const size_t offset = output.size();
+        output.resize(offset + count);
+        bulk_fn(input.data(), fposition, step_size, output.data() + offset, count);
     }
 
     state.xn2 = input[input.size() - 2];
     state.xn1 = input[input.size() - 1];
-
-    return output;
 }
 
-StereoBuffer16 None(State& state, const StereoBuffer16& input, float rate_multiplier) {
-    return StepOverSamples(
-        state, input, rate_multiplier,
-        [](u64 fraction, const auto& x0, const auto& x1, const auto& x2) { return x0; });
+void None(State& state, const StereoBuffer16& input, float rate_multiplier,
+          StereoBuffer16& output) {
+    StepOverSamples(
+        state, input, rate_multiplier, output,
+        [](u64 fraction, const auto& x0, const auto& x1, const auto& x2) { return x0; },
+        [](const std::array<s16, 2>* input, u64 position, u64 step, std::array<s16, 2>* output,
+           size_t count) {
+            for (size_t i = 0; i < count; i++, position += step)
+                output[i] = input[position / scale_factor - 2];
+        });
 }
 
-StereoBuffer16 Linear(State& state, const StereoBuffer16& input, float rate_multiplier) {
+void Linear(State& state, const StereoBuffer16& input, float rate_multiplier,
+            StereoBuffer16& output) {
     // Note on accuracy: Some values that this produces are +/- 1 from the actual firmware.
-    return StepOverSamples(state, input, rate_multiplier,
-                           [](u64 fraction, const auto& x0, const auto& x1, const auto& x2) {
-                               // This is a saturated subtraction. (Verified by black-box fuzzing.)
-                               s64 delta0 = MathUtil::Clamp<s64>(x1[0] - x0[0], -32768, 32767);
-                               s64 delta1 = MathUtil::Clamp<s64>(x1[1] - x0[1], -32768, 32767);
-
-                               return std::array<s16, 2>{
-                                   static_cast<s16>(x0[0] + fraction * delta0 / scale_factor),
-                                   static_cast<s16>(x0[1] + fraction * delta1 / scale_factor),
-                               };
-                           });
+    StepOverSamples(state, input, rate_multiplier, output,
+                    [](u64 fraction, const auto& x0, const auto& x1, const auto& x2) {
+                        // This is a saturated subtraction. (Verified by black-box fuzzing.)
+                        s64 delta0 = MathUtil::Clamp<s64>(x1[0] - x0[0], -32768, 32767);
+                        s64 delta1 = MathUtil::Clamp<s64>(x1[1] - x0[1], -32768, 32767);
+
+                        return std::array<s16, 2>{
+                            static_cast<s16>(x0[0] + fraction * delta0 / scale_factor),
+                            static_cast<s16>(x0[1] + fraction * delta1 / scale_factor),
+                        };
+                    },
+                    AudioCore::Kernels::InterpolateLinear);
 }
 
 } // namespace AudioInterp
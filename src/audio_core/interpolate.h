@@ -5,13 +5,13 @@
 #pragma once
 
 #include <array>
-#include <vector>
+#include "audio_core/counting_allocator.h"
 #include "common/common_types.h"
 
 namespace AudioInterp {
 
 /// A variable length buffer of signed PCM16 stereo samples.
-using StereoBuffer16 = std::vector<std::array<s16, 2>>;
+using StereoBuffer16 = AudioCore::CountedVector<std::array<s16, 2>>;
 
 struct State {
     // Two historical samples.
@@ -26,9 +26,10 @@ struct State {
  * @param rate_multiplier Stretch factor. Must be a positive non-zero value.
  *                        rate_multiplier > 1.0 performs decimation and rate_multipler < 1.0
  *                        performs upsampling.
- * @return The resampled audio buffer.
+ * @param output Receives the resampled audio. Its storage is reused.
  */
-StereoBuffer16 None(State& state, const StereoBuffer16& input, float rate_multiplier);
+void None(State& state, const StereoBuffer16& input, float rate_multiplier,
+          StereoBuffer16& output);
 
 /**
  * Linear interpolation. This is equivalent to a first-order hold. There is a two-sample predelay.
@@ -37,8 +38,9 @@ StereoBuffer16 None(State& state, const StereoBuffer16& input, float rate_multip
  * @param rate_multiplier Stretch factor. Must be a positive non-zero value.
  *                        rate_multiplier > 1.0 performs decimation and rate_multipler < 1.0
  *                        performs upsampling.
- * @return The resampled audio buffer.
+ * @param output Receives the resampled audio. Its storage is reused.
  */
-StereoBuffer16 Linear(State& state, const StereoBuffer16& input, float rate_multiplier);
+void Linear(State& state, const StereoBuffer16& input, float rate_multiplier,
+            StereoBuffer16& output);
 
 } // namespace AudioInterp
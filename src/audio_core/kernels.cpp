@@ -0,0 +1,503 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+#include "audio_core/kernels.h"
+#include "common/math_util.h"
+
+namespace AudioCore {
+namespace Kernels {
+
+static s16 ClampToS16(s32 value) {
+    return static_cast<s16>(MathUtil::Clamp(value, -32768, 32767));
+}
+
+static bool FitsInS16(s32 value) {
+    return value >= -32768 && value <= 32767;
+}
+
+#ifdef ARCHITECTURE_x86_64
+static __m128i LoadStereo(const std::array<s16, 2>& sample) {
+    u32 value;
+    std::memcpy(&value, sample.data(), sizeof(value));
+    return _mm_cvtsi32_si128(static_cast<int>(value));
+}
+
+static void StoreStereo(std::array<s16, 2>& sample, __m128i value) {
+    const u32 low = static_cast<u32>(_mm_cvtsi128_si32(value));
+    std::memcpy(sample.data(), &low, sizeof(low));
+}
+
+/// Sign-extends the four lower 16-bit lanes to 32 bits
+static __m128i ExtendLow16To32(__m128i value) {
+    return _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), value), 16);
+}
+
+/// Sign-extends the four upper 16-bit lanes to 32 bits
+static __m128i ExtendHigh16To32(__m128i value) {
+    return _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), value), 16);
+}
+#endif
+
+// ADPCM decoding
+
+// GC-ADPCM with scale factor and variable coefficients.
+// Frames are 8 bytes long containing 14 samples each.
+// Samples are 4 bits (one nibble) long.
+constexpr size_t ADPCM_FRAME_LEN = 8;
+constexpr size_t ADPCM_SAMPLES_PER_FRAME = 14;
+
+void DecodeADPCMGeneric(const u8* data, size_t sample_count, const std::array<s16, 16>& coeffs,
+                        s16& yn1_, s16& yn2_, std::array<s16, 2>* output) {
+    constexpr std::array<int, 16> SIGNED_NIBBLES = {
+        {0, 1, 2, 3, 4, 5, 6, 7, -8, -7, -6, -5, -4, -3, -2, -1}};
+
+    int yn1 = yn1_, yn2 = yn2_;
+
+    const size_t num_frames =
+        (sample_count + (ADPCM_SAMPLES_PER_FRAME - 1)) / ADPCM_SAMPLES_PER_FRAME; // Round up.
+    for (size_t framei = 0; framei < num_frames; framei++) {
+        const int frame_header = data[framei * ADPCM_FRAME_LEN];
+        const int scale = 1 << (frame_header & 0xF);
+        const int idx = (frame_header >> 4) & 0x7;
+
+        // Coefficients are fixed point with 11 bits fractional part.
+        const int coef1 = coeffs[idx * 2 + 0];
+        const int coef2 = coeffs[idx * 2 + 1];
+
+        // Decodes an audio sample. One nibble produces one sample.
+        const auto decode_sample = [&](const int nibble) -> s16 {
+            const int xn = nibble * scale;
+            // We first transform everything into 11 bit fixed point, perform the second order
+            // digital filter, then transform back.
+            // 0x400 == 0.5 in 11 bit fixed point.
+            // Filter: y[n] = x[n] + 0.5 + c1 * y[n-1] + c2 * y[n-2]
+            int val = ((xn << 11) + 0x400 + coef1 * yn1 + coef2 * yn2) >> 11;
+            // Clamp to output range.
+            val = MathUtil::Clamp(val, -32768, 32767);
+            // Advance output feedback.
+            yn2 = yn1;
+            yn1 = val;
+            return (s16)val;
+        };
+
+        size_t outputi = framei * ADPCM_SAMPLES_PER_FRAME;
+        size_t datai = framei * ADPCM_FRAME_LEN + 1;
+        for (size_t i = 0; i < ADPCM_SAMPLES_PER_FRAME && outputi < sample_count; i += 2) {
+            const s16 sample1 = decode_sample(SIGNED_NIBBLES[data[datai] >> 4]);
+            output[outputi].fill(sample1);
+            outputi++;
+
+            const s16 sample2 = decode_sample(SIGNED_NIBBLES[data[datai] & 0xF]);
+            output[outputi].fill(sample2);
+            outputi++;
+
+            datai++;
+        }
+    }
+
+    yn1_ = static_cast<s16>(yn1);
+    yn2_ = static_cast<s16>(yn2);
+}
+
+#ifdef ARCHITECTURE_x86_64
+void DecodeADPCM(const u8* data, size_t sample_count, const std::array<s16, 16>& coeffs, s16& yn1_,
+                 s16& yn2_, std::array<s16, 2>* output) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i nibble_mask = _mm_set1_epi8(0xF);
+    const __m128i half = _mm_set1_epi32(0x400);
+
+    int yn1 = yn1_, yn2 = yn2_;
+
+    const size_t num_frames =
+        (sample_count + (ADPCM_SAMPLES_PER_FRAME - 1)) / ADPCM_SAMPLES_PER_FRAME; // Round up.
+    for (size_t framei = 0; framei < num_frames; framei++) {
+        const u8* frame = data + framei * ADPCM_FRAME_LEN;
+        const int shift = frame[0] & 0xF;
+        const int idx = (frame[0] >> 4) & 0x7;
+        const int coef1 = coeffs[idx * 2 + 0];
+        const int coef2 = coeffs[idx * 2 + 1];
+
+        // Each byte holds two samples, and the last frame may be incomplete
+        const size_t first_sample = framei * ADPCM_SAMPLES_PER_FRAME;
+        const size_t num_bytes = std::min<size_t>(ADPCM_SAMPLES_PER_FRAME / 2,
+                                                  (sample_count - first_sample + 1) / 2);
+        u8 bytes[8] = {};
+        std::memcpy(bytes, frame + 1, num_bytes);
+
+        // The non-recursive part of the filter, x[n] + 0.5 in 11 bit fixed point, is computed for
+        // the whole frame at once. The nibbles are split with the high one first, sign-extended
+        // and scaled.
+        const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(bytes));
+        const __m128i high = _mm_and_si128(_mm_srli_epi16(packed, 4), nibble_mask);
+        const __m128i low = _mm_and_si128(packed, nibble_mask);
+        const __m128i nibbles = _mm_unpacklo_epi8(high, low);
+        const auto SignExtendNibbles = [](__m128i nibbles) {
+            return _mm_srai_epi16(_mm_slli_epi16(nibbles, 12), 12);
+        };
+        const __m128i nibbles_0_7 = SignExtendNibbles(_mm_unpacklo_epi8(nibbles, zero));
+        const __m128i nibbles_8_15 = SignExtendNibbles(_mm_unpackhi_epi8(nibbles, zero));
+        const __m128i scale_shift = _mm_cvtsi32_si128(shift + 11);
+
+        alignas(16) s32 xn[16];
+        const auto StoreScaled = [&](s32* dest, __m128i values) {
+            _mm_store_si128(reinterpret_cast<__m128i*>(dest),
+                            _mm_add_epi32(_mm_sll_epi32(values, scale_shift), half));
+        };
+        StoreScaled(xn + 0, ExtendLow16To32(nibbles_0_7));
+        StoreScaled(xn + 4, ExtendHigh16To32(nibbles_0_7));
+        StoreScaled(xn + 8, ExtendLow16To32(nibbles_8_15));
+        StoreScaled(xn + 12, ExtendHigh16To32(nibbles_8_15));
+
+        // The recursive part depends on the previous samples and is done one sample at a time
+        for (size_t i = 0; i < num_bytes * 2; i++) {
+            int val = (xn[i] + coef1 * yn1 + coef2 * yn2) >> 11;
+            val = MathUtil::Clamp(val, -32768, 32767);
+            yn2 = yn1;
+            yn1 = val;
+            output[first_sample + i].fill(static_cast<s16>(val));
+        }
+    }
+
+    yn1_ = static_cast<s16>(yn1);
+    yn2_ = static_cast<s16>(yn2);
+}
+#else
+void DecodeADPCM(const u8* data, size_t sample_count, const std::array<s16, 16>& coeffs, s16& yn1,
+                 s16& yn2, std::array<s16, 2>* output) {
+    DecodeADPCMGeneric(data, sample_count, coeffs, yn1, yn2, output);
+}
+#endif
+
+// Interpolation
+
+// Calculations are done in fixed point with 24 fractional bits.
+constexpr u64 scale_factor = 1 << 24;
+constexpr u64 scale_mask = scale_factor - 1;
+
+void InterpolateLinearGeneric(const std::array<s16, 2>* input, u64 position, u64 step,
+                              std::array<s16, 2>* output, size_t count) {
+    for (size_t i = 0; i < count; i++, position += step) {
+        const u64 fraction = position & scale_mask;
+        const size_t index = static_cast<size_t>(position / scale_factor);
+        const std::array<s16, 2>& x0 = input[index - 2];
+        const std::array<s16, 2>& x1 = input[index - 1];
+
+        // This is a saturated subtraction. (Verified by black-box fuzzing.)
+        s64 delta0 = MathUtil::Clamp<s64>(x1[0] - x0[0], -32768, 32767);
+        s64 delta1 = MathUtil::Clamp<s64>(x1[1] - x0[1], -32768, 32767);
+
+        output[i] = {
+            static_cast<s16>(x0[0] + fraction * delta0 / scale_factor),
+            static_cast<s16>(x0[1] + fraction * delta1 / scale_factor),
+        };
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+void InterpolateLinear(const std::array<s16, 2>* input, u64 position, u64 step,
+                       std::array<s16, 2>* output, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+
+    // The generic code computes x0 + floor(fraction * delta / 2^24), whose product doesn't fit
+    // in 32 bits. With fraction split into its upper and lower 12 bits, this is equal to
+    // x0 + ((fraction_high * delta + ((fraction_low * delta) >> 12)) >> 12), which does.
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        alignas(16) std::array<s16, 2> x0[4];
+        alignas(16) std::array<s16, 2> x1[4];
+        int fraction_high[4];
+        int fraction_low[4];
+        for (size_t j = 0; j < 4; j++, position += step) {
+            const size_t index = static_cast<size_t>(position / scale_factor);
+            x0[j] = input[index - 2];
+            x1[j] = input[index - 1];
+            fraction_high[j] = static_cast<int>((position & scale_mask) >> 12);
+            fraction_low[j] = static_cast<int>(position & 0xFFF);
+        }
+
+        const __m128i x0_values = _mm_load_si128(reinterpret_cast<const __m128i*>(x0));
+        const __m128i x1_values = _mm_load_si128(reinterpret_cast<const __m128i*>(x1));
+        const __m128i delta = _mm_subs_epi16(x1_values, x0_values);
+
+        // Multiplies the deltas of two samples, zero-extended to 32 bits, by their fractions
+        const auto Multiply = [](__m128i delta, int fraction_0, int fraction_1) {
+            return _mm_madd_epi16(delta,
+                                  _mm_set_epi32(fraction_1, fraction_1, fraction_0, fraction_0));
+        };
+        const auto Interpolate = [&](__m128i delta, __m128i x0, size_t first) {
+            const __m128i high = Multiply(delta, fraction_high[first], fraction_high[first + 1]);
+            const __m128i low = Multiply(delta, fraction_low[first], fraction_low[first + 1]);
+            const __m128i product = _mm_add_epi32(high, _mm_srai_epi32(low, 12));
+            return _mm_add_epi32(x0, _mm_srai_epi32(product, 12));
+        };
+        const __m128i result_0_1 = Interpolate(_mm_unpacklo_epi16(delta, zero),
+                                               ExtendLow16To32(x0_values), 0);
+        const __m128i result_2_3 = Interpolate(_mm_unpackhi_epi16(delta, zero),
+                                               ExtendHigh16To32(x0_values), 2);
+
+        // The interpolated values lie between x0 and x0 + delta, so this doesn't saturate
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i),
+                         _mm_packs_epi32(result_0_1, result_2_3));
+    }
+
+    InterpolateLinearGeneric(input, position, step, output + i, count - i);
+}
+#else
+void InterpolateLinear(const std::array<s16, 2>* input, u64 position, u64 step,
+                       std::array<s16, 2>* output, size_t count) {
+    InterpolateLinearGeneric(input, position, step, output, count);
+}
+#endif
+
+// Mixing
+
+void MixStereoIntoQuadGeneric(std::array<s32, 4>* dest, const std::array<s16, 2>* input,
+                              size_t count, const std::array<float, 4>& gains) {
+    for (size_t samplei = 0; samplei < count; samplei++) {
+        // Conversion from stereo (input) to quadraphonic (dest) occurs here.
+        dest[samplei][0] += static_cast<s32>(gains[0] * input[samplei][0]);
+        dest[samplei][1] += static_cast<s32>(gains[1] * input[samplei][1]);
+        dest[samplei][2] += static_cast<s32>(gains[2] * input[samplei][0]);
+        dest[samplei][3] += static_cast<s32>(gains[3] * input[samplei][1]);
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+void MixStereoIntoQuad(std::array<s32, 4>* dest, const std::array<s16, 2>* input, size_t count,
+                       const std::array<float, 4>& gains) {
+    const __m128 gain = _mm_loadu_ps(gains.data());
+    const auto MixSample = [&gain](std::array<s32, 4>& dest, __m128i sample) {
+        __m128i* dest_pointer = reinterpret_cast<__m128i*>(dest.data());
+        const __m128i scaled = _mm_cvttps_epi32(_mm_mul_ps(gain, _mm_cvtepi32_ps(sample)));
+        _mm_storeu_si128(dest_pointer, _mm_add_epi32(_mm_loadu_si128(dest_pointer), scaled));
+    };
+
+    size_t samplei = 0;
+    for (; samplei + 2 <= count; samplei += 2) {
+        // Left and right channels of two samples, each duplicated to the four channels
+        const __m128i samples = ExtendLow16To32(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input + samplei)));
+        MixSample(dest[samplei], _mm_shuffle_epi32(samples, _MM_SHUFFLE(1, 0, 1, 0)));
+        MixSample(dest[samplei + 1], _mm_shuffle_epi32(samples, _MM_SHUFFLE(3, 2, 3, 2)));
+    }
+
+    MixStereoIntoQuadGeneric(dest + samplei, input + samplei, count - samplei, gains);
+}
+#else
+void MixStereoIntoQuad(std::array<s32, 4>* dest, const std::array<s16, 2>* input, size_t count,
+                       const std::array<float, 4>& gains) {
+    MixStereoIntoQuadGeneric(dest, input, count, gains);
+}
+#endif
+
+// Downmixing
+
+void DownmixQuadToStereoGeneric(std::array<s16, 2>* dest, const std::array<s32, 4>* input,
+                                size_t count, float gain) {
+    for (size_t samplei = 0; samplei < count; samplei++) {
+        const std::array<s32, 4>& sample = input[samplei];
+        s16 left = ClampToS16(static_cast<s32>(gain * sample[0] + gain * sample[2]));
+        s16 right = ClampToS16(static_cast<s32>(gain * sample[1] + gain * sample[3]));
+        dest[samplei] = {ClampToS16(static_cast<s32>(dest[samplei][0]) + left),
+                         ClampToS16(static_cast<s32>(dest[samplei][1]) + right)};
+    }
+}
+
+void DownmixQuadToMonoGeneric(std::array<s16, 2>* dest, const std::array<s32, 4>* input,
+                              size_t count, float gain) {
+    for (size_t samplei = 0; samplei < count; samplei++) {
+        const std::array<s32, 4>& sample = input[samplei];
+        s16 mono = ClampToS16(static_cast<s32>(
+            (gain * sample[0] + gain * sample[1] + gain * sample[2] + gain * sample[3]) / 2));
+        dest[samplei] = {ClampToS16(static_cast<s32>(dest[samplei][0]) + mono),
+                         ClampToS16(static_cast<s32>(dest[samplei][1]) + mono)};
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+/// Loads a quadraphonic sample and scales it by gain
+static __m128 LoadScaledQuad(const std::array<s32, 4>& sample, __m128 gain) {
+    const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sample.data()));
+    return _mm_mul_ps(gain, _mm_cvtepi32_ps(value));
+}
+
+/// Adds samples to four stereo samples of dest with saturation
+static void MixIntoStereo(std::array<s16, 2>* dest, __m128i samples) {
+    __m128i* dest_pointer = reinterpret_cast<__m128i*>(dest);
+    _mm_storeu_si128(dest_pointer, _mm_adds_epi16(_mm_loadu_si128(dest_pointer), samples));
+}
+
+void DownmixQuadToStereo(std::array<s16, 2>* dest, const std::array<s32, 4>* input, size_t count,
+                         float gain) {
+    const __m128 gain_vector = _mm_set1_ps(gain);
+    // Sums channels 0 and 2 and channels 1 and 3 of two samples
+    const auto Downmix = [&](const std::array<s32, 4>* input) {
+        const __m128 sample_0 = LoadScaledQuad(input[0], gain_vector);
+        const __m128 sample_1 = LoadScaledQuad(input[1], gain_vector);
+        const __m128 channels_0_1 = _mm_shuffle_ps(sample_0, sample_1, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m128 channels_2_3 = _mm_shuffle_ps(sample_0, sample_1, _MM_SHUFFLE(3, 2, 3, 2));
+        return _mm_cvttps_epi32(_mm_add_ps(channels_0_1, channels_2_3));
+    };
+
+    size_t samplei = 0;
+    for (; samplei + 4 <= count; samplei += 4) {
+        const __m128i stereo_0_1 = Downmix(input + samplei);
+        const __m128i stereo_2_3 = Downmix(input + samplei + 2);
+        MixIntoStereo(dest + samplei, _mm_packs_epi32(stereo_0_1, stereo_2_3));
+    }
+
+    DownmixQuadToStereoGeneric(dest + samplei, input + samplei, count - samplei, gain);
+}
+
+void DownmixQuadToMono(std::array<s16, 2>* dest, const std::array<s32, 4>* input, size_t count,
+                       float gain) {
+    const __m128 gain_vector = _mm_set1_ps(gain);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    size_t samplei = 0;
+    for (; samplei + 4 <= count; samplei += 4) {
+        __m128 channel_0 = LoadScaledQuad(input[samplei], gain_vector);
+        __m128 channel_1 = LoadScaledQuad(input[samplei + 1], gain_vector);
+        __m128 channel_2 = LoadScaledQuad(input[samplei + 2], gain_vector);
+        __m128 channel_3 = LoadScaledQuad(input[samplei + 3], gain_vector);
+        _MM_TRANSPOSE4_PS(channel_0, channel_1, channel_2, channel_3);
+
+        // Summed in the same order as the generic code, floating point addition not being
+        // associative
+        const __m128 sum =
+            _mm_add_ps(_mm_add_ps(_mm_add_ps(channel_0, channel_1), channel_2), channel_3);
+        const __m128i mono = _mm_cvttps_epi32(_mm_div_ps(sum, two));
+        const __m128i mono16 = _mm_packs_epi32(mono, mono);
+        MixIntoStereo(dest + samplei, _mm_unpacklo_epi16(mono16, mono16));
+    }
+
+    DownmixQuadToMonoGeneric(dest + samplei, input + samplei, count - samplei, gain);
+}
+#else
+void DownmixQuadToStereo(std::array<s16, 2>* dest, const std::array<s32, 4>* input, size_t count,
+                         float gain) {
+    DownmixQuadToStereoGeneric(dest, input, count, gain);
+}
+
+void DownmixQuadToMono(std::array<s16, 2>* dest, const std::array<s32, 4>* input, size_t count,
+                       float gain) {
+    DownmixQuadToMonoGeneric(dest, input, count, gain);
+}
+#endif
+
+// Filters
+
+void SimpleFilterGeneric(SimpleFilterState& filter, std::array<s16, 2>* samples, size_t count) {
+    for (size_t samplei = 0; samplei < count; samplei++) {
+        const std::array<s16, 2> x0 = samples[samplei];
+        std::array<s16, 2> y0;
+        for (size_t i = 0; i < 2; i++) {
+            const s32 tmp = (filter.b0 * x0[i] + filter.a1 * filter.y1[i]) >> 15;
+            y0[i] = MathUtil::Clamp(tmp, -32768, 32767);
+        }
+
+        filter.y1 = y0;
+        samples[samplei] = y0;
+    }
+}
+
+void BiquadFilterGeneric(BiquadFilterState& filter, std::array<s16, 2>* samples, size_t count) {
+    for (size_t samplei = 0; samplei < count; samplei++) {
+        const std::array<s16, 2> x0 = samples[samplei];
+        std::array<s16, 2> y0;
+        for (size_t i = 0; i < 2; i++) {
+            const s32 tmp = (filter.b0 * x0[i] + filter.b1 * filter.x1[i] +
+                             filter.b2 * filter.x2[i] + filter.a1 * filter.y1[i] +
+                             filter.a2 * filter.y2[i]) >>
+                            14;
+            y0[i] = MathUtil::Clamp(tmp, -32768, 32767);
+        }
+
+        filter.x2 = filter.x1;
+        filter.x1 = x0;
+        filter.y2 = filter.y1;
+        filter.y1 = y0;
+        samples[samplei] = y0;
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+// The filters are recursive, so the samples are filtered one at a time, with the two channels
+// filtered at once. Each pair of products is computed with a multiply-add of 16-bit lanes, which
+// requires the coefficients to fit in 16 bits. This isn't the case of the passthrough
+// configuration the simple filter is reset to.
+
+void SimpleFilter(SimpleFilterState& filter, std::array<s16, 2>* samples, size_t count) {
+    if (!FitsInS16(filter.b0) || !FitsInS16(filter.a1)) {
+        SimpleFilterGeneric(filter, samples, count);
+        return;
+    }
+
+    const __m128i coeffs = _mm_set1_epi32((filter.a1 << 16) | (filter.b0 & 0xFFFF));
+    __m128i y1 = LoadStereo(filter.y1);
+    for (size_t samplei = 0; samplei < count; samplei++) {
+        const __m128i x0 = LoadStereo(samples[samplei]);
+        const __m128i sum = _mm_madd_epi16(_mm_unpacklo_epi16(x0, y1), coeffs);
+        const __m128i y0 = _mm_packs_epi32(_mm_srai_epi32(sum, 15), sum);
+        StoreStereo(samples[samplei], y0);
+        y1 = y0;
+    }
+    StoreStereo(filter.y1, y1);
+}
+
+void BiquadFilter(BiquadFilterState& filter, std::array<s16, 2>* samples, size_t count) {
+    if (!FitsInS16(filter.a1) || !FitsInS16(filter.a2) || !FitsInS16(filter.b0) ||
+        !FitsInS16(filter.b1) || !FitsInS16(filter.b2)) {
+        BiquadFilterGeneric(filter, samples, count);
+        return;
+    }
+
+    const auto Pair = [](s32 first, s32 second) {
+        return _mm_set1_epi32((second << 16) | (first & 0xFFFF));
+    };
+    const __m128i coeffs_b0_b1 = Pair(filter.b0, filter.b1);
+    const __m128i coeffs_b2_a1 = Pair(filter.b2, filter.a1);
+    const __m128i coeffs_a2 = Pair(filter.a2, 0);
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i x1 = LoadStereo(filter.x1);
+    __m128i x2 = LoadStereo(filter.x2);
+    __m128i y1 = LoadStereo(filter.y1);
+    __m128i y2 = LoadStereo(filter.y2);
+    for (size_t samplei = 0; samplei < count; samplei++) {
+        const __m128i x0 = LoadStereo(samples[samplei]);
+        const __m128i sum = _mm_add_epi32(
+            _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(x0, x1), coeffs_b0_b1),
+                          _mm_madd_epi16(_mm_unpacklo_epi16(x2, y1), coeffs_b2_a1)),
+            _mm_madd_epi16(_mm_unpacklo_epi16(y2, zero), coeffs_a2));
+        const __m128i y0 = _mm_packs_epi32(_mm_srai_epi32(sum, 14), sum);
+        StoreStereo(samples[samplei], y0);
+
+        x2 = x1;
+        x1 = x0;
+        y2 = y1;
+        y1 = y0;
+    }
+    StoreStereo(filter.x1, x1);
+    StoreStereo(filter.x2, x2);
+    StoreStereo(filter.y1, y1);
+    StoreStereo(filter.y2, y2);
+}
+#else
+void SimpleFilter(SimpleFilterState& filter, std::array<s16, 2>* samples, size_t count) {
+    SimpleFilterGeneric(filter, samples, count);
+}
+
+void BiquadFilter(BiquadFilterState& filter, std::array<s16, 2>* samples, size_t count) {
+    BiquadFilterGeneric(filter, samples, count);
+}
+#endif
+
+} // namespace Kernels
+} // namespace AudioCore
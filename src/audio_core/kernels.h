@@ -0,0 +1,86 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include "common/common_types.h"
+
+/**
+ * Inner loops of the audio pipeline. Each kernel has a portable implementation, suffixed with
+ * Generic, and the unsuffixed one, which is vectorized with SSE2 on x86-64. Both give bit-identical
+ * results.
+ */
+namespace AudioCore {
+namespace Kernels {
+
+/**
+ * Decodes GC-ADPCM into stereo samples, see Codec::DecodeADPCM.
+ * @param data ADPCM data, in frames of 8 bytes holding 14 samples each
+ * @param sample_count Number of samples to decode
+ * @param coeffs ADPCM coefficients
+ * @param yn1, yn2 The last two decoded samples. Updated with the samples decoded.
+ * @param output Receives the decoded samples. Must hold sample_count rounded up to a multiple of
+ *               two samples.
+ */
+void DecodeADPCM(const u8* data, size_t sample_count, const std::array<s16, 16>& coeffs, s16& yn1,
+                 s16& yn2, std::array<s16, 2>* output);
+void DecodeADPCMGeneric(const u8* data, size_t sample_count, const std::array<s16, 16>& coeffs,
+                        s16& yn1, s16& yn2, std::array<s16, 2>* output);
+
+/**
+ * Linearly interpolates samples. Output sample i is interpolated between input[index - 2] and
+ * input[index - 1], with index and fraction the integer and fractional parts of
+ * position + i * step in fixed point with 24 fractional bits.
+ */
+void InterpolateLinear(const std::array<s16, 2>* input, u64 position, u64 step,
+                       std::array<s16, 2>* output, size_t count);
+void InterpolateLinearGeneric(const std::array<s16, 2>* input, u64 position, u64 step,
+                              std::array<s16, 2>* output, size_t count);
+
+/// Scales stereo samples by the gains of each of the four output channels and adds them to
+/// quadraphonic samples. Channels 0 and 2 get the left input channel, 1 and 3 the right one.
+void MixStereoIntoQuad(std::array<s32, 4>* dest, const std::array<s16, 2>* input, size_t count,
+                       const std::array<float, 4>& gains);
+void MixStereoIntoQuadGeneric(std::array<s32, 4>* dest, const std::array<s16, 2>* input,
+                              size_t count, const std::array<float, 4>& gains);
+
+/// Downmixes scaled quadraphonic samples to stereo and adds them to dest, with saturation.
+void DownmixQuadToStereo(std::array<s16, 2>* dest, const std::array<s32, 4>* input, size_t count,
+                         float gain);
+void DownmixQuadToStereoGeneric(std::array<s16, 2>* dest, const std::array<s32, 4>* input,
+                                size_t count, float gain);
+
+/// Downmixes scaled quadraphonic samples to mono and adds them to both channels of dest, with
+/// saturation.
+void DownmixQuadToMono(std::array<s16, 2>* dest, const std::array<s32, 4>* input, size_t count,
+                       float gain);
+void DownmixQuadToMonoGeneric(std::array<s16, 2>* dest, const std::array<s32, 4>* input,
+                              size_t count, float gain);
+
+/// Coefficients and state of the first-order filter of a source, see
+/// SourceConfiguration::Configuration::SimpleFilter.
+struct SimpleFilterState {
+    s32 a1, b0;
+    std::array<s16, 2> y1;
+};
+
+/// Coefficients and state of the second-order filter of a source, see
+/// SourceConfiguration::Configuration::BiquadFilter.
+struct BiquadFilterState {
+    s32 a1, a2, b0, b1, b2;
+    std::array<s16, 2> x1, x2, y1, y2;
+};
+
+/// Filters stereo samples in place. Both channels are filtered at once.
+void SimpleFilter(SimpleFilterState& filter, std::array<s16, 2>* samples, size_t count);
+void SimpleFilterGeneric(SimpleFilterState& filter, std::array<s16, 2>* samples, size_t count);
+
+/// Filters stereo samples in place. Both channels are filtered at once.
+void BiquadFilter(BiquadFilterState& filter, std::array<s16, 2>* samples, size_t count);
+void BiquadFilterGeneric(BiquadFilterState& filter, std::array<s16, 2>* samples, size_t count);
+
+} // namespace Kernels
+} // namespace AudioCore
@@ -0,0 +1,173 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+#include "audio_core/resampler.h"
+#include "common/math_util.h"
+
+namespace AudioCore {
+
+/// Length of the filter, in input samples
+constexpr size_t NUM_TAPS = 48;
+/// Number of phases tabulated per input sample, the coefficients in between being interpolated
+constexpr size_t NUM_PHASES = 128;
+/// Stride of a phase in the coefficient table, as the coefficients are duplicated per channel
+constexpr size_t PHASE_STRIDE = NUM_TAPS * 2;
+/// Cutoff of the filter relative to the lower of the two sample rates, leaving room for the
+/// transition band below the Nyquist frequency
+constexpr double CUTOFF = 0.45;
+/// Shape parameter of the Kaiser window, trading the width of the transition band for stopband
+/// attenuation
+constexpr double KAISER_BETA = 8.0;
+
+/// Zeroth order modified Bessel function of the first kind
+static double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; term > sum * 1e-12; ++k) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static double Sinc(double x) {
+    constexpr double pi = 3.14159265358979323846;
+    return x == 0.0 ? 1.0 : std::sin(pi * x) / (pi * x);
+}
+
+Resampler::Resampler(unsigned int input_rate, unsigned int output_rate) {
+    SetRates(input_rate, output_rate);
+}
+
+void Resampler::SetRates(unsigned int input_rate, unsigned int output_rate) {
+    this->input_rate = input_rate;
+    this->output_rate = output_rate;
+
+    // The table has an extra phase, a whole input sample ahead, to interpolate the last one with
+    coefficients.resize((NUM_PHASES + 1) * PHASE_STRIDE);
+    const double cutoff = CUTOFF * std::min(1.0, static_cast<double>(output_rate) / input_rate);
+    for (size_t phase = 0; phase <= NUM_PHASES; ++phase) {
+        float* phase_coefficients = &coefficients[phase * PHASE_STRIDE];
+        // Distance from the first tap to the center of the filter, in input samples
+        const double center = NUM_TAPS / 2 - 1 + static_cast<double>(phase) / NUM_PHASES;
+
+        std::array<double, NUM_TAPS> taps;
+        double sum = 0.0;
+        for (size_t tap = 0; tap < NUM_TAPS; ++tap) {
+            const double x = tap - center;
+            const double window = x / (NUM_TAPS / 2);
+            taps[tap] = 2 * cutoff * Sinc(2 * cutoff * x) *
+                        BesselI0(KAISER_BETA * std::sqrt(std::max(0.0, 1 - window * window))) /
+                        BesselI0(KAISER_BETA);
+            sum += taps[tap];
+        }
+
+        // Each phase passes DC at unity gain, so that interpolating between phases doesn't
+        // modulate the signal
+        for (size_t tap = 0; tap < NUM_TAPS; ++tap) {
+            phase_coefficients[tap * 2] = phase_coefficients[tap * 2 + 1] =
+                static_cast<float>(taps[tap] / sum);
+        }
+    }
+
+    Reset();
+}
+
+void Resampler::Reset() {
+    // The filter starts centered on the first input sample, with silence before it
+    history.assign((NUM_TAPS / 2 - 1) * 2, 0.0f);
+    position = 0;
+    fraction = 0;
+}
+
+/// Filters the interleaved stereo samples starting at input, with the coefficients of a phase
+/// interpolated with the ones of the next phase.
+#ifdef ARCHITECTURE_x86_64
+static void Filter(const float* input, const float* coefficients, float t, s16* output) {
+    const float* next_coefficients = coefficients + PHASE_STRIDE;
+    const __m128 tv = _mm_set1_ps(t);
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    // Two accumulators of two stereo samples each, to hide the latency of the additions
+    for (size_t i = 0; i < PHASE_STRIDE; i += 8) {
+        const __m128 c0 = _mm_loadu_ps(coefficients + i);
+        const __m128 c1 = _mm_loadu_ps(coefficients + i + 4);
+        const __m128 n0 = _mm_loadu_ps(next_coefficients + i);
+        const __m128 n1 = _mm_loadu_ps(next_coefficients + i + 4);
+        const __m128 k0 = _mm_add_ps(c0, _mm_mul_ps(tv, _mm_sub_ps(n0, c0)));
+        const __m128 k1 = _mm_add_ps(c1, _mm_mul_ps(tv, _mm_sub_ps(n1, c1)));
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(k0, _mm_loadu_ps(input + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(k1, _mm_loadu_ps(input + i + 4)));
+    }
+    // Sums the left and right halves, giving [left right left right]
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    // Rounds to the nearest integer and saturates both channels at once
+    const __m128i samples = _mm_cvtps_epi32(sum);
+    const int packed = _mm_cvtsi128_si32(_mm_packs_epi32(samples, samples));
+    output[0] = static_cast<s16>(packed & 0xFFFF);
+    output[1] = static_cast<s16>(packed >> 16);
+}
+#else
+static void Filter(const float* input, const float* coefficients, float t, s16* output) {
+    const float* next_coefficients = coefficients + PHASE_STRIDE;
+    float left = 0.0f;
+    float right = 0.0f;
+    for (size_t i = 0; i < PHASE_STRIDE; i += 2) {
+        const float coefficient = coefficients[i] + t * (next_coefficients[i] - coefficients[i]);
+        left += coefficient * input[i];
+        right += coefficient * input[i + 1];
+    }
+    output[0] = static_cast<s16>(MathUtil::Clamp<long>(std::lrint(left), -32768, 32767));
+    output[1] = static_cast<s16>(MathUtil::Clamp<long>(std::lrint(right), -32768, 32767));
+}
+#endif
+
+void Resampler::Process(const s16* input, size_t num_samples, std::vector<s16>& output) {
+    const size_t old_size = history.size();
+    history.resize(old_size + num_samples * 2);
+    std::transform(input, input + num_samples * 2, history.begin() + old_size,
+                   [](s16 sample) { return static_cast<float>(sample); });
+
+    output.clear();
+    const size_t num_history_samples = history.size() / 2;
+    if (num_history_samples >= position + NUM_TAPS) {
+        // Enough room for every sample which can be produced, plus one for rounding
+        const u64 available = num_history_samples - position - NUM_TAPS + 1;
+        output.reserve((available * output_rate / input_rate + 2) * 2);
+    }
+
+    const u32 step = input_rate / output_rate;
+    const u32 step_fraction = input_rate % output_rate;
+    while (position + NUM_TAPS <= num_history_samples) {
+        // The fraction is mapped to a phase and the position between that phase and the next one
+        const u64 scaled_fraction = static_cast<u64>(fraction) * NUM_PHASES;
+        const size_t phase = static_cast<size_t>(scaled_fraction / output_rate);
+        const float t = static_cast<float>(scaled_fraction % output_rate) / output_rate;
+
+        output.resize(output.size() + 2);
+        Filter(&history[position * 2], &coefficients[phase * PHASE_STRIDE], t,
+               &output[output.size() - 2]);
+
+        position += step;
+        fraction += step_fraction;
+        if (fraction >= output_rate) {
+            fraction -= output_rate;
+            ++position;
+        }
+    }
+
+    // Drops the samples which are behind the filter
+    const size_t consumed = std::min(position, num_history_samples);
+    history.erase(history.begin(), history.begin() + consumed * 2);
+    position -= consumed;
+}
+
+} // namespace AudioCore
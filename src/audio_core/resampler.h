@@ -0,0 +1,62 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "common/common_types.h"
+
+namespace AudioCore {
+
+/**
+ * Polyphase FIR resampler converting stereo PCM16 samples between two fixed sample rates, used to
+ * convert the output of the DSP to the sample rate of the sink. The windowed sinc filter is
+ * tabulated for a number of phases when the rates are set, and the coefficients between two
+ * phases are linearly interpolated. The position in the input is tracked exactly, in units of the
+ * output sample rate, so that the conversion doesn't drift.
+ */
+class Resampler final {
+public:
+    Resampler(unsigned int input_rate, unsigned int output_rate);
+
+    /// Sets the sample rates and clears the samples buffered.
+    void SetRates(unsigned int input_rate, unsigned int output_rate);
+
+    /// Clears the samples buffered.
+    void Reset();
+
+    unsigned int GetInputRate() const {
+        return input_rate;
+    }
+
+    unsigned int GetOutputRate() const {
+        return output_rate;
+    }
+
+    /**
+     * Resamples stereo samples. The output lags the input by half the length of the filter.
+     * @param input Samples in interleaved stereo PCM16 format.
+     * @param num_samples Number of samples.
+     * @param output Receives the resampled samples in interleaved stereo PCM16 format. Its storage
+     * is reused.
+     */
+    void Process(const s16* input, size_t num_samples, std::vector<s16>& output);
+
+private:
+    unsigned int input_rate;
+    unsigned int output_rate;
+
+    /// Coefficients of the phases in order, each duplicated for the two channels
+    std::vector<float> coefficients;
+
+    /// Input samples which are still needed, in interleaved stereo format
+    std::vector<float> history;
+    /// Index in history of the first sample under the filter
+    size_t position;
+    /// Position between that sample and the next one, in units of 1 / output_rate samples
+    u32 fraction;
+};
+
+} // namespace AudioCore
@@ -0,0 +1,56 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include "audio_core/sample_ring.h"
+
+namespace AudioCore {
+
+static size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+SampleRing::SampleRing(size_t capacity_)
+    : capacity(RoundUpToPowerOfTwo(capacity_)), buffer(capacity * 2) {}
+
+size_t SampleRing::Push(const s16* samples, size_t sample_count) {
+    const size_t write = write_index.load(std::memory_order_relaxed);
+    const size_t read = read_index.load(std::memory_order_acquire);
+
+    const size_t count = std::min(sample_count, capacity - (write - read));
+    const size_t offset = write & (capacity - 1);
+    const size_t first = std::min(count, capacity - offset);
+    std::memcpy(&buffer[offset * 2], samples, first * 2 * sizeof(s16));
+    std::memcpy(&buffer[0], samples + first * 2, (count - first) * 2 * sizeof(s16));
+
+    write_index.store(write + count, std::memory_order_release);
+    return count;
+}
+
+size_t SampleRing::Pop(s16* samples, size_t sample_count) {
+    const size_t read = read_index.load(std::memory_order_relaxed);
+    const size_t write = write_index.load(std::memory_order_acquire);
+
+    const size_t count = std::min(sample_count, write - read);
+    const size_t offset = read & (capacity - 1);
+    const size_t first = std::min(count, capacity - offset);
+    std::memcpy(samples, &buffer[offset * 2], first * 2 * sizeof(s16));
+    std::memcpy(samples + first * 2, &buffer[0], (count - first) * 2 * sizeof(s16));
+
+    read_index.store(read + count, std::memory_order_release);
+    return count;
+}
+
+size_t SampleRing::Size() const {
+    // The read index is loaded first so that it can't be ahead of the write index
+    const size_t read = read_index.load(std::memory_order_acquire);
+    const size_t write = write_index.load(std::memory_order_acquire);
+    return write - read;
+}
+
+} // namespace AudioCore
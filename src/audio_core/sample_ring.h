@@ -0,0 +1,61 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+#include "common/common_types.h"
+
+namespace AudioCore {
+
+/**
+ * Fixed-capacity ring of stereo PCM16 samples, shared by a single producer thread and a single
+ * consumer thread without locking. The storage is allocated once on construction, so neither side
+ * allocates, and the number of queued samples is available at any time in constant time.
+ */
+class SampleRing final {
+public:
+    /**
+     * @param capacity Minimum number of stereo samples the ring can hold. It is rounded up to a
+     *                 power of two.
+     */
+    explicit SampleRing(size_t capacity);
+
+    /**
+     * Queues samples. Must only be called from the producer thread.
+     * @param samples Samples in interleaved stereo PCM16 format.
+     * @param sample_count Number of samples.
+     * @return Number of samples queued, which is less than sample_count if the ring is full.
+     */
+    size_t Push(const s16* samples, size_t sample_count);
+
+    /**
+     * Dequeues samples. Must only be called from the consumer thread.
+     * @param samples Buffer receiving the samples in interleaved stereo PCM16 format.
+     * @param sample_count Maximum number of samples to dequeue.
+     * @return Number of samples dequeued, which is less than sample_count if the ring runs empty.
+     */
+    size_t Pop(s16* samples, size_t sample_count);
+
+    /// Number of samples queued. May be called from any thread.
+    size_t Size() const;
+
+    /// Number of samples the ring can hold.
+    size_t Capacity() const {
+        return capacity;
+    }
+
+private:
+    size_t capacity;
+    std::vector<s16> buffer;
+
+    // Total numbers of samples ever pushed and popped. Only the producer stores to write_index
+    // and only the consumer stores to read_index.
+    std::atomic<size_t> write_index{0};
+    std::atomic<size_t> read_index{0};
+};
+
+} // namespace AudioCore
@@ -2,10 +2,10 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
-#include <list>
-#include <numeric>
+#include <cstring>
 #include <SDL.h>
 #include "audio_core/audio_core.h"
+#include "audio_core/sample_ring.h"
 #include "audio_core/sdl2_sink.h"
 #include "common/assert.h"
 #include "common/logging/log.h"
@@ -18,7 +18,9 @@ struct SDL2Sink::Impl {
 
     SDL_AudioDeviceID audio_device_id = 0;
 
-    std::list<std::vector<s16>> queue;
+    /// Samples waiting to be played, pushed by the emulator and popped by the SDL audio thread.
+    /// This holds well over the maximum latency targeted by the time stretcher.
+    SampleRing queue{32768};
 
     static void Callback(void* impl_, u8* buffer, int buffer_size_in_bytes);
 };
@@ -91,27 +93,17 @@ void SDL2Sink::EnqueueSamples(const s16* samples, size_t sample_count) {
     if (impl->audio_device_id <= 0)
         return;
 
-    SDL_LockAudioDevice(impl->audio_device_id);
-    impl->queue.emplace_back(samples, samples + sample_count * 2);
-    SDL_UnlockAudioDevice(impl->audio_device_id);
+    const size_t queued = impl->queue.Push(samples, sample_count);
+    if (queued < sample_count) {
+        LOG_TRACE(Audio_Sink, "Audio queue full, dropped %zu samples", sample_count - queued);
+    }
 }
 
 size_t SDL2Sink::SamplesInQueue() const {
     if (impl->audio_device_id <= 0)
         return 0;
 
-    SDL_LockAudioDevice(impl->audio_device_id);
-
-    size_t total_size = std::accumulate(impl->queue.begin(), impl->queue.end(),
-                                        static_cast<size_t>(0), [](size_t sum, const auto& buffer) {
-                                            // Division by two because each stereo sample is made of
-                                            // two s16.
-                                            return sum + buffer.size() / 2;
-                                        });
-
-    SDL_UnlockAudioDevice(impl->audio_device_id);
-
-    return total_size;
+    return impl->queue.Size();
 }
 
 void SDL2Sink::SetDevice(int device_id) {
@@ -121,26 +113,13 @@ void SDL2Sink::SetDevice(int device_id) {
 void SDL2Sink::Impl::Callback(void* impl_, u8* buffer, int buffer_size_in_bytes) {
     Impl* impl = reinterpret_cast<Impl*>(impl_);
 
-    size_t remaining_size = static_cast<size_t>(buffer_size_in_bytes) /
-                            sizeof(s16); // Keep track of size in 16-bit increments.
-
-    while (remaining_size > 0 && !impl->queue.empty()) {
-        if (impl->queue.front().size() <= remaining_size) {
-            memcpy(buffer, impl->queue.front().data(), impl->queue.front().size() * sizeof(s16));
-            buffer += impl->queue.front().size() * sizeof(s16);
-            remaining_size -= impl->queue.front().size();
-            impl->queue.pop_front();
-        } else {
-            memcpy(buffer, impl->queue.front().data(), remaining_size * sizeof(s16));
-            buffer += remaining_size * sizeof(s16);
-            impl->queue.front().erase(impl->queue.front().begin(),
-                                      impl->queue.front().begin() + remaining_size);
-            remaining_size = 0;
-        }
-    }
+    // Division by two because each stereo sample is made of two s16.
+    const size_t sample_count = static_cast<size_t>(buffer_size_in_bytes) / sizeof(s16) / 2;
+    s16* samples = reinterpret_cast<s16*>(buffer);
 
-    if (remaining_size > 0) {
-        memset(buffer, 0, remaining_size * sizeof(s16));
+    const size_t popped = impl->queue.Pop(samples, sample_count);
+    if (popped < sample_count) {
+        std::memset(samples + popped * 2, 0, (sample_count - popped) * 2 * sizeof(s16));
     }
 }
 
@@ -7,6 +7,7 @@
 #include <vector>
 #include <SoundTouch.h>
 #include "audio_core/audio_core.h"
+#include "audio_core/resampler.h"
 #include "audio_core/time_stretch.h"
 #include "common/common_types.h"
 #include "common/logging/log.h"
@@ -32,6 +33,12 @@ constexpr double SMOOTHING_FACTOR = 0.007;
 struct TimeStretcher::Impl {
     soundtouch::SoundTouch soundtouch;
 
+    /// Converts the samples to the output sample rate before they are stretched, leaving only the
+    /// tempo to SoundTouch
+    Resampler resampler{native_sample_rate, native_sample_rate};
+    /// Output of the resampler, whose storage is reused
+    std::vector<s16> resampled_samples;
+
     steady_clock::time_point frame_timer = steady_clock::now();
     size_t samples_queued = 0;
 
@@ -40,7 +47,7 @@ struct TimeStretcher::Impl {
     double sample_rate = static_cast<double>(native_sample_rate);
 };
 
-std::vector<s16> TimeStretcher::Process(size_t samples_in_queue) {
+void TimeStretcher::Process(size_t samples_in_queue, std::vector<s16>& output) {
     // This is a very simple algorithm without any fancy control theory. It works and is stable.
 
     double ratio = CalculateCurrentRatio();
@@ -52,18 +59,16 @@ std::vector<s16> TimeStretcher::Process(size_t samples_in_queue) {
     // SoundTouch's tempo definition the inverse of our ratio definition.
     impl->soundtouch.setTempo(1.0 / impl->smoothed_ratio);
 
-    std::vector<s16> samples = GetSamples();
+    GetSamples(output);
     if (samples_in_queue >= DROP_FRAMES_SAMPLE_DELAY) {
-        samples.clear();
+        output.clear();
         LOG_DEBUG(Audio, "Dropping frames!");
     }
-    return samples;
 }
 
 TimeStretcher::TimeStretcher() : impl(std::make_unique<Impl>()) {
     impl->soundtouch.setPitch(1.0);
     impl->soundtouch.setChannels(2);
-    impl->soundtouch.setSampleRate(native_sample_rate);
     Reset();
 }
 
@@ -73,11 +78,18 @@ TimeStretcher::~TimeStretcher() {
 
 void TimeStretcher::SetOutputSampleRate(unsigned int sample_rate) {
     impl->sample_rate = static_cast<double>(sample_rate);
-    impl->soundtouch.setRate(static_cast<double>(native_sample_rate) / impl->sample_rate);
+    impl->resampler.SetRates(native_sample_rate, sample_rate);
+    impl->soundtouch.setSampleRate(sample_rate);
 }
 
 void TimeStretcher::AddSamples(const s16* buffer, size_t num_samples) {
-    impl->soundtouch.putSamples(buffer, static_cast<uint>(num_samples));
+    if (impl->resampler.GetOutputRate() == impl->resampler.GetInputRate()) {
+        impl->soundtouch.putSamples(buffer, static_cast<uint>(num_samples));
+    } else {
+        impl->resampler.Process(buffer, num_samples, impl->resampled_samples);
+        impl->soundtouch.putSamples(impl->resampled_samples.data(),
+                                    static_cast<uint>(impl->resampled_samples.size() / 2));
+    }
     impl->samples_queued += num_samples;
 }
 
@@ -130,14 +142,12 @@ double TimeStretcher::CorrectForUnderAndOverflow(double ratio, size_t sample_del
     return ClampRatio(ratio);
 }
 
-std::vector<s16> TimeStretcher::GetSamples() {
+void TimeStretcher::GetSamples(std::vector<s16>& output) {
     uint available = impl->soundtouch.numSamples();
 
-    std::vector<s16> output(static_cast<size_t>(available) * 2);
+    output.resize(static_cast<size_t>(available) * 2);
 
     impl->soundtouch.receiveSamples(output.data(), available);
-
-    return output;
 }
 
 } // namespace AudioCore
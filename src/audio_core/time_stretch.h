@@ -40,9 +40,10 @@ public:
      * Timer calculations use sample_delay to determine how much of a margin we have.
      * @param sample_delay How many samples are buffered downstream of this module and haven't been
      * played yet.
-     * @return Samples to play in interleaved stereo PCM16 format.
+     * @param output Receives the samples to play in interleaved stereo PCM16 format. Its storage is
+     * reused.
      */
-    std::vector<s16> Process(size_t sample_delay);
+    void Process(size_t sample_delay, std::vector<s16>& output);
 
 private:
     struct Impl;
@@ -54,7 +55,7 @@ private:
     /// direction.
     double CorrectForUnderAndOverflow(double ratio, size_t sample_delay) const;
     /// INTERNAL: Gets the time-stretched samples from SoundTouch.
-    std::vector<s16> GetSamples();
+    void GetSamples(std::vector<s16>& output);
 };
 
 } // namespace AudioCore
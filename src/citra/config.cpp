@@ -82,6 +82,14 @@ void Config::ReadValues() {
     // Renderer
     Settings::values.use_hw_renderer = sdl2_config->GetBoolean("Renderer", "use_hw_renderer", true);
     Settings::values.use_shader_jit = sdl2_config->GetBoolean("Renderer", "use_shader_jit", true);
+    Settings::values.use_shader_jit_specialization =
+        sdl2_config->GetBoolean("Renderer", "use_shader_jit_specialization", false);
+    Settings::values.use_disk_shader_cache =
+        sdl2_config->GetBoolean("Renderer", "use_disk_shader_cache", true);
+    Settings::values.use_uber_shader =
+        sdl2_config->GetBoolean("Renderer", "use_uber_shader", false);
+    Settings::values.use_gpu_texture_decode =
+        sdl2_config->GetBoolean("Renderer", "use_gpu_texture_decode", false);
     Settings::values.resolution_factor =
         (float)sdl2_config->GetReal("Renderer", "resolution_factor", 1.0);
     Settings::values.use_vsync = sdl2_config->GetBoolean("Renderer", "use_vsync", false);
@@ -118,7 +126,12 @@ void Config::ReadValues() {
     Settings::values.sink_id = sdl2_config->Get("Audio", "output_engine", "auto");
     Settings::values.enable_audio_stretching =
         sdl2_config->GetBoolean("Audio", "enable_audio_stretching", true);
+    Settings::values.enable_parallel_audio_sources =
+        sdl2_config->GetBoolean("Audio", "enable_parallel_audio_sources", false);
+    Settings::values.enable_offline_audio =
+        sdl2_config->GetBoolean("Audio", "enable_offline_audio", false);
     Settings::values.audio_device_id = sdl2_config->Get("Audio", "output_device", "auto");
+    Settings::values.audio_file_path = sdl2_config->Get("Audio", "output_file", "audio.wav");
 
     // Data Storage
     Settings::values.use_virtual_sd =
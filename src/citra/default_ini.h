@@ -70,6 +70,24 @@ use_hw_renderer =
 # 0: Interpreter (slow), 1 (default): JIT (fast)
 use_shader_jit =
 
+# Whether the shader JIT compiles the bool and int uniforms of shaders in as constants, which speeds
+# up their flow control but compiles a shader again for each new combination of these uniforms
+# 0 (default): Off, 1: On
+use_shader_jit_specialization =
+
+# Whether to store compiled shader programs on disk, reducing stutter on subsequent boots
+# 0: Off, 1 (default): On
+use_disk_shader_cache =
+
+# Whether to draw with a generic shader while new shaders compile in the background, trading GPU
+# time for fewer stutters. Requires GL_ARB_parallel_shader_compile.
+# 0 (default): Off, 1: On
+use_uber_shader =
+
+# Whether to decode tiled textures with a shader on the GPU instead of on the emulation thread
+# 0 (default): Off, 1: On
+use_gpu_texture_decode =
+
 # Resolution scale factor
 # 0: Auto (scales resolution to window size), 1: Native 3DS screen resolution, Otherwise a scale
 # factor for the 3DS resolution
@@ -116,7 +134,8 @@ swap_screen =
 
 [Audio]
 # Which audio output engine to use.
-# auto (default): Auto-select, null: No audio output, sdl2: SDL2 (if available)
+# auto (default): Auto-select, null: No audio output, sdl2: SDL2 (if available),
+# file: Write to output_file
 output_engine =
 
 # Whether or not to enable the audio-stretching post-processing effect.
@@ -125,10 +144,25 @@ output_engine =
 # 0: No, 1 (default): Yes
 enable_audio_stretching =
 
+# Whether to process the audio sources in parallel on a few worker threads, which lightens the
+# load on the emulation thread in titles playing many sounds at once
+# 0 (default): No, 1: Yes
+enable_parallel_audio_sources =
+
+# Whether to output every audio frame as is, instead of pacing the audio against the wall clock.
+# This disables audio-stretching and never drops frames, which suits the file output engine.
+# 0 (default): No, 1: Yes
+enable_offline_audio =
+
 # Which audio device to use.
 # auto (default): Auto-select
 output_device =
 
+# File written by the file output engine, at the native sample rate of 32728 Hz.
+# Written as a WAV file if its name ends with .wav, and as raw stereo PCM16 samples otherwise.
+# Defaults to audio.wav
+output_file =
+
 [Data Storage]
 # Whether to create a virtual SD card.
 # 1 (default): Yes, 0: No
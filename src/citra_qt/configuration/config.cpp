@@ -66,6 +66,13 @@ void Config::ReadValues() {
     qt_config->beginGroup("Renderer");
     Settings::values.use_hw_renderer = qt_config->value("use_hw_renderer", true).toBool();
     Settings::values.use_shader_jit = qt_config->value("use_shader_jit", true).toBool();
+    Settings::values.use_shader_jit_specialization =
+        qt_config->value("use_shader_jit_specialization", false).toBool();
+    Settings::values.use_disk_shader_cache =
+        qt_config->value("use_disk_shader_cache", true).toBool();
+    Settings::values.use_uber_shader = qt_config->value("use_uber_shader", false).toBool();
+    Settings::values.use_gpu_texture_decode =
+        qt_config->value("use_gpu_texture_decode", false).toBool();
     Settings::values.resolution_factor = qt_config->value("resolution_factor", 1.0).toFloat();
     Settings::values.use_vsync = qt_config->value("use_vsync", false).toBool();
     Settings::values.toggle_framelimit = qt_config->value("toggle_framelimit", true).toBool();
@@ -94,8 +101,14 @@ void Config::ReadValues() {
     Settings::values.sink_id = qt_config->value("output_engine", "auto").toString().toStdString();
     Settings::values.enable_audio_stretching =
         qt_config->value("enable_audio_stretching", true).toBool();
+    Settings::values.enable_parallel_audio_sources =
+        qt_config->value("enable_parallel_audio_sources", false).toBool();
+    Settings::values.enable_offline_audio =
+        qt_config->value("enable_offline_audio", false).toBool();
     Settings::values.audio_device_id =
         qt_config->value("output_device", "auto").toString().toStdString();
+    Settings::values.audio_file_path =
+        qt_config->value("output_file", "audio.wav").toString().toStdString();
     qt_config->endGroup();
 
     using namespace Service::CAM;
@@ -211,6 +224,11 @@ void Config::SaveValues() {
     qt_config->beginGroup("Renderer");
     qt_config->setValue("use_hw_renderer", Settings::values.use_hw_renderer);
     qt_config->setValue("use_shader_jit", Settings::values.use_shader_jit);
+    qt_config->setValue("use_shader_jit_specialization",
+                        Settings::values.use_shader_jit_specialization);
+    qt_config->setValue("use_disk_shader_cache", Settings::values.use_disk_shader_cache);
+    qt_config->setValue("use_uber_shader", Settings::values.use_uber_shader);
+    qt_config->setValue("use_gpu_texture_decode", Settings::values.use_gpu_texture_decode);
     qt_config->setValue("resolution_factor", (double)Settings::values.resolution_factor);
     qt_config->setValue("use_vsync", Settings::values.use_vsync);
     qt_config->setValue("toggle_framelimit", Settings::values.toggle_framelimit);
@@ -238,7 +256,11 @@ void Config::SaveValues() {
     qt_config->beginGroup("Audio");
     qt_config->setValue("output_engine", QString::fromStdString(Settings::values.sink_id));
     qt_config->setValue("enable_audio_stretching", Settings::values.enable_audio_stretching);
+    qt_config->setValue("enable_parallel_audio_sources",
+                        Settings::values.enable_parallel_audio_sources);
+    qt_config->setValue("enable_offline_audio", Settings::values.enable_offline_audio);
     qt_config->setValue("output_device", QString::fromStdString(Settings::values.audio_device_id));
+    qt_config->setValue("output_file", QString::fromStdString(Settings::values.audio_file_path));
     qt_config->endGroup();
 
     using namespace Service::CAM;
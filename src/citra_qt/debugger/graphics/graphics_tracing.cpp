@@ -2,23 +2,14 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
-#include <algorithm>
-#include <array>
-#include <iterator>
 #include <memory>
 #include <QBoxLayout>
 #include <QComboBox>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QPushButton>
-#include <boost/range/algorithm/copy.hpp>
 #include "citra_qt/debugger/graphics/graphics_tracing.h"
-#include "common/common_types.h"
-#include "core/hw/gpu.h"
-#include "core/hw/lcd.h"
 #include "core/tracer/recorder.h"
-#include "nihstro/float24.h"
-#include "video_core/pica_state.h"
 
 GraphicsTracingWidget::GraphicsTracingWidget(std::shared_ptr<Pica::DebugContext> debug_context,
                                              QWidget* parent)
@@ -62,42 +53,16 @@ void GraphicsTracingWidget::StartRecording() {
     if (!context)
         return;
 
-    auto shader_binary = Pica::g_state.vs.program_code;
-    auto swizzle_data = Pica::g_state.vs.swizzle_data;
+    // The trace is written to the file while recording
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save CiTrace"), "citrace.ctf",
+                                                    tr("CiTrace File (*.ctf)"));
 
-    // Encode floating point numbers to 24-bit values
-    // TODO: Drop this explicit conversion once we store float24 values bit-correctly internally.
-    std::array<u32, 4 * 16> default_attributes;
-    for (unsigned i = 0; i < 16; ++i) {
-        for (unsigned comp = 0; comp < 3; ++comp) {
-            default_attributes[4 * i + comp] = nihstro::to_float24(
-                Pica::g_state.input_default_attributes.attr[i][comp].ToFloat32());
-        }
+    if (filename.isEmpty()) {
+        // If the user canceled the dialog, don't start recording
+        return;
     }
 
-    std::array<u32, 4 * 96> vs_float_uniforms;
-    for (unsigned i = 0; i < 96; ++i)
-        for (unsigned comp = 0; comp < 3; ++comp)
-            vs_float_uniforms[4 * i + comp] =
-                nihstro::to_float24(Pica::g_state.vs.uniforms.f[i][comp].ToFloat32());
-
-    CiTrace::Recorder::InitialState state;
-    std::copy_n((u32*)&GPU::g_regs, sizeof(GPU::g_regs) / sizeof(u32),
-                std::back_inserter(state.gpu_registers));
-    std::copy_n((u32*)&LCD::g_regs, sizeof(LCD::g_regs) / sizeof(u32),
-                std::back_inserter(state.lcd_registers));
-    std::copy_n((u32*)&Pica::g_state.regs, sizeof(Pica::g_state.regs) / sizeof(u32),
-                std::back_inserter(state.pica_registers));
-    boost::copy(default_attributes, std::back_inserter(state.default_attributes));
-    boost::copy(shader_binary, std::back_inserter(state.vs_program_binary));
-    boost::copy(swizzle_data, std::back_inserter(state.vs_swizzle_data));
-    boost::copy(vs_float_uniforms, std::back_inserter(state.vs_float_uniforms));
-    // boost::copy(TODO: Not implemented, std::back_inserter(state.gs_program_binary));
-    // boost::copy(TODO: Not implemented, std::back_inserter(state.gs_swizzle_data));
-    // boost::copy(TODO: Not implemented, std::back_inserter(state.gs_float_uniforms));
-
-    auto recorder = new CiTrace::Recorder(state);
-    context->recorder = std::shared_ptr<CiTrace::Recorder>(recorder);
+    context->recorder = std::make_shared<CiTrace::Recorder>(filename.toStdString());
 
     emit SetStartTracingButtonEnabled(false);
     emit SetStopTracingButtonEnabled(true);
@@ -109,15 +74,7 @@ void GraphicsTracingWidget::StopRecording() {
     if (!context)
         return;
 
-    QString filename = QFileDialog::getSaveFileName(this, tr("Save CiTrace"), "citrace.ctf",
-                                                    tr("CiTrace File (*.ctf)"));
-
-    if (filename.isEmpty()) {
-        // If the user canceled the dialog, keep recording
-        return;
-    }
-
-    context->recorder->Finish(filename.toStdString());
+    context->recorder->Finish();
     context->recorder = nullptr;
 
     emit SetStopTracingButtonEnabled(false);
@@ -111,8 +111,12 @@ void GMainWindow::InitializeWidgets() {
     emu_frametime_label->setToolTip(
         tr("Time taken to emulate a 3DS frame, not counting framelimiting or v-sync. For "
            "full-speed emulation this should be at most 16.67 ms."));
+    draw_calls_label = new QLabel();
+    draw_calls_label->setToolTip(
+        tr("Draws issued by the game per frame, and the number of batches they were merged into "
+           "when submitted to the host GPU."));
 
-    for (auto& label : {emu_speed_label, game_fps_label, emu_frametime_label}) {
+    for (auto& label : {emu_speed_label, game_fps_label, emu_frametime_label, draw_calls_label}) {
         label->setVisible(false);
         label->setFrameStyle(QFrame::NoFrame);
         label->setContentsMargins(4, 0, 4, 0);
@@ -449,6 +453,7 @@ void GMainWindow::ShutdownGame() {
     emu_speed_label->setVisible(false);
     game_fps_label->setVisible(false);
     emu_frametime_label->setVisible(false);
+    draw_calls_label->setVisible(false);
 
     emulation_running = false;
 }
@@ -642,10 +647,14 @@ void GMainWindow::UpdateStatusBar() {
     emu_speed_label->setText(tr("Speed: %1%").arg(results.emulation_speed * 100.0, 0, 'f', 0));
     game_fps_label->setText(tr("Game: %1 FPS").arg(results.game_fps, 0, 'f', 0));
     emu_frametime_label->setText(tr("Frame: %1 ms").arg(results.frametime * 1000.0, 0, 'f', 2));
+    draw_calls_label->setText(tr("Draws: %1 (%2 batches)")
+                                  .arg(results.draws_per_frame, 0, 'f', 0)
+                                  .arg(results.batches_per_frame, 0, 'f', 0));
 
     emu_speed_label->setVisible(true);
     game_fps_label->setVisible(true);
     emu_frametime_label->setVisible(true);
+    draw_calls_label->setVisible(true);
 }
 
 void GMainWindow::OnCoreError(Core::System::ResultStatus result, std::string details) {
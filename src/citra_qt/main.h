@@ -141,6 +141,7 @@ private:
     QLabel* emu_speed_label = nullptr;
     QLabel* game_fps_label = nullptr;
     QLabel* emu_frametime_label = nullptr;
+    QLabel* draw_calls_label = nullptr;
     QTimer status_bar_update_timer;
 
     std::unique_ptr<Config> config;
@@ -0,0 +1,307 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// This needs to be included before getopt.h because the latter #defines symbols used by it
+#include "common/microprofile.h"
+
+#ifdef _MSC_VER
+#include <getopt.h>
+#else
+#include <getopt.h>
+#include <unistd.h>
+#endif
+
+#include <glad/glad.h>
+#include "citrace_replay/emu_window_sdl2_hidden.h"
+#include "common/hash.h"
+#include "common/logging/backend.h"
+#include "common/logging/filter.h"
+#include "common/logging/log.h"
+#include "common/scm_rev.h"
+#include "common/scope_exit.h"
+#include "core/core_timing.h"
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/process.h"
+#include "core/hw/gpu.h"
+#include "core/hw/hw.h"
+#include "core/memory.h"
+#include "core/memory_setup.h"
+#include "core/settings.h"
+#include "core/tracer/player.h"
+#include "video_core/renderer_base.h"
+#include "video_core/video_core.h"
+
+static void PrintHelp(const char* argv0) {
+    std::cout << "Usage: " << argv0
+              << " [options] <filename>\n"
+                 "-f, --first-frame=N   Start replaying from frame N (default: 0)\n"
+                 "-n, --loops=NUMBER    Replay the trace NUMBER times (default: 1)\n"
+                 "-r, --renderer=NAME   Render with the 'hw' (default) or 'sw' rasterizer\n"
+                 "-s, --shader=NAME     Run shaders with the 'jit' (default) or 'interpreter'\n"
+                 "-h, --help            Display this help and exit\n"
+                 "-v, --version         Output version information and exit\n";
+}
+
+static void PrintVersion() {
+    std::cout << "citrace-replay " << Common::g_scm_branch << " " << Common::g_scm_desc
+              << std::endl;
+}
+
+/// Backing memory of the emulated FCRAM and VRAM, which is all the memory a trace can refer to
+static std::shared_ptr<std::vector<u8>> fcram;
+static std::shared_ptr<std::vector<u8>> vram;
+
+/**
+ * Sets up the subset of the emulated system the GPU needs. Physical addresses are resolved
+ * through the current process' mappings, so a placeholder process gets FCRAM mapped at the linear
+ * heap and VRAM at its fixed address.
+ */
+static bool InitSystem(EmuWindow* emu_window) {
+    Memory::InitMemoryMap();
+    CoreTiming::Init();
+    HW::Init();
+    Kernel::Init(0);
+
+    fcram = std::make_shared<std::vector<u8>>(Memory::FCRAM_SIZE);
+    vram = std::make_shared<std::vector<u8>>(Memory::VRAM_SIZE);
+
+    Kernel::g_current_process =
+        Kernel::Process::Create(Kernel::CodeSet::Create("citrace-replay", 0));
+    auto& vm_manager = Kernel::g_current_process->vm_manager;
+    vm_manager
+        .MapMemoryBlock(Memory::LINEAR_HEAP_VADDR, fcram, 0, Memory::FCRAM_SIZE,
+                        Kernel::MemoryState::Continuous)
+        .Unwrap();
+    vm_manager
+        .MapMemoryBlock(Memory::VRAM_VADDR, vram, 0, Memory::VRAM_SIZE, Kernel::MemoryState::IO)
+        .Unwrap();
+
+    return VideoCore::Init(emu_window);
+}
+
+static void ShutdownSystem() {
+    VideoCore::Shutdown();
+    Kernel::Shutdown();
+    HW::Shutdown();
+    CoreTiming::Shutdown();
+}
+
+/// Clears guest memory, so that every loop starts from the same contents
+static void ResetGuestMemory() {
+    Memory::RasterizerFlushAndInvalidateRegion(Memory::FCRAM_PADDR, Memory::FCRAM_SIZE);
+    Memory::RasterizerFlushAndInvalidateRegion(Memory::VRAM_PADDR, Memory::VRAM_SIZE);
+    std::fill(fcram->begin(), fcram->end(), 0);
+    std::fill(vram->begin(), vram->end(), 0);
+}
+
+/// Hashes the contents of the framebuffers currently displayed on both screens
+static u64 HashDisplayedFramebuffers() {
+    std::array<u64, 2> hashes{};
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        const auto& framebuffer = GPU::g_regs.framebuffer_config[i];
+        PAddr addr =
+            framebuffer.active_fb == 0 ? framebuffer.address_left1 : framebuffer.address_left2;
+        u32 size = framebuffer.stride * framebuffer.height;
+
+        // The renderer may only have the latest contents in its own surfaces
+        Memory::RasterizerFlushRegion(addr, size);
+        const u8* data = Memory::GetPhysicalPointer(addr);
+        if (data != nullptr) {
+            hashes[i] = Common::ComputeHash64(data, size);
+        }
+    }
+    return Common::ComputeHash64(hashes.data(), sizeof(hashes));
+}
+
+/// Application entry point
+int main(int argc, char** argv) {
+    int option_index = 0;
+    unsigned loops = 1;
+    size_t first_frame = 0;
+    bool use_hw_renderer = true;
+    bool use_shader_jit = true;
+    char* endarg;
+    std::string filepath;
+
+    static struct option long_options[] = {
+        {"first-frame", required_argument, 0, 'f'},
+        {"loops", required_argument, 0, 'n'},
+        {"renderer", required_argument, 0, 'r'},
+        {"shader", required_argument, 0, 's'},
+        {"help", no_argument, 0, 'h'},
+        {"version", no_argument, 0, 'v'},
+        {0, 0, 0, 0},
+    };
+
+    while (optind < argc) {
+        char arg = getopt_long(argc, argv, "f:n:r:s:hv", long_options, &option_index);
+        if (arg != -1) {
+            switch (arg) {
+            case 'f':
+                errno = 0;
+                first_frame = strtoul(optarg, &endarg, 0);
+                if (endarg == optarg)
+                    errno = EINVAL;
+                if (errno != 0) {
+                    perror("--first-frame");
+                    return 1;
+                }
+                break;
+            case 'n':
+                errno = 0;
+                loops = strtoul(optarg, &endarg, 0);
+                if (endarg == optarg || loops == 0)
+                    errno = EINVAL;
+                if (errno != 0) {
+                    perror("--loops");
+                    return 1;
+                }
+                break;
+            case 'r':
+                if (std::strcmp(optarg, "hw") == 0) {
+                    use_hw_renderer = true;
+                } else if (std::strcmp(optarg, "sw") == 0) {
+                    use_hw_renderer = false;
+                } else {
+                    std::cerr << "--renderer: expected 'hw' or 'sw'" << std::endl;
+                    return 1;
+                }
+                break;
+            case 's':
+                if (std::strcmp(optarg, "jit") == 0) {
+                    use_shader_jit = true;
+                } else if (std::strcmp(optarg, "interpreter") == 0) {
+                    use_shader_jit = false;
+                } else {
+                    std::cerr << "--shader: expected 'jit' or 'interpreter'" << std::endl;
+                    return 1;
+                }
+                break;
+            case 'h':
+                PrintHelp(argv[0]);
+                return 0;
+            case 'v':
+                PrintVersion();
+                return 0;
+            default:
+                PrintHelp(argv[0]);
+                return 1;
+            }
+        } else {
+            filepath = argv[optind];
+            optind++;
+        }
+    }
+
+    Log::Filter log_filter(Log::Level::Info);
+    Log::SetFilter(&log_filter);
+
+    MicroProfileOnThreadCreate("ReplayThread");
+    SCOPE_EXIT({ MicroProfileShutdown(); });
+
+    if (filepath.empty()) {
+        LOG_CRITICAL(Frontend, "No CiTrace file specified");
+        return 1;
+    }
+
+    CiTrace::Player player;
+    if (!player.Load(filepath)) {
+        return 1;
+    }
+
+    const size_t frame_count = player.GetFrameCount();
+    if (first_frame >= frame_count) {
+        LOG_CRITICAL(Frontend, "First frame %zu is out of range, the trace has %zu frames",
+                     first_frame, frame_count);
+        return 1;
+    }
+
+    // There is no configuration file, only the settings the renderer depends on are set up
+    Settings::values.use_hw_renderer = use_hw_renderer;
+    Settings::values.use_shader_jit = use_shader_jit;
+    Settings::values.resolution_factor = 1.0f;
+    Settings::values.use_vsync = false;
+    Settings::values.toggle_framelimit = false;
+    VideoCore::g_hw_renderer_enabled = use_hw_renderer;
+    VideoCore::g_shader_jit_enabled = use_shader_jit;
+    VideoCore::g_toggle_framelimit_enabled = false;
+
+    std::unique_ptr<EmuWindow_SDL2_Hidden> emu_window{std::make_unique<EmuWindow_SDL2_Hidden>()};
+
+    SCOPE_EXIT({ ShutdownSystem(); });
+    if (!InitSystem(emu_window.get())) {
+        LOG_CRITICAL(Frontend, "VideoCore not initialized");
+        return 1;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    std::vector<u64> reference_hashes(frame_count);
+    std::vector<double> frame_times;
+    frame_times.reserve((frame_count - first_frame) * loops);
+    unsigned mismatches = 0;
+
+    for (unsigned loop = 0; loop < loops; ++loop) {
+        ResetGuestMemory();
+        player.RestoreInitialState();
+        // Not timed, with version 2 traces this only replays from the closest keyframe
+        player.Seek(first_frame);
+
+        Milliseconds loop_time{0};
+        for (size_t frame = first_frame; frame < frame_count; ++frame) {
+            auto start = Clock::now();
+            player.ReplayFrame(frame);
+            VideoCore::g_renderer->SwapBuffers();
+            // Wait for the GPU, so that the time covers rendering the frame and not just submitting
+            glFinish();
+            Milliseconds frame_time = Clock::now() - start;
+
+            loop_time += frame_time;
+            frame_times.push_back(frame_time.count());
+
+            u64 hash = HashDisplayedFramebuffers();
+            if (loop == 0) {
+                reference_hashes[frame] = hash;
+            } else if (hash != reference_hashes[frame]) {
+                ++mismatches;
+            }
+
+            std::printf("loop %u frame %zu: %8.3f ms, hash %016" PRIx64 "%s\n", loop, frame,
+                        frame_time.count(), hash,
+                        loop > 0 && hash != reference_hashes[frame] ? " (mismatch)" : "");
+        }
+
+        std::printf("loop %u: %zu frames in %.3f ms\n", loop, frame_count - first_frame,
+                    loop_time.count());
+    }
+
+    if (!frame_times.empty()) {
+        const auto minmax = std::minmax_element(frame_times.begin(), frame_times.end());
+        double total = 0.0;
+        for (double time : frame_times) {
+            total += time;
+        }
+        std::printf("frame times: min %.3f ms, avg %.3f ms, max %.3f ms\n", *minmax.first,
+                    total / frame_times.size(), *minmax.second);
+    }
+
+    if (mismatches != 0) {
+        std::printf("%u frames differ from the first loop\n", mismatches);
+        return 2;
+    }
+
+    return 0;
+}
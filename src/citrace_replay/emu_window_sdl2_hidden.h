@@ -0,0 +1,41 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <utility>
+#include "core/frontend/emu_window.h"
+
+struct SDL_Window;
+
+/// Window that is never shown, only used to own the OpenGL context the renderer draws with
+class EmuWindow_SDL2_Hidden : public EmuWindow {
+public:
+    EmuWindow_SDL2_Hidden();
+    ~EmuWindow_SDL2_Hidden();
+
+    /// Swap buffers to display the next frame
+    void SwapBuffers() override;
+
+    /// Polls window events
+    void PollEvents() override;
+
+    /// Makes the graphics context current for the caller thread
+    void MakeCurrent() override;
+
+    /// Releases the GL context from the caller thread
+    void DoneCurrent() override;
+
+private:
+    /// The window can't be resized, so there's no minimal client area to enforce
+    void OnMinimalClientAreaChangeRequest(
+        const std::pair<unsigned, unsigned>& minimal_size) override {}
+
+    /// Internal SDL2 render window
+    SDL_Window* render_window;
+
+    using SDL_GLContext = void*;
+    /// The OpenGL context associated with the window
+    SDL_GLContext gl_context;
+};
@@ -36,6 +36,7 @@
 #include <cstring>
 #include <dirent.h>
 #include <pwd.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 
@@ -57,6 +58,7 @@
 #endif
 
 #include <algorithm>
+#include <limits>
 #include <sys/stat.h>
 
 #ifndef S_ISDIR
@@ -889,4 +891,45 @@ bool IOFile::Resize(u64 size) {
     return m_good;
 }
 
+MappedFile::MappedFile(const IOFile& file) {
+#ifndef _WIN32
+    if (!file.IsOpen())
+        return;
+
+    const u64 file_size = file.GetSize();
+    if (file_size == 0 || file_size > std::numeric_limits<size_t>::max())
+        return;
+
+    void* mapping = mmap(nullptr, static_cast<size_t>(file_size), PROT_READ, MAP_SHARED,
+                         fileno(file.m_file), 0);
+    if (mapping == MAP_FAILED) {
+        LOG_WARNING(Common_Filesystem, "mmap failed: %s", GetLastErrorMsg());
+        return;
+    }
+
+    data = static_cast<u8*>(mapping);
+    size = file_size;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (data != nullptr)
+        munmap(data, static_cast<size_t>(size));
+#endif
+}
+
+void MappedFile::WillRead(u64 offset, u64 length) const {
+#ifndef _WIN32
+    if (data == nullptr || offset >= size)
+        return;
+
+    // The advised range has to start on a page boundary
+    static const u64 page_size = static_cast<u64>(sysconf(_SC_PAGESIZE));
+    const u64 start = offset & ~(page_size - 1);
+    const u64 end = std::min(offset + length, size);
+    madvise(data + start, static_cast<size_t>(end - start), MADV_WILLNEED);
+#endif
+}
+
 } // namespace
@@ -249,10 +249,44 @@ public:
     }
 
 private:
+    friend class MappedFile;
+
     std::FILE* m_file = nullptr;
     bool m_good = true;
 };
 
+/**
+ * Read-only memory mapping of a whole file, through which it can be read without going through
+ * stdio. Files are only mapped on the platforms which have mmap; elsewhere IsMapped returns false
+ * and the file has to be read through an IOFile.
+ */
+class MappedFile : public NonCopyable {
+public:
+    /// Maps a file opened for reading. The file must not be resized while it is mapped, but it can
+    /// be closed.
+    explicit MappedFile(const IOFile& file);
+    ~MappedFile();
+
+    bool IsMapped() const {
+        return data != nullptr;
+    }
+
+    const u8* GetData() const {
+        return data;
+    }
+
+    u64 GetSize() const {
+        return size;
+    }
+
+    /// Hints the system that a range of the file is about to be read, so that it reads it ahead.
+    void WillRead(u64 offset, u64 length) const;
+
+private:
+    u8* data = nullptr;
+    u64 size = 0;
+};
+
 } // namespace
 
 // To deal with Windows being dumb at unicode:
@@ -0,0 +1,74 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/thread.h"
+#include "common/thread_pool.h"
+
+namespace Common {
+
+ThreadPool::ThreadPool(size_t num_workers, const std::string& name) {
+    workers.reserve(num_workers);
+    for (size_t i = 0; i < num_workers; ++i) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this, name);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    work_available.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Run(size_t count_, Task task_, void* context_) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = task_;
+        context = context_;
+        count = count_;
+        next_index.store(0, std::memory_order_relaxed);
+        busy_workers = workers.size();
+        ++generation;
+    }
+    work_available.notify_all();
+
+    RunIterations();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    work_done.wait(lock, [this] { return busy_workers == 0; });
+}
+
+void ThreadPool::RunIterations() {
+    size_t i;
+    while ((i = next_index.fetch_add(1, std::memory_order_relaxed)) < count) {
+        task(context, i);
+    }
+}
+
+void ThreadPool::WorkerLoop(std::string name) {
+    SetCurrentThreadName(name.c_str());
+
+    size_t last_generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_available.wait(lock, [&] { return stop || generation != last_generation; });
+            if (stop)
+                return;
+            last_generation = generation;
+        }
+
+        RunIterations();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy_workers == 0)
+            work_done.notify_one();
+    }
+}
+
+} // namespace Common
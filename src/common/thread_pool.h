@@ -0,0 +1,74 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Common {
+
+/**
+ * A small pool of worker threads running the iterations of a loop in parallel. The thread calling
+ * ParallelFor takes part in the work, so a pool without workers runs the loop sequentially.
+ * Running a loop doesn't allocate.
+ */
+class ThreadPool final {
+public:
+    /**
+     * @param num_workers Number of worker threads to start
+     * @param name Name given to the worker threads
+     */
+    ThreadPool(size_t num_workers, const std::string& name);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Number of worker threads, not counting the thread calling ParallelFor
+    size_t NumWorkers() const {
+        return workers.size();
+    }
+
+    /**
+     * Calls func(i) for each i in [0, count), in any order and on any of the threads, and returns
+     * once all the calls have returned. Only one thread at a time may call this.
+     */
+    template <typename Func>
+    void ParallelFor(size_t count, Func&& func) {
+        using FuncType = std::remove_reference_t<Func>;
+        Run(count, [](void* context, size_t i) { (*static_cast<FuncType*>(context))(i); },
+            const_cast<void*>(static_cast<const void*>(&func)));
+    }
+
+private:
+    using Task = void (*)(void* context, size_t i);
+
+    void Run(size_t count, Task task, void* context);
+    void RunIterations();
+    void WorkerLoop(std::string name);
+
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+    size_t generation = 0;   ///< Incremented each time a loop is started
+    size_t busy_workers = 0; ///< Workers which haven't finished the current loop yet
+    bool stop = false;
+
+    // The current loop. Only written while all the workers are idle.
+    Task task = nullptr;
+    void* context = nullptr;
+    size_t count = 0;
+    std::atomic<size_t> next_index{0};
+};
+
+} // namespace Common
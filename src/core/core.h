@@ -105,6 +105,14 @@ public:
         return *cpu_core;
     }
 
+    /**
+     * Gets a reference to the loader of the running application.
+     * @returns A reference to the application loader.
+     */
+    Loader::AppLoader& GetAppLoader() const {
+        return *app_loader;
+    }
+
     PerfStats perf_stats;
     FrameLimiter frame_limiter;
 
@@ -22,6 +22,7 @@ struct NCCHData {
     std::shared_ptr<std::vector<u8>> logo;
     std::shared_ptr<std::vector<u8>> banner;
     std::shared_ptr<FileUtil::IOFile> romfs_file;
+    std::shared_ptr<const FileUtil::MappedFile> romfs_mapping;
     u64 romfs_offset = 0;
     u64 romfs_size = 0;
 };
@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
 #include "common/common_types.h"
@@ -13,6 +14,20 @@
 
 namespace FileSys {
 
+/// Reads at least this large are followed by a hint to read ahead the data after them, as they
+/// usually stream through large assets
+constexpr size_t READ_AHEAD_THRESHOLD = 64 * 1024;
+
+std::shared_ptr<const FileUtil::MappedFile> MapIVFCContainer(const FileUtil::IOFile& file,
+                                                             u64 offset, u64 size) {
+    auto mapping = std::make_shared<const FileUtil::MappedFile>(file);
+    if (!mapping->IsMapped() || offset > mapping->GetSize() ||
+        size > mapping->GetSize() - offset) {
+        return nullptr;
+    }
+    return mapping;
+}
+
 std::string IVFCArchive::GetName() const {
     return "IVFC";
 }
@@ -20,7 +35,7 @@ std::string IVFCArchive::GetName() const {
 ResultVal<std::unique_ptr<FileBackend>> IVFCArchive::OpenFile(const Path& path,
                                                               const Mode& mode) const {
     return MakeResult<std::unique_ptr<FileBackend>>(
-        std::make_unique<IVFCFile>(romfs_file, data_offset, data_size));
+        std::make_unique<IVFCFile>(romfs_file, romfs_mapping, data_offset, data_size));
 }
 
 ResultCode IVFCArchive::DeleteFile(const Path& path) const {
@@ -87,6 +102,19 @@ u64 IVFCArchive::GetFreeBytes() const {
 
 ResultVal<size_t> IVFCFile::Read(const u64 offset, const size_t length, u8* buffer) const {
     LOG_TRACE(Service_FS, "called offset=%llu, length=%zu", offset, length);
+    if (romfs_mapping) {
+        if (offset >= data_size)
+            return MakeResult<size_t>(0);
+
+        const size_t read_length = (size_t)std::min((u64)length, data_size - offset);
+        const u64 position = data_offset + offset;
+        std::memcpy(buffer, romfs_mapping->GetData() + position, read_length);
+        if (read_length >= READ_AHEAD_THRESHOLD) {
+            romfs_mapping->WillRead(position + read_length, read_length);
+        }
+        return MakeResult<size_t>(read_length);
+    }
+
     romfs_file->Seek(data_offset + offset, SEEK_SET);
     size_t read_length = (size_t)std::min((u64)length, data_size - offset);
 
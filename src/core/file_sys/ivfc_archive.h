@@ -20,6 +20,18 @@
 
 namespace FileSys {
 
+/**
+ * Maps the container of an IVFC image into memory, so that the image can be read without going
+ * through stdio.
+ * @param file The container of the image
+ * @param offset Offset of the image in the container
+ * @param size Size of the image
+ * @return The mapping, or nullptr if the container can't be mapped on this platform or is too small
+ * to hold the image
+ */
+std::shared_ptr<const FileUtil::MappedFile> MapIVFCContainer(const FileUtil::IOFile& file,
+                                                             u64 offset, u64 size);
+
 /**
  * Helper which implements an interface to deal with IVFC images used in some archives
  * This should be subclassed by concrete archive types, which will provide the
@@ -28,7 +40,8 @@ namespace FileSys {
 class IVFCArchive : public ArchiveBackend {
 public:
     IVFCArchive(std::shared_ptr<FileUtil::IOFile> file, u64 offset, u64 size)
-        : romfs_file(file), data_offset(offset), data_size(size) {}
+        : romfs_file(file), romfs_mapping(MapIVFCContainer(*file, offset, size)),
+          data_offset(offset), data_size(size) {}
 
     std::string GetName() const override;
 
@@ -46,14 +59,20 @@ public:
 
 protected:
     std::shared_ptr<FileUtil::IOFile> romfs_file;
+    std::shared_ptr<const FileUtil::MappedFile> romfs_mapping;
     u64 data_offset;
     u64 data_size;
 };
 
+/**
+ * File of an IVFC image, read from the mapping of its container when there is one, and through
+ * stdio otherwise
+ */
 class IVFCFile : public FileBackend {
 public:
-    IVFCFile(std::shared_ptr<FileUtil::IOFile> file, u64 offset, u64 size)
-        : romfs_file(file), data_offset(offset), data_size(size) {}
+    IVFCFile(std::shared_ptr<FileUtil::IOFile> file,
+             std::shared_ptr<const FileUtil::MappedFile> mapping, u64 offset, u64 size)
+        : romfs_file(file), romfs_mapping(mapping), data_offset(offset), data_size(size) {}
 
     ResultVal<size_t> Read(u64 offset, size_t length, u8* buffer) const override;
     ResultVal<size_t> Write(u64 offset, size_t length, bool flush, const u8* buffer) const override;
@@ -66,6 +85,7 @@ public:
 
 private:
     std::shared_ptr<FileUtil::IOFile> romfs_file;
+    std::shared_ptr<const FileUtil::MappedFile> romfs_mapping;
     u64 data_offset;
     u64 data_size;
 };
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <array>
 #include <cinttypes>
+#include <vector>
 #include "audio_core/hle/pipe.h"
 #include "common/assert.h"
 #include "common/hash.h"
@@ -303,9 +304,7 @@ static void WriteProcessPipe(Service::Interface* self) {
                "Invalid Buffer: pipe=%u, size=0x%X, buffer=0x%08X", pipe, size, buffer);
 
     std::vector<u8> message(size);
-    for (u32 i = 0; i < size; i++) {
-        message[i] = Memory::Read8(buffer + i);
-    }
+    Memory::ReadBlock(buffer, message.data(), message.size());
 
     // This behaviour was confirmed by RE.
     // The likely reason for this is that games tend to pass in garbage at these bytes
@@ -325,7 +324,7 @@ static void WriteProcessPipe(Service::Interface* self) {
         break;
     }
 
-    DSP::HLE::PipeWrite(pipe, message);
+    DSP::HLE::PipeWrite(pipe, message.data(), message.size());
 
     cmd_buff[0] = IPC::MakeHeader(0xD, 1, 0);
     cmd_buff[1] = RESULT_SUCCESS.raw; // No error
@@ -364,11 +363,7 @@ static void ReadPipeIfPossible(Service::Interface* self) {
     cmd_buff[0] = IPC::MakeHeader(0x10, 1, 2);
     cmd_buff[1] = RESULT_SUCCESS.raw; // No error
     if (DSP::HLE::GetPipeReadableSize(pipe) >= size) {
-        std::vector<u8> response = DSP::HLE::PipeRead(pipe, size);
-
-        Memory::WriteBlock(addr, response.data(), response.size());
-
-        cmd_buff[2] = static_cast<u32>(response.size());
+        cmd_buff[2] = static_cast<u32>(DSP::HLE::PipeReadToMemory(pipe, addr, size));
     } else {
         cmd_buff[2] = 0; // Return no data
     }
@@ -406,13 +401,11 @@ static void ReadPipe(Service::Interface* self) {
                size, addr);
 
     if (DSP::HLE::GetPipeReadableSize(pipe) >= size) {
-        std::vector<u8> response = DSP::HLE::PipeRead(pipe, size);
-
-        Memory::WriteBlock(addr, response.data(), response.size());
+        const size_t read_size = DSP::HLE::PipeReadToMemory(pipe, addr, size);
 
         cmd_buff[0] = IPC::MakeHeader(0xE, 2, 2);
         cmd_buff[1] = RESULT_SUCCESS.raw; // No error
-        cmd_buff[2] = static_cast<u32>(response.size());
+        cmd_buff[2] = static_cast<u32>(read_size);
         cmd_buff[3] = IPC::StaticBufferDesc(size, 0);
         cmd_buff[4] = addr;
     } else {
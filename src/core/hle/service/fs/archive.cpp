@@ -2,12 +2,15 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <chrono>
+#include <cinttypes>
 #include <cstddef>
 #include <memory>
 #include <system_error>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 #include <boost/container/flat_map.hpp>
 #include "common/assert.h"
 #include "common/common_types.h"
@@ -81,8 +84,72 @@ enum class DirectoryCommand : u32 {
     Close = 0x08020000,
 };
 
-File::File(std::unique_ptr<FileSys::FileBackend>&& backend, const FileSys::Path& path)
-    : path(path), priority(0), backend(std::move(backend)) {}
+/// Read statistics of each archive type, accumulated since the archives were initialized
+static std::unordered_map<ArchiveIdCode, ArchiveReadStats> archive_read_stats;
+
+ResultVal<size_t> ReadFileToMemory(const FileSys::FileBackend& backend, u64 offset, size_t length,
+                                   VAddr address) {
+    std::vector<u8> bounce_buffer;
+    size_t total_read = 0;
+    while (total_read < length) {
+        size_t chunk_size = length - total_read;
+        u8* buffer = Memory::GetDirectPointer(address + static_cast<VAddr>(total_read), chunk_size);
+        if (buffer == nullptr) {
+            bounce_buffer.resize(chunk_size);
+            buffer = bounce_buffer.data();
+        }
+
+        ResultVal<size_t> read = backend.Read(offset + total_read, chunk_size, buffer);
+        if (read.Failed())
+            return read.Code();
+        if (buffer == bounce_buffer.data()) {
+            Memory::WriteBlock(address + static_cast<VAddr>(total_read), buffer, *read);
+        }
+
+        total_read += *read;
+        // The end of the file was reached
+        if (*read < chunk_size)
+            break;
+    }
+    return MakeResult<size_t>(total_read);
+}
+
+ResultVal<size_t> WriteFileFromMemory(const FileSys::FileBackend& backend, u64 offset,
+                                      size_t length, bool flush, VAddr address) {
+    std::vector<u8> bounce_buffer;
+    size_t total_written = 0;
+    // Writes at least once, so that empty writes still flush
+    do {
+        size_t chunk_size = length - total_written;
+        const VAddr chunk_address = address + static_cast<VAddr>(total_written);
+        const u8* buffer = Memory::GetDirectPointer(chunk_address, chunk_size);
+        if (buffer == nullptr) {
+            bounce_buffer.resize(chunk_size);
+            Memory::ReadBlock(chunk_address, bounce_buffer.data(), chunk_size);
+            buffer = bounce_buffer.data();
+        }
+
+        const bool last_chunk = total_written + chunk_size == length;
+        ResultVal<size_t> written =
+            backend.Write(offset + total_written, chunk_size, flush && last_chunk, buffer);
+        if (written.Failed())
+            return written.Code();
+
+        total_written += *written;
+        if (*written < chunk_size)
+            break;
+    } while (total_written < length);
+    return MakeResult<size_t>(total_written);
+}
+
+ArchiveReadStats GetArchiveReadStats(ArchiveIdCode id_code) {
+    auto itr = archive_read_stats.find(id_code);
+    return itr == archive_read_stats.end() ? ArchiveReadStats{} : itr->second;
+}
+
+File::File(std::unique_ptr<FileSys::FileBackend>&& backend, const FileSys::Path& path,
+           ArchiveIdCode archive_id_code)
+    : path(path), priority(0), backend(std::move(backend)), archive_id_code(archive_id_code) {}
 
 File::~File() {}
 
@@ -109,13 +176,15 @@ void File::HandleSyncRequest(Kernel::SharedPtr<Kernel::ServerSession> server_ses
                       offset, length, backend->GetSize());
         }
 
-        std::vector<u8> data(length);
-        ResultVal<size_t> read = backend->Read(offset, data.size(), data.data());
+        const auto start = std::chrono::steady_clock::now();
+        ResultVal<size_t> read = ReadFileToMemory(*backend, offset, length, address);
         if (read.Failed()) {
             cmd_buff[1] = read.Code().raw;
             return;
         }
-        Memory::WriteBlock(address, data.data(), *read);
+        ArchiveReadStats& stats = archive_read_stats[archive_id_code];
+        stats.bytes_read += *read;
+        stats.read_time += std::chrono::steady_clock::now() - start;
         cmd_buff[2] = static_cast<u32>(*read);
         break;
     }
@@ -129,9 +198,8 @@ void File::HandleSyncRequest(Kernel::SharedPtr<Kernel::ServerSession> server_ses
         LOG_TRACE(Service_FS, "Write %s: offset=0x%llx length=%d address=0x%x, flush=0x%x",
                   GetName().c_str(), offset, length, address, flush);
 
-        std::vector<u8> data(length);
-        Memory::ReadBlock(address, data.data(), data.size());
-        ResultVal<size_t> written = backend->Write(offset, data.size(), flush != 0, data.data());
+        ResultVal<size_t> written =
+            WriteFileFromMemory(*backend, offset, length, flush != 0, address);
         if (written.Failed()) {
             cmd_buff[1] = written.Code().raw;
             return;
@@ -249,15 +317,25 @@ using FileSys::ArchiveFactory;
  */
 static boost::container::flat_map<ArchiveIdCode, std::unique_ptr<ArchiveFactory>> id_code_map;
 
+struct OpenedArchive {
+    ArchiveIdCode id_code;
+    std::unique_ptr<ArchiveBackend> backend;
+};
+
 /**
- * Map of active archive handles. Values are pointers to the archives in `idcode_map`.
+ * Map of active archive handles, with the archives and the id codes they were opened with.
  */
-static std::unordered_map<ArchiveHandle, std::unique_ptr<ArchiveBackend>> handle_map;
+static std::unordered_map<ArchiveHandle, OpenedArchive> handle_map;
 static ArchiveHandle next_handle;
 
-static ArchiveBackend* GetArchive(ArchiveHandle handle) {
+static OpenedArchive* GetOpenedArchive(ArchiveHandle handle) {
     auto itr = handle_map.find(handle);
-    return (itr == handle_map.end()) ? nullptr : itr->second.get();
+    return (itr == handle_map.end()) ? nullptr : &itr->second;
+}
+
+static ArchiveBackend* GetArchive(ArchiveHandle handle) {
+    OpenedArchive* archive = GetOpenedArchive(handle);
+    return archive == nullptr ? nullptr : archive->backend.get();
 }
 
 ResultVal<ArchiveHandle> OpenArchive(ArchiveIdCode id_code, FileSys::Path& archive_path) {
@@ -274,7 +352,7 @@ ResultVal<ArchiveHandle> OpenArchive(ArchiveIdCode id_code, FileSys::Path& archi
     while (handle_map.count(next_handle) != 0) {
         ++next_handle;
     }
-    handle_map.emplace(next_handle, std::move(res));
+    handle_map.emplace(next_handle, OpenedArchive{id_code, std::move(res)});
     return MakeResult<ArchiveHandle>(next_handle++);
 }
 
@@ -303,15 +381,16 @@ ResultCode RegisterArchiveType(std::unique_ptr<FileSys::ArchiveFactory>&& factor
 ResultVal<std::shared_ptr<File>> OpenFileFromArchive(ArchiveHandle archive_handle,
                                                      const FileSys::Path& path,
                                                      const FileSys::Mode mode) {
-    ArchiveBackend* archive = GetArchive(archive_handle);
+    OpenedArchive* archive = GetOpenedArchive(archive_handle);
     if (archive == nullptr)
         return FileSys::ERR_INVALID_ARCHIVE_HANDLE;
 
-    auto backend = archive->OpenFile(path, mode);
+    auto backend = archive->backend->OpenFile(path, mode);
     if (backend.Failed())
         return backend.Code();
 
-    auto file = std::shared_ptr<File>(new File(std::move(backend).Unwrap(), path));
+    auto file =
+        std::shared_ptr<File>(new File(std::move(backend).Unwrap(), path, archive->id_code));
     return MakeResult<std::shared_ptr<File>>(std::move(file));
 }
 
@@ -573,6 +652,7 @@ void UnregisterArchiveTypes() {
 /// Initialize archives
 void ArchiveInit() {
     next_handle = 1;
+    archive_read_stats.clear();
 
     AddService(new FS::Interface);
 
@@ -581,6 +661,11 @@ void ArchiveInit() {
 
 /// Shutdown archives
 void ArchiveShutdown() {
+    for (const auto& entry : archive_read_stats) {
+        LOG_DEBUG(Service_FS, "Read %" PRIu64 " bytes from archive 0x%08X at %.1f MB/s",
+                  entry.second.bytes_read, static_cast<u32>(entry.first),
+                  entry.second.GetThroughput() / 1e6);
+    }
     handle_map.clear();
     UnregisterArchiveTypes();
 }
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include "common/common_types.h"
@@ -43,9 +44,21 @@ enum class MediaType : u32 { NAND = 0, SDMC = 1, GameCard = 2 };
 
 typedef u64 ArchiveHandle;
 
+/// Amount of data read through the files of an archive type, and the time spent reading it
+struct ArchiveReadStats {
+    u64 bytes_read = 0;
+    std::chrono::nanoseconds read_time{0};
+
+    /// Gets the read throughput in bytes per second
+    double GetThroughput() const {
+        return read_time.count() != 0 ? bytes_read * 1e9 / read_time.count() : 0.0;
+    }
+};
+
 class File final : public Kernel::SessionRequestHandler {
 public:
-    File(std::unique_ptr<FileSys::FileBackend>&& backend, const FileSys::Path& path);
+    File(std::unique_ptr<FileSys::FileBackend>&& backend, const FileSys::Path& path,
+         ArchiveIdCode archive_id_code);
     ~File();
 
     std::string GetName() const {
@@ -55,6 +68,7 @@ public:
     FileSys::Path path; ///< Path of the file
     u32 priority;       ///< Priority of the file. TODO(Subv): Find out what this means
     std::unique_ptr<FileSys::FileBackend> backend; ///< File backend interface
+    ArchiveIdCode archive_id_code; ///< Type of the archive the file was opened from
 
 protected:
     void HandleSyncRequest(Kernel::SharedPtr<Kernel::ServerSession> server_session) override;
@@ -76,6 +90,38 @@ protected:
     void HandleSyncRequest(Kernel::SharedPtr<Kernel::ServerSession> server_session) override;
 };
 
+/**
+ * Reads from a file straight into emulated memory. The memory which can't be accessed directly
+ * from the host, such as memory cached by the rasterizer, goes through a bounce buffer.
+ * @param backend File to read from
+ * @param offset Offset in bytes in the file to start reading from
+ * @param length Length in bytes of the data to read
+ * @param address Virtual address of the memory to read into
+ * @return Number of bytes read, or error code
+ */
+ResultVal<size_t> ReadFileToMemory(const FileSys::FileBackend& backend, u64 offset, size_t length,
+                                   VAddr address);
+
+/**
+ * Writes to a file straight from emulated memory. The memory which can't be accessed directly
+ * from the host, such as memory cached by the rasterizer, goes through a bounce buffer.
+ * @param backend File to write to
+ * @param offset Offset in bytes in the file to start writing to
+ * @param length Length in bytes of the data to write
+ * @param flush Whether to flush the file once written
+ * @param address Virtual address of the memory to write from
+ * @return Number of bytes written, or error code
+ */
+ResultVal<size_t> WriteFileFromMemory(const FileSys::FileBackend& backend, u64 offset,
+                                      size_t length, bool flush, VAddr address);
+
+/**
+ * Gets the amount of data read through the files of an archive type since the archives were
+ * initialized, and the time spent reading it.
+ * @param id_code IdCode of the archive type
+ */
+ArchiveReadStats GetArchiveReadStats(ArchiveIdCode id_code);
+
 /**
  * Opens an archive
  * @param id_code IdCode of the archive to open
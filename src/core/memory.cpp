@@ -292,6 +292,28 @@ u8* GetPointer(const VAddr vaddr) {
     return nullptr;
 }
 
+u8* GetDirectPointer(const VAddr vaddr, size_t& size) {
+    size_t page_index = vaddr >> PAGE_BITS;
+    u8* const page_pointer = current_page_table->pointers[page_index];
+    size_t run_size = PAGE_SIZE - (vaddr & PAGE_MASK);
+
+    // Extends the run over the following pages while they are contiguous on the host, or while they
+    // can't be accessed directly either. Only regular memory pages have pointers.
+    while (run_size < size && page_index + 1 < PAGE_TABLE_NUM_ENTRIES) {
+        const u8* const next_page_pointer = current_page_table->pointers[page_index + 1];
+        if (page_pointer != nullptr
+                ? next_page_pointer != current_page_table->pointers[page_index] + PAGE_SIZE
+                : next_page_pointer != nullptr) {
+            break;
+        }
+        ++page_index;
+        run_size += PAGE_SIZE;
+    }
+
+    size = std::min(size, run_size);
+    return page_pointer != nullptr ? page_pointer + (vaddr & PAGE_MASK) : nullptr;
+}
+
 std::string ReadCString(VAddr vaddr, std::size_t max_length) {
     std::string string;
     string.reserve(max_length);
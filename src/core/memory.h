@@ -145,6 +145,18 @@ void CopyBlock(VAddr dest_addr, VAddr src_addr, size_t size);
 
 u8* GetPointer(VAddr virtual_address);
 
+/**
+ * Gets a pointer to emulated memory which can be accessed directly from the host, which is only
+ * the case for regular memory which isn't cached by the rasterizer.
+ * @param vaddr Virtual address of the memory.
+ * @param size Number of bytes to access. It is reduced to the number of bytes from vaddr on which
+ * are contiguous on the host and can be accessed through the returned pointer, or to the number of
+ * bytes which can't be accessed directly if the returned pointer is null.
+ * @returns Pointer to the memory, or nullptr if it can't be accessed directly, in which case it
+ * has to go through ReadBlock and WriteBlock.
+ */
+u8* GetDirectPointer(VAddr vaddr, size_t& size);
+
 std::string ReadCString(VAddr virtual_address, std::size_t max_length);
 
 /**
@@ -40,6 +40,13 @@ void PerfStats::EndGameFrame() {
     game_frames += 1;
 }
 
+void PerfStats::AddBatch(u32 draws) {
+    std::lock_guard<std::mutex> lock(object_mutex);
+
+    this->draws += draws;
+    batches += 1;
+}
+
 PerfStats::Results PerfStats::GetAndResetStats(u64 current_system_time_us) {
     std::lock_guard<std::mutex> lock(object_mutex);
 
@@ -56,6 +63,10 @@ PerfStats::Results PerfStats::GetAndResetStats(u64 current_system_time_us) {
     results.frametime = duration_cast<DoubleSecs>(accumulated_frametime).count() /
                         static_cast<double>(system_frames);
     results.emulation_speed = system_us_per_second / 1'000'000.0;
+    if (game_frames != 0) {
+        results.draws_per_frame = static_cast<double>(draws) / game_frames;
+        results.batches_per_frame = static_cast<double>(batches) / game_frames;
+    }
 
     // Reset counters
     reset_point = now;
@@ -63,6 +74,8 @@ PerfStats::Results PerfStats::GetAndResetStats(u64 current_system_time_us) {
     accumulated_frametime = Clock::duration::zero();
     system_frames = 0;
     game_frames = 0;
+    draws = 0;
+    batches = 0;
 
     return results;
 }
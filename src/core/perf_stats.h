@@ -27,12 +27,19 @@ public:
         double frametime;
         /// Ratio of walltime / emulated time elapsed
         double emulation_speed;
+        /// Pica draws per game frame
+        double draws_per_frame;
+        /// Batches of host GPU draw calls per game frame
+        double batches_per_frame;
     };
 
     void BeginSystemFrame();
     void EndSystemFrame();
     void EndGameFrame();
 
+    /// Records a batch of host GPU draw calls that merged the given number of Pica draws
+    void AddBatch(u32 draws);
+
     Results GetAndResetStats(u64 current_system_time_us);
 
     /**
@@ -55,6 +62,10 @@ private:
     u32 system_frames = 0;
     /// Cumulative number of game frames (GSP frame submissions) since last reset
     u32 game_frames = 0;
+    /// Cumulative number of Pica draws since last reset
+    u32 draws = 0;
+    /// Cumulative number of host GPU draw batches since last reset
+    u32 batches = 0;
 
     /// Point when the previous system frame ended
     Clock::time_point previous_frame_end = reset_point;
@@ -31,6 +31,8 @@ void Apply() {
 
     AudioCore::SelectSink(values.sink_id);
     AudioCore::EnableStretching(values.enable_audio_stretching);
+    AudioCore::EnableParallelSources(values.enable_parallel_audio_sources);
+    AudioCore::EnableOfflineRendering(values.enable_offline_audio);
 
     Service::HID::ReloadInputDevices();
     Service::IR::ReloadInputDevices();
@@ -92,6 +92,10 @@ struct Values {
     // Renderer
     bool use_hw_renderer;
     bool use_shader_jit;
+    bool use_shader_jit_specialization;
+    bool use_disk_shader_cache;
+    bool use_uber_shader;
+    bool use_gpu_texture_decode;
     float resolution_factor;
     bool use_vsync;
     bool toggle_framelimit;
@@ -117,7 +121,10 @@ struct Values {
     // Audio
     std::string sink_id;
     bool enable_audio_stretching;
+    bool enable_parallel_audio_sources;
+    bool enable_offline_audio;
     std::string audio_device_id;
+    std::string audio_file_path;
 
     // Camera
     std::array<std::string, Service::CAM::NumCameras> camera_name;
@@ -64,6 +64,11 @@ enum CTStreamElementType : u32 {
     FrameMarker = 0xE1,
     MemoryLoad = 0xE2,
     RegisterWrite = 0xE3,
+
+    // Version 2 only
+    StateSnapshot = 0xE4,
+    MemoryBlob = 0xE5,
+    MemoryUpdate = 0xE6,
 };
 
 struct CTMemoryLoad {
@@ -96,5 +101,118 @@ struct CTStreamElement {
     };
 };
 
+/*
+ * Version 2 layout
+ *
+ * The file starts with a CTHeaderV2, followed by the chunks and finally the index the header points
+ * to: chunk_count CTChunkV2, frame_count CTFrameV2 and blob_count CTBlobV2 entries, in this order.
+ *
+ * Each chunk holds a sequence of records, optionally compressed. A record is a
+ * CTStreamElementType followed by its data:
+ * - FrameMarker: nothing
+ * - RegisterWrite: CTRegisterWrite
+ * - StateSnapshot: CTStateSnapshot, followed by its blocks
+ * - MemoryBlob: CTMemoryBlob, followed by the blob contents
+ * - MemoryUpdate: CTMemoryUpdate
+ *
+ * Memory contents are stored once per distinct content (identified by a 64-bit hash) as blobs, and
+ * memory updates refer to them. Updates never cross page boundaries, and pages whose contents
+ * didn't change since they were last recorded aren't recorded again.
+ *
+ * State snapshot blocks hold the raw register and table words, except for shader uniforms and
+ * default attributes: floats are stored as IEEE 754 single precision values, 4 per vector, and
+ * boolean and integer uniforms as one byte per value.
+ *
+ * Keyframe chunks start with a StateSnapshot and the memory updates restoring all recorded memory,
+ * so that playback can start at any frame from the closest preceding keyframe.
+ */
+
+struct CTHeaderV2 {
+    static u32 ExpectedVersion() {
+        return 2;
+    }
+
+    char magic[4];
+    u32 version;
+    u32 header_size;
+    u32 page_size;
+
+    u32 chunk_count;
+    u32 frame_count;
+    u32 blob_count;
+    u32 pad;
+
+    u64 index_offset;
+};
+
+struct CTChunkV2 {
+    enum : u32 {
+        Compressed = 1 << 0,
+        Keyframe = 1 << 1,
+    };
+
+    u64 file_offset;
+    u32 stored_size;
+    u32 size; ///< Uncompressed size
+    u32 flags;
+    u32 keyframe_size; ///< Size of the records restoring the state at the start of a keyframe
+};
+
+struct CTFrameV2 {
+    u32 chunk;
+    u32 offset; ///< Offset of the first record of the frame in the uncompressed chunk
+};
+
+struct CTBlobV2 {
+    u32 chunk;
+    u32 offset; ///< Offset of the contents in the uncompressed chunk
+    u32 size;
+    u32 pad;
+    u64 hash;
+};
+
+struct CTStateSnapshot {
+    u32 block_count;
+};
+
+struct CTStateBlock {
+    enum Id : u32 {
+        GpuRegisters = 1,
+        LcdRegisters,
+        PicaRegisters,
+        DefaultAttributes,
+        VsProgramBinary,
+        VsSwizzleData,
+        VsFloatUniforms,
+        VsBoolUniforms,
+        VsIntUniforms,
+        GsProgramBinary,
+        GsSwizzleData,
+        GsFloatUniforms,
+        GsBoolUniforms,
+        GsIntUniforms,
+        LightingLuts,
+        FogLut,
+        ProcTexNoiseTable,
+        ProcTexColorMapTable,
+        ProcTexAlphaMapTable,
+        ProcTexColorTable,
+        ProcTexColorDiffTable,
+    } id;
+
+    u32 size; ///< Size of the data following this in bytes
+};
+
+struct CTMemoryBlob {
+    u32 id;
+    u32 size;
+};
+
+struct CTMemoryUpdate {
+    u32 physical_address;
+    u32 size;
+    u32 blob_id;
+};
+
 #pragma pack()
 }
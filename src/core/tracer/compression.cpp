@@ -0,0 +1,146 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include "core/tracer/compression.h"
+
+// The data is a sequence of matches, each preceded by the literals before it. A sequence is a
+// token byte holding the literal length in its upper and the match length in its lower nibble,
+// the literals, and a 16-bit little-endian distance to the match. Lengths that don't fit a nibble
+// continue in extra bytes, which are summed up until one is lower than 255. The last sequence
+// consists only of literals.
+
+namespace CiTrace {
+namespace Compression {
+
+constexpr size_t MIN_MATCH_LENGTH = 4;
+constexpr size_t MAX_MATCH_DISTANCE = 0xFFFF;
+constexpr unsigned HASH_BITS = 16;
+
+static u32 Read32(const u8* data) {
+    u32 value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static u32 HashSequence(u32 sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void WriteExtraLength(std::vector<u8>& out, size_t length) {
+    for (length -= 15; length >= 255; length -= 255) {
+        out.push_back(255);
+    }
+    out.push_back(static_cast<u8>(length));
+}
+
+static bool ReadExtraLength(const u8* data, size_t size, size_t& pos, size_t& length) {
+    u8 value;
+    do {
+        if (pos == size)
+            return false;
+        value = data[pos++];
+        length += value;
+    } while (value == 255);
+    return true;
+}
+
+static void WriteSequence(std::vector<u8>& out, const u8* literals, size_t literal_length,
+                          size_t match_length, size_t match_distance) {
+    size_t encoded_match_length = match_length != 0 ? match_length - MIN_MATCH_LENGTH : 0;
+    out.push_back(static_cast<u8>((std::min<size_t>(literal_length, 15) << 4) |
+                                  std::min<size_t>(encoded_match_length, 15)));
+    if (literal_length >= 15) {
+        WriteExtraLength(out, literal_length);
+    }
+    out.insert(out.end(), literals, literals + literal_length);
+
+    if (match_length != 0) {
+        out.push_back(static_cast<u8>(match_distance));
+        out.push_back(static_cast<u8>(match_distance >> 8));
+        if (encoded_match_length >= 15) {
+            WriteExtraLength(out, encoded_match_length);
+        }
+    }
+}
+
+std::vector<u8> Compress(const u8* data, size_t size) {
+    std::vector<u8> out;
+    out.reserve(size / 2 + 16);
+
+    // Most recent position of each hashed 4-byte sequence
+    std::vector<u32> positions(1 << HASH_BITS, 0);
+
+    size_t literals_start = 0;
+    size_t pos = 0;
+    while (pos + MIN_MATCH_LENGTH <= size) {
+        u32 sequence = Read32(data + pos);
+        u32& entry = positions[HashSequence(sequence)];
+        size_t candidate = entry;
+        entry = static_cast<u32>(pos);
+
+        if (candidate >= pos || pos - candidate > MAX_MATCH_DISTANCE ||
+            Read32(data + candidate) != sequence) {
+            ++pos;
+            continue;
+        }
+
+        size_t length = MIN_MATCH_LENGTH;
+        while (pos + length < size && data[candidate + length] == data[pos + length]) {
+            ++length;
+        }
+
+        WriteSequence(out, data + literals_start, pos - literals_start, length, pos - candidate);
+        pos += length;
+        literals_start = pos;
+    }
+
+    WriteSequence(out, data + literals_start, size - literals_start, 0, 0);
+    return out;
+}
+
+bool Decompress(const u8* data, size_t size, u8* out, size_t out_size) {
+    size_t pos = 0;
+    size_t out_pos = 0;
+    while (true) {
+        // Data ending right after a match has been truncated
+        if (pos == size)
+            return false;
+        u8 token = data[pos++];
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !ReadExtraLength(data, size, pos, literal_length))
+            return false;
+        if (literal_length > size - pos || literal_length > out_size - out_pos)
+            return false;
+        std::copy_n(data + pos, literal_length, out + out_pos);
+        pos += literal_length;
+        out_pos += literal_length;
+
+        // The last sequence has no match
+        if (pos == size)
+            return out_pos == out_size;
+
+        if (size - pos < 2)
+            return false;
+        size_t distance = data[pos] | (data[pos + 1] << 8);
+        pos += 2;
+
+        size_t match_length = token & 0xF;
+        if (match_length == 15 && !ReadExtraLength(data, size, pos, match_length))
+            return false;
+        match_length += MIN_MATCH_LENGTH;
+        if (distance == 0 || distance > out_pos || match_length > out_size - out_pos)
+            return false;
+
+        // Matches may overlap the bytes they produce, so this has to go forward byte by byte
+        for (size_t i = 0; i < match_length; ++i, ++out_pos) {
+            out[out_pos] = out[out_pos - distance];
+        }
+    }
+}
+
+} // namespace Compression
+} // namespace CiTrace
@@ -0,0 +1,32 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "common/common_types.h"
+
+/**
+ * Byte-oriented LZ77 compression for CiTrace chunks. It is tuned for speed rather than ratio since
+ * chunks are compressed while recording, and works well on the highly repetitive command lists and
+ * memory contents of traces.
+ */
+namespace CiTrace {
+namespace Compression {
+
+/// Compresses the given data, the result may be larger than the input for incompressible data
+std::vector<u8> Compress(const u8* data, size_t size);
+
+/**
+ * Decompresses data produced by Compress.
+ * @param size Size of the compressed data
+ * @param out Buffer receiving the decompressed data
+ * @param out_size Size of the decompressed data, which has to be known in advance
+ * @return False if the data is corrupted or doesn't decompress to exactly out_size bytes
+ */
+bool Decompress(const u8* data, size_t size, u8* out, size_t out_size);
+
+} // namespace Compression
+} // namespace CiTrace
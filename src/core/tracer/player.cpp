@@ -0,0 +1,554 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "core/hw/gpu.h"
+#include "core/hw/hw.h"
+#include "core/hw/lcd.h"
+#include "core/memory.h"
+#include "core/tracer/citrace.h"
+#include "core/tracer/compression.h"
+#include "core/tracer/player.h"
+#include "core/tracer/state_snapshot.h"
+#include "video_core/pica_state.h"
+#include "video_core/rasterizer_interface.h"
+#include "video_core/renderer_base.h"
+#include "video_core/video_core.h"
+
+namespace CiTrace {
+
+/// Common interface of the supported format versions
+class Player::Trace {
+public:
+    virtual ~Trace() = default;
+
+    virtual size_t GetFrameCount() const = 0;
+
+    /// Returns the closest frame at or before the given one that playback can start from
+    virtual size_t FindKeyframe(size_t frame) const = 0;
+
+    /// Restores the state at the start of a frame returned by FindKeyframe
+    virtual void RestoreKeyframe(size_t frame) = 0;
+
+    virtual void ReplayFrame(size_t frame) = 0;
+};
+
+static void ReplayMemoryLoad(u32 physical_address, const u8* data, u32 size) {
+    u8* dest = Memory::GetPhysicalPointer(physical_address);
+    if (dest == nullptr) {
+        LOG_ERROR(HW_GPU, "Memory load to unmapped address 0x%08X", physical_address);
+        return;
+    }
+
+    // Cached copies of the region would otherwise shadow, or later overwrite, the new data
+    Memory::RasterizerFlushAndInvalidateRegion(physical_address, size);
+    std::memcpy(dest, data, size);
+}
+
+static void ReplayRegisterWrite(const CTRegisterWrite& write) {
+    VAddr addr = Memory::PhysicalToVirtualAddress(write.physical_address);
+    switch (write.size) {
+    case CTRegisterWrite::SIZE_8:
+        HW::Write<u8>(addr, static_cast<u8>(write.value));
+        break;
+    case CTRegisterWrite::SIZE_16:
+        HW::Write<u16>(addr, static_cast<u16>(write.value));
+        break;
+    case CTRegisterWrite::SIZE_32:
+        HW::Write<u32>(addr, static_cast<u32>(write.value));
+        break;
+    case CTRegisterWrite::SIZE_64:
+        HW::Write<u64>(addr, write.value);
+        break;
+    default:
+        LOG_ERROR(HW_GPU, "Unknown register write size 0x%X", static_cast<u32>(write.size));
+        break;
+    }
+}
+
+/// Version 1 traces, which are small enough to be kept in memory as a whole
+class TraceV1 final : public Player::Trace {
+public:
+    bool Load(std::vector<u8> data) {
+        file_data = std::move(data);
+        std::memcpy(&header, file_data.data(), sizeof(header));
+
+        auto in_file = [this](u64 offset, u64 size) { return offset + size <= file_data.size(); };
+
+        const auto& initial = header.initial_state_offsets;
+        const std::array<std::pair<u32, u32>, 10> initial_state_ranges = {{
+            {initial.gpu_registers, initial.gpu_registers_size},
+            {initial.lcd_registers, initial.lcd_registers_size},
+            {initial.pica_registers, initial.pica_registers_size},
+            {initial.default_attributes, initial.default_attributes_size},
+            {initial.vs_program_binary, initial.vs_program_binary_size},
+            {initial.vs_swizzle_data, initial.vs_swizzle_data_size},
+            {initial.vs_float_uniforms, initial.vs_float_uniforms_size},
+            {initial.gs_program_binary, initial.gs_program_binary_size},
+            {initial.gs_swizzle_data, initial.gs_swizzle_data_size},
+            {initial.gs_float_uniforms, initial.gs_float_uniforms_size},
+        }};
+        for (const auto& range : initial_state_ranges) {
+            if (!in_file(range.first, u64{range.second} * sizeof(u32))) {
+                LOG_ERROR(HW_GPU, "Initial state exceeds the end of the file");
+                return false;
+            }
+        }
+
+        if (!in_file(header.stream_offset, u64{header.stream_size} * sizeof(CTStreamElement))) {
+            LOG_ERROR(HW_GPU, "Stream exceeds the end of the file");
+            return false;
+        }
+
+        stream.resize(header.stream_size);
+        std::memcpy(stream.data(), file_data.data() + header.stream_offset,
+                    stream.size() * sizeof(CTStreamElement));
+
+        for (size_t i = 0; i < stream.size(); ++i) {
+            if (i == 0 || stream[i - 1].type == FrameMarker) {
+                frame_starts.push_back(i);
+            }
+
+            if (stream[i].type == MemoryLoad) {
+                const auto& load = stream[i].memory_load;
+                if (!in_file(load.file_offset, load.size)) {
+                    LOG_ERROR(HW_GPU, "Memory load %zu exceeds the end of the file", i);
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    size_t GetFrameCount() const override {
+        return frame_starts.size();
+    }
+
+    size_t FindKeyframe(size_t frame) const override {
+        // Only the initial state is known
+        return 0;
+    }
+
+    void RestoreKeyframe(size_t frame) override {
+        const auto& initial = header.initial_state_offsets;
+        const u8* data = file_data.data();
+
+        CopyInitialState(data + initial.gpu_registers, initial.gpu_registers_size, &GPU::g_regs,
+                         sizeof(GPU::g_regs));
+        CopyInitialState(data + initial.lcd_registers, initial.lcd_registers_size, &LCD::g_regs,
+                         sizeof(LCD::g_regs));
+        CopyInitialState(data + initial.pica_registers, initial.pica_registers_size,
+                         &Pica::g_state.regs, sizeof(Pica::g_state.regs));
+
+        auto& default_attributes = Pica::g_state.input_default_attributes.attr;
+        CopyInitialState(data + initial.default_attributes, initial.default_attributes_size,
+                         default_attributes, std::extent<decltype(default_attributes)>::value);
+
+        auto& vs = Pica::g_state.vs;
+        CopyInitialState(data + initial.vs_program_binary, initial.vs_program_binary_size,
+                         vs.program_code.data(), sizeof(vs.program_code));
+        CopyInitialState(data + initial.vs_swizzle_data, initial.vs_swizzle_data_size,
+                         vs.swizzle_data.data(), sizeof(vs.swizzle_data));
+        CopyInitialState(data + initial.vs_float_uniforms, initial.vs_float_uniforms_size,
+                         vs.uniforms.f, std::extent<decltype(vs.uniforms.f)>::value);
+
+        auto& gs = Pica::g_state.gs;
+        CopyInitialState(data + initial.gs_program_binary, initial.gs_program_binary_size,
+                         gs.program_code.data(), sizeof(gs.program_code));
+        CopyInitialState(data + initial.gs_swizzle_data, initial.gs_swizzle_data_size,
+                         gs.swizzle_data.data(), sizeof(gs.swizzle_data));
+        CopyInitialState(data + initial.gs_float_uniforms, initial.gs_float_uniforms_size,
+                         gs.uniforms.f, std::extent<decltype(gs.uniforms.f)>::value);
+    }
+
+    void ReplayFrame(size_t frame) override {
+        size_t end = frame + 1 < frame_starts.size() ? frame_starts[frame + 1] : stream.size();
+        for (size_t i = frame_starts[frame]; i < end; ++i) {
+            const CTStreamElement& element = stream[i];
+            switch (element.type) {
+            case FrameMarker:
+                break;
+            case MemoryLoad:
+                ReplayMemoryLoad(element.memory_load.physical_address,
+                                 file_data.data() + element.memory_load.file_offset,
+                                 element.memory_load.size);
+                break;
+            case RegisterWrite:
+                ReplayRegisterWrite(element.register_write);
+                break;
+            default:
+                LOG_ERROR(HW_GPU, "Unknown stream element type 0x%X",
+                          static_cast<u32>(element.type));
+                break;
+            }
+        }
+    }
+
+private:
+    /// Copies as many words of an initial state block as fit into the destination
+    static void CopyInitialState(const u8* source, u32 size, void* dest, size_t dest_size) {
+        std::memcpy(dest, source, std::min<size_t>(size * sizeof(u32), dest_size));
+    }
+
+    /// Restores float24 vectors, which are stored as one raw value per component
+    static void CopyInitialState(const u8* source, u32 size, Math::Vec4<Pica::float24>* dest,
+                                 size_t count) {
+        for (size_t i = 0; i < std::min<size_t>(size / 4, count); ++i) {
+            for (size_t comp = 0; comp < 4; ++comp) {
+                u32 value;
+                std::memcpy(&value, source + (i * 4 + comp) * sizeof(u32), sizeof(u32));
+                dest[i][comp] = Pica::float24::FromRaw(value);
+            }
+        }
+    }
+
+    std::vector<u8> file_data;
+    CTHeader header;
+    std::vector<CTStreamElement> stream;
+
+    /// Index of the first stream element of each frame
+    std::vector<size_t> frame_starts;
+};
+
+/// Version 2 traces, whose chunks are read from the file as needed
+class TraceV2 final : public Player::Trace {
+public:
+    bool Load(FileUtil::IOFile trace_file) {
+        file = std::move(trace_file);
+        const u64 file_size = file.GetSize();
+
+        if (!file.Seek(0, SEEK_SET) || file.ReadArray(&header, 1) != 1 ||
+            header.index_offset > file_size) {
+            LOG_ERROR(HW_GPU, "Could not read the header");
+            return false;
+        }
+
+        const u64 index_size = u64{header.chunk_count} * sizeof(CTChunkV2) +
+                               u64{header.frame_count} * sizeof(CTFrameV2) +
+                               u64{header.blob_count} * sizeof(CTBlobV2);
+        if (index_size > file_size - header.index_offset) {
+            LOG_ERROR(HW_GPU, "Index exceeds the end of the file");
+            return false;
+        }
+
+        chunks.resize(header.chunk_count);
+        frames.resize(header.frame_count);
+        blobs.resize(header.blob_count);
+        if (!file.Seek(header.index_offset, SEEK_SET) ||
+            file.ReadArray(chunks.data(), chunks.size()) != chunks.size() ||
+            file.ReadArray(frames.data(), frames.size()) != frames.size() ||
+            file.ReadArray(blobs.data(), blobs.size()) != blobs.size()) {
+            LOG_ERROR(HW_GPU, "Could not read the index");
+            return false;
+        }
+
+        if (chunks.empty() || !(chunks[0].flags & CTChunkV2::Keyframe)) {
+            LOG_ERROR(HW_GPU, "Missing initial state");
+            return false;
+        }
+
+        for (const auto& chunk : chunks) {
+            if (chunk.file_offset + chunk.stored_size > header.index_offset ||
+                chunk.keyframe_size > chunk.size) {
+                LOG_ERROR(HW_GPU, "Invalid chunk");
+                return false;
+            }
+        }
+
+        for (size_t i = 0; i < frames.size(); ++i) {
+            if (frames[i].chunk >= chunks.size() ||
+                frames[i].offset > chunks[frames[i].chunk].size ||
+                (i > 0 && std::tie(frames[i].chunk, frames[i].offset) <
+                              std::tie(frames[i - 1].chunk, frames[i - 1].offset))) {
+                LOG_ERROR(HW_GPU, "Invalid frame %zu", i);
+                return false;
+            }
+        }
+
+        for (const auto& blob : blobs) {
+            if (blob.chunk >= chunks.size() ||
+                u64{blob.offset} + blob.size > chunks[blob.chunk].size) {
+                LOG_ERROR(HW_GPU, "Invalid memory blob");
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    size_t GetFrameCount() const override {
+        return frames.size();
+    }
+
+    size_t FindKeyframe(size_t frame) const override {
+        u32 chunk = frames[frame].chunk;
+        while (!(chunks[chunk].flags & CTChunkV2::Keyframe)) {
+            --chunk;
+        }
+
+        // Keyframes are only started at frame boundaries, the frame follows the restored state
+        const CTFrameV2 start{chunk, chunks[chunk].keyframe_size};
+        auto keyframe = std::lower_bound(frames.begin(), frames.begin() + frame + 1, start,
+                                         [](const CTFrameV2& a, const CTFrameV2& b) {
+                                             return std::tie(a.chunk, a.offset) <
+                                                    std::tie(b.chunk, b.offset);
+                                         });
+        return static_cast<size_t>(keyframe - frames.begin());
+    }
+
+    void RestoreKeyframe(size_t frame) override {
+        const u32 chunk = frames[frame].chunk;
+        Replay({chunk, 0}, {chunk, chunks[chunk].keyframe_size});
+    }
+
+    void ReplayFrame(size_t frame) override {
+        CTFrameV2 end = frame + 1 < frames.size() ? frames[frame + 1]
+                                                  : CTFrameV2{static_cast<u32>(chunks.size()), 0};
+        Replay(frames[frame], end);
+    }
+
+private:
+    using ChunkData = std::shared_ptr<const std::vector<u8>>;
+
+    /// Number of decompressed chunks kept around for memory blobs referenced by later chunks
+    static constexpr size_t CHUNK_CACHE_SIZE = 4;
+
+    /// Replays the records in [begin, end), skipping the state restoring part of keyframes
+    void Replay(CTFrameV2 begin, CTFrameV2 end) {
+        CTFrameV2 pos = begin;
+        ChunkData data;
+        u32 data_chunk = 0;
+        while (std::tie(pos.chunk, pos.offset) < std::tie(end.chunk, end.offset)) {
+            if (pos.offset == chunks[pos.chunk].size) {
+                ++pos.chunk;
+                pos.offset = pos.chunk < chunks.size() ? chunks[pos.chunk].keyframe_size : 0;
+                continue;
+            }
+
+            if (data == nullptr || data_chunk != pos.chunk) {
+                data = GetChunk(pos.chunk);
+                data_chunk = pos.chunk;
+                if (data == nullptr)
+                    return;
+            }
+
+            size_t offset = pos.offset;
+            if (!ReplayRecord(*data, offset)) {
+                LOG_ERROR(HW_GPU, "Invalid record in chunk %u at offset 0x%X", pos.chunk,
+                          pos.offset);
+                return;
+            }
+            pos.offset = static_cast<u32>(offset);
+        }
+    }
+
+    template <typename T>
+    static bool Read(const std::vector<u8>& data, size_t& offset, T& value) {
+        if (data.size() - offset < sizeof(T))
+            return false;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    bool ReplayRecord(const std::vector<u8>& data, size_t& offset) {
+        CTStreamElementType type;
+        if (!Read(data, offset, type))
+            return false;
+
+        switch (type) {
+        case FrameMarker:
+            return true;
+
+        case RegisterWrite: {
+            CTRegisterWrite write;
+            if (!Read(data, offset, write))
+                return false;
+            ReplayRegisterWrite(write);
+            return true;
+        }
+
+        case StateSnapshot:
+            return LoadStateSnapshot(data.data(), data.size(), offset);
+
+        case MemoryBlob: {
+            // The contents are looked up through the index when they're used
+            CTMemoryBlob blob;
+            if (!Read(data, offset, blob) || data.size() - offset < blob.size)
+                return false;
+            offset += blob.size;
+            return true;
+        }
+
+        case MemoryUpdate: {
+            CTMemoryUpdate update;
+            if (!Read(data, offset, update) || update.blob_id >= blobs.size())
+                return false;
+
+            const CTBlobV2& blob = blobs[update.blob_id];
+            ChunkData blob_data = GetChunk(blob.chunk);
+            if (blob_data == nullptr)
+                return false;
+            ReplayMemoryLoad(update.physical_address, blob_data->data() + blob.offset,
+                             std::min(update.size, blob.size));
+            return true;
+        }
+
+        default:
+            return false;
+        }
+    }
+
+    ChunkData GetChunk(u32 index) {
+        auto cached = std::find_if(chunk_cache.begin(), chunk_cache.end(),
+                                   [index](const auto& entry) { return entry.first == index; });
+        if (cached != chunk_cache.end()) {
+            return cached->second;
+        }
+
+        const CTChunkV2& chunk = chunks[index];
+        std::vector<u8> stored(chunk.stored_size);
+        if (!file.Seek(chunk.file_offset, SEEK_SET) ||
+            file.ReadBytes(stored.data(), stored.size()) != stored.size()) {
+            LOG_ERROR(HW_GPU, "Could not read chunk %u", index);
+            return nullptr;
+        }
+
+        auto data = std::make_shared<std::vector<u8>>(chunk.size);
+        if (chunk.flags & CTChunkV2::Compressed) {
+            if (!Compression::Decompress(stored.data(), stored.size(), data->data(),
+                                         data->size())) {
+                LOG_ERROR(HW_GPU, "Could not decompress chunk %u", index);
+                return nullptr;
+            }
+        } else if (stored.size() == data->size()) {
+            *data = std::move(stored);
+        } else {
+            LOG_ERROR(HW_GPU, "Invalid chunk %u", index);
+            return nullptr;
+        }
+
+        if (chunk_cache.size() == CHUNK_CACHE_SIZE) {
+            chunk_cache.erase(chunk_cache.begin());
+        }
+        chunk_cache.emplace_back(index, data);
+        return data;
+    }
+
+    FileUtil::IOFile file;
+    CTHeaderV2 header;
+    std::vector<CTChunkV2> chunks;
+    std::vector<CTFrameV2> frames;
+    std::vector<CTBlobV2> blobs;
+
+    /// Recently used chunks, least recently loaded first
+    std::vector<std::pair<u32, ChunkData>> chunk_cache;
+};
+
+Player::Player() = default;
+Player::~Player() = default;
+
+bool Player::Load(const std::string& filename) {
+    trace = nullptr;
+    state_valid = false;
+
+    FileUtil::IOFile file(filename, "rb");
+    if (!file.IsOpen()) {
+        LOG_ERROR(HW_GPU, "Could not open CiTrace file %s", filename.c_str());
+        return false;
+    }
+
+    // Both versions start with the magic word and the version
+    struct {
+        char magic[4];
+        u32 version;
+    } header;
+    if (file.ReadArray(&header, 1) != 1 ||
+        std::memcmp(header.magic, CTHeader::ExpectedMagicWord(), sizeof(header.magic)) != 0) {
+        LOG_ERROR(HW_GPU, "%s is not a CiTrace file", filename.c_str());
+        return false;
+    }
+
+    if (header.version == CTHeader::ExpectedVersion()) {
+        std::vector<u8> data(file.GetSize());
+        if (!file.Seek(0, SEEK_SET) ||
+            file.ReadBytes(data.data(), data.size()) != data.size() ||
+            data.size() < sizeof(CTHeader)) {
+            LOG_ERROR(HW_GPU, "Could not read CiTrace file %s", filename.c_str());
+            return false;
+        }
+
+        auto trace_v1 = std::make_unique<TraceV1>();
+        if (!trace_v1->Load(std::move(data)))
+            return false;
+        trace = std::move(trace_v1);
+    } else if (header.version == CTHeaderV2::ExpectedVersion()) {
+        auto trace_v2 = std::make_unique<TraceV2>();
+        if (!trace_v2->Load(std::move(file)))
+            return false;
+        trace = std::move(trace_v2);
+    } else {
+        LOG_ERROR(HW_GPU, "%s uses unsupported CiTrace version %u", filename.c_str(),
+                  header.version);
+        return false;
+    }
+
+    return true;
+}
+
+size_t Player::GetFrameCount() const {
+    return trace != nullptr ? trace->GetFrameCount() : 0;
+}
+
+void Player::RestoreInitialState() {
+    state_valid = false;
+    Seek(0);
+}
+
+void Player::Seek(size_t frame) {
+    const size_t keyframe = trace->FindKeyframe(frame);
+
+    // Keep going from the current state if it is on the way to the frame
+    if (!state_valid || next_frame > frame || next_frame < keyframe) {
+        auto& rasterizer = *VideoCore::g_renderer->Rasterizer();
+
+        // Make sure nothing recorded against the previous state is still pending
+        rasterizer.FlushAll();
+
+        trace->RestoreKeyframe(keyframe);
+
+        // The registers were restored behind the rasterizer's back, let it resync its derived state
+        for (u32 id = 0; id < Pica::Regs::NUM_REGS; ++id) {
+            rasterizer.NotifyPicaRegisterChanged(id);
+        }
+
+        next_frame = keyframe;
+        state_valid = true;
+    }
+
+    for (; next_frame < frame; ++next_frame) {
+        trace->ReplayFrame(next_frame);
+    }
+}
+
+void Player::ReplayFrame(size_t frame) {
+    if (!state_valid || frame != next_frame) {
+        Seek(frame);
+    }
+
+    trace->ReplayFrame(frame);
+    next_frame = frame + 1;
+}
+
+} // namespace
@@ -0,0 +1,63 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "common/common_types.h"
+
+namespace CiTrace {
+
+/**
+ * Plays back CiTrace files written by the Recorder. The trace is replayed through the same entry
+ * points the emulated CPU uses (HW::Write and guest memory), so it drives the command processor
+ * and the active renderer exactly like the recorded title did.
+ *
+ * The caller is responsible for setting up the emulated hardware: the memory map (with FCRAM and
+ * VRAM mapped so that Memory::GetPhysicalPointer resolves them), HW and VideoCore.
+ */
+class Player {
+public:
+    Player();
+    ~Player();
+
+    /**
+     * Loads and validates a trace.
+     * @return False if the file couldn't be read or isn't a valid CiTrace
+     */
+    bool Load(const std::string& filename);
+
+    /// Number of frames in the loaded trace, including a trailing unterminated frame if any
+    size_t GetFrameCount() const;
+
+    /// Restores the GPU, LCD and Pica state the trace was recorded from
+    void RestoreInitialState();
+
+    /**
+     * Restores the state at the start of a frame. Version 2 traces start from the closest keyframe,
+     * older ones have to be replayed from the beginning.
+     * @param frame Index of the frame, in the range [0, GetFrameCount())
+     */
+    void Seek(size_t frame);
+
+    /**
+     * Replays the memory loads and register writes of a frame, seeking to it first unless it
+     * follows the previously replayed one. The frame marker terminating it is not acted upon,
+     * presenting the frame is left to the caller.
+     * @param frame Index of the frame, in the range [0, GetFrameCount())
+     */
+    void ReplayFrame(size_t frame);
+
+    class Trace;
+
+private:
+    std::unique_ptr<Trace> trace;
+
+    /// Frame whose start the replayed state corresponds to, if any
+    size_t next_frame = 0;
+    bool state_valid = false;
+};
+
+} // namespace
@@ -2,203 +2,228 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
-#include "common/assert.h"
-#include "common/file_util.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
+#include "core/memory.h"
+#include "core/tracer/compression.h"
 #include "core/tracer/recorder.h"
+#include "core/tracer/state_snapshot.h"
 
 namespace CiTrace {
 
-Recorder::Recorder(const InitialState& initial_state) : initial_state(initial_state) {}
+/// Chunks are finished at the end of the first frame exceeding this size, starting a keyframe
+constexpr size_t CHUNK_SIZE_TARGET = 4 * 1024 * 1024;
 
-void Recorder::Finish(const std::string& filename) {
-    // Setup CiTrace header
-    CTHeader header;
+/// Chunks exceeding this size are finished right away, even in the middle of a frame
+constexpr size_t CHUNK_SIZE_LIMIT = 32 * 1024 * 1024;
+
+static CTHeaderV2 MakeHeader() {
+    CTHeaderV2 header{};
     std::memcpy(header.magic, CTHeader::ExpectedMagicWord(), 4);
-    header.version = CTHeader::ExpectedVersion();
-    header.header_size = sizeof(CTHeader);
-
-    // Calculate file offsets
-    auto& initial = header.initial_state_offsets;
-
-    initial.gpu_registers_size = static_cast<u32>(initial_state.gpu_registers.size());
-    initial.lcd_registers_size = static_cast<u32>(initial_state.lcd_registers.size());
-    initial.pica_registers_size = static_cast<u32>(initial_state.pica_registers.size());
-    initial.default_attributes_size = static_cast<u32>(initial_state.default_attributes.size());
-    initial.vs_program_binary_size = static_cast<u32>(initial_state.vs_program_binary.size());
-    initial.vs_swizzle_data_size = static_cast<u32>(initial_state.vs_swizzle_data.size());
-    initial.vs_float_uniforms_size = static_cast<u32>(initial_state.vs_float_uniforms.size());
-    initial.gs_program_binary_size = static_cast<u32>(initial_state.gs_program_binary.size());
-    initial.gs_swizzle_data_size = static_cast<u32>(initial_state.gs_swizzle_data.size());
-    initial.gs_float_uniforms_size = static_cast<u32>(initial_state.gs_float_uniforms.size());
-    header.stream_size = static_cast<u32>(stream.size());
-
-    initial.gpu_registers = sizeof(header);
-    initial.lcd_registers = initial.gpu_registers + initial.gpu_registers_size * sizeof(u32);
-    initial.pica_registers = initial.lcd_registers + initial.lcd_registers_size * sizeof(u32);
-    ;
-    initial.default_attributes = initial.pica_registers + initial.pica_registers_size * sizeof(u32);
-    initial.vs_program_binary =
-        initial.default_attributes + initial.default_attributes_size * sizeof(u32);
-    initial.vs_swizzle_data =
-        initial.vs_program_binary + initial.vs_program_binary_size * sizeof(u32);
-    initial.vs_float_uniforms =
-        initial.vs_swizzle_data + initial.vs_swizzle_data_size * sizeof(u32);
-    initial.gs_program_binary =
-        initial.vs_float_uniforms + initial.vs_float_uniforms_size * sizeof(u32);
-    initial.gs_swizzle_data =
-        initial.gs_program_binary + initial.gs_program_binary_size * sizeof(u32);
-    initial.gs_float_uniforms =
-        initial.gs_swizzle_data + initial.gs_swizzle_data_size * sizeof(u32);
-    header.stream_offset = initial.gs_float_uniforms + initial.gs_float_uniforms_size * sizeof(u32);
-
-    // Iterate through stream elements, update relevant stream element data
-    for (auto& stream_element : stream) {
-        switch (stream_element.data.type) {
-        case MemoryLoad: {
-            auto& file_offset = memory_regions[stream_element.hash];
-            if (!stream_element.uses_existing_data) {
-                file_offset = header.stream_offset;
-            }
-            stream_element.data.memory_load.file_offset = file_offset;
-            break;
-        }
+    header.version = CTHeaderV2::ExpectedVersion();
+    header.header_size = sizeof(CTHeaderV2);
+    header.page_size = Memory::PAGE_SIZE;
+    return header;
+}
 
-        default:
-            // Other commands don't use any extra data
-            DEBUG_ASSERT(stream_element.extra_data.size() == 0);
-            break;
-        }
-        header.stream_offset += static_cast<u32>(stream_element.extra_data.size());
+Recorder::Recorder(const std::string& filename) : filename(filename), file(filename, "wb") {
+    if (!file.IsOpen()) {
+        LOG_ERROR(HW_GPU, "Could not open CiTrace file %s for writing", filename.c_str());
+        write_failed = true;
     }
 
-    try {
-        // Open file and write header
-        FileUtil::IOFile file(filename, "wb");
-        size_t written = file.WriteObject(header);
-        if (written != 1 || file.Tell() != initial.gpu_registers)
-            throw "Failed to write header";
-
-        // Write initial state
-        written =
-            file.WriteArray(initial_state.gpu_registers.data(), initial_state.gpu_registers.size());
-        if (written != initial_state.gpu_registers.size() || file.Tell() != initial.lcd_registers)
-            throw "Failed to write GPU registers";
-
-        written =
-            file.WriteArray(initial_state.lcd_registers.data(), initial_state.lcd_registers.size());
-        if (written != initial_state.lcd_registers.size() || file.Tell() != initial.pica_registers)
-            throw "Failed to write LCD registers";
-
-        written = file.WriteArray(initial_state.pica_registers.data(),
-                                  initial_state.pica_registers.size());
-        if (written != initial_state.pica_registers.size() ||
-            file.Tell() != initial.default_attributes)
-            throw "Failed to write Pica registers";
-
-        written = file.WriteArray(initial_state.default_attributes.data(),
-                                  initial_state.default_attributes.size());
-        if (written != initial_state.default_attributes.size() ||
-            file.Tell() != initial.vs_program_binary)
-            throw "Failed to write default vertex attributes";
-
-        written = file.WriteArray(initial_state.vs_program_binary.data(),
-                                  initial_state.vs_program_binary.size());
-        if (written != initial_state.vs_program_binary.size() ||
-            file.Tell() != initial.vs_swizzle_data)
-            throw "Failed to write vertex shader program binary";
-
-        written = file.WriteArray(initial_state.vs_swizzle_data.data(),
-                                  initial_state.vs_swizzle_data.size());
-        if (written != initial_state.vs_swizzle_data.size() ||
-            file.Tell() != initial.vs_float_uniforms)
-            throw "Failed to write vertex shader swizzle data";
-
-        written = file.WriteArray(initial_state.vs_float_uniforms.data(),
-                                  initial_state.vs_float_uniforms.size());
-        if (written != initial_state.vs_float_uniforms.size() ||
-            file.Tell() != initial.gs_program_binary)
-            throw "Failed to write vertex shader float uniforms";
-
-        written = file.WriteArray(initial_state.gs_program_binary.data(),
-                                  initial_state.gs_program_binary.size());
-        if (written != initial_state.gs_program_binary.size() ||
-            file.Tell() != initial.gs_swizzle_data)
-            throw "Failed to write geomtry shader program binary";
-
-        written = file.WriteArray(initial_state.gs_swizzle_data.data(),
-                                  initial_state.gs_swizzle_data.size());
-        if (written != initial_state.gs_swizzle_data.size() ||
-            file.Tell() != initial.gs_float_uniforms)
-            throw "Failed to write geometry shader swizzle data";
-
-        written = file.WriteArray(initial_state.gs_float_uniforms.data(),
-                                  initial_state.gs_float_uniforms.size());
-        if (written != initial_state.gs_float_uniforms.size() ||
-            file.Tell() != initial.gs_float_uniforms + sizeof(u32) * initial.gs_float_uniforms_size)
-            throw "Failed to write geometry shader float uniforms";
-
-        // Iterate through stream elements, write "extra data"
-        for (const auto& stream_element : stream) {
-            if (stream_element.extra_data.size() == 0)
-                continue;
-
-            written =
-                file.WriteBytes(stream_element.extra_data.data(), stream_element.extra_data.size());
-            if (written != stream_element.extra_data.size())
-                throw "Failed to write extra data";
-        }
+    // The header is written again with the index location once the recording is finished
+    const CTHeaderV2 header = MakeHeader();
+    Write(&header, sizeof(header));
 
-        if (file.Tell() != header.stream_offset)
-            throw "Unexpected end of extra data";
+    BeginChunk(true);
+    frames.push_back({0, static_cast<u32>(chunk.size())});
+}
 
-        // Write actual stream elements
-        for (const auto& stream_element : stream) {
-            if (1 != file.WriteObject(stream_element.data))
-                throw "Failed to write stream element";
-        }
-    } catch (const char* str) {
-        LOG_ERROR(HW_GPU, "Writing CiTrace file failed: %s", str);
+Recorder::~Recorder() {
+    if (!finished) {
+        file.Close();
+        FileUtil::Delete(filename);
+    }
+}
+
+void Recorder::Finish() {
+    // Don't keep an empty frame after the last frame marker
+    const CTFrameV2& last_frame = frames.back();
+    if (last_frame.chunk == chunks.size() && last_frame.offset == chunk.size()) {
+        frames.pop_back();
     }
+    FlushChunk();
+
+    CTHeaderV2 header = MakeHeader();
+    header.chunk_count = static_cast<u32>(chunks.size());
+    header.frame_count = static_cast<u32>(frames.size());
+    header.blob_count = static_cast<u32>(blobs.size());
+    header.index_offset = file.Tell();
+
+    Write(chunks.data(), chunks.size() * sizeof(CTChunkV2));
+    Write(frames.data(), frames.size() * sizeof(CTFrameV2));
+    Write(blobs.data(), blobs.size() * sizeof(CTBlobV2));
+
+    if (!write_failed && file.Seek(0, SEEK_SET)) {
+        Write(&header, sizeof(header));
+    }
+    file.Close();
+
+    if (write_failed) {
+        LOG_ERROR(HW_GPU, "Writing CiTrace file %s failed", filename.c_str());
+        FileUtil::Delete(filename);
+    }
+    finished = true;
 }
 
 void Recorder::FrameFinished() {
-    stream.push_back({{FrameMarker}});
+    AppendRecord(FrameMarker);
+
+    if (chunk.size() >= CHUNK_SIZE_TARGET) {
+        FlushChunk();
+        BeginChunk(true);
+    }
+    frames.push_back({static_cast<u32>(chunks.size()), static_cast<u32>(chunk.size())});
 }
 
 void Recorder::MemoryAccessed(const u8* data, u32 size, u32 physical_address) {
-    StreamElement element = {{MemoryLoad}};
-    element.data.memory_load.size = size;
-    element.data.memory_load.physical_address = physical_address;
-
-    // Compute hash over given memory region to check if the contents are already stored internally
-    boost::crc_32_type result;
-    result.process_bytes(data, size);
-    element.hash = result.checksum();
-
-    element.uses_existing_data = (memory_regions.find(element.hash) != memory_regions.end());
-    if (!element.uses_existing_data) {
-        element.extra_data.resize(size);
-        memcpy(element.extra_data.data(), data, size);
-        memory_regions.insert({element.hash, 0}); // file offset will be initialized in Finish()
+    // Pages are recorded separately, so that only the ones that changed are stored again
+    while (size > 0) {
+        u32 segment_size =
+            std::min(size, Memory::PAGE_SIZE - (physical_address & Memory::PAGE_MASK));
+        RecordMemorySegment(data, segment_size, physical_address);
+
+        data += segment_size;
+        physical_address += segment_size;
+        size -= segment_size;
+    }
+}
+
+void Recorder::RecordMemorySegment(const u8* data, u32 size, u32 physical_address) {
+    const u64 hash = Common::ComputeHash64(data, size);
+
+    auto overlaps = [physical_address, size](const MemorySegment& segment) {
+        return segment.physical_address < physical_address + size &&
+               physical_address < segment.physical_address + segment.size;
+    };
+
+    // Segments are kept in recording order, later ones taking precedence where they overlap
+    auto& segments = pages[physical_address >> Memory::PAGE_BITS];
+    auto same_range = std::find_if(segments.begin(), segments.end(), [&](const auto& segment) {
+        return segment.physical_address == physical_address && segment.size == size;
+    });
+    if (same_range != segments.end() && blobs[same_range->blob_id].hash == hash &&
+        std::none_of(same_range + 1, segments.end(), overlaps)) {
+        // The player's memory already holds these contents
+        return;
+    }
+
+    // Segments entirely covered by the new one don't contribute to the player's memory anymore
+    segments.erase(std::remove_if(segments.begin(), segments.end(),
+                                  [&](const MemorySegment& segment) {
+                                      return physical_address <= segment.physical_address &&
+                                             segment.physical_address + segment.size <=
+                                                 physical_address + size;
+                                  }),
+                   segments.end());
+
+    u32 blob_id;
+    auto blob = blob_ids.find(hash);
+    if (blob != blob_ids.end() && blobs[blob->second].size == size) {
+        blob_id = blob->second;
+    } else {
+        blob_id = static_cast<u32>(blobs.size());
+        const CTMemoryBlob blob_record{blob_id, size};
+        AppendRecord(MemoryBlob, &blob_record, sizeof(blob_record));
+        blobs.push_back({static_cast<u32>(chunks.size()), static_cast<u32>(chunk.size()), size, 0,
+                         hash});
+        chunk.insert(chunk.end(), data, data + size);
+        blob_ids[hash] = blob_id;
     }
 
-    stream.push_back(element);
+    const CTMemoryUpdate update{physical_address, size, blob_id};
+    AppendRecord(MemoryUpdate, &update, sizeof(update));
+    segments.push_back({physical_address, size, blob_id});
+
+    if (chunk.size() >= CHUNK_SIZE_LIMIT) {
+        FlushChunk();
+        BeginChunk(false);
+    }
 }
 
 template <typename T>
 void Recorder::RegisterWritten(u32 physical_address, T value) {
-    StreamElement element = {{RegisterWrite}};
-    element.data.register_write.size =
-        (sizeof(T) == 1) ? CTRegisterWrite::SIZE_8
-                         : (sizeof(T) == 2) ? CTRegisterWrite::SIZE_16
-                                            : (sizeof(T) == 4) ? CTRegisterWrite::SIZE_32
-                                                               : CTRegisterWrite::SIZE_64;
-    element.data.register_write.physical_address = physical_address;
-    element.data.register_write.value = value;
-
-    stream.push_back(element);
+    CTRegisterWrite write;
+    write.size = (sizeof(T) == 1) ? CTRegisterWrite::SIZE_8
+                                  : (sizeof(T) == 2) ? CTRegisterWrite::SIZE_16
+                                                     : (sizeof(T) == 4) ? CTRegisterWrite::SIZE_32
+                                                                        : CTRegisterWrite::SIZE_64;
+    write.physical_address = physical_address;
+    write.value = value;
+    AppendRecord(RegisterWrite, &write, sizeof(write));
+}
+
+void Recorder::AppendRecord(CTStreamElementType type, const void* data, size_t size) {
+    const u8* type_bytes = reinterpret_cast<const u8*>(&type);
+    chunk.insert(chunk.end(), type_bytes, type_bytes + sizeof(type));
+    if (size != 0) {
+        const u8* bytes = static_cast<const u8*>(data);
+        chunk.insert(chunk.end(), bytes, bytes + size);
+    }
+}
+
+void Recorder::BeginChunk(bool keyframe) {
+    chunk_flags = 0;
+    keyframe_size = 0;
+    if (!keyframe)
+        return;
+
+    chunk_flags = CTChunkV2::Keyframe;
+    AppendRecord(StateSnapshot);
+    SaveStateSnapshot(chunk);
+    for (const auto& page : pages) {
+        for (const auto& segment : page.second) {
+            const CTMemoryUpdate update{segment.physical_address, segment.size, segment.blob_id};
+            AppendRecord(MemoryUpdate, &update, sizeof(update));
+        }
+    }
+    keyframe_size = static_cast<u32>(chunk.size());
+}
+
+void Recorder::FlushChunk() {
+    CTChunkV2 info{};
+    info.file_offset = file.Tell();
+    info.size = static_cast<u32>(chunk.size());
+    info.flags = chunk_flags;
+    info.keyframe_size = keyframe_size;
+
+    std::vector<u8> compressed = Compression::Compress(chunk.data(), chunk.size());
+    if (compressed.size() < chunk.size()) {
+        info.flags |= CTChunkV2::Compressed;
+        info.stored_size = static_cast<u32>(compressed.size());
+        Write(compressed.data(), compressed.size());
+    } else {
+        info.stored_size = info.size;
+        Write(chunk.data(), chunk.size());
+    }
+
+    chunks.push_back(info);
+    chunk.clear();
+}
+
+void Recorder::Write(const void* data, size_t size) {
+    if (write_failed || size == 0)
+        return;
+
+    if (file.WriteBytes(data, size) != size) {
+        LOG_ERROR(HW_GPU, "Failed to write to CiTrace file %s, recording stopped",
+                  filename.c_str());
+        write_failed = true;
+    }
 }
 
 template void Recorder::RegisterWritten(u32, u8);
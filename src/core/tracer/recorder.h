@@ -7,35 +7,30 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
-#include <boost/crc.hpp>
 #include "common/common_types.h"
+#include "common/file_util.h"
 #include "core/tracer/citrace.h"
 
 namespace CiTrace {
 
+/**
+ * Records a version 2 CiTrace. Records are collected into chunks which are compressed and written
+ * to the file as soon as they are complete, so memory usage doesn't grow with the length of the
+ * recording.
+ */
 class Recorder {
 public:
-    struct InitialState {
-        std::vector<u32> gpu_registers;
-        std::vector<u32> lcd_registers;
-        std::vector<u32> pica_registers;
-        std::vector<u32> default_attributes;
-        std::vector<u32> vs_program_binary;
-        std::vector<u32> vs_swizzle_data;
-        std::vector<u32> vs_float_uniforms;
-        std::vector<u32> gs_program_binary;
-        std::vector<u32> gs_swizzle_data;
-        std::vector<u32> gs_float_uniforms;
-    };
-
     /**
-     * Recorder constructor
-     * @param initial_state Initial recorder state
+     * Starts recording to the given file, capturing the current GPU state as the initial state.
+     * @note Recording stops (with an error logged) if writing the file fails.
      */
-    Recorder(const InitialState& initial_state);
+    explicit Recorder(const std::string& filename);
+
+    /// Deletes the file unless the recording was finished, since it couldn't be played back
+    ~Recorder();
 
-    /// Finish recording of this Citrace and save it using the given filename.
-    void Finish(const std::string& filename);
+    /// Finish recording of this CiTrace, writing the index which makes the file complete.
+    void Finish();
 
     /// Mark end of a frame
     void FrameFinished();
@@ -55,33 +50,45 @@ public:
     void RegisterWritten(u32 physical_address, T value);
 
 private:
-    // Initial state of recording start
-    InitialState initial_state;
+    /// Recorded contents of part of a page
+    struct MemorySegment {
+        u32 physical_address;
+        u32 size;
+        u32 blob_id;
+    };
 
-    // Command stream
-    struct StreamElement {
-        CTStreamElement data;
+    void AppendRecord(CTStreamElementType type, const void* data = nullptr, size_t size = 0);
 
-        /**
-          * Extra data to store along "core" data.
-          * This is e.g. used for data used in MemoryUpdates.
-          */
-        std::vector<u8> extra_data;
+    /// Records a memory access that doesn't cross a page boundary
+    void RecordMemorySegment(const u8* data, u32 size, u32 physical_address);
 
-        /// Optional CRC hash (e.g. for hashing memory regions)
-        boost::crc_32_type::value_type hash;
+    /// Starts a new chunk, which is a keyframe if requested
+    void BeginChunk(bool keyframe);
 
-        /// If true, refer to data already written to the output file instead of extra_data
-        bool uses_existing_data;
-    };
+    /// Compresses the current chunk and writes it to the file
+    void FlushChunk();
 
-    std::vector<StreamElement> stream;
+    void Write(const void* data, size_t size);
 
-    /**
-     * Internal cache which maps hashes of memory contents to file offsets at which those memory
-     * contents are stored.
-     */
-    std::unordered_map<boost::crc_32_type::value_type /*hash*/, u32 /*file_offset*/> memory_regions;
+    std::string filename;
+    FileUtil::IOFile file;
+    bool finished = false;
+    bool write_failed = false;
+
+    /// Uncompressed records of the chunk being recorded
+    std::vector<u8> chunk;
+    u32 chunk_flags = 0;
+    u32 keyframe_size = 0;
+
+    std::vector<CTChunkV2> chunks;
+    std::vector<CTFrameV2> frames;
+    std::vector<CTBlobV2> blobs;
+
+    /// Maps hashes of memory contents to the blob storing them
+    std::unordered_map<u64, u32> blob_ids;
+
+    /// Recorded contents of each page, in the order the player's memory received them
+    std::unordered_map<u32, std::vector<MemorySegment>> pages;
 };
 
 } // namespace
@@ -0,0 +1,210 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include "core/hw/gpu.h"
+#include "core/hw/lcd.h"
+#include "core/tracer/citrace.h"
+#include "core/tracer/state_snapshot.h"
+#include "video_core/pica_state.h"
+
+namespace CiTrace {
+
+using Pica::float24;
+
+template <typename T>
+static void Append(std::vector<u8>& out, const T& value) {
+    const u8* bytes = reinterpret_cast<const u8*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static void AppendBlock(std::vector<u8>& out, CTStateBlock::Id id, const void* data, size_t size) {
+    Append(out, CTStateBlock{id, static_cast<u32>(size)});
+    const u8* bytes = static_cast<const u8*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+static void AppendFloatBlock(std::vector<u8>& out, CTStateBlock::Id id,
+                             const Math::Vec4<float24>* vectors, size_t count) {
+    std::vector<float> values;
+    for (size_t i = 0; i < count; ++i) {
+        for (unsigned comp = 0; comp < 4; ++comp) {
+            values.push_back(vectors[i][comp].ToFloat32());
+        }
+    }
+    AppendBlock(out, id, values.data(), values.size() * sizeof(float));
+}
+
+static void AppendShaderBlocks(std::vector<u8>& out, const Pica::Shader::ShaderSetup& setup,
+                               CTStateBlock::Id first_id) {
+    const auto& uniforms = setup.uniforms;
+
+    std::vector<u8> bool_uniforms(uniforms.b.begin(), uniforms.b.end());
+    std::vector<u8> int_uniforms;
+    for (const auto& value : uniforms.i) {
+        int_uniforms.insert(int_uniforms.end(), {value.x, value.y, value.z, value.w});
+    }
+
+    // The shader blocks of each stage are in the same order
+    auto id = [first_id](unsigned index) {
+        return static_cast<CTStateBlock::Id>(first_id + index);
+    };
+    AppendBlock(out, id(0), setup.program_code.data(), sizeof(setup.program_code));
+    AppendBlock(out, id(1), setup.swizzle_data.data(), sizeof(setup.swizzle_data));
+    AppendFloatBlock(out, id(2), uniforms.f, std::extent<decltype(uniforms.f)>::value);
+    AppendBlock(out, id(3), bool_uniforms.data(), bool_uniforms.size());
+    AppendBlock(out, id(4), int_uniforms.data(), int_uniforms.size());
+}
+
+void SaveStateSnapshot(std::vector<u8>& out) {
+    const auto& state = Pica::g_state;
+
+    // Every block id is saved, and the ids are contiguous starting from 1
+    Append(out, CTStateSnapshot{CTStateBlock::ProcTexColorDiffTable});
+    AppendBlock(out, CTStateBlock::GpuRegisters, &GPU::g_regs, sizeof(GPU::g_regs));
+    AppendBlock(out, CTStateBlock::LcdRegisters, &LCD::g_regs, sizeof(LCD::g_regs));
+    AppendBlock(out, CTStateBlock::PicaRegisters, &state.regs, sizeof(state.regs));
+    AppendFloatBlock(out, CTStateBlock::DefaultAttributes, state.input_default_attributes.attr,
+                     std::extent<decltype(state.input_default_attributes.attr)>::value);
+    AppendShaderBlocks(out, state.vs, CTStateBlock::VsProgramBinary);
+    AppendShaderBlocks(out, state.gs, CTStateBlock::GsProgramBinary);
+    AppendBlock(out, CTStateBlock::LightingLuts, state.lighting.luts.data(),
+                sizeof(state.lighting.luts));
+    AppendBlock(out, CTStateBlock::FogLut, state.fog.lut.data(), sizeof(state.fog.lut));
+    AppendBlock(out, CTStateBlock::ProcTexNoiseTable, state.proctex.noise_table.data(),
+                sizeof(state.proctex.noise_table));
+    AppendBlock(out, CTStateBlock::ProcTexColorMapTable, state.proctex.color_map_table.data(),
+                sizeof(state.proctex.color_map_table));
+    AppendBlock(out, CTStateBlock::ProcTexAlphaMapTable, state.proctex.alpha_map_table.data(),
+                sizeof(state.proctex.alpha_map_table));
+    AppendBlock(out, CTStateBlock::ProcTexColorTable, state.proctex.color_table.data(),
+                sizeof(state.proctex.color_table));
+    AppendBlock(out, CTStateBlock::ProcTexColorDiffTable, state.proctex.color_diff_table.data(),
+                sizeof(state.proctex.color_diff_table));
+}
+
+static void LoadFloatBlock(const u8* data, size_t size, Math::Vec4<float24>* vectors,
+                           size_t count) {
+    for (size_t i = 0; i < std::min(size / (4 * sizeof(float)), count); ++i) {
+        for (unsigned comp = 0; comp < 4; ++comp) {
+            float value;
+            std::memcpy(&value, data + (i * 4 + comp) * sizeof(float), sizeof(float));
+            vectors[i][comp] = float24::FromFloat32(value);
+        }
+    }
+}
+
+/// Loads the block if it belongs to the shader stage starting at first_id
+static void LoadShaderBlock(const CTStateBlock& block, const u8* data,
+                            Pica::Shader::ShaderSetup& setup, CTStateBlock::Id first_id) {
+    auto& uniforms = setup.uniforms;
+    switch (block.id - first_id) {
+    case 0:
+        std::memcpy(setup.program_code.data(), data,
+                    std::min<size_t>(block.size, sizeof(setup.program_code)));
+        break;
+    case 1:
+        std::memcpy(setup.swizzle_data.data(), data,
+                    std::min<size_t>(block.size, sizeof(setup.swizzle_data)));
+        break;
+    case 2:
+        LoadFloatBlock(data, block.size, uniforms.f, std::extent<decltype(uniforms.f)>::value);
+        break;
+    case 3:
+        for (size_t i = 0; i < std::min<size_t>(block.size, uniforms.b.size()); ++i) {
+            uniforms.b[i] = data[i] != 0;
+        }
+        break;
+    case 4:
+        for (size_t i = 0; i < std::min<size_t>(block.size / 4, uniforms.i.size()); ++i) {
+            uniforms.i[i] = {data[4 * i], data[4 * i + 1], data[4 * i + 2], data[4 * i + 3]};
+        }
+        break;
+    }
+}
+
+bool LoadStateSnapshot(const u8* data, size_t size, size_t& pos) {
+    auto& state = Pica::g_state;
+
+    CTStateSnapshot snapshot;
+    if (size - pos < sizeof(snapshot))
+        return false;
+    std::memcpy(&snapshot, data + pos, sizeof(snapshot));
+    pos += sizeof(snapshot);
+
+    for (u32 i = 0; i < snapshot.block_count; ++i) {
+        CTStateBlock block;
+        if (size - pos < sizeof(block))
+            return false;
+        std::memcpy(&block, data + pos, sizeof(block));
+        pos += sizeof(block);
+        if (size - pos < block.size)
+            return false;
+        const u8* block_data = data + pos;
+        pos += block.size;
+
+        auto copy = [&block, block_data](void* dest, size_t dest_size) {
+            std::memcpy(dest, block_data, std::min<size_t>(block.size, dest_size));
+        };
+
+        switch (block.id) {
+        case CTStateBlock::GpuRegisters:
+            copy(&GPU::g_regs, sizeof(GPU::g_regs));
+            break;
+        case CTStateBlock::LcdRegisters:
+            copy(&LCD::g_regs, sizeof(LCD::g_regs));
+            break;
+        case CTStateBlock::PicaRegisters:
+            copy(&state.regs, sizeof(state.regs));
+            break;
+        case CTStateBlock::DefaultAttributes:
+            LoadFloatBlock(block_data, block.size, state.input_default_attributes.attr,
+                           std::extent<decltype(state.input_default_attributes.attr)>::value);
+            break;
+        case CTStateBlock::VsProgramBinary:
+        case CTStateBlock::VsSwizzleData:
+        case CTStateBlock::VsFloatUniforms:
+        case CTStateBlock::VsBoolUniforms:
+        case CTStateBlock::VsIntUniforms:
+            LoadShaderBlock(block, block_data, state.vs, CTStateBlock::VsProgramBinary);
+            break;
+        case CTStateBlock::GsProgramBinary:
+        case CTStateBlock::GsSwizzleData:
+        case CTStateBlock::GsFloatUniforms:
+        case CTStateBlock::GsBoolUniforms:
+        case CTStateBlock::GsIntUniforms:
+            LoadShaderBlock(block, block_data, state.gs, CTStateBlock::GsProgramBinary);
+            break;
+        case CTStateBlock::LightingLuts:
+            copy(state.lighting.luts.data(), sizeof(state.lighting.luts));
+            break;
+        case CTStateBlock::FogLut:
+            copy(state.fog.lut.data(), sizeof(state.fog.lut));
+            break;
+        case CTStateBlock::ProcTexNoiseTable:
+            copy(state.proctex.noise_table.data(), sizeof(state.proctex.noise_table));
+            break;
+        case CTStateBlock::ProcTexColorMapTable:
+            copy(state.proctex.color_map_table.data(), sizeof(state.proctex.color_map_table));
+            break;
+        case CTStateBlock::ProcTexAlphaMapTable:
+            copy(state.proctex.alpha_map_table.data(), sizeof(state.proctex.alpha_map_table));
+            break;
+        case CTStateBlock::ProcTexColorTable:
+            copy(state.proctex.color_table.data(), sizeof(state.proctex.color_table));
+            break;
+        case CTStateBlock::ProcTexColorDiffTable:
+            copy(state.proctex.color_diff_table.data(), sizeof(state.proctex.color_diff_table));
+            break;
+        default:
+            break;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
@@ -0,0 +1,23 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "common/common_types.h"
+
+namespace CiTrace {
+
+/// Appends a CTStateSnapshot capturing the current GPU, LCD and Pica state, and its blocks
+void SaveStateSnapshot(std::vector<u8>& out);
+
+/**
+ * Restores the state captured by SaveStateSnapshot. Blocks with unknown ids are skipped.
+ * @param pos Offset of the CTStateSnapshot in data, advanced past its blocks
+ * @return False if the snapshot exceeds the end of the data
+ */
+bool LoadStateSnapshot(const u8* data, size_t size, size_t& pos);
+
+} // namespace
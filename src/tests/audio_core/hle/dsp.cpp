@@ -0,0 +1,384 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "audio_core/codec.h"
+#include "audio_core/counting_allocator.h"
+#include "audio_core/file_sink.h"
+#include "audio_core/hle/dsp.h"
+#include "audio_core/null_sink.h"
+#include "audio_core/sink.h"
+#include "common/common_paths.h"
+#include "common/common_types.h"
+#include "common/file_util.h"
+#include "common/scope_exit.h"
+#include "core/memory.h"
+#include "core/memory_setup.h"
+
+namespace DSP {
+namespace HLE {
+
+using Configuration = SourceConfiguration::Configuration;
+
+static void ConfigureSource(size_t source_id, Configuration::Format format,
+                            Configuration::MonoOrStereo mono_or_stereo, u32 offset, u32 length,
+                            float rate_multiplier) {
+    Configuration& config = g_dsp_memory.region_0.source_configurations.config[source_id];
+    config.enable = 1;
+    config.enable_dirty.Assign(1);
+    config.gain[0][0] = 0.5f;
+    config.gain[0][1] = 0.5f;
+    config.gain[1][2] = 0.5f;
+    config.gain[1][3] = 0.25f;
+    config.gain_0_dirty.Assign(1);
+    config.gain_1_dirty.Assign(1);
+    config.rate_multiplier = rate_multiplier;
+    config.rate_multiplier_dirty.Assign(1);
+    config.interpolation_mode = Configuration::InterpolationMode::Linear;
+    config.interpolation_dirty.Assign(1);
+    config.format.Assign(format);
+    config.mono_or_stereo.Assign(mono_or_stereo);
+    config.physical_address = Memory::FCRAM_PADDR + offset;
+    config.length = length;
+    config.is_looping.Assign(1);
+    config.embedded_buffer_dirty.Assign(1);
+}
+
+/// Plays looping buffers of guest memory on a few sources, with region 0 read from and region 1
+/// written to.
+class PlayingSources {
+public:
+    PlayingSources() {
+        for (size_t i = 0; i < guest_memory.size(); ++i) {
+            guest_memory[i] = static_cast<u8>(i * 37 + i / 7);
+        }
+        Memory::MapMemoryRegion(Memory::LINEAR_HEAP_VADDR, Memory::PAGE_SIZE,
+                                guest_memory.data());
+
+        SetSink(std::make_unique<AudioCore::NullSink>());
+        Init();
+        EnableStretching(false);
+
+        g_dsp_memory.raw_memory.fill(0);
+        g_dsp_memory.region_0.frame_counter = 1;
+        g_dsp_memory.region_1.frame_counter = 0;
+
+        ConfigureSource(0, Configuration::Format::PCM16, Configuration::MonoOrStereo::Stereo, 0,
+                        500, 1.0f);
+        ConfigureSource(1, Configuration::Format::PCM8, Configuration::MonoOrStereo::Mono, 2000,
+                        700, 0.75f);
+        ConfigureSource(2, Configuration::Format::ADPCM, Configuration::MonoOrStereo::Mono, 3000,
+                        901, 1.5f);
+        DspConfiguration& dsp_config = g_dsp_memory.region_0.dsp_configuration;
+        dsp_config.volume[0] = 1.0f;
+        dsp_config.volume[1] = 0.5f;
+        dsp_config.volume_0_dirty.Assign(1);
+        dsp_config.volume_1_dirty.Assign(1);
+        dsp_config.output_format = DspConfiguration::OutputFormat::Stereo;
+        dsp_config.output_format_dirty.Assign(1);
+
+        auto& coeffs = g_dsp_memory.region_0.adpcm_coefficients.coeff[2];
+        coeffs[0] = 0x400;
+        coeffs[1] = -0x100;
+        coeffs[2] = 0x200;
+        coeffs[3] = 0x100;
+        coeffs[4] = 0x600;
+        coeffs[5] = -0x200;
+        g_dsp_memory.region_0.source_configurations.config[2].adpcm_coefficients_dirty.Assign(1);
+    }
+
+    ~PlayingSources() {
+        EnableParallelSources(false);
+        EnableOfflineRendering(false);
+        EnableStretching(true);
+        Init();
+        g_dsp_memory.raw_memory.fill(0);
+        Memory::UnmapRegion(Memory::LINEAR_HEAP_VADDR, Memory::PAGE_SIZE);
+    }
+
+    /// Overwrites the samples of the buffers, as the application would with the next ones
+    void OverwriteGuestMemory() {
+        guest_memory.fill(0x55);
+    }
+
+    const u8* GetGuestMemory(u32 offset) const {
+        return guest_memory.data() + offset;
+    }
+
+private:
+    std::array<u8, Memory::PAGE_SIZE> guest_memory;
+};
+
+TEST_CASE("DSP HLE ticks without allocating in steady state", "[audio_core][hle]") {
+    PlayingSources playing_sources;
+
+    // Let the buffers reach the sizes they need to hold the longest of the looping buffers
+    for (int i = 0; i < 20; ++i) {
+        Tick();
+    }
+
+    const size_t allocation_count = AudioCore::GetAllocationCount();
+    for (int i = 0; i < 200; ++i) {
+        Tick();
+    }
+
+    REQUIRE(AudioCore::GetAllocationCount() == allocation_count);
+    for (size_t i = 0; i < 3; ++i) {
+        REQUIRE(g_dsp_memory.region_1.source_statuses.status[i].is_enabled == 1);
+    }
+}
+
+TEST_CASE("DSP HLE writes the output of a frame on the next tick", "[audio_core][hle]") {
+    PlayingSources playing_sources;
+
+    Tick();
+    REQUIRE(g_dsp_memory.region_1.source_statuses.status[0].is_enabled == 0);
+
+    Tick();
+    REQUIRE(g_dsp_memory.region_1.source_statuses.status[0].is_enabled == 1);
+}
+
+TEST_CASE("DSP HLE decodes ADPCM with the coefficients of the shared memory",
+          "[audio_core][hle]") {
+    PlayingSources playing_sources;
+
+    // Only the ADPCM source plays, at its own rate and with unit gains to the left and right
+    // channels of the final mix, which then holds its decoded samples
+    auto& configs = g_dsp_memory.region_0.source_configurations.config;
+    for (size_t i = 0; i < 2; ++i) {
+        configs[i].enable = 0;
+    }
+    Configuration& config = configs[2];
+    config.gain[0][0] = 1.0f;
+    config.gain[0][1] = 1.0f;
+    config.gain[1][2] = 0.0f;
+    config.gain[1][3] = 0.0f;
+    config.rate_multiplier = 1.0f;
+    config.interpolation_mode = Configuration::InterpolationMode::None;
+
+    std::array<s16, 16> coeffs;
+    std::copy(std::begin(g_dsp_memory.region_0.adpcm_coefficients.coeff[2]),
+              std::end(g_dsp_memory.region_0.adpcm_coefficients.coeff[2]), coeffs.begin());
+    constexpr size_t num_frames = 5;
+    Codec::ADPCMState state = {};
+    Codec::StereoBuffer16 expected;
+    Codec::DecodeADPCM(playing_sources.GetGuestMemory(3000), num_frames * samples_per_frame,
+                       coeffs, state, expected);
+
+    // The coefficients make a difference to the samples
+    Codec::ADPCMState zero_state = {};
+    Codec::StereoBuffer16 decoded_without_coefficients;
+    Codec::DecodeADPCM(playing_sources.GetGuestMemory(3000), num_frames * samples_per_frame, {},
+                       zero_state, decoded_without_coefficients);
+    REQUIRE(decoded_without_coefficients != expected);
+
+    // The output of each frame is written to the shared memory on the next tick. The interpolation
+    // delays the samples by the two samples of history it starts with.
+    Tick();
+    for (size_t frame = 0; frame < num_frames; ++frame) {
+        Tick();
+        const FinalMixSamples& output = g_dsp_memory.region_1.final_samples;
+        for (size_t i = 0; i < samples_per_frame; ++i) {
+            const size_t position = frame * samples_per_frame + i;
+            const std::array<s16, 2> sample = position >= 2 ? expected[position - 2]
+                                                            : std::array<s16, 2>{};
+            CAPTURE(position);
+            REQUIRE(output.pcm16[i][0] == sample[0]);
+            REQUIRE(output.pcm16[i][1] == sample[1]);
+        }
+    }
+}
+
+TEST_CASE("DSP HLE processes sources in parallel like sequentially", "[audio_core][hle]") {
+    const auto Render = [](bool parallel) {
+        PlayingSources playing_sources;
+        EnableParallelSources(parallel);
+
+        std::vector<FinalMixSamples> frames(100);
+        for (auto& frame : frames) {
+            Tick();
+            frame = g_dsp_memory.region_1.final_samples;
+        }
+        return frames;
+    };
+
+    const std::vector<FinalMixSamples> sequential = Render(false);
+    const std::vector<FinalMixSamples> parallel = Render(true);
+    for (size_t i = 0; i < sequential.size(); ++i) {
+        REQUIRE(std::memcmp(&sequential[i], &parallel[i], sizeof(FinalMixSamples)) == 0);
+    }
+}
+
+TEST_CASE("DSP HLE plays the samples buffers held when they were queued", "[audio_core][hle]") {
+    const auto Render = [](bool overwrite) {
+        PlayingSources playing_sources;
+
+        std::vector<FinalMixSamples> frames(50);
+        for (auto& frame : frames) {
+            Tick();
+            // The buffers are queued by the first tick, and the application may reuse their
+            // memory while the frame is generated
+            if (overwrite) {
+                playing_sources.OverwriteGuestMemory();
+            }
+            frame = g_dsp_memory.region_1.final_samples;
+        }
+        return frames;
+    };
+
+    const std::vector<FinalMixSamples> expected = Render(false);
+    const std::vector<FinalMixSamples> overwritten = Render(true);
+    for (size_t i = 0; i < expected.size(); ++i) {
+        REQUIRE(std::memcmp(&expected[i], &overwritten[i], sizeof(FinalMixSamples)) == 0);
+    }
+}
+
+/// Counts the samples enqueued to it, at the sample rate of a typical audio device
+class CountingSink final : public AudioCore::Sink {
+public:
+    explicit CountingSink(size_t& count) : count(count) {}
+
+    unsigned int GetNativeSampleRate() const override {
+        return 48000;
+    }
+
+    void EnqueueSamples(const s16*, size_t sample_count) override {
+        count += sample_count;
+    }
+
+    size_t SamplesInQueue() const override {
+        return 0;
+    }
+
+    void SetDevice(int) override {}
+
+    std::vector<std::string> GetDeviceList() const override {
+        return {};
+    }
+
+private:
+    size_t& count;
+};
+
+TEST_CASE("DSP HLE converts its output to the sample rate of the sink", "[audio_core][hle]") {
+    constexpr size_t num_frames = 100;
+    size_t count = 0;
+    {
+        PlayingSources playing_sources;
+        SetSink(std::make_unique<CountingSink>(count));
+        for (size_t i = 0; i < num_frames; ++i) {
+            Tick();
+        }
+        SetSink(std::make_unique<AudioCore::NullSink>());
+    }
+
+    // Short of the samples held back by the resampler
+    const size_t expected = num_frames * samples_per_frame * 48000 / AudioCore::native_sample_rate;
+    REQUIRE(count <= expected);
+    REQUIRE(count >= expected - 64);
+}
+
+/// Records the samples enqueued to it, at the native sample rate of the DSP
+class RecordingSink final : public AudioCore::Sink {
+public:
+    explicit RecordingSink(std::vector<s16>& samples) : samples(samples) {}
+
+    unsigned int GetNativeSampleRate() const override {
+        return AudioCore::native_sample_rate;
+    }
+
+    void EnqueueSamples(const s16* new_samples, size_t sample_count) override {
+        samples.insert(samples.end(), new_samples, new_samples + sample_count * 2);
+    }
+
+    size_t SamplesInQueue() const override {
+        return 0;
+    }
+
+    void SetDevice(int) override {}
+
+    std::vector<std::string> GetDeviceList() const override {
+        return {};
+    }
+
+private:
+    std::vector<s16>& samples;
+};
+
+/// Path of a file in the temporary directory of the system
+static std::string GetTemporaryPath(const std::string& name) {
+#ifdef _WIN32
+    const char* directory = std::getenv("TEMP");
+    return std::string(directory ? directory : ".") + DIR_SEP + name;
+#else
+    const char* directory = std::getenv("TMPDIR");
+    return std::string(directory ? directory : "/tmp") + DIR_SEP + name;
+#endif
+}
+
+TEST_CASE("DSP HLE renders offline to a WAV file", "[audio_core][hle]") {
+    const std::string path = GetTemporaryPath("dsp_hle_offline_render.wav");
+    SCOPE_EXIT({ FileUtil::Delete(path); });
+    constexpr size_t num_frames = 100;
+
+    // Each tick starts a frame, the last one being written out when the sink is replaced
+    const auto Render = [&](std::unique_ptr<AudioCore::Sink> render_sink, bool offline) {
+        std::vector<FinalMixSamples> final_samples(num_frames);
+        PlayingSources playing_sources;
+        EnableOfflineRendering(offline);
+        SetSink(std::move(render_sink));
+
+        // The output of each frame is written to the shared memory on the next tick
+        Tick();
+        for (auto& frame : final_samples) {
+            Tick();
+            frame = g_dsp_memory.region_1.final_samples;
+        }
+
+        SetSink(std::make_unique<AudioCore::NullSink>());
+        return final_samples;
+    };
+
+    const std::vector<FinalMixSamples> final_samples =
+        Render(std::make_unique<AudioCore::FileSink>(path), true);
+
+    // Reference output of the same frames, played in real time to a sink needing no resampling
+    std::vector<s16> expected;
+    Render(std::make_unique<RecordingSink>(expected), false);
+    REQUIRE(expected.size() * sizeof(s16) == (num_frames + 1) * sizeof(FinalMixSamples));
+
+    std::array<u8, 44> header;
+    std::vector<u8> samples((num_frames + 1) * sizeof(FinalMixSamples));
+    {
+        FileUtil::IOFile file(path, "rb");
+        REQUIRE(file.GetSize() == header.size() + samples.size());
+        file.ReadBytes(header.data(), header.size());
+        file.ReadBytes(samples.data(), samples.size());
+    }
+
+    REQUIRE(std::memcmp(header.data(), "RIFF", 4) == 0);
+    REQUIRE(std::memcmp(header.data() + 8, "WAVEfmt ", 8) == 0);
+    REQUIRE(std::memcmp(header.data() + 36, "data", 4) == 0);
+    u32 sample_rate, data_size;
+    std::memcpy(&sample_rate, header.data() + 24, sizeof(sample_rate));
+    std::memcpy(&data_size, header.data() + 40, sizeof(data_size));
+    REQUIRE(sample_rate == 32728);
+    REQUIRE(data_size == samples.size());
+
+    // Every frame is written as is, with nothing dropped or stretched
+    REQUIRE(std::memcmp(samples.data(), final_samples.data(),
+                        num_frames * sizeof(FinalMixSamples)) == 0);
+    REQUIRE(std::memcmp(samples.data(), expected.data(), samples.size()) == 0);
+}
+
+} // namespace HLE
+} // namespace DSP
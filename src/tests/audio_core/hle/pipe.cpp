@@ -0,0 +1,48 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <catch.hpp>
+#include "audio_core/hle/pipe.h"
+#include "common/common_types.h"
+
+namespace DSP {
+namespace HLE {
+
+TEST_CASE("DSP pipes are read in pieces", "[audio_core][hle]") {
+    ResetPipes();
+
+    // Initializing the DSP writes the number of structs and their addresses to the audio pipe
+    const std::array<u8, 4> initialize = {{0, 0, 0, 0}};
+    PipeWrite(DspPipe::Audio, initialize.data(), initialize.size());
+    REQUIRE(GetDspState() == DspState::On);
+    REQUIRE(GetPipeReadableSize(DspPipe::Audio) == 32);
+
+    std::array<u8, 32> buffer{};
+    REQUIRE(PipeRead(DspPipe::Audio, buffer.data(), 2) == 2);
+    REQUIRE(buffer[0] == 15);
+    REQUIRE(buffer[1] == 0);
+    REQUIRE(GetPipeReadableSize(DspPipe::Audio) == 30);
+
+    // Reads past the end of the data only get what remains
+    REQUIRE(PipeRead(DspPipe::Audio, buffer.data() + 2, 40) == 30);
+    REQUIRE(GetPipeReadableSize(DspPipe::Audio) == 0);
+    REQUIRE(PipeRead(DspPipe::Audio, buffer.data(), 2) == 0);
+
+    // The struct addresses are little endian DSP dram addresses, from 0x8000 on
+    for (size_t i = 2; i < buffer.size(); i += 2) {
+        REQUIRE((buffer[i + 1] & 0x80) != 0);
+    }
+
+    // The pipe is written to again once drained
+    PipeWrite(DspPipe::Audio, initialize.data(), initialize.size());
+    REQUIRE(GetPipeReadableSize(DspPipe::Audio) == 32);
+
+    ResetPipes();
+    REQUIRE(GetPipeReadableSize(DspPipe::Audio) == 0);
+    REQUIRE(GetDspState() == DspState::Off);
+}
+
+} // namespace HLE
+} // namespace DSP
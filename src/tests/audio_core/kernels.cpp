@@ -0,0 +1,183 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <limits>
+#include <random>
+#include <vector>
+#include <catch.hpp>
+#include "audio_core/kernels.h"
+#include "common/common_types.h"
+
+namespace AudioCore {
+namespace Kernels {
+
+using Stereo16 = std::array<s16, 2>;
+using Quad32 = std::array<s32, 4>;
+
+static std::mt19937 rng(0x5A3D);
+
+/// Random samples, a quarter of which are at the extremes of the range to exercise saturation
+template <typename T>
+static T RandomSample(T min = std::numeric_limits<T>::min(),
+                      T max = std::numeric_limits<T>::max()) {
+    switch (std::uniform_int_distribution<int>(0, 7)(rng)) {
+    case 0:
+        return min;
+    case 1:
+        return max;
+    default:
+        return std::uniform_int_distribution<T>(min, max)(rng);
+    }
+}
+
+static std::vector<Stereo16> RandomStereo(size_t count) {
+    std::vector<Stereo16> samples(count);
+    for (auto& sample : samples)
+        sample = {RandomSample<s16>(), RandomSample<s16>()};
+    return samples;
+}
+
+static std::vector<Quad32> RandomQuad(size_t count, s32 range) {
+    std::vector<Quad32> samples(count);
+    for (auto& sample : samples)
+        for (auto& channel : sample)
+            channel = RandomSample<s32>(-range, range);
+    return samples;
+}
+
+// Counts which aren't multiples of the vector widths, to exercise the remainders
+static const std::array<size_t, 6> counts = {{0, 1, 3, 14, 159, 160}};
+
+TEST_CASE("DecodeADPCM matches the generic kernel", "[audio_core]") {
+    for (int i = 0; i < 200; i++) {
+        const size_t count = counts[i % counts.size()] + i / counts.size();
+        std::vector<u8> data((count + 13) / 14 * 8);
+        for (auto& byte : data)
+            byte = static_cast<u8>(RandomSample<u16>(0, 0xFF));
+        std::array<s16, 16> coeffs;
+        for (auto& coeff : coeffs)
+            coeff = RandomSample<s16>(-0x1000, 0x1000);
+
+        const s16 yn1 = RandomSample<s16>(), yn2 = RandomSample<s16>();
+        s16 yn1_generic = yn1, yn2_generic = yn2;
+        s16 yn1_vector = yn1, yn2_vector = yn2;
+        std::vector<Stereo16> generic(count + 1), vector(count + 1);
+        DecodeADPCMGeneric(data.data(), count, coeffs, yn1_generic, yn2_generic, generic.data());
+        DecodeADPCM(data.data(), count, coeffs, yn1_vector, yn2_vector, vector.data());
+
+        REQUIRE(vector == generic);
+        REQUIRE(yn1_vector == yn1_generic);
+        REQUIRE(yn2_vector == yn2_generic);
+    }
+}
+
+TEST_CASE("InterpolateLinear matches the generic kernel", "[audio_core]") {
+    const std::vector<Stereo16> input = RandomStereo(400);
+    for (int i = 0; i < 200; i++) {
+        const size_t count = counts[i % counts.size()];
+        // Steps from well below to well above one input sample per output sample
+        const u64 step = std::uniform_int_distribution<u64>(1 << 20, 2 << 24)(rng);
+        const u64 position = (2 << 24) + (rng() & 0xFFFFFF);
+        if (position + count * step >= (input.size() + 1) << 24)
+            continue;
+
+        std::vector<Stereo16> generic(count), vector(count);
+        InterpolateLinearGeneric(input.data(), position, step, generic.data(), count);
+        InterpolateLinear(input.data(), position, step, vector.data(), count);
+
+        REQUIRE(vector == generic);
+    }
+}
+
+TEST_CASE("MixStereoIntoQuad matches the generic kernel", "[audio_core]") {
+    std::uniform_real_distribution<float> gain(-2.0f, 2.0f);
+    for (int i = 0; i < 60; i++) {
+        const size_t count = counts[i % counts.size()];
+        const std::vector<Stereo16> input = RandomStereo(count);
+        const std::array<float, 4> gains = {{gain(rng), gain(rng), gain(rng), gain(rng)}};
+
+        std::vector<Quad32> generic = RandomQuad(count, 1 << 24);
+        std::vector<Quad32> vector = generic;
+        MixStereoIntoQuadGeneric(generic.data(), input.data(), count, gains);
+        MixStereoIntoQuad(vector.data(), input.data(), count, gains);
+
+        REQUIRE(vector == generic);
+    }
+}
+
+TEST_CASE("Downmixing matches the generic kernels", "[audio_core]") {
+    std::uniform_real_distribution<float> gain(0.0f, 2.0f);
+    for (int i = 0; i < 60; i++) {
+        const size_t count = counts[i % counts.size()];
+        const std::vector<Quad32> input = RandomQuad(count, 1 << 17);
+        const std::vector<Stereo16> dest = RandomStereo(count);
+        const float volume = gain(rng);
+
+        std::vector<Stereo16> generic = dest, vector = dest;
+        DownmixQuadToStereoGeneric(generic.data(), input.data(), count, volume);
+        DownmixQuadToStereo(vector.data(), input.data(), count, volume);
+        REQUIRE(vector == generic);
+
+        generic = dest;
+        vector = dest;
+        DownmixQuadToMonoGeneric(generic.data(), input.data(), count, volume);
+        DownmixQuadToMono(vector.data(), input.data(), count, volume);
+        REQUIRE(vector == generic);
+    }
+}
+
+TEST_CASE("Filters match the generic kernels", "[audio_core]") {
+    SECTION("simple filter") {
+        for (int i = 0; i < 60; i++) {
+            const size_t count = counts[i % counts.size()];
+            SimpleFilterState filter;
+            // Includes the passthrough configuration, whose b0 doesn't fit in 16 bits
+            filter.a1 = i == 0 ? 0 : RandomSample<s16>(-0x7FFF, 0x7FFF);
+            filter.b0 = i == 0 ? 1 << 15 : RandomSample<s16>(-0x7FFF, 0x7FFF);
+            filter.y1 = {RandomSample<s16>(), RandomSample<s16>()};
+
+            const std::vector<Stereo16> samples = RandomStereo(count);
+            SimpleFilterState generic_filter = filter, vector_filter = filter;
+            std::vector<Stereo16> generic = samples, vector = samples;
+            SimpleFilterGeneric(generic_filter, generic.data(), count);
+            SimpleFilter(vector_filter, vector.data(), count);
+
+            REQUIRE(vector == generic);
+            REQUIRE(vector_filter.y1 == generic_filter.y1);
+        }
+    }
+
+    SECTION("biquad filter") {
+        for (int i = 0; i < 60; i++) {
+            const size_t count = counts[i % counts.size()];
+            // Coefficients for which the sum of the products doesn't overflow
+            BiquadFilterState filter;
+            filter.a1 = RandomSample<s16>(-0x3000, 0x3000);
+            filter.a2 = RandomSample<s16>(-0x3000, 0x3000);
+            filter.b0 = RandomSample<s16>(-0x3000, 0x3000);
+            filter.b1 = RandomSample<s16>(-0x3000, 0x3000);
+            filter.b2 = RandomSample<s16>(-0x3000, 0x3000);
+            filter.x1 = {RandomSample<s16>(), RandomSample<s16>()};
+            filter.x2 = {RandomSample<s16>(), RandomSample<s16>()};
+            filter.y1 = {RandomSample<s16>(), RandomSample<s16>()};
+            filter.y2 = {RandomSample<s16>(), RandomSample<s16>()};
+
+            const std::vector<Stereo16> samples = RandomStereo(count);
+            BiquadFilterState generic_filter = filter, vector_filter = filter;
+            std::vector<Stereo16> generic = samples, vector = samples;
+            BiquadFilterGeneric(generic_filter, generic.data(), count);
+            BiquadFilter(vector_filter, vector.data(), count);
+
+            REQUIRE(vector == generic);
+            REQUIRE(vector_filter.x1 == generic_filter.x1);
+            REQUIRE(vector_filter.x2 == generic_filter.x2);
+            REQUIRE(vector_filter.y1 == generic_filter.y1);
+            REQUIRE(vector_filter.y2 == generic_filter.y2);
+        }
+    }
+}
+
+} // namespace Kernels
+} // namespace AudioCore
@@ -0,0 +1,159 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <catch.hpp>
+#include "audio_core/audio_core.h"
+#include "audio_core/resampler.h"
+#include "common/common_types.h"
+
+namespace AudioCore {
+
+constexpr double pi = 3.14159265358979323846;
+
+/// Tone at about -6 dBFS, in interleaved stereo format with the right channel in opposite phase
+static std::vector<s16> GenerateTone(double frequency, unsigned int sample_rate,
+                                     size_t num_samples) {
+    std::vector<s16> samples(num_samples * 2);
+    for (size_t i = 0; i < num_samples; ++i) {
+        const double value = 16384.0 * std::sin(2 * pi * frequency * i / sample_rate);
+        samples[i * 2] = static_cast<s16>(std::lrint(value));
+        samples[i * 2 + 1] = static_cast<s16>(std::lrint(-value));
+    }
+    return samples;
+}
+
+/**
+ * Measures the signal to noise and distortion ratio of one channel of a resampled tone, by fitting
+ * a sinusoid of the frequency of the tone and taking everything else as noise.
+ * @returns The ratio in dB.
+ */
+static double MeasureSINAD(const std::vector<s16>& samples, size_t channel, size_t first,
+                           size_t count, double frequency, unsigned int sample_rate) {
+    // Least squares fit of a * sin + b * cos + c, by solving the normal equations
+    std::array<std::array<double, 4>, 3> system{};
+    for (size_t i = first; i < first + count; ++i) {
+        const double phase = 2 * pi * frequency * i / sample_rate;
+        const std::array<double, 3> basis = {{std::sin(phase), std::cos(phase), 1.0}};
+        const double y = samples[i * 2 + channel];
+        for (size_t row = 0; row < 3; ++row) {
+            for (size_t column = 0; column < 3; ++column)
+                system[row][column] += basis[row] * basis[column];
+            system[row][3] += basis[row] * y;
+        }
+    }
+    for (size_t pivot = 0; pivot < 3; ++pivot) {
+        for (size_t row = 0; row < 3; ++row) {
+            if (row == pivot)
+                continue;
+            const double factor = system[row][pivot] / system[pivot][pivot];
+            for (size_t column = pivot; column < 4; ++column)
+                system[row][column] -= factor * system[pivot][column];
+        }
+    }
+    const double a = system[0][3] / system[0][0];
+    const double b = system[1][3] / system[1][1];
+    const double c = system[2][3] / system[2][2];
+
+    double signal = 0.0;
+    double noise = 0.0;
+    for (size_t i = first; i < first + count; ++i) {
+        const double phase = 2 * pi * frequency * i / sample_rate;
+        const double fit = a * std::sin(phase) + b * std::cos(phase);
+        const double error = samples[i * 2 + channel] - fit - c;
+        signal += fit * fit;
+        noise += error * error;
+    }
+    return 10 * std::log10(signal / noise);
+}
+
+TEST_CASE("Resampler converts tones cleanly", "[audio_core]") {
+    constexpr size_t num_input_samples = 16384;
+
+    for (unsigned int output_rate : {44100u, 48000u, 22050u}) {
+        // Up to the edge of the passband, which is below the Nyquist frequency of the output when
+        // downsampling
+        const double max_frequency = std::min<unsigned int>(native_sample_rate, output_rate) * 0.4;
+        for (double frequency : {50.0, 440.0, 1000.0, 3000.0, 6000.0, 9000.0, 12000.0, 13000.0}) {
+            if (frequency > max_frequency)
+                continue;
+            Resampler resampler(native_sample_rate, output_rate);
+            const std::vector<s16> input =
+                GenerateTone(frequency, native_sample_rate, num_input_samples);
+
+            // In uneven chunks, as the DSP and the stretcher would feed it
+            std::vector<s16> output;
+            std::vector<s16> chunk;
+            for (size_t offset = 0; offset < num_input_samples;) {
+                const size_t length =
+                    std::min<size_t>(num_input_samples - offset, 150 + offset % 23);
+                resampler.Process(&input[offset * 2], length, chunk);
+                output.insert(output.end(), chunk.begin(), chunk.end());
+                offset += length;
+            }
+
+            // The length of the output matches the conversion ratio, bar the latency of the filter
+            const double expected = static_cast<double>(num_input_samples) * output_rate /
+                                    native_sample_rate;
+            REQUIRE(output.size() / 2 <= expected + 1);
+            REQUIRE(output.size() / 2 >= expected - 64);
+
+            // Past the start, where the filter is still filled with silence
+            const size_t first = 256;
+            const size_t count = output.size() / 2 - first;
+            INFO("output rate " << output_rate << ", frequency " << frequency);
+            REQUIRE(MeasureSINAD(output, 0, first, count, frequency, output_rate) > 80.0);
+            REQUIRE(MeasureSINAD(output, 1, first, count, frequency, output_rate) > 80.0);
+        }
+    }
+}
+
+TEST_CASE("Resampler passes samples through at the same rate", "[audio_core]") {
+    Resampler resampler(native_sample_rate, native_sample_rate);
+    const std::vector<s16> input = GenerateTone(1000.0, native_sample_rate, 1000);
+
+    std::vector<s16> output;
+    resampler.Process(input.data(), input.size() / 2, output);
+
+    // Aligned with the input, but held back by the latency of the filter
+    const size_t latency = input.size() / 2 - output.size() / 2;
+    REQUIRE(latency <= 32);
+    // Past the ringing caused by the tone starting abruptly
+    for (size_t i = 128; i < output.size(); ++i) {
+        REQUIRE(std::abs(output[i] - input[i]) <= 1);
+    }
+}
+
+TEST_CASE("Resampler benchmark", "[.][benchmark][audio_core]") {
+    // Frames of the length the DSP produces
+    constexpr size_t frame_length = 160;
+    constexpr size_t num_input_samples = native_sample_rate * 10 / frame_length * frame_length;
+    const std::vector<s16> input = GenerateTone(1000.0, native_sample_rate, num_input_samples);
+
+    for (unsigned int output_rate : {44100u, 48000u}) {
+        Resampler resampler(native_sample_rate, output_rate);
+        std::vector<s16> output;
+        size_t num_output_samples = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset < num_input_samples; offset += frame_length) {
+            resampler.Process(&input[offset * 2], frame_length, output);
+            num_output_samples += output.size() / 2;
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const double ns =
+            static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                                    .count());
+        std::printf("Resampling %u Hz to %u Hz: %.1f ns per output sample, %.0fx real time\n",
+                    native_sample_rate, output_rate, ns / num_output_samples,
+                    num_input_samples * 1e9 / native_sample_rate / ns);
+    }
+}
+
+} // namespace AudioCore
@@ -0,0 +1,138 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <catch.hpp>
+#include "audio_core/sample_ring.h"
+#include "common/common_types.h"
+
+namespace AudioCore {
+
+/// Stereo samples numbered from first, with the right channel holding the complement
+static std::vector<s16> NumberedSamples(size_t first, size_t count) {
+    std::vector<s16> samples(count * 2);
+    for (size_t i = 0; i < count; ++i) {
+        samples[i * 2] = static_cast<s16>(first + i);
+        samples[i * 2 + 1] = static_cast<s16>(~(first + i));
+    }
+    return samples;
+}
+
+TEST_CASE("SampleRing rounds its capacity up to a power of two", "[audio_core]") {
+    REQUIRE(SampleRing(1).Capacity() == 1);
+    REQUIRE(SampleRing(64).Capacity() == 64);
+    REQUIRE(SampleRing(1000).Capacity() == 1024);
+}
+
+TEST_CASE("SampleRing wraps around the end of its buffer", "[audio_core]") {
+    SampleRing ring(16);
+    std::vector<s16> out(16 * 2);
+
+    // Move the indices close to the end of the buffer
+    const std::vector<s16> head = NumberedSamples(0, 13);
+    REQUIRE(ring.Push(head.data(), 13) == 13);
+    REQUIRE(ring.Pop(out.data(), 13) == 13);
+    REQUIRE(ring.Size() == 0);
+
+    // Both the push and the pop are split at the end of the buffer
+    const std::vector<s16> samples = NumberedSamples(100, 10);
+    REQUIRE(ring.Push(samples.data(), 10) == 10);
+    REQUIRE(ring.Size() == 10);
+    REQUIRE(ring.Pop(out.data(), 10) == 10);
+    REQUIRE(std::equal(samples.begin(), samples.end(), out.begin()));
+
+    // Keep going around the ring several times
+    for (size_t first = 200; first < 400; first += 11) {
+        const std::vector<s16> batch = NumberedSamples(first, 11);
+        REQUIRE(ring.Push(batch.data(), 11) == 11);
+        REQUIRE(ring.Pop(out.data(), 11) == 11);
+        REQUIRE(std::equal(batch.begin(), batch.end(), out.begin()));
+    }
+}
+
+TEST_CASE("SampleRing truncates pushes to the free space", "[audio_core]") {
+    SampleRing ring(16);
+    std::vector<s16> out(32 * 2);
+
+    const std::vector<s16> samples = NumberedSamples(0, 20);
+    REQUIRE(ring.Push(samples.data(), 20) == 16);
+    REQUIRE(ring.Size() == 16);
+
+    // Nothing fits in a full ring
+    REQUIRE(ring.Push(samples.data(), 1) == 0);
+    REQUIRE(ring.Size() == 16);
+
+    // Only the samples which fit were queued, and the queued ones are intact
+    REQUIRE(ring.Pop(out.data(), 5) == 5);
+    const std::vector<s16> more = NumberedSamples(16, 8);
+    REQUIRE(ring.Push(more.data(), 8) == 5);
+    REQUIRE(ring.Pop(out.data() + 5 * 2, 32) == 16);
+    const std::vector<s16> expected = NumberedSamples(0, 21);
+    REQUIRE(std::equal(expected.begin(), expected.end(), out.begin()));
+}
+
+TEST_CASE("SampleRing pops nothing when empty", "[audio_core]") {
+    SampleRing ring(16);
+    std::vector<s16> out(4 * 2, 0x1234);
+
+    REQUIRE(ring.Pop(out.data(), 4) == 0);
+    REQUIRE(ring.Size() == 0);
+    REQUIRE(std::all_of(out.begin(), out.end(), [](s16 value) { return value == 0x1234; }));
+
+    // A pop asking for more than is queued returns what there is, then runs empty again
+    const std::vector<s16> samples = NumberedSamples(0, 3);
+    REQUIRE(ring.Push(samples.data(), 3) == 3);
+    REQUIRE(ring.Pop(out.data(), 4) == 3);
+    REQUIRE(std::equal(samples.begin(), samples.end(), out.begin()));
+    REQUIRE(ring.Pop(out.data(), 4) == 0);
+    REQUIRE(ring.Size() == 0);
+}
+
+TEST_CASE("SampleRing keeps samples in order across threads", "[audio_core]") {
+    // Batch sizes are coprime with the capacity, so that transfers straddle the end of the buffer
+    constexpr size_t total = 1000000;
+    constexpr size_t push_batch = 77;
+    constexpr size_t pop_batch = 100;
+    SampleRing ring(1000);
+
+    std::thread producer([&] {
+        for (size_t first = 0; first < total; first += push_batch) {
+            const size_t count = std::min(push_batch, total - first);
+            const std::vector<s16> samples = NumberedSamples(first, count);
+            size_t pushed = 0;
+            while (pushed < count) {
+                const size_t pushed_now =
+                    ring.Push(samples.data() + pushed * 2, count - pushed);
+                if (pushed_now == 0)
+                    std::this_thread::yield();
+                pushed += pushed_now;
+            }
+        }
+    });
+
+    std::vector<s16> out(pop_batch * 2);
+    size_t popped = 0;
+    size_t mismatches = 0;
+    size_t overfull = 0;
+    while (popped < total) {
+        if (ring.Size() > ring.Capacity())
+            ++overfull;
+        const size_t count = ring.Pop(out.data(), pop_batch);
+        if (count == 0)
+            std::this_thread::yield();
+        const std::vector<s16> expected = NumberedSamples(popped, count);
+        if (!std::equal(expected.begin(), expected.end(), out.begin()))
+            ++mismatches;
+        popped += count;
+    }
+    producer.join();
+
+    REQUIRE(mismatches == 0);
+    REQUIRE(overfull == 0);
+    REQUIRE(ring.Size() == 0);
+}
+
+} // namespace AudioCore
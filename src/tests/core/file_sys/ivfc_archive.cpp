@@ -0,0 +1,52 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "common/file_util.h"
+#include "core/file_sys/ivfc_archive.h"
+
+namespace FileSys {
+
+TEST_CASE("IVFC files read the same mapped and through stdio", "[core][file_sys]") {
+    const std::string path = "ivfc_archive_test.bin";
+    std::vector<u8> container(300000);
+    for (size_t i = 0; i < container.size(); ++i)
+        container[i] = static_cast<u8>(i * 11 + i / 263);
+    {
+        FileUtil::IOFile file(path, "wb");
+        file.WriteBytes(container.data(), container.size());
+    }
+
+    constexpr u64 image_offset = 0x1000;
+    constexpr u64 image_size = 250000;
+    const auto file = std::make_shared<FileUtil::IOFile>(path, "rb");
+    const auto mapping = MapIVFCContainer(*file, image_offset, image_size);
+    // Images which don't fit in their container aren't mapped
+    REQUIRE(MapIVFCContainer(*file, image_offset, container.size()) == nullptr);
+
+    const IVFCFile stdio_file(file, nullptr, image_offset, image_size);
+    const IVFCFile mapped_file(file, mapping, image_offset, image_size);
+    REQUIRE(mapped_file.GetSize() == image_size);
+
+    // Small and large reads, and reads past the end of the image
+    for (u64 offset : {u64(0), u64(1234), u64(100000), image_size - 70000, image_size - 10}) {
+        for (size_t length : {size_t(16), size_t(80000)}) {
+            std::vector<u8> stdio_data(length), mapped_data(length);
+            const ResultVal<size_t> stdio_read = stdio_file.Read(offset, length, stdio_data.data());
+            const ResultVal<size_t> mapped_read =
+                mapped_file.Read(offset, length, mapped_data.data());
+            REQUIRE(*mapped_read == *stdio_read);
+            REQUIRE(mapped_data == stdio_data);
+        }
+    }
+
+    file->Close();
+    FileUtil::Delete(path);
+}
+
+} // namespace FileSys
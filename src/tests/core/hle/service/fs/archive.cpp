@@ -0,0 +1,231 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "common/file_util.h"
+#include "core/file_sys/file_backend.h"
+#include "core/file_sys/ivfc_archive.h"
+#include "core/hle/service/fs/archive.h"
+#include "core/memory.h"
+#include "core/memory_setup.h"
+
+namespace Service {
+namespace FS {
+
+/// File backed by a buffer in host memory
+class BufferFile final : public FileSys::FileBackend {
+public:
+    explicit BufferFile(std::vector<u8>& data) : data(data) {}
+
+    ResultVal<size_t> Read(u64 offset, size_t length, u8* buffer) const override {
+        const size_t read_length = static_cast<size_t>(
+            std::min<u64>(length, offset < data.size() ? data.size() - offset : 0));
+        std::memcpy(buffer, data.data() + offset, read_length);
+        return MakeResult<size_t>(read_length);
+    }
+
+    ResultVal<size_t> Write(u64 offset, size_t length, bool flush,
+                            const u8* buffer) const override {
+        if (offset + length > data.size())
+            data.resize(static_cast<size_t>(offset + length));
+        std::memcpy(data.data() + offset, buffer, length);
+        flushes += flush ? 1 : 0;
+        return MakeResult<size_t>(length);
+    }
+
+    u64 GetSize() const override {
+        return data.size();
+    }
+
+    bool SetSize(u64 size) const override {
+        data.resize(static_cast<size_t>(size));
+        return true;
+    }
+
+    bool Close() const override {
+        return true;
+    }
+
+    void Flush() const override {}
+
+    mutable int flushes = 0;
+
+private:
+    std::vector<u8>& data;
+};
+
+/// Maps two pages of emulated memory to buffers which aren't contiguous on the host
+class TwoPages {
+public:
+    TwoPages() : first(Memory::PAGE_SIZE), second(Memory::PAGE_SIZE) {
+        Memory::MapMemoryRegion(Memory::HEAP_VADDR, Memory::PAGE_SIZE, first.data());
+        Memory::MapMemoryRegion(Memory::HEAP_VADDR + Memory::PAGE_SIZE, Memory::PAGE_SIZE,
+                                second.data());
+    }
+
+    ~TwoPages() {
+        Memory::UnmapRegion(Memory::HEAP_VADDR, Memory::PAGE_SIZE * 2);
+    }
+
+    std::vector<u8> first;
+    std::vector<u8> second;
+};
+
+TEST_CASE("Files are read straight into emulated memory", "[core][fs]") {
+    TwoPages pages;
+    std::vector<u8> data(Memory::PAGE_SIZE * 2);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<u8>(i * 7 + i / 251);
+    BufferFile file(data);
+
+    // Across the two pages, up to the end of the file
+    const VAddr address = Memory::HEAP_VADDR + Memory::PAGE_SIZE - 100;
+    const ResultVal<size_t> read = ReadFileToMemory(file, data.size() - 300, 400, address);
+    REQUIRE(read.Succeeded());
+    REQUIRE(*read == 300);
+    REQUIRE(std::memcmp(pages.first.data() + Memory::PAGE_SIZE - 100, &data[data.size() - 300],
+                        100) == 0);
+    REQUIRE(std::memcmp(pages.second.data(), &data[data.size() - 200], 200) == 0);
+    REQUIRE(pages.second[200] == 0);
+}
+
+TEST_CASE("Files are written straight from emulated memory", "[core][fs]") {
+    TwoPages pages;
+    for (size_t i = 0; i < Memory::PAGE_SIZE; ++i) {
+        pages.first[i] = static_cast<u8>(i);
+        pages.second[i] = static_cast<u8>(i * 3);
+    }
+    std::vector<u8> data;
+    BufferFile file(data);
+
+    const VAddr address = Memory::HEAP_VADDR + Memory::PAGE_SIZE - 100;
+    const ResultVal<size_t> written = WriteFileFromMemory(file, 10, 300, true, address);
+    REQUIRE(written.Succeeded());
+    REQUIRE(*written == 300);
+    REQUIRE(data.size() == 310);
+    REQUIRE(std::memcmp(&data[10], pages.first.data() + Memory::PAGE_SIZE - 100, 100) == 0);
+    REQUIRE(std::memcmp(&data[110], pages.second.data(), 200) == 0);
+    // Flushed once, after the last piece
+    REQUIRE(file.flushes == 1);
+}
+
+/// Maps two pages of emulated memory around an unmapped one, which has no host pointer
+class PagesAroundGap {
+public:
+    PagesAroundGap() : first(Memory::PAGE_SIZE), last(Memory::PAGE_SIZE) {
+        Memory::MapMemoryRegion(Memory::HEAP_VADDR, Memory::PAGE_SIZE, first.data());
+        Memory::MapMemoryRegion(Memory::HEAP_VADDR + Memory::PAGE_SIZE * 2, Memory::PAGE_SIZE,
+                                last.data());
+    }
+
+    ~PagesAroundGap() {
+        Memory::UnmapRegion(Memory::HEAP_VADDR, Memory::PAGE_SIZE * 3);
+    }
+
+    std::vector<u8> first;
+    std::vector<u8> last;
+};
+
+TEST_CASE("Files are read through a buffer into pages without a host pointer", "[core][fs]") {
+    PagesAroundGap pages;
+    std::vector<u8> data(Memory::PAGE_SIZE * 3);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<u8>(i * 7 + i / 251);
+    BufferFile file(data);
+
+    // From the end of the first page to the start of the last one, the gap dropping its bytes
+    const VAddr address = Memory::HEAP_VADDR + Memory::PAGE_SIZE - 100;
+    const size_t length = Memory::PAGE_SIZE + 300;
+    const ResultVal<size_t> read = ReadFileToMemory(file, 50, length, address);
+    REQUIRE(read.Succeeded());
+    REQUIRE(*read == length);
+    REQUIRE(std::memcmp(pages.first.data() + Memory::PAGE_SIZE - 100, &data[50], 100) == 0);
+    REQUIRE(std::memcmp(pages.last.data(), &data[50 + 100 + Memory::PAGE_SIZE], 200) == 0);
+    REQUIRE(pages.last[200] == 0);
+}
+
+TEST_CASE("Files are written through a buffer from pages without a host pointer",
+          "[core][fs]") {
+    PagesAroundGap pages;
+    for (size_t i = 0; i < Memory::PAGE_SIZE; ++i) {
+        pages.first[i] = static_cast<u8>(i + 1);
+        pages.last[i] = static_cast<u8>(i * 3 + 1);
+    }
+    std::vector<u8> data;
+    BufferFile file(data);
+
+    // The gap reads as zeros, the pages around it as they are
+    const VAddr address = Memory::HEAP_VADDR + Memory::PAGE_SIZE - 100;
+    const size_t length = Memory::PAGE_SIZE + 300;
+    const ResultVal<size_t> written = WriteFileFromMemory(file, 10, length, true, address);
+    REQUIRE(written.Succeeded());
+    REQUIRE(*written == length);
+    REQUIRE(data.size() == 10 + length);
+    REQUIRE(std::memcmp(&data[10], pages.first.data() + Memory::PAGE_SIZE - 100, 100) == 0);
+    REQUIRE(std::all_of(&data[110], &data[110 + Memory::PAGE_SIZE], [](u8 b) { return b == 0; }));
+    REQUIRE(std::memcmp(&data[110 + Memory::PAGE_SIZE], pages.last.data(), 200) == 0);
+    REQUIRE(file.flushes == 1);
+}
+
+TEST_CASE("Streaming a RomFS into emulated memory", "[.][benchmark][core][fs]") {
+    const std::string path = "fs_romfs_benchmark.bin";
+    constexpr size_t romfs_size = 64 * 1024 * 1024;
+    constexpr size_t buffer_size = 4 * 1024 * 1024;
+    constexpr size_t read_size = 1024 * 1024;
+
+    {
+        std::vector<u8> block(read_size);
+        for (size_t i = 0; i < block.size(); ++i)
+            block[i] = static_cast<u8>(i * 13 + i / 509);
+        FileUtil::IOFile file(path, "wb");
+        for (size_t i = 0; i < romfs_size / read_size; ++i)
+            file.WriteBytes(block.data(), block.size());
+    }
+
+    std::vector<u8> memory(buffer_size);
+    Memory::MapMemoryRegion(Memory::HEAP_VADDR, buffer_size, memory.data());
+
+    const auto romfs_file = std::make_shared<FileUtil::IOFile>(path, "rb");
+    const FileSys::IVFCFile romfs(romfs_file, nullptr, 0, romfs_size);
+    const FileSys::IVFCFile mapped_romfs(
+        romfs_file, FileSys::MapIVFCContainer(*romfs_file, 0, romfs_size), 0, romfs_size);
+    const auto Stream = [&](const char* name, auto read) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset < romfs_size; offset += read_size) {
+            read(offset, Memory::HEAP_VADDR + static_cast<VAddr>(offset % buffer_size));
+        }
+        const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        std::printf("%s: %.0f MB/s\n", name, romfs_size / duration.count() / 1e6);
+    };
+
+    // Once to bring the file into the page cache
+    Stream("cold", [&](u64 offset, VAddr address) {
+        ReadFileToMemory(romfs, offset, read_size, address);
+    });
+    Stream("through a buffer", [&](u64 offset, VAddr address) {
+        std::vector<u8> data(read_size);
+        const ResultVal<size_t> read = romfs.Read(offset, data.size(), data.data());
+        Memory::WriteBlock(address, data.data(), *read);
+    });
+    Stream("into memory", [&](u64 offset, VAddr address) {
+        ReadFileToMemory(romfs, offset, read_size, address);
+    });
+    Stream("mapped into memory", [&](u64 offset, VAddr address) {
+        ReadFileToMemory(mapped_romfs, offset, read_size, address);
+    });
+
+    Memory::UnmapRegion(Memory::HEAP_VADDR, buffer_size);
+    FileUtil::Delete(path);
+}
+
+} // namespace FS
+} // namespace Service
@@ -0,0 +1,156 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "core/tracer/compression.h"
+
+namespace CiTrace {
+namespace Compression {
+
+/// Bytes without repeated 4-byte sequences, which the compressor has to store as literals
+static std::vector<u8> RandomBytes(size_t size, u32 seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<u8> data(size);
+    std::generate(data.begin(), data.end(), [&] { return static_cast<u8>(byte(rng)); });
+    return data;
+}
+
+static std::vector<u8> RoundTrip(const std::vector<u8>& data) {
+    const std::vector<u8> compressed = Compress(data.data(), data.size());
+    std::vector<u8> decompressed(data.size());
+    REQUIRE(Decompress(compressed.data(), compressed.size(), decompressed.data(),
+                       decompressed.size()));
+    return decompressed;
+}
+
+/// Size of a length field holding the given length, beyond the token nibble
+static size_t ExtraLengthSize(size_t length) {
+    return length >= 15 ? (length - 15) / 255 + 1 : 0;
+}
+
+TEST_CASE("Compression round-trips empty data", "[core][tracer]") {
+    const std::vector<u8> compressed = Compress(nullptr, 0);
+    REQUIRE(compressed == std::vector<u8>{0x00});
+    REQUIRE(Decompress(compressed.data(), compressed.size(), nullptr, 0));
+
+    u8 out = 0;
+    REQUIRE(!Decompress(compressed.data(), compressed.size(), &out, 1));
+}
+
+TEST_CASE("Compression round-trips incompressible data", "[core][tracer]") {
+    const std::vector<u8> data = RandomBytes(100000, 0x12345678);
+    const std::vector<u8> compressed = Compress(data.data(), data.size());
+
+    // Everything ends up in a single run of literals
+    REQUIRE(compressed.size() == 1 + ExtraLengthSize(data.size()) + data.size());
+    REQUIRE(RoundTrip(data) == data);
+}
+
+TEST_CASE("Compression encodes literal lengths at the nibble boundaries", "[core][tracer]") {
+    for (size_t length : {1, 14, 15, 16, 269, 270, 271, 524, 525, 526}) {
+        const std::vector<u8> data = RandomBytes(length, static_cast<u32>(length * 7 + 1));
+        const std::vector<u8> compressed = Compress(data.data(), data.size());
+        CAPTURE(length);
+        REQUIRE(compressed.size() == 1 + ExtraLengthSize(length) + length);
+        REQUIRE(RoundTrip(data) == data);
+    }
+}
+
+TEST_CASE("Compression encodes match lengths at the nibble boundaries", "[core][tracer]") {
+    // Match lengths are stored minus the minimum length of 4
+    for (size_t encoded : {0, 14, 15, 16, 269, 270, 271, 524, 525, 526}) {
+        const size_t length = encoded + 4;
+
+        // The block is followed by a copy of itself, which ends right before a different byte
+        std::vector<u8> data = RandomBytes(length, static_cast<u32>(length * 13 + 5));
+        data.insert(data.end(), data.begin(), data.end());
+        const std::vector<u8> tail = RandomBytes(8, 0xCAFE);
+        data.insert(data.end(), tail.begin(), tail.end());
+        data[2 * length] = static_cast<u8>(~data[0]);
+
+        const std::vector<u8> compressed = Compress(data.data(), data.size());
+        CAPTURE(length);
+        REQUIRE(compressed.size() == 1 + ExtraLengthSize(length) + length + 2 +
+                                         ExtraLengthSize(encoded) + 1 + tail.size());
+        REQUIRE(RoundTrip(data) == data);
+    }
+}
+
+TEST_CASE("Compression handles matches overlapping their output", "[core][tracer]") {
+    for (size_t period : {1, 2, 3, 7}) {
+        const std::vector<u8> pattern = RandomBytes(period, static_cast<u32>(period + 99));
+        std::vector<u8> data;
+        for (size_t i = 0; i < 5000; ++i) {
+            data.push_back(pattern[i % period]);
+        }
+
+        const std::vector<u8> compressed = Compress(data.data(), data.size());
+        CAPTURE(period);
+        REQUIRE(compressed.size() < 64);
+        REQUIRE(RoundTrip(data) == data);
+    }
+
+    // A single literal repeated by a match at distance 1
+    const std::vector<u8> compressed = {0x11, 'a', 0x01, 0x00, 0x00};
+    std::vector<u8> out(6);
+    REQUIRE(Decompress(compressed.data(), compressed.size(), out.data(), out.size()));
+    REQUIRE(out == std::vector<u8>(6, 'a'));
+}
+
+TEST_CASE("Compression rejects truncated data", "[core][tracer]") {
+    // Literal runs and matches with extra length bytes, to truncate every kind of field
+    std::vector<u8> data = RandomBytes(300, 1);
+    data.insert(data.end(), data.begin(), data.begin() + 280);
+    const std::vector<u8> tail = RandomBytes(20, 2);
+    data.insert(data.end(), tail.begin(), tail.end());
+    data.insert(data.end(), 400, 0x55);
+
+    const std::vector<u8> compressed = Compress(data.data(), data.size());
+    REQUIRE(RoundTrip(data) == data);
+
+    std::vector<u8> out(data.size());
+    for (size_t size = 0; size < compressed.size(); ++size) {
+        CAPTURE(size);
+        REQUIRE(!Decompress(compressed.data(), size, out.data(), out.size()));
+    }
+}
+
+TEST_CASE("Compression rejects corrupted data", "[core][tracer]") {
+    std::vector<u8> out(16);
+
+    // Valid stream: a literal and a match of 4 repeating it
+    const std::vector<u8> valid = {0x10, 'a', 0x01, 0x00, 0x00};
+    REQUIRE(Decompress(valid.data(), valid.size(), out.data(), 5));
+
+    // Output size mismatch
+    REQUIRE(!Decompress(valid.data(), valid.size(), out.data(), 4));
+    REQUIRE(!Decompress(valid.data(), valid.size(), out.data(), 6));
+
+    // Match distance of zero, and reaching before the start of the output
+    const std::vector<u8> zero_distance = {0x10, 'a', 0x00, 0x00, 0x00};
+    REQUIRE(!Decompress(zero_distance.data(), zero_distance.size(), out.data(), 5));
+    const std::vector<u8> far_distance = {0x10, 'a', 0x02, 0x00, 0x00};
+    REQUIRE(!Decompress(far_distance.data(), far_distance.size(), out.data(), 5));
+
+    // Literal run longer than the remaining data
+    const std::vector<u8> long_literals = {0x50, 'a', 'b'};
+    REQUIRE(!Decompress(long_literals.data(), long_literals.size(), out.data(), 5));
+
+    // Extra length bytes running past the end of the data
+    const std::vector<u8> unterminated_length = {0xF0, 255, 255};
+    REQUIRE(!Decompress(unterminated_length.data(), unterminated_length.size(), out.data(),
+                        out.size()));
+
+    // Match running past the end of the output buffer
+    const std::vector<u8> long_match = {0x1F, 'a', 0x01, 0x00, 0x10, 0x00};
+    REQUIRE(!Decompress(long_match.data(), long_match.size(), out.data(), out.size()));
+}
+
+} // namespace Compression
+} // namespace CiTrace
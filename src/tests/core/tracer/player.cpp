@@ -0,0 +1,190 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "common/file_util.h"
+#include "core/hw/hw.h"
+#include "core/hw/lcd.h"
+#include "core/memory.h"
+#include "core/memory_setup.h"
+#include "core/tracer/citrace.h"
+#include "core/tracer/player.h"
+#include "core/tracer/recorder.h"
+#include "video_core/rasterizer_interface.h"
+#include "video_core/renderer_base.h"
+#include "video_core/video_core.h"
+
+namespace CiTrace {
+
+class NullRasterizer final : public VideoCore::RasterizerInterface {
+public:
+    void AddTriangle(const Pica::Shader::OutputVertex& v0, const Pica::Shader::OutputVertex& v1,
+                     const Pica::Shader::OutputVertex& v2) override {}
+    void DrawTriangles() override {}
+    void NotifyPicaRegisterWrite(u32 id, u32 old_value, u32 new_value) override {}
+    void NotifyPicaRegisterChanged(u32 id) override {}
+    void FlushAll() override {}
+    void FlushRegion(PAddr addr, u32 size) override {}
+    void FlushAndInvalidateRegion(PAddr addr, u32 size) override {}
+};
+
+class NullRenderer final : public RendererBase {
+public:
+    NullRenderer() {
+        rasterizer = std::make_unique<NullRasterizer>();
+    }
+
+    void SwapBuffers() override {}
+    void SetWindow(EmuWindow* window) override {}
+    bool Init() override {
+        return true;
+    }
+    void ShutDown() override {}
+};
+
+/// Maps VRAM to a host buffer and installs a renderer for the player to notify
+class PlaybackEnvironment {
+public:
+    PlaybackEnvironment() : vram(Memory::VRAM_SIZE) {
+        Memory::MapMemoryRegion(Memory::VRAM_VADDR, Memory::VRAM_SIZE, vram.data());
+        VideoCore::g_renderer = std::make_unique<NullRenderer>();
+    }
+
+    ~PlaybackEnvironment() {
+        VideoCore::g_renderer = nullptr;
+        Memory::UnmapRegion(Memory::VRAM_VADDR, Memory::VRAM_SIZE);
+    }
+
+    std::vector<u8> vram;
+};
+
+/// Physical address of an LCD register, as the LCD reports writes to the recorder
+static u32 LcdRegisterAddress(u32 index) {
+    return HW::VADDR_LCD - Memory::IO_AREA_VADDR + Memory::IO_AREA_PADDR + index * sizeof(u32);
+}
+
+/// Writes an LCD register the way the emulated CPU would while recording
+static void WriteLcdRegister(Recorder& recorder, u32 index, u32 value) {
+    LCD::g_regs[index] = value;
+    recorder.RegisterWritten<u32>(LcdRegisterAddress(index), value);
+}
+
+TEST_CASE("Player seeks to frames following a later keyframe", "[core][tracer]") {
+    const std::string path = "citrace_player_test.ctf";
+    PlaybackEnvironment environment;
+    std::vector<u8>& vram = environment.vram;
+
+    const u32 fill_top = LCD_REG_INDEX(color_fill_top);
+    const u32 fill_bottom = LCD_REG_INDEX(color_fill_bottom);
+    constexpr u32 page_1 = Memory::PAGE_SIZE;
+    constexpr u32 page_2 = 2 * Memory::PAGE_SIZE;
+
+    // More than a chunk worth of incompressible memory, so that frame 1 starts a new keyframe
+    std::mt19937 rng(0x9E3779B9);
+    std::uniform_int_distribution<int> random_byte(0, 255);
+    std::vector<u8> initial_vram(0x480000);
+    std::generate(initial_vram.begin(), initial_vram.end(),
+                  [&] { return static_cast<u8>(random_byte(rng)); });
+    auto recorded_vram = [&] {
+        return std::vector<u8>(vram.begin(), vram.begin() + initial_vram.size());
+    };
+    std::vector<u8> vram_at_frame_1, vram_at_frame_2, vram_at_end;
+    {
+        LCD::g_regs[fill_top] = 0;
+        LCD::g_regs[fill_bottom] = 0;
+        Recorder recorder(path);
+
+        // Frame 0
+        std::copy(initial_vram.begin(), initial_vram.end(), vram.begin());
+        recorder.MemoryAccessed(vram.data(), static_cast<u32>(initial_vram.size()),
+                                Memory::VRAM_PADDR);
+        WriteLcdRegister(recorder, fill_top, 1);
+        WriteLcdRegister(recorder, fill_bottom, 0x77);
+        recorder.FrameFinished();
+        vram_at_frame_1 = recorded_vram();
+
+        // Frame 1
+        std::fill_n(vram.begin() + page_1, Memory::PAGE_SIZE, 0x11);
+        recorder.MemoryAccessed(vram.data() + page_1, Memory::PAGE_SIZE,
+                                Memory::VRAM_PADDR + page_1);
+        WriteLcdRegister(recorder, fill_top, 2);
+        recorder.FrameFinished();
+        vram_at_frame_2 = recorded_vram();
+
+        // Frame 2
+        std::fill_n(vram.begin() + page_2, Memory::PAGE_SIZE, 0x22);
+        recorder.MemoryAccessed(vram.data() + page_2, Memory::PAGE_SIZE,
+                                Memory::VRAM_PADDR + page_2);
+        WriteLcdRegister(recorder, fill_top, 3);
+        recorder.FrameFinished();
+        vram_at_end = recorded_vram();
+
+        recorder.Finish();
+    }
+
+    // Frames 1 and 2 are in the second chunk, which is a keyframe
+    {
+        FileUtil::IOFile file(path, "rb");
+        CTHeaderV2 header;
+        REQUIRE(file.ReadArray(&header, 1) == 1);
+        REQUIRE(header.version == CTHeaderV2::ExpectedVersion());
+        REQUIRE(header.chunk_count == 2);
+        REQUIRE(header.frame_count == 3);
+
+        std::vector<CTChunkV2> chunks(header.chunk_count);
+        std::vector<CTFrameV2> frames(header.frame_count);
+        REQUIRE(file.Seek(header.index_offset, SEEK_SET));
+        REQUIRE(file.ReadArray(chunks.data(), chunks.size()) == chunks.size());
+        REQUIRE(file.ReadArray(frames.data(), frames.size()) == frames.size());
+        REQUIRE((chunks[1].flags & CTChunkV2::Keyframe) != 0);
+        REQUIRE(frames[1].chunk == 1);
+        REQUIRE(frames[2].chunk == 1);
+    }
+
+    auto clobber_state = [&] {
+        std::fill(vram.begin(), vram.end(), 0xEE);
+        LCD::g_regs[fill_top] = 0xDEAD;
+        LCD::g_regs[fill_bottom] = 0xDEAD;
+    };
+
+    Player player;
+    REQUIRE(player.Load(path));
+    REQUIRE(player.GetFrameCount() == 3);
+
+    // Restoring the keyframe has to bring back memory and registers last written in frame 0
+    clobber_state();
+    player.Seek(2);
+    REQUIRE(recorded_vram() == vram_at_frame_2);
+    REQUIRE(LCD::g_regs[fill_top] == 2);
+    REQUIRE(LCD::g_regs[fill_bottom] == 0x77);
+
+    player.ReplayFrame(2);
+    REQUIRE(recorded_vram() == vram_at_end);
+    REQUIRE(LCD::g_regs[fill_top] == 3);
+
+    // Seeking backwards undoes the memory changes of later frames
+    player.Seek(1);
+    REQUIRE(recorded_vram() == vram_at_frame_1);
+    REQUIRE(LCD::g_regs[fill_top] == 1);
+    REQUIRE(LCD::g_regs[fill_bottom] == 0x77);
+
+    // The first keyframe holds the registers from before the recording started
+    clobber_state();
+    player.ReplayFrame(0);
+    REQUIRE(recorded_vram() == initial_vram);
+    REQUIRE(LCD::g_regs[fill_top] == 1);
+    player.Seek(0);
+    REQUIRE(LCD::g_regs[fill_top] == 0);
+    REQUIRE(LCD::g_regs[fill_bottom] == 0);
+
+    FileUtil::Delete(path);
+}
+
+} // namespace CiTrace
@@ -0,0 +1,363 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "core/settings.h"
+#include "video_core/geometry_pipeline.h"
+#include "video_core/pica_state.h"
+#include "video_core/pica_types.h"
+#include "video_core/regs_pipeline.h"
+#include "video_core/regs_shader.h"
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_interpreter.h"
+#ifdef ARCHITECTURE_x86_64
+#include "video_core/shader/shader_jit_x64.h"
+#endif // ARCHITECTURE_x86_64
+
+namespace Pica {
+namespace Shader {
+
+static constexpr u32 SWIZZLE_XYZW = 0xF | (0x1B << 5) | (0x1B << 14) | (0x1B << 23);
+
+/// The engines able to run geometry shaders on this host
+static std::vector<std::unique_ptr<ShaderEngine>> MakeEngines() {
+    std::vector<std::unique_ptr<ShaderEngine>> engines;
+    engines.push_back(std::make_unique<InterpreterEngine>(false));
+    engines.push_back(std::make_unique<InterpreterEngine>(true));
+#ifdef ARCHITECTURE_x86_64
+    engines.push_back(std::make_unique<JitX64Engine>());
+#endif // ARCHITECTURE_x86_64
+    return engines;
+}
+
+static Math::Vec4<float24> MakeVec(float x, float y, float z, float w) {
+    return Math::MakeVec(float24::FromFloat32(x), float24::FromFloat32(y), float24::FromFloat32(z),
+                         float24::FromFloat32(w));
+}
+
+/// Vertex shader output with two attributes, distinct for each index
+static AttributeBuffer MakeVertex(unsigned index) {
+    AttributeBuffer vertex;
+    std::memset(&vertex, 0, sizeof(vertex));
+    vertex.attr[0] = MakeVec(1.0f * index, index + 0.5f, -1.0f * index, 1.0f);
+    vertex.attr[1] = MakeVec(0.25f * index, 0.5f, 0.75f, 1.0f - 0.125f * index);
+    return vertex;
+}
+
+static void RequireAttribute(const Math::Vec4<float24>& actual,
+                             const Math::Vec4<float24>& expected) {
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        CAPTURE(comp);
+        REQUIRE(actual[comp].ToFloat32() == expected[comp].ToFloat32());
+    }
+}
+
+/// Vertices emitted by a geometry shader writing o0 and o1, with the windings set before them
+struct EmittedVertices {
+    std::vector<AttributeBuffer> vertices;
+    /// Number of vertices emitted before each winding change
+    std::vector<size_t> windings;
+
+    void Connect(GSUnitState& unit) {
+        unit.SetVertexHandler([this](const AttributeBuffer& vertex) { vertices.push_back(vertex); },
+                              [this] { windings.push_back(vertices.size()); });
+    }
+
+    void RequireVertex(size_t index, const Math::Vec4<float24>& attr0,
+                       const Math::Vec4<float24>& attr1) const {
+        CAPTURE(index);
+        REQUIRE(index < vertices.size());
+        RequireAttribute(vertices[index].attr[0], attr0);
+        RequireAttribute(vertices[index].attr[1], attr1);
+    }
+};
+
+TEST_CASE("Geometry shader engines emit the same vertices and windings", "[video_core][shader]") {
+    auto setup = std::make_unique<ShaderSetup>();
+    std::memset(setup.get(), 0, sizeof(ShaderSetup));
+    setup->output_mask = 0x3;
+    setup->swizzle_data[0] = SWIZZLE_XYZW;
+    const u32 program[] = {
+        0xac000000, // setemit 0
+        0x00020000, // add o0, c0, v0
+        0x4c201000, // mov o1, v1
+        0xa8000000, // emit
+        0xad000000, // setemit 1
+        0x00021000, // add o0, c1, v0
+        0xa8000000, // emit
+        0xae800000, // setemit 2, prim
+        0x00022000, // add o0, c2, v0
+        0xa8000000, // emit
+        0xacc00000, // setemit 0, prim, inv
+        0x00023000, // add o0, c3, v0
+        0x20223080, // mul o1, c3, v1
+        0xa8000000, // emit
+        0x88000000, // end
+    };
+    std::copy(std::begin(program), std::end(program), setup->program_code.begin());
+    for (unsigned i = 0; i < 4; ++i) {
+        setup->uniforms.f[i] = MakeVec(0.5f * i, 1.0f - i, 0.25f, 2.0f);
+    }
+
+    ShaderRegs config;
+    std::memset(&config, 0, sizeof(config));
+    config.max_input_attribute_index.Assign(1);
+    config.input_attribute_to_register_map_low = 0x10;
+    config.output_mask.Assign(0x3);
+
+    const auto Render = [&](ShaderEngine& engine) {
+        EmittedVertices emitted;
+        GSUnitState unit;
+        emitted.Connect(unit);
+        unit.ConfigOutput(config);
+
+        engine.SetupBatch(*setup, 0);
+        for (unsigned i = 0; i < 4; ++i) {
+            unit.LoadInput(config, MakeVertex(i));
+            engine.Run(*setup, unit);
+        }
+        return emitted;
+    };
+
+    // Each run emits a triangle, then a second one sharing two of its vertices with the order of
+    // the vertices reversed
+    const EmittedVertices expected = Render(*MakeEngines().front());
+    REQUIRE(expected.vertices.size() == 4 * 6);
+    REQUIRE(expected.windings == std::vector<size_t>({3, 9, 15, 21}));
+    for (unsigned i = 0; i < 4; ++i) {
+        const AttributeBuffer input = MakeVertex(i);
+        const auto& c3 = setup->uniforms.f[3];
+        expected.RequireVertex(6 * i + 3, c3 + input.attr[0], c3 * input.attr[1]);
+    }
+
+    for (const auto& engine : MakeEngines()) {
+        const EmittedVertices actual = Render(*engine);
+        REQUIRE(actual.vertices.size() == expected.vertices.size());
+        REQUIRE(actual.windings == expected.windings);
+        for (size_t i = 0; i < expected.vertices.size(); ++i) {
+            actual.RequireVertex(i, expected.vertices[i].attr[0], expected.vertices[i].attr[1]);
+        }
+    }
+}
+
+/**
+ * Geometry pipeline fed with vertex shader outputs of two attributes, running a geometry shader
+ * which writes o0 and o1, and recording the vertices it emits.
+ */
+class GeometryPipelineTest {
+public:
+    GeometryPipelineTest(PipelineRegs::GSMode mode, std::initializer_list<u32> program)
+        : state(std::make_unique<State>()) {
+        state->Reset();
+
+        auto& regs = state->regs;
+        regs.pipeline.use_gs.Assign(PipelineRegs::UseGS::Yes);
+        regs.pipeline.variable_primitive.Assign(mode == PipelineRegs::GSMode::VariablePrimitive);
+        regs.pipeline.gs_unit_exclusive_configuration.Assign(1);
+        regs.pipeline.vs_outmap_total_minus_1_a.Assign(1);
+        regs.pipeline.vs_outmap_total_minus_1_b.Assign(1);
+        regs.pipeline.gs_config.mode.Assign(mode);
+        regs.gs.shader_mode.Assign(ShaderRegs::ShaderMode::GS);
+        regs.gs.input_to_uniform.Assign(mode != PipelineRegs::GSMode::Point);
+        regs.gs.input_attribute_to_register_map_low = 0x3210;
+        regs.gs.output_mask.Assign(0x3);
+
+        state->gs.swizzle_data[0] = SWIZZLE_XYZW;
+        std::copy(program.begin(), program.end(), state->gs.program_code.begin());
+
+        emitted.Connect(state->gs_unit);
+    }
+
+    void Start(ShaderEngine& engine) {
+        state->geometry_pipeline.Reconfigure();
+        state->geometry_pipeline.Setup(&engine);
+    }
+
+    std::unique_ptr<State> state;
+    EmittedVertices emitted;
+};
+
+TEST_CASE("Geometry pipeline buffers vertices into the inputs in point mode",
+          "[video_core][shader]") {
+    for (const auto& engine : MakeEngines()) {
+        GeometryPipelineTest test(PipelineRegs::GSMode::Point,
+                                  {
+                                      0xac000000, // setemit 0
+                                      0x4c000000, // mov o0, v0
+                                      0x4c201000, // mov o1, v1
+                                      0xa8000000, // emit
+                                      0xad000000, // setemit 1
+                                      0x4c002000, // mov o0, v2
+                                      0x4c203000, // mov o1, v3
+                                      0xa8000000, // emit
+                                      0xae800000, // setemit 2, prim
+                                      0x00000100, // add o0, v0, v2
+                                      0xa8000000, // emit
+                                      0x88000000, // end
+                                  });
+        // Two vertex shader outputs per run
+        test.state->regs.gs.max_input_attribute_index.Assign(3);
+        test.Start(*engine);
+
+        GeometryPipeline& pipeline = test.state->geometry_pipeline;
+        REQUIRE(pipeline.IsEnabled());
+        REQUIRE(!pipeline.NeedIndexInput());
+        for (unsigned i = 0; i < 5; ++i) {
+            pipeline.SubmitVertex(MakeVertex(i));
+            REQUIRE(test.emitted.vertices.size() == (i + 1) / 2 * 3);
+        }
+
+        for (unsigned run = 0; run < 2; ++run) {
+            const AttributeBuffer a = MakeVertex(2 * run);
+            const AttributeBuffer b = MakeVertex(2 * run + 1);
+            test.emitted.RequireVertex(3 * run, a.attr[0], a.attr[1]);
+            test.emitted.RequireVertex(3 * run + 1, b.attr[0], b.attr[1]);
+            test.emitted.RequireVertex(3 * run + 2, a.attr[0] + b.attr[0], b.attr[1]);
+        }
+        REQUIRE(test.emitted.windings.empty());
+    }
+}
+
+TEST_CASE("Geometry pipeline buffers vertices into the uniforms in fixed primitive mode",
+          "[video_core][shader]") {
+    for (const auto& engine : MakeEngines()) {
+        GeometryPipelineTest test(PipelineRegs::GSMode::FixedPrimitive,
+                                  {
+                                      0xac000000, // setemit 0
+                                      0x4c024000, // mov o0, c4
+                                      0x4c225000, // mov o1, c5
+                                      0xa8000000, // emit
+                                      0xad000000, // setemit 1
+                                      0x4c026000, // mov o0, c6
+                                      0x4c227000, // mov o1, c7
+                                      0xa8000000, // emit
+                                      0xae800000, // setemit 2, prim
+                                      0x4c028000, // mov o0, c8
+                                      0x4c229000, // mov o1, c9
+                                      0xa8000000, // emit
+                                      0x88000000, // end
+                                  });
+        // Three vertices of two attributes each, from c4 on
+        auto& gs_config = test.state->regs.pipeline.gs_config;
+        gs_config.fixed_vertex_num_minus_1.Assign(2);
+        gs_config.stride_minus_1.Assign(1);
+        gs_config.start_index.Assign(4);
+        test.Start(*engine);
+
+        GeometryPipeline& pipeline = test.state->geometry_pipeline;
+        REQUIRE(!pipeline.NeedIndexInput());
+        for (unsigned i = 0; i < 8; ++i) {
+            pipeline.SubmitVertex(MakeVertex(i));
+            REQUIRE(test.emitted.vertices.size() == (i + 1) / 3 * 3);
+        }
+
+        for (unsigned i = 0; i < 6; ++i) {
+            const AttributeBuffer vertex = MakeVertex(i);
+            test.emitted.RequireVertex(i, vertex.attr[0], vertex.attr[1]);
+        }
+    }
+}
+
+TEST_CASE("Geometry pipeline buffers vertices into the uniforms in variable primitive mode",
+          "[video_core][shader]") {
+    for (const auto& engine : MakeEngines()) {
+        GeometryPipelineTest test(PipelineRegs::GSMode::VariablePrimitive,
+                                  {
+                                      0xac000000, // setemit 0
+                                      0x4c021000, // mov o0, c1
+                                      0x4c222000, // mov o1, c2
+                                      0xa8000000, // emit
+                                      0xad000000, // setemit 1
+                                      0x4c023000, // mov o0, c3
+                                      0x4c220000, // mov o1, c0
+                                      0xa8000000, // emit
+                                      0xae800000, // setemit 2, prim
+                                      0x4c024000, // mov o0, c4
+                                      0xa8000000, // emit
+                                      0x88000000, // end
+                                  });
+        // Only the first vertex of each primitive passes all of its attributes
+        test.state->regs.pipeline.variable_primitive_vertex_num = 1;
+        test.Start(*engine);
+
+        GeometryPipeline& pipeline = test.state->geometry_pipeline;
+        for (unsigned primitive = 0; primitive < 2; ++primitive) {
+            // The vertex count of each primitive comes first, from the index buffer
+            REQUIRE(pipeline.NeedIndexInput());
+            pipeline.SubmitIndex(3);
+            for (unsigned i = 0; i < 3; ++i) {
+                REQUIRE(!pipeline.NeedIndexInput());
+                REQUIRE(test.emitted.vertices.size() == primitive * 3);
+                pipeline.SubmitVertex(MakeVertex(3 * primitive + i));
+            }
+            REQUIRE(test.emitted.vertices.size() == (primitive + 1) * 3);
+        }
+        REQUIRE(pipeline.NeedIndexInput());
+
+        const Math::Vec4<float24> count = MakeVec(3.0f, 3.0f, 3.0f, 3.0f);
+        for (unsigned primitive = 0; primitive < 2; ++primitive) {
+            const AttributeBuffer a = MakeVertex(3 * primitive);
+            const AttributeBuffer b = MakeVertex(3 * primitive + 1);
+            const AttributeBuffer c = MakeVertex(3 * primitive + 2);
+            test.emitted.RequireVertex(3 * primitive, a.attr[0], a.attr[1]);
+            test.emitted.RequireVertex(3 * primitive + 1, b.attr[0], count);
+            test.emitted.RequireVertex(3 * primitive + 2, c.attr[0], count);
+        }
+    }
+}
+
+TEST_CASE("Geometry pipeline sets b15 after the first run of a batch", "[video_core][shader]") {
+    const std::initializer_list<u32> program = {
+        0x9fc00801, // ifu b15, 2, 1
+        0x4c221000, // mov o1, c1
+        0x4c220000, // mov o1, c0 (else)
+        0xac000000, // setemit 0
+        0x4c000000, // mov o0, v0
+        0xa8000000, // emit
+        0xad000000, // setemit 1
+        0xa8000000, // emit
+        0xae800000, // setemit 2, prim
+        0xa8000000, // emit
+        0x88000000, // end
+    };
+    const Math::Vec4<float24> first = MakeVec(1.0f, 2.0f, 3.0f, 4.0f);
+    const Math::Vec4<float24> next = MakeVec(-1.0f, -2.0f, -3.0f, -4.0f);
+
+    // The engines specializing on the bool uniforms must take the change of b15 into account
+    const bool specialization = Settings::values.use_shader_jit_specialization;
+    std::vector<EmittedVertices> results;
+    for (bool specialize : {false, true}) {
+        Settings::values.use_shader_jit_specialization = specialize;
+        for (const auto& engine : MakeEngines()) {
+            GeometryPipelineTest test(PipelineRegs::GSMode::Point, program);
+            test.state->regs.gs.max_input_attribute_index.Assign(1);
+            test.state->gs.uniforms.f[0] = first;
+            test.state->gs.uniforms.f[1] = next;
+            test.state->gs.uniforms.b[15] = false;
+            test.Start(*engine);
+
+            for (unsigned i = 0; i < 3; ++i) {
+                test.state->geometry_pipeline.SubmitVertex(MakeVertex(i));
+            }
+            results.push_back(test.emitted);
+        }
+    }
+    Settings::values.use_shader_jit_specialization = specialization;
+
+    for (const EmittedVertices& emitted : results) {
+        REQUIRE(emitted.vertices.size() == 9);
+        for (unsigned i = 0; i < 9; ++i) {
+            emitted.RequireVertex(i, MakeVertex(i / 3).attr[0], i < 3 ? first : next);
+        }
+    }
+}
+
+} // namespace Shader
+} // namespace Pica
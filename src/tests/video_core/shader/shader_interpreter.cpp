@@ -0,0 +1,146 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "video_core/pica_types.h"
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_interpreter.h"
+#ifdef ARCHITECTURE_x86_64
+#include "video_core/shader/shader_jit_x64.h"
+#endif // ARCHITECTURE_x86_64
+
+namespace Pica {
+namespace Shader {
+
+// Operand descriptors with identity swizzles, writing all components or only one of them
+static constexpr u32 IDENTITY_SWIZZLE = (0x1B << 5) | (0x1B << 14) | (0x1B << 23);
+static constexpr u32 SWIZZLE_XYZW = 0xF | IDENTITY_SWIZZLE;
+static constexpr u32 SWIZZLE_X = 0x8 | IDENTITY_SWIZZLE;
+static constexpr u32 SWIZZLE_Y = 0x4 | IDENTITY_SWIZZLE;
+static constexpr u32 SWIZZLE_Z = 0x2 | IDENTITY_SWIZZLE;
+static constexpr u32 SWIZZLE_W = 0x1 | IDENTITY_SWIZZLE;
+
+/**
+ * Sets up a program transforming v0 by the matrix in c0-c3 to o0, and writing
+ * (c8 + v1 * c10 + v1 * c11 + v1 * c12) * v2 to o1, the sum being computed in a loop over aL.
+ */
+static std::unique_ptr<ShaderSetup> MakeTestShader() {
+    auto setup = std::make_unique<ShaderSetup>();
+    std::memset(setup.get(), 0, sizeof(ShaderSetup));
+
+    setup->swizzle_data[0] = SWIZZLE_XYZW;
+    setup->swizzle_data[1] = SWIZZLE_X;
+    setup->swizzle_data[2] = SWIZZLE_Y;
+    setup->swizzle_data[3] = SWIZZLE_Z;
+    setup->swizzle_data[4] = SWIZZLE_W;
+
+    const u32 program[] = {
+        0x08020001, // dp4 o0.x, c0, v0
+        0x08021002, // dp4 o0.y, c1, v0
+        0x08022003, // dp4 o0.z, c2, v0
+        0x08023004, // dp4 o0.w, c3, v0
+        0x4e028000, // mov r0, c8
+        0xa4001800, // loop i0, until 6
+        0xf0c2aa00, // mad r0, v1, c10[aL], r0
+        0x20210100, // mul o1, r0, v2
+        0x88000000, // end
+    };
+    std::copy(std::begin(program), std::end(program), setup->program_code.begin());
+
+    for (unsigned i = 0; i < 16; ++i) {
+        for (unsigned j = 0; j < 4; ++j) {
+            setup->uniforms.f[i][j] = float24::FromFloat32(0.25f * i - 0.125f * j + 1.0f);
+        }
+    }
+    // Three iterations, aL going from 0 to 2
+    setup->uniforms.i[0] = Math::Vec4<u8>(2, 0, 1, 0);
+
+    return setup;
+}
+
+static void SetInputs(UnitState& state, unsigned vertex) {
+    std::memset(&state, 0, sizeof(UnitState));
+    for (unsigned i = 0; i < 3; ++i) {
+        for (unsigned j = 0; j < 4; ++j) {
+            state.registers.input[i][j] = float24::FromFloat32(0.5f * vertex + 0.75f * i - j);
+        }
+    }
+}
+
+TEST_CASE("InterpreterEngine pre-decoded programs match the reference", "[video_core][shader]") {
+    auto setup = MakeTestShader();
+    InterpreterEngine reference(false);
+    InterpreterEngine decoded(true);
+
+    for (unsigned vertex = 0; vertex < 16; ++vertex) {
+        UnitState expected, actual;
+        SetInputs(expected, vertex);
+        SetInputs(actual, vertex);
+
+        reference.SetupBatch(*setup, 0);
+        reference.Run(*setup, expected);
+        decoded.SetupBatch(*setup, 0);
+        decoded.Run(*setup, actual);
+
+        REQUIRE(std::memcmp(&expected.registers, &actual.registers, sizeof(expected.registers)) ==
+                0);
+        REQUIRE(expected.address_registers[2] == actual.address_registers[2]);
+    }
+
+    SECTION("programs are decoded again when they change") {
+        setup->program_code[7] = 0x20210180; // mul o1, r0, v3
+        UnitState expected, actual;
+        SetInputs(expected, 0);
+        SetInputs(actual, 0);
+
+        reference.SetupBatch(*setup, 0);
+        reference.Run(*setup, expected);
+        decoded.SetupBatch(*setup, 0);
+        decoded.Run(*setup, actual);
+
+        REQUIRE(std::memcmp(&expected.registers, &actual.registers, sizeof(expected.registers)) ==
+                0);
+    }
+}
+
+static double BenchmarkEngine(ShaderEngine& engine, ShaderSetup& setup) {
+    constexpr unsigned NUM_VERTICES = 200000;
+
+    UnitState state;
+    SetInputs(state, 0);
+
+    const auto start = std::chrono::steady_clock::now();
+    engine.SetupBatch(setup, 0);
+    for (unsigned vertex = 0; vertex < NUM_VERTICES; ++vertex) {
+        state.registers.input[0].x = float24::FromFloat32(static_cast<float>(vertex));
+        engine.Run(setup, state);
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / NUM_VERTICES;
+}
+
+TEST_CASE("Shader engines benchmark", "[.][benchmark][video_core][shader]") {
+    auto setup = MakeTestShader();
+
+    InterpreterEngine reference(false);
+    std::printf("interpreter, decoding every instruction: %.1f ns/vertex\n",
+                BenchmarkEngine(reference, *setup));
+
+    InterpreterEngine decoded(true);
+    std::printf("interpreter, pre-decoded: %.1f ns/vertex\n", BenchmarkEngine(decoded, *setup));
+
+#ifdef ARCHITECTURE_x86_64
+    JitX64Engine jit;
+    std::printf("x64 JIT: %.1f ns/vertex\n", BenchmarkEngine(jit, *setup));
+#endif // ARCHITECTURE_x86_64
+}
+
+} // namespace Shader
+} // namespace Pica
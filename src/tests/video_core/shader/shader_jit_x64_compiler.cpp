@@ -0,0 +1,197 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "core/settings.h"
+#include "video_core/pica_types.h"
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_interpreter.h"
+#include "video_core/shader/shader_jit_x64.h"
+
+namespace Pica {
+namespace Shader {
+
+// Operand descriptors with identity swizzles, writing all components or only one of them
+static constexpr u32 IDENTITY_SWIZZLE = (0x1B << 5) | (0x1B << 14) | (0x1B << 23);
+static constexpr u32 SWIZZLE_XYZW = 0xF | IDENTITY_SWIZZLE;
+static constexpr u32 SWIZZLE_X = 0x8 | IDENTITY_SWIZZLE;
+static constexpr u32 SWIZZLE_Y = 0x4 | IDENTITY_SWIZZLE;
+
+static std::unique_ptr<ShaderSetup> MakeShader(std::initializer_list<u32> program,
+                                               u16 output_mask) {
+    auto setup = std::make_unique<ShaderSetup>();
+    std::memset(setup.get(), 0, sizeof(ShaderSetup));
+    setup->output_mask = output_mask;
+    setup->swizzle_data[0] = SWIZZLE_XYZW;
+    setup->swizzle_data[1] = SWIZZLE_X;
+    setup->swizzle_data[2] = SWIZZLE_Y;
+    std::copy(program.begin(), program.end(), setup->program_code.begin());
+
+    // c0 holds the thresholds the inputs are compared against
+    setup->uniforms.f[0] = Math::MakeVec(float24::FromFloat32(0.75f), float24::FromFloat32(1.0f),
+                                         float24::Zero(), float24::Zero());
+    for (unsigned i = 1; i < 8; ++i) {
+        for (unsigned j = 0; j < 4; ++j) {
+            setup->uniforms.f[i][j] = float24::FromFloat32(0.5f * i - 0.25f * j + 0.25f);
+        }
+    }
+    // Three iterations
+    setup->uniforms.i[0] = Math::Vec4<u8>(2, 0, 1, 0);
+
+    return setup;
+}
+
+/// Sets the inputs of a vertex, leaving the other registers as the previous run left them
+static void SetInputs(UnitState& state, unsigned vertex) {
+    state.registers.input[0] =
+        Math::MakeVec(float24::FromFloat32(0.25f * (vertex % 7)),
+                      float24::FromFloat32(0.5f * (vertex % 5)),
+                      float24::FromFloat32(0.25f * vertex), float24::FromFloat32(1.0f));
+    state.registers.input[1] =
+        Math::MakeVec(float24::FromFloat32(1.5f - 0.125f * vertex), float24::FromFloat32(0.5f),
+                      float24::FromFloat32(-2.0f), float24::FromFloat32(0.125f * vertex));
+}
+
+/**
+ * Runs a sequence of vertices through both engines, each one keeping its unit state from one
+ * vertex to the next, and compares the outputs read once the program ends.
+ */
+static void CompareRuns(ShaderSetup& setup, ShaderEngine& reference, ShaderEngine& jit) {
+    UnitState expected, actual;
+    std::memset(&expected, 0, sizeof(UnitState));
+    std::memset(&actual, 0, sizeof(UnitState));
+
+    reference.SetupBatch(setup, 0);
+    jit.SetupBatch(setup, 0);
+    for (unsigned vertex = 0; vertex < 16; ++vertex) {
+        SetInputs(expected, vertex);
+        SetInputs(actual, vertex);
+        reference.Run(setup, expected);
+        jit.Run(setup, actual);
+
+        for (unsigned reg = 0; reg < 16; ++reg) {
+            if (!(setup.output_mask & (1 << reg)))
+                continue;
+            for (unsigned comp = 0; comp < 4; ++comp) {
+                CAPTURE(vertex);
+                CAPTURE(reg);
+                CAPTURE(comp);
+                REQUIRE(actual.registers.output[reg][comp].ToFloat32() ==
+                        expected.registers.output[reg][comp].ToFloat32());
+            }
+        }
+    }
+}
+
+/// Restores the specialization setting at the end of a test, whether it passes or not
+class SpecializationSetting {
+public:
+    SpecializationSetting() : saved(Settings::values.use_shader_jit_specialization) {}
+    ~SpecializationSetting() {
+        Settings::values.use_shader_jit_specialization = saved;
+    }
+
+private:
+    bool saved;
+};
+
+TEST_CASE("JIT keeps temporaries read by the next run", "[video_core][shader]") {
+    auto setup = MakeShader(
+        {
+            0x00012000, // add o0, r2, v0
+            0x4e800000, // mov r4, v0
+            0x4e400000, // mov r2, v0
+            0x4e412000, // mov r2, r2
+            0x4e801000, // mov r4, v1
+            0x00213a00, // add o1, r3, r4
+            0x4e601001, // mov r3.x, v1
+            0x4e600002, // mov r3.y, v0
+            0x88000000, // end
+        },
+        0x3);
+
+    InterpreterEngine interpreter;
+    JitX64Engine jit;
+    CompareRuns(*setup, interpreter, jit);
+}
+
+TEST_CASE("JIT skips only the outputs excluded by the output mask", "[video_core][shader]") {
+    auto setup = MakeShader(
+        {
+            0x22021000, // mul r0, c1, v0
+            0x00210080, // add o1, r0, v1
+            0x4e201000, // mov r1, v1
+            0x20022880, // mul o0, c2, r1
+            0x00423000, // add o2, c3, v0
+            0x4c611000, // mov o3, r1
+            0x88000000, // end
+        },
+        0xF);
+
+    InterpreterEngine interpreter;
+    JitX64Engine jit;
+    for (u16 output_mask : {0xF, 0x5, 0xA, 0x1}) {
+        CAPTURE(output_mask);
+        setup->output_mask = output_mask;
+        CompareRuns(*setup, interpreter, jit);
+    }
+}
+
+TEST_CASE("JIT keeps registers live across CALL, IF and LOOP returns", "[video_core][shader]") {
+    auto setup = MakeShader(
+        {
+            0xbc620000, // cmp c0, v0, gt, le
+            0x4e224000, // mov r1, c4
+            0xa4001400, // loop i0, until 5
+            0x02211800, // add r1, r1, r0
+            0x95c03c02, // callc cc.y, 15, 2
+            0x22025080, // mul r0, c5, v1
+            0x4c011000, // mov o0, r1
+            0xa2802401, // ifc cc.x, 9, 1
+            0x4c212000, // mov o1, r2
+            0x00226900, // add o1, c6, r2 (else)
+            0x9c003001, // ifu b0, 12, 1
+            0x4c410000, // mov o2, r0
+            0x00422980, // add o2, c2, r3 (else)
+            0x98404401, // callu b1, 17, 1
+            0x88000000, // end
+            0x22427880, // mul r2, c7, r1 (subroutine)
+            0x02412000, // add r2, r2, v0
+            0x02613080, // add r3, r3, v1 (subroutine)
+        },
+        0x7);
+
+    SpecializationSetting saved_setting;
+    for (bool specialize : {false, true}) {
+        CAPTURE(specialize);
+        Settings::values.use_shader_jit_specialization = specialize;
+
+        // The same engines are reused as the uniforms change, the specialized shaders being
+        // compiled again for each of their values
+        InterpreterEngine interpreter;
+        JitX64Engine jit;
+        for (u16 output_mask : {0x7, 0x3}) {
+            for (unsigned iterations : {2, 0}) {
+                for (unsigned bools = 0; bools < 4; ++bools) {
+                    CAPTURE(output_mask);
+                    CAPTURE(iterations);
+                    CAPTURE(bools);
+                    setup->output_mask = output_mask;
+                    setup->uniforms.i[0].x = static_cast<u8>(iterations);
+                    setup->uniforms.b[0] = (bools & 1) != 0;
+                    setup->uniforms.b[1] = (bools & 2) != 0;
+                    CompareRuns(*setup, interpreter, jit);
+                }
+            }
+        }
+    }
+}
+
+} // namespace Shader
+} // namespace Pica
@@ -0,0 +1,231 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "video_core/pica_types.h"
+#include "video_core/regs_shader.h"
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_interpreter.h"
+#include "video_core/shader/shader_jit_x64.h"
+#include "video_core/shader/shader_jit_x64_soa_compiler.h"
+
+namespace Pica {
+namespace Shader {
+
+static constexpr u32 SWIZZLE_XYZW = 0xF | (0x1B << 5) | (0x1B << 14) | (0x1B << 23);
+
+/// Sets up a program reading v0 and v1 and writing o0 and o1, with the uniforms used by the tests
+static std::unique_ptr<ShaderSetup> MakeShader(std::initializer_list<u32> program) {
+    auto setup = std::make_unique<ShaderSetup>();
+    std::memset(setup.get(), 0, sizeof(ShaderSetup));
+    setup->output_mask = 0x3;
+    setup->swizzle_data[0] = SWIZZLE_XYZW;
+    std::copy(program.begin(), program.end(), setup->program_code.begin());
+
+    // c0 holds the thresholds the inputs are compared against
+    setup->uniforms.f[0] = Math::MakeVec(float24::FromFloat32(0.75f), float24::FromFloat32(1.0f),
+                                         float24::Zero(), float24::Zero());
+    for (unsigned i = 1; i < 8; ++i) {
+        for (unsigned j = 0; j < 4; ++j) {
+            setup->uniforms.f[i][j] = float24::FromFloat32(0.5f * i - 0.25f * j + 0.25f);
+        }
+    }
+    // Three iterations
+    setup->uniforms.i[0] = Math::Vec4<u8>(2, 0, 1, 0);
+
+    return setup;
+}
+
+static ShaderRegs MakeConfig() {
+    ShaderRegs config;
+    std::memset(&config, 0, sizeof(config));
+    config.max_input_attribute_index.Assign(1);
+    config.input_attribute_to_register_map_low = 0x10;
+    config.output_mask.Assign(0x3);
+    return config;
+}
+
+/// Vertices whose v0.x and v0.y fall on either side of the thresholds in c0 as given
+static std::vector<AttributeBuffer> MakeInputs(const std::vector<float>& x,
+                                               const std::vector<float>& y) {
+    std::vector<AttributeBuffer> inputs(x.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        std::memset(&inputs[i], 0, sizeof(AttributeBuffer));
+        inputs[i].attr[0] =
+            Math::MakeVec(float24::FromFloat32(x[i]), float24::FromFloat32(y[i]),
+                          float24::FromFloat32(0.25f * i), float24::FromFloat32(1.0f));
+        inputs[i].attr[1] = Math::MakeVec(float24::FromFloat32(1.5f - 0.125f * i),
+                                          float24::FromFloat32(0.5f), float24::FromFloat32(-2.0f),
+                                          float24::FromFloat32(0.125f * i));
+    }
+    return inputs;
+}
+
+/// Runs the vertices in batches of varying sizes, leaving lanes of the last group of most of them
+/// unused
+static std::vector<AttributeBuffer> RunBatches(ShaderEngine& engine, ShaderSetup& setup,
+                                               const ShaderRegs& config,
+                                               const std::vector<AttributeBuffer>& inputs) {
+    static const unsigned batch_sizes[] = {8, 3, 5, 1, 7, 4, 6, 2};
+
+    std::vector<AttributeBuffer> outputs(inputs.size());
+    std::memset(outputs.data(), 0, outputs.size() * sizeof(AttributeBuffer));
+    UnitState state;
+    engine.SetupBatch(setup, 0);
+    for (unsigned first = 0, batch = 0; first < inputs.size(); ++batch) {
+        const unsigned count = std::min<unsigned>(batch_sizes[batch % 8],
+                                                  static_cast<unsigned>(inputs.size()) - first);
+        engine.RunBatch(setup, state, config, &inputs[first], &outputs[first], count);
+        first += count;
+    }
+    return outputs;
+}
+
+static void CheckOutputs(const std::vector<AttributeBuffer>& expected,
+                         const std::vector<AttributeBuffer>& actual) {
+    REQUIRE(expected.size() == actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        for (unsigned attr = 0; attr < 2; ++attr) {
+            for (unsigned comp = 0; comp < 4; ++comp) {
+                CAPTURE(i);
+                CAPTURE(attr);
+                CAPTURE(comp);
+                REQUIRE(actual[i].attr[attr][comp].ToFloat32() ==
+                        expected[i].attr[attr][comp].ToFloat32());
+            }
+        }
+    }
+}
+
+/// Lane counts the host supports, the SoA JIT isn't tested at all without SSE4.1
+static std::vector<unsigned> SupportedLaneCounts() {
+    if (!JitSoaShader::IsSupported())
+        return {};
+    if (JitSoaShader::GetMaxLaneCount() < 8)
+        return {4};
+    return {4, 8};
+}
+
+// The threshold comparisons of the inputs below come out as follows:
+// - vertices 0-7: x below, y below
+// - vertices 8-15: x above, y above
+// - vertices 16-31: mixed within any group of 4 or 8
+static const std::vector<float> input_x = {
+    0.0f, 0.5f, 0.25f, 0.0f, 0.5f, 0.5f, 0.0f, 0.25f,
+    1.0f, 2.0f, 1.5f, 1.0f, 1.25f, 0.75f, 1.0f, 3.0f,
+    0.0f, 1.0f, 1.0f, 0.5f, 2.0f, 0.0f, 0.25f, 1.5f,
+    1.0f, 0.0f, 0.5f, 1.0f, 0.0f, 2.0f, 1.0f, 0.5f,
+};
+static const std::vector<float> input_y = {
+    0.0f, 0.5f, 0.75f, 0.25f, 0.5f, 0.0f, 0.5f, 0.25f,
+    1.0f, 1.5f, 2.0f, 1.0f, 3.0f, 1.25f, 1.0f, 1.5f,
+    1.0f, 1.0f, 0.0f, 0.5f, 0.5f, 2.0f, 1.5f, 0.0f,
+    0.0f, 1.0f, 1.0f, 0.5f, 0.5f, 0.0f, 2.0f, 1.5f,
+};
+
+TEST_CASE("SoA JIT batches with divergent IFC, CALLC and LOOP match the interpreter",
+          "[video_core][shader]") {
+    auto setup = MakeShader({
+        0xbc620000, // cmp c0, v0, gt, le
+        0xa2801002, // ifc cc.x, 4, 2
+        0x22021000, // mul r0, c1, v0
+        0x00222800, // add o1, c2, r0
+        0x02023000, // add r0, c3, v0 (else)
+        0x20221800, // mul o1, c1, r0
+        0x4e224000, // mov r1, c4
+        0xa4002400, // loop i0, until 9
+        0x02211080, // add r1, r1, v1
+        0x95c03404, // callc cc.y, 13, 4
+        0x4c011000, // mov o0, r1
+        0x88000000, // end
+        0x84000000, // nop
+        0x22225880, // mul r1, c5, r1 (subroutine)
+        0xa3404001, // ifc cc.x && cc.y, 16, 1
+        0x02226880, // add r1, c6, r1
+        0x02227880, // add r1, c7, r1 (else)
+    });
+    const ShaderRegs config = MakeConfig();
+    const auto inputs = MakeInputs(input_x, input_y);
+
+    InterpreterEngine interpreter;
+    const auto expected = RunBatches(interpreter, *setup, config, inputs);
+
+    for (unsigned lanes : SupportedLaneCounts()) {
+        CAPTURE(lanes);
+        JitX64Engine jit(lanes);
+        const auto actual = RunBatches(jit, *setup, config, inputs);
+
+        const auto* soa_shader =
+            static_cast<const JitSoaShader*>(setup->engine_data.cached_soa_shader);
+        REQUIRE(soa_shader != nullptr);
+        REQUIRE(soa_shader->GetLaneCount() == lanes);
+        REQUIRE(soa_shader->IsEfficient());
+        CheckOutputs(expected, actual);
+    }
+}
+
+TEST_CASE("SoA JIT batches fall back to the per-vertex JIT on divergent JMPC and END",
+          "[video_core][shader]") {
+    // Vertices with x below the threshold jump over the first END
+    auto jmpc_setup = MakeShader({
+        0xbc820000, // cmp c0, v0, gt, gt
+        0x4c000000, // mov o0, v0
+        0xb2801400, // jmpc cc.x, 5
+        0x20221000, // mul o1, c1, v0
+        0x88000000, // end
+        0x00222000, // add o1, c2, v0
+        0x88000000, // end
+    });
+
+    // Vertices with x below the threshold end within the conditional block
+    auto end_setup = MakeShader({
+        0xbc820000, // cmp c0, v0, gt, gt
+        0x4c000000, // mov o0, v0
+        0x4e221000, // mov o1, c1
+        0xa2801400, // ifc cc.x, 5, 0
+        0x88000000, // end
+        0x00222000, // add o1, c2, v0
+        0x88000000, // end
+    });
+
+    const ShaderRegs config = MakeConfig();
+    const auto inputs = MakeInputs(input_x, input_y);
+    const std::vector<AttributeBuffer> divergent_inputs(inputs.begin() + 16, inputs.end());
+
+    for (ShaderSetup* setup : {jmpc_setup.get(), end_setup.get()}) {
+        InterpreterEngine interpreter;
+        const auto expected = RunBatches(interpreter, *setup, config, inputs);
+        const auto expected_divergent = RunBatches(interpreter, *setup, config, divergent_inputs);
+
+        for (unsigned lanes : SupportedLaneCounts()) {
+            CAPTURE(lanes);
+            JitX64Engine jit(lanes);
+
+            // Groups where all vertices take the same path run in the SoA shader, the others are
+            // run again one vertex at a time
+            CheckOutputs(expected, RunBatches(jit, *setup, config, inputs));
+
+            const auto* soa_shader =
+                static_cast<const JitSoaShader*>(setup->engine_data.cached_soa_shader);
+            REQUIRE(soa_shader != nullptr);
+
+            // The SoA shader stops being used once most of its runs fail, the results staying the
+            // same
+            for (unsigned i = 0; i < 64 && soa_shader->IsEfficient(); ++i) {
+                CheckOutputs(expected_divergent, RunBatches(jit, *setup, config, divergent_inputs));
+            }
+            REQUIRE(!soa_shader->IsEfficient());
+            CheckOutputs(expected, RunBatches(jit, *setup, config, inputs));
+        }
+    }
+}
+
+} // namespace Shader
+} // namespace Pica
@@ -0,0 +1,296 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "common/vector_math.h"
+#include "video_core/pica_state.h"
+#include "video_core/pica_types.h"
+#include "video_core/regs_rasterizer.h"
+#include "video_core/shader/shader.h"
+#include "video_core/swrasterizer/clipper.h"
+#include "video_core/swrasterizer/rasterizer.h"
+
+namespace Pica {
+namespace Clipper {
+
+using Rasterizer::Vertex;
+
+// Distance in pixels from the edges of the triangles within which the coverage of a sample may
+// differ between both paths, and the tolerance of the values interpolated at the samples
+constexpr float EDGE_MARGIN = 0.25f;
+constexpr float VALUE_TOLERANCE = 0.01f;
+
+/// Encodes a float24 register value, for a number float24 represents exactly
+static u32 Float24Raw(float value) {
+    u32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const u32 sign = bits >> 31;
+    const u32 exponent = ((bits >> 23) & 0xFF) - 127 + 63;
+    const u32 mantissa = (bits >> 7) & 0xFFFF;
+    return (sign << 23) | (exponent << 16) | mantissa;
+}
+
+/// Sets the viewport the clipper reads, restoring the previous one at the end of the test
+class ViewportSetting {
+public:
+    ViewportSetting(int x, int y, int width, int height) {
+        auto& regs = g_state.regs.rasterizer;
+        saved_x = regs.viewport_corner.x;
+        saved_y = regs.viewport_corner.y;
+        saved_size_x = regs.viewport_size_x;
+        saved_size_y = regs.viewport_size_y;
+        regs.viewport_corner.x.Assign(x);
+        regs.viewport_corner.y.Assign(y);
+        regs.viewport_size_x.Assign(Float24Raw(width / 2.f));
+        regs.viewport_size_y.Assign(Float24Raw(height / 2.f));
+        REQUIRE(float24::FromRaw(regs.viewport_size_x).ToFloat32() == width / 2.f);
+        REQUIRE(float24::FromRaw(regs.viewport_size_y).ToFloat32() == height / 2.f);
+    }
+    ~ViewportSetting() {
+        auto& regs = g_state.regs.rasterizer;
+        regs.viewport_corner.x.Assign(saved_x);
+        regs.viewport_corner.y.Assign(saved_y);
+        regs.viewport_size_x.Assign(saved_size_x);
+        regs.viewport_size_y.Assign(saved_size_y);
+    }
+
+private:
+    int saved_x, saved_y;
+    u32 saved_size_x, saved_size_y;
+};
+
+static OutputVertex MakeVertex(float x, float y, float z, float w, float red) {
+    OutputVertex vtx;
+    std::memset(&vtx, 0, sizeof(vtx));
+    vtx.pos = Math::MakeVec(float24::FromFloat32(x), float24::FromFloat32(y),
+                            float24::FromFloat32(z), float24::FromFloat32(w));
+    // The red component is scaled by 1/w along with the other attributes
+    vtx.color.r() = float24::FromFloat32(red);
+    return vtx;
+}
+
+/// Vertices of the triangles the clipper emits, three by three
+static std::vector<Vertex> Clip(const OutputVertex (&triangle)[3], bool use_guard_band) {
+    std::vector<Vertex> vertices;
+    ClipTriangle(triangle[0], triangle[1], triangle[2], use_guard_band,
+                 [&](const Vertex& v0, const Vertex& v1, const Vertex& v2) {
+                     vertices.push_back(v0);
+                     vertices.push_back(v1);
+                     vertices.push_back(v2);
+                 });
+    return vertices;
+}
+
+/// Depth and perspective-corrected red component interpolated at a screen position
+struct Sample {
+    bool covered;
+    float depth;
+    float red;
+};
+
+/**
+ * Finds a triangle containing the point, counting those whose edges are at most `margin` pixels
+ * away from it, or excluding those at less than `-margin` pixels for a negative margin.
+ */
+static Sample SampleTriangles(const std::vector<Vertex>& vertices, float x, float y,
+                              float margin) {
+    for (size_t i = 0; i < vertices.size(); i += 3) {
+        float sx[3], sy[3];
+        for (int j = 0; j < 3; ++j) {
+            sx[j] = vertices[i + j].screenpos.x.ToFloat32();
+            sy[j] = vertices[i + j].screenpos.y.ToFloat32();
+        }
+        const float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+        if (std::fabs(area) < 1e-3f)
+            continue;
+
+        float lambda[3];
+        bool inside = true;
+        for (int j = 0; j < 3; ++j) {
+            const int a = (j + 1) % 3, b = (j + 2) % 3;
+            const float edge = (sx[b] - sx[a]) * (y - sy[a]) - (sy[b] - sy[a]) * (x - sx[a]);
+            const float length = std::hypot(sx[b] - sx[a], sy[b] - sy[a]);
+            lambda[j] = edge / area;
+            inside &= (area > 0.f ? edge : -edge) >= -margin * length;
+        }
+        if (!inside)
+            continue;
+
+        float depth = 0.f, inv_w = 0.f, red = 0.f;
+        for (int j = 0; j < 3; ++j) {
+            depth += lambda[j] * vertices[i + j].screenpos.z.ToFloat32();
+            inv_w += lambda[j] * vertices[i + j].pos.w.ToFloat32();
+            red += lambda[j] * vertices[i + j].color.r().ToFloat32();
+        }
+        return {true, depth, red / inv_w};
+    }
+    return {false, 0.f, 0.f};
+}
+
+/// Checks that both sets of triangles cover the same samples of the viewport with the same values
+static void CompareCoverage(const std::vector<Vertex>& expected,
+                            const std::vector<Vertex>& actual, int viewport_x, int viewport_y,
+                            int width, int height) {
+    for (int y = viewport_y; y < viewport_y + height; y += 2) {
+        for (int x = viewport_x; x < viewport_x + width; x += 2) {
+            const float sample_x = x + 0.5f;
+            const float sample_y = y + 0.5f;
+            for (const auto* first : {&expected, &actual}) {
+                const auto* second = first == &expected ? &actual : &expected;
+                const Sample inner = SampleTriangles(*first, sample_x, sample_y, -EDGE_MARGIN);
+                if (!inner.covered)
+                    continue;
+
+                CAPTURE(sample_x);
+                CAPTURE(sample_y);
+                const Sample outer = SampleTriangles(*second, sample_x, sample_y, EDGE_MARGIN);
+                REQUIRE(outer.covered);
+                REQUIRE(std::fabs(outer.depth - inner.depth) < VALUE_TOLERANCE);
+                REQUIRE(std::fabs(outer.red - inner.red) < VALUE_TOLERANCE);
+            }
+        }
+    }
+}
+
+/// Checks that the vertices lie in front of the camera, within the depth range and the given area
+static void CheckVertices(const std::vector<Vertex>& vertices, float min_x, float min_y,
+                          float max_x, float max_y) {
+    for (const auto& vertex : vertices) {
+        const float x = vertex.screenpos.x.ToFloat32();
+        const float y = vertex.screenpos.y.ToFloat32();
+        const float z = vertex.screenpos.z.ToFloat32();
+        CAPTURE(x);
+        CAPTURE(y);
+        CAPTURE(z);
+        REQUIRE(vertex.pos.w.ToFloat32() > 0.f);
+        REQUIRE(std::isfinite(vertex.pos.w.ToFloat32()));
+        REQUIRE(x >= min_x - EDGE_MARGIN);
+        REQUIRE(x <= max_x + EDGE_MARGIN);
+        REQUIRE(y >= min_y - EDGE_MARGIN);
+        REQUIRE(y <= max_y + EDGE_MARGIN);
+        REQUIRE(z >= -1.f - VALUE_TOLERANCE);
+        REQUIRE(z <= VALUE_TOLERANCE);
+    }
+}
+
+static void CompareClipping(const OutputVertex (&triangle)[3], int viewport_x, int viewport_y,
+                            int width, int height) {
+    const std::vector<Vertex> clipped = Clip(triangle, false);
+    const std::vector<Vertex> guard_band = Clip(triangle, true);
+
+    CheckVertices(clipped, static_cast<float>(viewport_x), static_cast<float>(viewport_y),
+                  static_cast<float>(viewport_x + width), static_cast<float>(viewport_y + height));
+    CheckVertices(guard_band, Rasterizer::GUARD_BAND_MIN, Rasterizer::GUARD_BAND_MIN,
+                  Rasterizer::GUARD_BAND_MAX, Rasterizer::GUARD_BAND_MAX);
+    CompareCoverage(clipped, guard_band, viewport_x, viewport_y, width, height);
+}
+
+TEST_CASE("Guard band clipping covers the viewport like full clipping", "[video_core][clipper]") {
+    struct Viewport {
+        int x, y, width, height;
+    };
+    // A centered guard band, and an asymmetric one
+    for (const Viewport& viewport : {Viewport{0, 0, 400, 240}, Viewport{200, 96, 160, 128}}) {
+        CAPTURE(viewport.x);
+        CAPTURE(viewport.y);
+        ViewportSetting setting(viewport.x, viewport.y, viewport.width, viewport.height);
+
+        SECTION("triangles crossing the x and y planes, within and past the guard band") {
+            for (int axis = 0; axis < 2; ++axis) {
+                for (float extent : {-12.f, -2.5f, 2.5f, 12.f}) {
+                    CAPTURE(axis);
+                    CAPTURE(extent);
+                    float x[3] = {-0.25f, extent, 0.3f};
+                    float y[3] = {-0.5f, 0.3f, 0.8f};
+                    if (axis == 1)
+                        std::swap(x, y);
+                    const OutputVertex triangle[3] = {
+                        MakeVertex(x[0], y[0], -0.2f, 1.f, 0.1f),
+                        MakeVertex(x[1] * 1.5f, y[1] * 1.5f, -0.75f, 1.5f, 0.5f),
+                        MakeVertex(x[2] * 0.75f, y[2] * 0.75f, -0.6f, 0.75f, 0.9f),
+                    };
+                    CompareClipping(triangle, viewport.x, viewport.y, viewport.width,
+                                    viewport.height);
+                }
+            }
+        }
+
+        SECTION("triangles crossing the depth planes") {
+            for (float z : {0.5f, -2.f}) {
+                CAPTURE(z);
+                const OutputVertex triangle[3] = {
+                    MakeVertex(-0.5f, -0.5f, -0.5f, 1.f, 0.1f),
+                    MakeVertex(0.75f, -0.25f, z, 1.f, 0.5f),
+                    MakeVertex(0.f, 1.5f, -0.25f, 1.f, 0.9f),
+                };
+                CompareClipping(triangle, viewport.x, viewport.y, viewport.width,
+                                viewport.height);
+            }
+        }
+
+        SECTION("triangles crossing the w plane") {
+            for (float w : {-0.5f, 0.f, -4.f}) {
+                CAPTURE(w);
+                const OutputVertex triangle[3] = {
+                    MakeVertex(-0.5f, -0.5f, -0.5f, 1.f, 0.1f),
+                    MakeVertex(0.5f, -0.25f, -0.5f, 2.f, 0.5f),
+                    MakeVertex(0.25f, 0.5f, -0.25f, w, 0.9f),
+                };
+                CompareClipping(triangle, viewport.x, viewport.y, viewport.width,
+                                viewport.height);
+            }
+        }
+
+        SECTION("random triangles") {
+            std::mt19937 rng(37);
+            std::uniform_real_distribution<float> xy(-6.f, 6.f);
+            std::uniform_real_distribution<float> z(-1.5f, 0.5f);
+            std::uniform_real_distribution<float> w(-0.5f, 2.f);
+            std::uniform_real_distribution<float> red(0.f, 1.f);
+            for (int i = 0; i < 64; ++i) {
+                CAPTURE(i);
+                const OutputVertex triangle[3] = {
+                    MakeVertex(xy(rng), xy(rng), z(rng), w(rng), red(rng)),
+                    MakeVertex(xy(rng), xy(rng), z(rng), w(rng), red(rng)),
+                    MakeVertex(xy(rng), xy(rng), z(rng), w(rng), red(rng)),
+                };
+                CompareClipping(triangle, viewport.x, viewport.y, viewport.width,
+                                viewport.height);
+            }
+        }
+    }
+}
+
+TEST_CASE("Clipper rejects and accepts triangles without clipping them", "[video_core][clipper]") {
+    ViewportSetting setting(0, 0, 400, 240);
+
+    // Outside of x = +w, within the guard band
+    const OutputVertex outside[3] = {
+        MakeVertex(1.5f, 0.f, -0.5f, 1.f, 0.f),
+        MakeVertex(2.5f, 0.5f, -0.5f, 1.f, 0.f),
+        MakeVertex(2.f, 1.f, -0.5f, 1.f, 0.f),
+    };
+    REQUIRE(Clip(outside, true).empty());
+    REQUIRE(Clip(outside, false).empty());
+
+    // Crossing x = +w within the guard band, it is left to the scissoring of the rasterizer
+    const OutputVertex crossing[3] = {
+        MakeVertex(0.5f, 0.f, -0.5f, 1.f, 0.f),
+        MakeVertex(2.5f, 0.5f, -0.5f, 1.f, 0.f),
+        MakeVertex(0.5f, 1.f, -0.5f, 1.f, 0.f),
+    };
+    const std::vector<Vertex> accepted = Clip(crossing, true);
+    REQUIRE(accepted.size() == 3);
+    REQUIRE(accepted[1].screenpos.x.ToFloat32() == 700.f);
+    REQUIRE(Clip(crossing, false).size() == 6);
+}
+
+} // namespace Clipper
+} // namespace Pica
@@ -0,0 +1,147 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "common/vector_math.h"
+#include "video_core/swrasterizer/coverage.h"
+
+namespace Pica {
+namespace Rasterizer {
+
+using Pixel = std::tuple<int, int, int, int, int>;
+
+static int SignedArea(const Math::Vec2<int>& vtx1, const Math::Vec2<int>& vtx2,
+                      const Math::Vec2<int>& vtx3) {
+    const auto vec1 = Math::MakeVec(vtx2 - vtx1, 0);
+    const auto vec2 = Math::MakeVec(vtx3 - vtx1, 0);
+    return Math::Cross(vec1, vec2).z;
+}
+
+/// Coverage computed the way the rasterizer did it before incremental edge functions, by
+/// evaluating the barycentric coordinates from scratch at each pixel of the bounding box
+static std::vector<Pixel> ReferenceCoverage(const Math::Vec2<int> (&vtx)[3], int min_x, int min_y,
+                                            int max_x, int max_y) {
+    auto IsRightSideOrFlatBottomEdge = [](const Math::Vec2<int>& vtx, const Math::Vec2<int>& line1,
+                                          const Math::Vec2<int>& line2) {
+        if (line1.y == line2.y) {
+            return vtx.y < line1.y;
+        } else {
+            return vtx.x < line1.x + (line2.x - line1.x) * (vtx.y - line1.y) / (line2.y - line1.y);
+        }
+    };
+    int bias0 = IsRightSideOrFlatBottomEdge(vtx[0], vtx[1], vtx[2]) ? -1 : 0;
+    int bias1 = IsRightSideOrFlatBottomEdge(vtx[1], vtx[2], vtx[0]) ? -1 : 0;
+    int bias2 = IsRightSideOrFlatBottomEdge(vtx[2], vtx[0], vtx[1]) ? -1 : 0;
+
+    std::vector<Pixel> pixels;
+    for (int y = min_y + 8; y < max_y; y += 0x10) {
+        for (int x = min_x + 8; x < max_x; x += 0x10) {
+            int w0 = bias0 + SignedArea(vtx[1], vtx[2], {x, y});
+            int w1 = bias1 + SignedArea(vtx[2], vtx[0], {x, y});
+            int w2 = bias2 + SignedArea(vtx[0], vtx[1], {x, y});
+            if (w0 < 0 || w1 < 0 || w2 < 0)
+                continue;
+            pixels.emplace_back(x, y, w0, w1, w2);
+        }
+    }
+    return pixels;
+}
+
+static std::vector<Pixel> QuadCoverage(const Math::Vec2<int> (&vtx)[3], int min_x, int min_y,
+                                       int max_x, int max_y) {
+    std::vector<Pixel> pixels;
+    ForEachCoveredQuad(TriangleEdges(vtx[0], vtx[1], vtx[2]), min_x, min_y, max_x, max_y,
+                       [](int, int) { return true; },
+                       [&](const CoverageQuad& quad) {
+                           for (int i = 0; i < 4; ++i) {
+                               if (quad.mask & (1 << i)) {
+                                   const auto& w = quad.w[i];
+                                   pixels.emplace_back(quad.x + (i & 1) * 16,
+                                                       quad.y + (i >> 1) * 16, w[0], w[1], w[2]);
+                               }
+                           }
+                       });
+    std::sort(pixels.begin(), pixels.end(), [](const Pixel& a, const Pixel& b) {
+        return std::tie(std::get<1>(a), std::get<0>(a)) < std::tie(std::get<1>(b), std::get<0>(b));
+    });
+    return pixels;
+}
+
+/// Checks both coverages for a triangle wound counter-clockwise like the rasterizer does, with the
+/// bounding box clamped and aligned like the rasterizer does
+static void CheckCoverage(const Math::Vec2<int> (&triangle)[3], int viewport_width,
+                          int viewport_height) {
+    Math::Vec2<int> vtx[3] = {triangle[0], triangle[1], triangle[2]};
+    if (SignedArea(vtx[0], vtx[1], vtx[2]) < 0)
+        std::swap(vtx[1], vtx[2]);
+
+    int min_x = std::max({std::min({vtx[0].x, vtx[1].x, vtx[2].x}), 0}) & ~0xF;
+    int min_y = std::max({std::min({vtx[0].y, vtx[1].y, vtx[2].y}), 0}) & ~0xF;
+    int max_x = std::min(std::max({vtx[0].x, vtx[1].x, vtx[2].x}), viewport_width * 16);
+    int max_y = std::min(std::max({vtx[0].y, vtx[1].y, vtx[2].y}), viewport_height * 16);
+    max_x = (max_x + 0xF) & ~0xF;
+    max_y = (max_y + 0xF) & ~0xF;
+
+    REQUIRE(QuadCoverage(vtx, min_x, min_y, max_x, max_y) ==
+            ReferenceCoverage(vtx, min_x, min_y, max_x, max_y));
+}
+
+TEST_CASE("Quad coverage matches per-pixel evaluation", "[video_core][swrasterizer]") {
+    SECTION("edges on pixel centers and flat edges") {
+        const Math::Vec2<int> flat_bottom[3] = {{8, 8}, {8, 136}, {136, 136}};
+        CheckCoverage(flat_bottom, 400, 240);
+        const Math::Vec2<int> flat_top[3] = {{8, 8}, {72, 136}, {136, 8}};
+        CheckCoverage(flat_top, 400, 240);
+        const Math::Vec2<int> square_half[3] = {{136, 8}, {8, 136}, {136, 136}};
+        CheckCoverage(square_half, 400, 240);
+    }
+
+    SECTION("random triangles") {
+        std::mt19937 rng(0x3D5);
+        // Vertices partly outside of the viewport, as allowed by the guard band
+        std::uniform_int_distribution<int> coord(-64 * 16, 300 * 16);
+        std::uniform_int_distribution<int> small_offset(-24 * 16, 24 * 16);
+
+        for (int i = 0; i < 2000; ++i) {
+            Math::Vec2<int> vtx[3];
+            vtx[0] = {coord(rng), coord(rng)};
+            if (i % 2 == 0) {
+                vtx[1] = {coord(rng), coord(rng)};
+                vtx[2] = {coord(rng), coord(rng)};
+            } else {
+                // Small triangles, with vertices sometimes sharing a coordinate
+                vtx[1] = {vtx[0].x + small_offset(rng), vtx[0].y + small_offset(rng)};
+                vtx[2] = {vtx[0].x + small_offset(rng), i % 3 ? vtx[1].y : vtx[0].y};
+            }
+
+            if (SignedArea(vtx[0], vtx[1], vtx[2]) == 0)
+                continue;
+
+            CheckCoverage(vtx, 256, 240);
+        }
+    }
+}
+
+TEST_CASE("Quad coverage skips rejected blocks", "[video_core][swrasterizer]") {
+    const Math::Vec2<int> vtx[3] = {{0, 0}, {32 * 16, 0}, {0, 32 * 16}};
+    int quads = 0;
+    ForEachCoveredQuad(TriangleEdges(vtx[0], vtx[1], vtx[2]), 0, 0, 32 * 16, 32 * 16,
+                       [](int block_x, int block_y) { return block_x == 1 && block_y == 1; },
+                       [&](const CoverageQuad& quad) {
+                           REQUIRE(quad.x >= 8 * 16);
+                           REQUIRE(quad.x < 16 * 16);
+                           REQUIRE(quad.y >= 8 * 16);
+                           REQUIRE(quad.y < 16 * 16);
+                           ++quads;
+                       });
+    REQUIRE(quads == 16);
+}
+
+} // namespace Rasterizer
+} // namespace Pica
@@ -0,0 +1,136 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "core/memory.h"
+#include "core/memory_setup.h"
+#include "video_core/pica_state.h"
+#include "video_core/regs_framebuffer.h"
+#include "video_core/swrasterizer/framebuffer.h"
+
+namespace Pica {
+namespace Rasterizer {
+
+TEST_CASE("DepthTestFailsForRange matches the depth test of every value in the ranges",
+          "[video_core][swrasterizer]") {
+    constexpr u32 max_value = 5;
+    for (u32 func_index = 0; func_index < 8; ++func_index) {
+        const auto func = static_cast<FramebufferRegs::CompareFunc>(func_index);
+        for (u32 min_z = 0; min_z <= max_value; ++min_z) {
+            for (u32 max_z = min_z; max_z <= max_value; ++max_z) {
+                for (u32 ref_min = 0; ref_min <= max_value; ++ref_min) {
+                    for (u32 ref_max = ref_min; ref_max <= max_value; ++ref_max) {
+                        bool all_fail = true;
+                        for (u32 z = min_z; z <= max_z; ++z) {
+                            for (u32 ref = ref_min; ref <= ref_max; ++ref) {
+                                all_fail &= !EvaluateCompareFunc(func, z, ref);
+                            }
+                        }
+
+                        CAPTURE(func_index);
+                        CAPTURE(min_z);
+                        CAPTURE(max_z);
+                        CAPTURE(ref_min);
+                        CAPTURE(ref_max);
+                        REQUIRE(DepthTestFailsForRange(func, min_z, max_z, {ref_min, ref_max}) ==
+                                all_fail);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/// D16 depth buffer mapped at the start of VRAM, filled with a single value
+class DepthBuffer {
+public:
+    static constexpr u32 WIDTH = 64;
+    static constexpr u32 HEIGHT = 64;
+    static constexpr u32 SIZE = WIDTH * HEIGHT * 2;
+
+    explicit DepthBuffer(u16 value) : memory(SIZE) {
+        Memory::MapMemoryRegion(Memory::VRAM_VADDR, SIZE, memory.data());
+        Fill(value);
+
+        auto& framebuffer = g_state.regs.framebuffer.framebuffer;
+        framebuffer.depth_buffer_address.Assign(Memory::VRAM_PADDR / 8);
+        framebuffer.depth_format.Assign(FramebufferRegs::DepthFormat::D16);
+        framebuffer.width.Assign(WIDTH);
+        framebuffer.height.Assign(HEIGHT - 1);
+        InvalidateDepthTiles();
+    }
+
+    ~DepthBuffer() {
+        InvalidateDepthTiles();
+        Memory::UnmapRegion(Memory::VRAM_VADDR, SIZE);
+    }
+
+    /// Overwrites the buffer behind the back of the coarse depth buffer
+    void Fill(u16 value) {
+        for (size_t i = 0; i < memory.size(); i += 2) {
+            memory[i] = static_cast<u8>(value);
+            memory[i + 1] = static_cast<u8>(value >> 8);
+        }
+    }
+
+private:
+    std::vector<u8> memory;
+};
+
+TEST_CASE("Coarse depth buffer tiles are read again once invalidated",
+          "[video_core][swrasterizer]") {
+    DepthBuffer buffer(0x4040);
+    const PAddr begin = Memory::VRAM_PADDR;
+    const PAddr end = begin + DepthBuffer::SIZE;
+
+    auto RequireBounds = [](u32 min, u32 max) {
+        for (int tile_y = 0; tile_y < 2; ++tile_y) {
+            for (int tile_x = 0; tile_x < 2; ++tile_x) {
+                const DepthTileBounds bounds = GetDepthTileBounds(tile_x, tile_y);
+                REQUIRE(bounds.min == min);
+                REQUIRE(bounds.max == max);
+            }
+        }
+    };
+
+    RequireBounds(0x4040, 0x4040);
+
+    // The bounds of the tiles are kept until the memory holding them is invalidated
+    buffer.Fill(0x2020);
+    RequireBounds(0x4040, 0x4040);
+    InvalidateDepthTiles(end, 0x100);
+    InvalidateDepthTiles(begin - 0x100, 0x100);
+    RequireBounds(0x4040, 0x4040);
+
+    SECTION("writes overlapping the end of the buffer") {
+        InvalidateDepthTiles(end - 1, 0x100);
+        RequireBounds(0x2020, 0x2020);
+    }
+
+    SECTION("writes overlapping the start of the buffer") {
+        InvalidateDepthTiles(begin - 0x100, 0x101);
+        RequireBounds(0x2020, 0x2020);
+    }
+
+    SECTION("writes covering the whole buffer") {
+        InvalidateDepthTiles(begin - 0x100, DepthBuffer::SIZE + 0x200);
+        RequireBounds(0x2020, 0x2020);
+    }
+
+    SECTION("writes within the buffer") {
+        InvalidateDepthTiles(begin + 0x800, 2);
+        RequireBounds(0x2020, 0x2020);
+
+        // Depth values written by the rasterizer widen the bounds of their tile
+        SetDepth(1, 2, 0x1000);
+        REQUIRE(GetDepthTileBounds(0, 0).min == 0x1000);
+        REQUIRE(GetDepthTileBounds(0, 0).max == 0x2020);
+        REQUIRE(GetDepthTileBounds(1, 0).min == 0x2020);
+    }
+}
+
+} // namespace Rasterizer
+} // namespace Pica
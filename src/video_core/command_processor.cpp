@@ -16,6 +16,7 @@
 #include "core/tracer/recorder.h"
 #include "video_core/command_processor.h"
 #include "video_core/debug_utils/debug_utils.h"
+#include "video_core/geometry_pipeline.h"
 #include "video_core/pica_state.h"
 #include "video_core/pica_types.h"
 #include "video_core/primitive_assembly.h"
@@ -154,8 +155,12 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
     u32 old_value = regs.reg_array[id];
 
     const u32 write_mask = expand_bits_to_bytes[mask];
+    const u32 new_value = (old_value & ~write_mask) | (value & write_mask);
 
-    regs.reg_array[id] = (old_value & ~write_mask) | (value & write_mask);
+    // Give the rasterizer a chance to draw queued triangles with the state they were queued with
+    VideoCore::g_renderer->Rasterizer()->NotifyPicaRegisterWrite(id, old_value, new_value);
+
+    regs.reg_array[id] = new_value;
 
     // Double check for is_pica_tracing to avoid call overhead
     if (DebugUtils::IsPicaTracing()) {
@@ -182,6 +187,7 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
 
     case PICA_REG_INDEX(pipeline.vs_default_attributes_setup.index):
         g_state.immediate.current_attribute = 0;
+        g_state.immediate.reset_geometry_pipeline = true;
         default_attr_counter = 0;
         break;
 
@@ -241,8 +247,16 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
                     MICROPROFILE_SCOPE(GPU_Drawing);
                     immediate_attribute_id = 0;
 
+                    if (g_state.immediate.reset_geometry_pipeline) {
+                        g_state.geometry_pipeline.Reconfigure();
+                        g_state.immediate.reset_geometry_pipeline = false;
+                    }
+                    ASSERT(!g_state.geometry_pipeline.NeedIndexInput());
+
                     auto* shader_engine = Shader::GetEngine();
+                    g_state.vs.output_mask = regs.vs.output_mask;
                     shader_engine->SetupBatch(g_state.vs, regs.vs.main_offset);
+                    g_state.geometry_pipeline.Setup(shader_engine);
 
                     // Send to vertex shader
                     if (g_debug_context)
@@ -255,16 +269,8 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
                     shader_engine->Run(g_state.vs, shader_unit);
                     shader_unit.WriteOutput(regs.vs, output);
 
-                    // Send to renderer
-                    using Pica::Shader::OutputVertex;
-                    auto AddTriangle = [](const OutputVertex& v0, const OutputVertex& v1,
-                                          const OutputVertex& v2) {
-                        VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
-                    };
-
-                    g_state.primitive_assembler.SubmitVertex(
-                        Shader::OutputVertex::FromAttributeBuffer(regs.rasterizer, output),
-                        AddTriangle);
+                    // Send to geometry pipeline
+                    g_state.geometry_pipeline.SubmitVertex(output);
                 }
             }
         }
@@ -343,16 +349,88 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
         const size_t VERTEX_CACHE_SIZE = 32;
         std::array<u16, VERTEX_CACHE_SIZE> vertex_cache_ids;
         std::array<Shader::OutputVertex, VERTEX_CACHE_SIZE> vertex_cache;
-        Shader::OutputVertex output_vertex;
 
         unsigned int vertex_cache_pos = 0;
         vertex_cache_ids.fill(-1);
 
+        // Vertices missing from the cache are gathered in batches, which the shader engine can
+        // process several at a time. The vertices waiting for a batch to complete are submitted
+        // in order once it has run.
+        std::array<Shader::AttributeBuffer, Shader::MAX_BATCH_SIZE> batch_input;
+        std::array<Shader::AttributeBuffer, Shader::MAX_BATCH_SIZE> batch_output;
+        std::array<Shader::OutputVertex, Shader::MAX_BATCH_SIZE> batch_vertices;
+        std::array<unsigned int, Shader::MAX_BATCH_SIZE> batch_vertex_ids;
+        unsigned int batch_size = 0;
+
+        struct PendingVertex {
+            Shader::OutputVertex output;
+            /// Index of the vertex in the batch, or -1 if it was found in the vertex cache
+            int batch_index;
+        };
+        const size_t MAX_PENDING_VERTICES = VERTEX_CACHE_SIZE;
+        std::array<PendingVertex, MAX_PENDING_VERTICES> pending_vertices;
+        unsigned int num_pending_vertices = 0;
+
         auto* shader_engine = Shader::GetEngine();
         Shader::UnitState shader_unit;
 
+        g_state.vs.output_mask = regs.vs.output_mask;
         shader_engine->SetupBatch(g_state.vs, regs.vs.main_offset);
 
+        // With the geometry shader enabled, the vertex shader outputs go through the geometry
+        // pipeline instead, whose inputs aren't OutputVertex and thus can't use the vertex cache.
+        // In the variable primitive mode, some indices give the vertex count of the next primitive,
+        // which depends on the vertices submitted before, so the vertices are submitted one by one.
+        GeometryPipeline& geometry_pipeline = g_state.geometry_pipeline;
+        geometry_pipeline.Reconfigure();
+        geometry_pipeline.Setup(shader_engine);
+        const bool use_gs = geometry_pipeline.IsEnabled();
+        const bool gs_variable_primitive =
+            use_gs && regs.pipeline.gs_config.mode == PipelineRegs::GSMode::VariablePrimitive;
+        ASSERT(!geometry_pipeline.NeedIndexInput() || is_indexed);
+
+        // Send to renderer
+        using Pica::Shader::OutputVertex;
+        auto AddTriangle = [](const OutputVertex& v0, const OutputVertex& v1,
+                              const OutputVertex& v2) {
+            VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
+        };
+
+        auto FlushPendingVertices = [&]() {
+            if (batch_size != 0) {
+                batch_output.fill({});
+                shader_engine->RunBatch(g_state.vs, shader_unit, regs.vs, batch_input.data(),
+                                        batch_output.data(), batch_size);
+
+                for (unsigned int i = 0; i < batch_size && !use_gs; ++i) {
+                    // Retrieve vertex from register data
+                    batch_vertices[i] =
+                        Shader::OutputVertex::FromAttributeBuffer(regs.rasterizer, batch_output[i]);
+
+                    if (is_indexed) {
+                        vertex_cache[vertex_cache_pos] = batch_vertices[i];
+                        vertex_cache_ids[vertex_cache_pos] = batch_vertex_ids[i];
+                        vertex_cache_pos = (vertex_cache_pos + 1) % VERTEX_CACHE_SIZE;
+                    }
+                }
+            }
+
+            for (unsigned int i = 0; i < num_pending_vertices; ++i) {
+                const PendingVertex& pending = pending_vertices[i];
+                if (use_gs) {
+                    geometry_pipeline.SubmitVertex(batch_output[pending.batch_index]);
+                    continue;
+                }
+                primitive_assembler.SubmitVertex(pending.batch_index < 0
+                                                     ? pending.output
+                                                     : batch_vertices[pending.batch_index],
+                                                 AddTriangle);
+            }
+
+            batch_size = 0;
+            num_pending_vertices = 0;
+        };
+
         for (unsigned int index = 0; index < regs.pipeline.num_vertices; ++index) {
             // Indexed rendering doesn't use the start offset
             unsigned int vertex =
@@ -363,57 +441,63 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
             // the PICA supports it, and it would mess up the caching, guard against it here.
             ASSERT(vertex != -1);
 
-            bool vertex_cache_hit = false;
+            if (is_indexed && g_debug_context && Pica::g_debug_context->recorder) {
+                int size = index_u16 ? 2 : 1;
+                memory_accesses.AddAccess(base_address + index_info.offset + size * index, size);
+            }
 
-            if (is_indexed) {
-                if (g_debug_context && Pica::g_debug_context->recorder) {
-                    int size = index_u16 ? 2 : 1;
-                    memory_accesses.AddAccess(base_address + index_info.offset + size * index,
-                                              size);
+            if (gs_variable_primitive) {
+                FlushPendingVertices();
+                if (geometry_pipeline.NeedIndexInput()) {
+                    geometry_pipeline.SubmitIndex(vertex);
+                    continue;
                 }
+            }
+
+            PendingVertex& pending = pending_vertices[num_pending_vertices++];
+            pending.batch_index = -1;
+            bool vertex_cache_hit = false;
 
-                for (unsigned int i = 0; i < VERTEX_CACHE_SIZE; ++i) {
+            if (is_indexed) {
+                for (unsigned int i = 0; i < VERTEX_CACHE_SIZE && !use_gs; ++i) {
                     if (vertex == vertex_cache_ids[i]) {
-                        output_vertex = vertex_cache[i];
+                        pending.output = vertex_cache[i];
                         vertex_cache_hit = true;
                         break;
                     }
                 }
+
+                // The vertex may also be waiting in the current batch
+                for (unsigned int i = 0; i < batch_size && !vertex_cache_hit; ++i) {
+                    if (vertex == batch_vertex_ids[i]) {
+                        pending.batch_index = i;
+                        vertex_cache_hit = true;
+                    }
+                }
             }
 
             if (!vertex_cache_hit) {
                 // Initialize data for the current vertex
-                Shader::AttributeBuffer input, output{};
+                Shader::AttributeBuffer& input = batch_input[batch_size];
                 loader.LoadVertex(base_address, index, vertex, input, memory_accesses);
 
                 // Send to vertex shader
                 if (g_debug_context)
                     g_debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation,
                                              (void*)&input);
-                shader_unit.LoadInput(regs.vs, input);
-                shader_engine->Run(g_state.vs, shader_unit);
-                shader_unit.WriteOutput(regs.vs, output);
-
-                // Retrieve vertex from register data
-                output_vertex = Shader::OutputVertex::FromAttributeBuffer(regs.rasterizer, output);
 
-                if (is_indexed) {
-                    vertex_cache[vertex_cache_pos] = output_vertex;
-                    vertex_cache_ids[vertex_cache_pos] = vertex;
-                    vertex_cache_pos = (vertex_cache_pos + 1) % VERTEX_CACHE_SIZE;
-                }
+                batch_vertex_ids[batch_size] = vertex;
+                pending.batch_index = batch_size++;
             }
 
-            // Send to renderer
-            using Pica::Shader::OutputVertex;
-            auto AddTriangle = [](const OutputVertex& v0, const OutputVertex& v1,
-                                  const OutputVertex& v2) {
-                VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
-            };
-
-            primitive_assembler.SubmitVertex(output_vertex, AddTriangle);
+            if (batch_size == Shader::MAX_BATCH_SIZE ||
+                num_pending_vertices == MAX_PENDING_VERTICES) {
+                FlushPendingVertices();
+            }
         }
 
+        FlushPendingVertices();
+
         for (auto& range : memory_accesses.ranges) {
             g_debug_context->recorder->MemoryAccessed(Memory::GetPhysicalPointer(range.first),
                                                       range.second, range.first);
@@ -511,6 +595,11 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
     case PICA_REG_INDEX_WORKAROUND(vs.program.set_word[6], 0x2d2):
     case PICA_REG_INDEX_WORKAROUND(vs.program.set_word[7], 0x2d3): {
         WriteProgramCode(g_state.regs.vs, g_state.vs, 512, value);
+        // Unless configured separately, the geometry shader unit receives the same program
+        if (!regs.pipeline.gs_unit_exclusive_configuration &&
+            regs.pipeline.use_gs == PipelineRegs::UseGS::No) {
+            WriteProgramCode(g_state.regs.gs, g_state.gs, 4096, value);
+        }
         break;
     }
 
@@ -523,6 +612,10 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
     case PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.set_word[6], 0x2dc):
     case PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.set_word[7], 0x2dd): {
         WriteSwizzlePatterns(g_state.regs.vs, g_state.vs, value);
+        if (!regs.pipeline.gs_unit_exclusive_configuration &&
+            regs.pipeline.use_gs == PipelineRegs::UseGS::No) {
+            WriteSwizzlePatterns(g_state.regs.gs, g_state.gs, value);
+        }
         break;
     }
 
@@ -599,6 +692,8 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
 }
 
 void ProcessCommandList(const u32* list, u32 size) {
+    VideoCore::g_renderer->Rasterizer()->NotifyCommandListStart();
+
     g_state.cmd_list.head_ptr = g_state.cmd_list.current_ptr = list;
     g_state.cmd_list.length = size / sizeof(u32);
 
@@ -618,6 +713,8 @@ void ProcessCommandList(const u32* list, u32 size) {
             WritePicaReg(cmd, *g_state.cmd_list.current_ptr++, header.parameter_mask);
         }
     }
+
+    VideoCore::g_renderer->Rasterizer()->NotifyCommandListEnd();
 }
 
 } // namespace
@@ -0,0 +1,60 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include "video_core/shader/shader.h"
+
+namespace Pica {
+
+struct State;
+
+class GeometryPipelineBackend;
+
+/**
+ * Buffers the outputs of the vertex shader into the inputs of the geometry shader, and runs the
+ * geometry shader once enough of them are gathered. This is the stage between the vertex shader
+ * and the primitive assembler when the geometry shader is enabled.
+ */
+class GeometryPipeline {
+public:
+    explicit GeometryPipeline(State& state);
+    ~GeometryPipeline();
+
+    /// Sets the handler receiving the vertex shader outputs when the geometry shader is disabled
+    void SetVertexHandler(Shader::VertexHandler vertex_handler);
+
+    /**
+     * Sets up the geometry shader unit for a batch of vertices. Must be called after Reconfigure
+     * and before the vertices are submitted.
+     */
+    void Setup(Shader::ShaderEngine* shader_engine);
+
+    /// Reconfigures the pipeline according to the current registers, discarding any partial input
+    void Reconfigure();
+
+    /// Returns whether the geometry shader is enabled by the current configuration
+    bool IsEnabled() const {
+        return backend != nullptr;
+    }
+
+    /// Returns whether the next index of an indexed draw must be passed to SubmitIndex rather than
+    /// used to load a vertex
+    bool NeedIndexInput() const;
+
+    /// Submits an index of an indexed draw, see NeedIndexInput
+    void SubmitIndex(unsigned int val);
+
+    /// Submits the outputs of the vertex shader for one vertex
+    void SubmitVertex(const Shader::AttributeBuffer& input);
+
+private:
+    Shader::VertexHandler vertex_handler;
+    Shader::ShaderEngine* shader_engine = nullptr;
+    std::unique_ptr<GeometryPipelineBackend> backend;
+    State& state;
+};
+
+} // namespace Pica
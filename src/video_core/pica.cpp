@@ -5,7 +5,10 @@
 #include <cstring>
 #include "video_core/pica.h"
 #include "video_core/pica_state.h"
+#include "video_core/rasterizer_interface.h"
 #include "video_core/regs_pipeline.h"
+#include "video_core/renderer_base.h"
+#include "video_core/video_core.h"
 
 namespace Pica {
 
@@ -24,12 +27,31 @@ void Zero(T& o) {
     memset(&o, 0, sizeof(o));
 }
 
+State::State() : geometry_pipeline(*this) {
+    auto SubmitVertex = [this](const Shader::AttributeBuffer& vertex) {
+        using Pica::Shader::OutputVertex;
+        auto AddTriangle = [](const OutputVertex& v0, const OutputVertex& v1,
+                              const OutputVertex& v2) {
+            VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
+        };
+        primitive_assembler.SubmitVertex(
+            Shader::OutputVertex::FromAttributeBuffer(regs.rasterizer, vertex), AddTriangle);
+    };
+
+    auto SetWinding = [this]() { primitive_assembler.SetWinding(); };
+
+    gs_unit.SetVertexHandler(SubmitVertex, SetWinding);
+    geometry_pipeline.SetVertexHandler(SubmitVertex);
+}
+
 void State::Reset() {
     Zero(regs);
     Zero(vs);
     Zero(gs);
     Zero(cmd_list);
     Zero(immediate);
+    immediate.reset_geometry_pipeline = true;
     primitive_assembler.Reconfigure(PipelineRegs::TriangleTopology::List);
+    geometry_pipeline.Reconfigure();
 }
 }
@@ -29,9 +29,20 @@ public:
     /// Draw the current batch of triangles
     virtual void DrawTriangles() = 0;
 
+    /// Notify rasterizer that the specified PICA register is about to be written
+    virtual void NotifyPicaRegisterWrite(u32 id, u32 old_value, u32 new_value) = 0;
+
     /// Notify rasterizer that the specified PICA register has been changed
     virtual void NotifyPicaRegisterChanged(u32 id) = 0;
 
+    /// Notify rasterizer that a command list is about to be processed. The emulated CPU may have
+    /// written to any memory since the previous command list.
+    virtual void NotifyCommandListStart() {}
+
+    /// Notify rasterizer that a command list has been processed. The emulated CPU may write to any
+    /// memory before the next command list.
+    virtual void NotifyCommandListEnd() {}
+
     /// Notify rasterizer that all caches should be flushed to 3DS memory
     virtual void FlushAll() = 0;
 
@@ -131,12 +131,18 @@ ASSERT_REG_POSITION(pipeline, 0x200);
 ASSERT_REG_POSITION(pipeline.vertex_attributes, 0x200);
 ASSERT_REG_POSITION(pipeline.index_array, 0x227);
 ASSERT_REG_POSITION(pipeline.num_vertices, 0x228);
+ASSERT_REG_POSITION(pipeline.use_gs, 0x229);
 ASSERT_REG_POSITION(pipeline.vertex_offset, 0x22a);
 ASSERT_REG_POSITION(pipeline.trigger_draw, 0x22e);
 ASSERT_REG_POSITION(pipeline.trigger_draw_indexed, 0x22f);
 ASSERT_REG_POSITION(pipeline.vs_default_attributes_setup, 0x232);
 ASSERT_REG_POSITION(pipeline.command_buffer, 0x238);
+ASSERT_REG_POSITION(pipeline.gs_unit_exclusive_configuration, 0x244);
 ASSERT_REG_POSITION(pipeline.gpu_mode, 0x245);
+ASSERT_REG_POSITION(pipeline.vs_outmap_total_minus_1_a, 0x24a);
+ASSERT_REG_POSITION(pipeline.vs_outmap_total_minus_1_b, 0x251);
+ASSERT_REG_POSITION(pipeline.gs_config, 0x252);
+ASSERT_REG_POSITION(pipeline.variable_primitive_vertex_num, 0x254);
 ASSERT_REG_POSITION(pipeline.triangle_topology, 0x25e);
 ASSERT_REG_POSITION(pipeline.restart_primitive, 0x25f);
 
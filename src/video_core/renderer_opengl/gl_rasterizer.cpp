@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -13,7 +15,10 @@
 #include "common/math_util.h"
 #include "common/microprofile.h"
 #include "common/vector_math.h"
+#include "core/core.h"
 #include "core/hw/gpu.h"
+#include "core/loader/loader.h"
+#include "core/settings.h"
 #include "video_core/pica_state.h"
 #include "video_core/regs_framebuffer.h"
 #include "video_core/regs_rasterizer.h"
@@ -27,25 +32,25 @@ MICROPROFILE_DEFINE(OpenGL_Drawing, "OpenGL", "Drawing", MP_RGB(128, 128, 192));
 MICROPROFILE_DEFINE(OpenGL_Blits, "OpenGL", "Blits", MP_RGB(100, 100, 255));
 MICROPROFILE_DEFINE(OpenGL_CacheManagement, "OpenGL", "Cache Mgmt", MP_RGB(100, 255, 100));
 
-RasterizerOpenGL::RasterizerOpenGL() : shader_dirty(true) {
+RasterizerOpenGL::RasterizerOpenGL()
+    : shader_dirty(true), vertex_buffer(GL_ARRAY_BUFFER, VERTEX_BUFFER_SIZE),
+      uniform_buffer(GL_UNIFORM_BUFFER, UNIFORM_BUFFER_SIZE),
+      texture_buffer(GL_TEXTURE_BUFFER, TEXTURE_BUFFER_SIZE) {
     // Create sampler objects
     for (size_t i = 0; i < texture_samplers.size(); ++i) {
         texture_samplers[i].Create();
         state.texture_units[i].sampler = texture_samplers[i].sampler.handle;
     }
 
-    // Generate VBO, VAO and UBO
-    vertex_buffer.Create();
+    // Generate VAO
     vertex_array.Create();
-    uniform_buffer.Create();
 
     state.draw.vertex_array = vertex_array.handle;
-    state.draw.vertex_buffer = vertex_buffer.handle;
-    state.draw.uniform_buffer = uniform_buffer.handle;
+    state.draw.vertex_buffer = vertex_buffer.GetHandle();
+    state.draw.uniform_buffer = uniform_buffer.GetHandle();
     state.Apply();
 
-    // Bind the UBO to binding point 0
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, uniform_buffer.handle);
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_buffer_alignment);
 
     uniform_block_data.dirty = true;
 
@@ -93,72 +98,16 @@ RasterizerOpenGL::RasterizerOpenGL() : shader_dirty(true) {
     // Create render framebuffer
     framebuffer.Create();
 
-    // Allocate and bind lighting lut textures
-    lighting_lut.Create();
-    state.lighting_lut.texture_buffer = lighting_lut.handle;
+    // Create the buffer textures viewing the lookup table stream buffer
+    texture_buffer_lut_rg.Create();
+    texture_buffer_lut_rgba.Create();
+    state.texture_buffer_lut_rg.texture_buffer = texture_buffer_lut_rg.handle;
+    state.texture_buffer_lut_rgba.texture_buffer = texture_buffer_lut_rgba.handle;
     state.Apply();
-    lighting_lut_buffer.Create();
-    glBindBuffer(GL_TEXTURE_BUFFER, lighting_lut_buffer.handle);
-    glBufferData(GL_TEXTURE_BUFFER,
-                 sizeof(GLfloat) * 2 * 256 * Pica::LightingRegs::NumLightingSampler, nullptr,
-                 GL_DYNAMIC_DRAW);
-    glActiveTexture(TextureUnits::LightingLUT.Enum());
-    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, lighting_lut_buffer.handle);
-
-    // Setup the LUT for the fog
-    fog_lut.Create();
-    state.fog_lut.texture_buffer = fog_lut.handle;
-    state.Apply();
-    fog_lut_buffer.Create();
-    glBindBuffer(GL_TEXTURE_BUFFER, fog_lut_buffer.handle);
-    glBufferData(GL_TEXTURE_BUFFER, sizeof(GLfloat) * 2 * 128, nullptr, GL_DYNAMIC_DRAW);
-    glActiveTexture(TextureUnits::FogLUT.Enum());
-    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, fog_lut_buffer.handle);
-
-    // Setup the noise LUT for proctex
-    proctex_noise_lut.Create();
-    state.proctex_noise_lut.texture_1d = proctex_noise_lut.handle;
-    state.Apply();
-    glActiveTexture(TextureUnits::ProcTexNoiseLUT.Enum());
-    glTexImage1D(GL_TEXTURE_1D, 0, GL_RG32F, 128, 0, GL_RG, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // Setup the color map for proctex
-    proctex_color_map.Create();
-    state.proctex_color_map.texture_1d = proctex_color_map.handle;
-    state.Apply();
-    glActiveTexture(TextureUnits::ProcTexColorMap.Enum());
-    glTexImage1D(GL_TEXTURE_1D, 0, GL_RG32F, 128, 0, GL_RG, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // Setup the alpha map for proctex
-    proctex_alpha_map.Create();
-    state.proctex_alpha_map.texture_1d = proctex_alpha_map.handle;
-    state.Apply();
-    glActiveTexture(TextureUnits::ProcTexAlphaMap.Enum());
-    glTexImage1D(GL_TEXTURE_1D, 0, GL_RG32F, 128, 0, GL_RG, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // Setup the LUT for proctex
-    proctex_lut.Create();
-    state.proctex_lut.texture_1d = proctex_lut.handle;
-    state.Apply();
-    glActiveTexture(TextureUnits::ProcTexLUT.Enum());
-    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA32F, 256, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // Setup the difference LUT for proctex
-    proctex_diff_lut.Create();
-    state.proctex_diff_lut.texture_1d = proctex_diff_lut.handle;
-    state.Apply();
-    glActiveTexture(TextureUnits::ProcTexDiffLUT.Enum());
-    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA32F, 256, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glActiveTexture(TextureUnits::TextureBufferLUT_RG.Enum());
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, texture_buffer.GetHandle());
+    glActiveTexture(TextureUnits::TextureBufferLUT_RGBA.Enum());
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, texture_buffer.GetHandle());
 
     // Sync fixed function OpenGL state
     SyncCullMode();
@@ -171,6 +120,29 @@ RasterizerOpenGL::RasterizerOpenGL() : shader_dirty(true) {
     SyncColorWriteMask();
     SyncStencilWriteMask();
     SyncDepthWriteMask();
+
+    if (Settings::values.use_disk_shader_cache && GLShader::IsProgramBinarySupported()) {
+        u64 program_id;
+        if (Core::System::GetInstance().GetAppLoader().ReadProgramId(program_id) ==
+            Loader::ResultStatus::Success) {
+            disk_shader_cache = std::make_unique<GLShader::ShaderDiskCache>(program_id);
+            LoadDiskShaderCache();
+        }
+    }
+
+    if (Settings::values.use_uber_shader && GLShader::IsParallelShaderCompileSupported()) {
+        // Let the driver decide how many threads to compile shaders on
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+
+        uber_shader.Create(GLShader::GenerateVertexShader().c_str(),
+                           GLShader::GenerateUberFragmentShader().c_str());
+        InitShaderProgram(uber_shader.handle);
+        uber_config_location = glGetUniformLocation(uber_shader.handle, "pica_config");
+        uber_config_float_location = glGetUniformLocation(uber_shader.handle, "pica_config_float");
+
+        state.draw.shader_program = 0;
+        state.Apply();
+    }
 }
 
 RasterizerOpenGL::~RasterizerOpenGL() {}
@@ -212,9 +184,51 @@ void RasterizerOpenGL::DrawTriangles() {
     if (vertex_batch.empty())
         return;
 
+    // The triangles stay queued until a register write or a memory access depends on them, or until
+    // the command list ends, so consecutive draws sharing the same state are submitted together
+    ++pending_draws;
+
+    if (vertex_batch.size() * sizeof(HardwareVertex) >= VERTEX_BUFFER_SIZE) {
+        FlushBatch();
+    }
+}
+
+static bool IsLUTDataRegister(u32 id) {
+    const auto InRange = [id](size_t first, size_t count) {
+        return id >= first && id < first + count;
+    };
+    return InRange(PICA_REG_INDEX(texturing.fog_lut_data), 8) ||
+           InRange(PICA_REG_INDEX(texturing.proctex_lut_data), 8) ||
+           InRange(PICA_REG_INDEX(lighting.lut_data), 8);
+}
+
+void RasterizerOpenGL::NotifyPicaRegisterWrite(u32 id, u32 old_value, u32 new_value) {
+    if (pending_draws == 0)
+        return;
+
+    // Only the rasterizer, texturing, framebuffer and lighting registers affect how triangles that
+    // were already assembled are drawn
+    if (id < PICA_REG_INDEX(rasterizer) || id >= PICA_REG_INDEX(pipeline))
+        return;
+
+    // Writes to the LUT data registers fill the next LUT entry even if the value is unchanged
+    if (old_value == new_value && !IsLUTDataRegister(id))
+        return;
+
+    FlushBatch();
+}
+
+void RasterizerOpenGL::FlushBatch() {
+    if (pending_draws == 0)
+        return;
+
     MICROPROFILE_SCOPE(OpenGL_Drawing);
     const auto& regs = Pica::g_state.regs;
 
+    // Looking up the surfaces below may flush memory regions, which must not draw this batch again
+    Core::System::GetInstance().perf_stats.AddBatch(pending_draws);
+    pending_draws = 0;
+
     // Sync and bind the framebuffer surfaces
     CachedSurface* color_surface;
     CachedSurface* depth_surface;
@@ -225,15 +239,28 @@ void RasterizerOpenGL::DrawTriangles() {
     state.draw.draw_framebuffer = framebuffer.handle;
     state.Apply();
 
-    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                           color_surface != nullptr ? color_surface->texture.handle : 0, 0);
-    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
-                           depth_surface != nullptr ? depth_surface->texture.handle : 0, 0);
     bool has_stencil =
         regs.framebuffer.framebuffer.depth_format == Pica::FramebufferRegs::DepthFormat::D24S8;
-    glFramebufferTexture2D(
-        GL_DRAW_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_TEXTURE_2D,
-        (has_stencil && depth_surface != nullptr) ? depth_surface->texture.handle : 0, 0);
+    GLuint color_texture = color_surface != nullptr ? color_surface->texture.handle : 0;
+    GLuint depth_texture = depth_surface != nullptr ? depth_surface->texture.handle : 0;
+    GLuint stencil_texture = has_stencil ? depth_texture : 0;
+
+    if (framebuffer_attachments.dirty || framebuffer_attachments.color != color_texture) {
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                               color_texture, 0);
+        framebuffer_attachments.color = color_texture;
+    }
+    if (framebuffer_attachments.dirty || framebuffer_attachments.depth != depth_texture) {
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                               depth_texture, 0);
+        framebuffer_attachments.depth = depth_texture;
+    }
+    if (framebuffer_attachments.dirty || framebuffer_attachments.stencil != stencil_texture) {
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_TEXTURE_2D,
+                               stencil_texture, 0);
+        framebuffer_attachments.stencil = stencil_texture;
+    }
+    framebuffer_attachments.dirty = false;
 
     // Sync the viewport
     // These registers hold half-width and half-height, so must be multiplied by 2
@@ -303,66 +330,34 @@ void RasterizerOpenGL::DrawTriangles() {
     // Sync and bind the shader
     if (shader_dirty) {
         SetShader();
-        shader_dirty = false;
-    }
-
-    // Sync the lighting luts
-    for (unsigned index = 0; index < uniform_block_data.lut_dirty.size(); index++) {
-        if (uniform_block_data.lut_dirty[index]) {
-            SyncLightingLUT(index);
-            uniform_block_data.lut_dirty[index] = false;
-        }
-    }
-
-    // Sync the fog lut
-    if (uniform_block_data.fog_lut_dirty) {
-        SyncFogLUT();
-        uniform_block_data.fog_lut_dirty = false;
-    }
-
-    // Sync the proctex noise lut
-    if (uniform_block_data.proctex_noise_lut_dirty) {
-        SyncProcTexNoiseLUT();
-        uniform_block_data.proctex_noise_lut_dirty = false;
-    }
-
-    // Sync the proctex color map
-    if (uniform_block_data.proctex_color_map_dirty) {
-        SyncProcTexColorMap();
-        uniform_block_data.proctex_color_map_dirty = false;
-    }
-
-    // Sync the proctex alpha map
-    if (uniform_block_data.proctex_alpha_map_dirty) {
-        SyncProcTexAlphaMap();
-        uniform_block_data.proctex_alpha_map_dirty = false;
+        // Keep polling the specialized program while the uber shader stands in for it
+        shader_dirty = current_shader == nullptr;
     }
 
-    // Sync the proctex lut
-    if (uniform_block_data.proctex_lut_dirty) {
-        SyncProcTexLUT();
-        uniform_block_data.proctex_lut_dirty = false;
-    }
-
-    // Sync the proctex difference lut
-    if (uniform_block_data.proctex_diff_lut_dirty) {
-        SyncProcTexDiffLUT();
-        uniform_block_data.proctex_diff_lut_dirty = false;
-    }
+    // Sync the LUTs within the texture buffer
+    SyncAndUploadLUTs();
 
     // Sync the uniform data
-    if (uniform_block_data.dirty) {
-        glBufferData(GL_UNIFORM_BUFFER, sizeof(UniformData), &uniform_block_data.data,
-                     GL_STATIC_DRAW);
-        uniform_block_data.dirty = false;
-    }
+    UploadUniforms();
 
     state.Apply();
 
-    // Draw the vertex batch
-    glBufferData(GL_ARRAY_BUFFER, vertex_batch.size() * sizeof(HardwareVertex), vertex_batch.data(),
-                 GL_STREAM_DRAW);
-    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertex_batch.size());
+    // Draw the vertex batch, splitting it up if it does not fit in the stream buffer at once
+    constexpr size_t max_vertices = 3 * (VERTEX_BUFFER_SIZE / (3 * sizeof(HardwareVertex)));
+    for (size_t base_vertex = 0; base_vertex < vertex_batch.size(); base_vertex += max_vertices) {
+        size_t vertices = std::min(max_vertices, vertex_batch.size() - base_vertex);
+        size_t vertex_size = vertices * sizeof(HardwareVertex);
+
+        u8* vbo;
+        GLintptr offset;
+        std::tie(vbo, offset, std::ignore) =
+            vertex_buffer.Map(vertex_size, sizeof(HardwareVertex));
+        std::memcpy(vbo, vertex_batch.data() + base_vertex, vertex_size);
+        vertex_buffer.Unmap(vertex_size);
+
+        glDrawArrays(GL_TRIANGLES, static_cast<GLint>(offset / sizeof(HardwareVertex)),
+                     static_cast<GLsizei>(vertices));
+    }
 
     // Mark framebuffer surfaces as dirty
     // TODO: Restrict invalidation area to the viewport
@@ -374,6 +369,10 @@ void RasterizerOpenGL::DrawTriangles() {
         depth_surface->dirty = true;
         res_cache.FlushRegion(depth_surface->addr, depth_surface->size, depth_surface, true);
     }
+    if (color_surface != nullptr && depth_surface != nullptr) {
+        // Either invalidation may have destroyed the other attachment if the two overlap
+        InvalidateFramebufferAttachments();
+    }
 
     vertex_batch.clear();
 
@@ -851,22 +850,39 @@ void RasterizerOpenGL::NotifyPicaRegisterChanged(u32 id) {
     }
 }
 
+void RasterizerOpenGL::InvalidateFramebufferAttachments() {
+    // Texture names of destroyed surfaces may be reused by new ones, so comparing handles is not
+    // enough to tell whether the attachments are still current
+    framebuffer_attachments.dirty = true;
+}
+
+void RasterizerOpenGL::NotifyCommandListEnd() {
+    // The textures of the queued draws are only loaded when they are drawn, and the CPU may write
+    // to them without notifying the rasterizer once the command list is done
+    FlushBatch();
+}
+
 void RasterizerOpenGL::FlushAll() {
+    FlushBatch();
     MICROPROFILE_SCOPE(OpenGL_CacheManagement);
     res_cache.FlushAll();
 }
 
 void RasterizerOpenGL::FlushRegion(PAddr addr, u32 size) {
+    FlushBatch();
     MICROPROFILE_SCOPE(OpenGL_CacheManagement);
     res_cache.FlushRegion(addr, size, nullptr, false);
 }
 
 void RasterizerOpenGL::FlushAndInvalidateRegion(PAddr addr, u32 size) {
+    FlushBatch();
     MICROPROFILE_SCOPE(OpenGL_CacheManagement);
     res_cache.FlushRegion(addr, size, nullptr, true);
+    InvalidateFramebufferAttachments();
 }
 
 bool RasterizerOpenGL::AccelerateDisplayTransfer(const GPU::Regs::DisplayTransferConfig& config) {
+    FlushBatch();
     MICROPROFILE_SCOPE(OpenGL_Blits);
 
     CachedSurface src_params;
@@ -930,6 +946,7 @@ bool RasterizerOpenGL::AccelerateDisplayTransfer(const GPU::Regs::DisplayTransfe
                    CachedSurface::GetFormatBpp(dst_params.pixel_format) / 8;
     dst_surface->dirty = true;
     res_cache.FlushRegion(config.GetPhysicalOutputAddress(), dst_size, dst_surface, true);
+    InvalidateFramebufferAttachments();
     return true;
 }
 
@@ -939,6 +956,7 @@ bool RasterizerOpenGL::AccelerateTextureCopy(const GPU::Regs::DisplayTransferCon
 }
 
 bool RasterizerOpenGL::AccelerateFill(const GPU::Regs::MemoryFillConfig& config) {
+    FlushBatch();
     MICROPROFILE_SCOPE(OpenGL_Blits);
     using PixelFormat = CachedSurface::PixelFormat;
     using SurfaceType = CachedSurface::SurfaceType;
@@ -959,6 +977,9 @@ bool RasterizerOpenGL::AccelerateFill(const GPU::Regs::MemoryFillConfig& config)
     // Clear call isn't affected
     cur_state.Apply();
 
+    // The fill target replaces the attachments of the draw framebuffer
+    InvalidateFramebufferAttachments();
+
     if (dst_type == SurfaceType::Color || dst_type == SurfaceType::Texture) {
         glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
                                dst_surface->texture.handle, 0);
@@ -1088,6 +1109,7 @@ bool RasterizerOpenGL::AccelerateDisplay(const GPU::Regs::FramebufferConfig& con
     if (framebuffer_addr == 0) {
         return false;
     }
+    FlushBatch();
     MICROPROFILE_SCOPE(OpenGL_CacheManagement);
 
     CachedSurface src_params;
@@ -1166,6 +1188,30 @@ void RasterizerOpenGL::SetShader() {
 
     // Find (or generate) the GLSL shader for the current TEV state
     auto cached_shader = shader_cache.find(config);
+    if (cached_shader == shader_cache.end() && uber_shader.handle != 0) {
+        // Compile the specialized shader in the background and draw with the uber shader until the
+        // driver is done with it
+        auto pending_shader = pending_shaders.find(config);
+        if (pending_shader == pending_shaders.end()) {
+            LOG_DEBUG(Render_OpenGL, "Creating new shader in the background");
+            shader->shader.CreateAsync(GLShader::GenerateVertexShader().c_str(),
+                                       GLShader::GenerateFragmentShader(config).c_str());
+            pending_shader = pending_shaders.emplace(config, std::move(shader)).first;
+        }
+
+        if (!GLShader::IsProgramLinkComplete(pending_shader->second->shader.handle)) {
+            SetUberShader(config);
+            return;
+        }
+
+        shader = std::move(pending_shader->second);
+        pending_shaders.erase(pending_shader);
+        GLShader::CheckProgramLinkStatus(shader->shader.handle);
+        InitShaderProgram(shader->shader.handle);
+        AppendToDiskShaderCache(config, shader->shader.handle);
+        cached_shader = shader_cache.emplace(config, std::move(shader)).first;
+    }
+
     if (cached_shader != shader_cache.end()) {
         current_shader = cached_shader->second.get();
 
@@ -1176,76 +1222,13 @@ void RasterizerOpenGL::SetShader() {
 
         shader->shader.Create(GLShader::GenerateVertexShader().c_str(),
                               GLShader::GenerateFragmentShader(config).c_str());
-
-        state.draw.shader_program = shader->shader.handle;
-        state.Apply();
-
-        // Set the texture samplers to correspond to different texture units
-        GLint uniform_tex = glGetUniformLocation(shader->shader.handle, "tex[0]");
-        if (uniform_tex != -1) {
-            glUniform1i(uniform_tex, TextureUnits::PicaTexture(0).id);
-        }
-        uniform_tex = glGetUniformLocation(shader->shader.handle, "tex[1]");
-        if (uniform_tex != -1) {
-            glUniform1i(uniform_tex, TextureUnits::PicaTexture(1).id);
-        }
-        uniform_tex = glGetUniformLocation(shader->shader.handle, "tex[2]");
-        if (uniform_tex != -1) {
-            glUniform1i(uniform_tex, TextureUnits::PicaTexture(2).id);
-        }
-
-        // Set the texture samplers to correspond to different lookup table texture units
-        GLint uniform_lut = glGetUniformLocation(shader->shader.handle, "lighting_lut");
-        if (uniform_lut != -1) {
-            glUniform1i(uniform_lut, TextureUnits::LightingLUT.id);
-        }
-
-        GLint uniform_fog_lut = glGetUniformLocation(shader->shader.handle, "fog_lut");
-        if (uniform_fog_lut != -1) {
-            glUniform1i(uniform_fog_lut, TextureUnits::FogLUT.id);
-        }
-
-        GLint uniform_proctex_noise_lut =
-            glGetUniformLocation(shader->shader.handle, "proctex_noise_lut");
-        if (uniform_proctex_noise_lut != -1) {
-            glUniform1i(uniform_proctex_noise_lut, TextureUnits::ProcTexNoiseLUT.id);
-        }
-
-        GLint uniform_proctex_color_map =
-            glGetUniformLocation(shader->shader.handle, "proctex_color_map");
-        if (uniform_proctex_color_map != -1) {
-            glUniform1i(uniform_proctex_color_map, TextureUnits::ProcTexColorMap.id);
-        }
-
-        GLint uniform_proctex_alpha_map =
-            glGetUniformLocation(shader->shader.handle, "proctex_alpha_map");
-        if (uniform_proctex_alpha_map != -1) {
-            glUniform1i(uniform_proctex_alpha_map, TextureUnits::ProcTexAlphaMap.id);
-        }
-
-        GLint uniform_proctex_lut = glGetUniformLocation(shader->shader.handle, "proctex_lut");
-        if (uniform_proctex_lut != -1) {
-            glUniform1i(uniform_proctex_lut, TextureUnits::ProcTexLUT.id);
-        }
-
-        GLint uniform_proctex_diff_lut =
-            glGetUniformLocation(shader->shader.handle, "proctex_diff_lut");
-        if (uniform_proctex_diff_lut != -1) {
-            glUniform1i(uniform_proctex_diff_lut, TextureUnits::ProcTexDiffLUT.id);
-        }
+        InitShaderProgram(shader->shader.handle);
+        AppendToDiskShaderCache(config, shader->shader.handle);
 
         current_shader = shader_cache.emplace(config, std::move(shader)).first->second.get();
 
         GLuint block_index = glGetUniformBlockIndex(current_shader->shader.handle, "shader_data");
         if (block_index != GL_INVALID_INDEX) {
-            GLint block_size;
-            glGetActiveUniformBlockiv(current_shader->shader.handle, block_index,
-                                      GL_UNIFORM_BLOCK_DATA_SIZE, &block_size);
-            ASSERT_MSG(block_size == sizeof(UniformData),
-                       "Uniform block size did not match! Got %d, expected %zu",
-                       static_cast<int>(block_size), sizeof(UniformData));
-            glUniformBlockBinding(current_shader->shader.handle, block_index, 0);
-
             // Update uniforms
             SyncDepthScale();
             SyncDepthOffset();
@@ -1272,6 +1255,116 @@ void RasterizerOpenGL::SetShader() {
     }
 }
 
+void RasterizerOpenGL::InitShaderProgram(GLuint program) {
+    state.draw.shader_program = program;
+    state.Apply();
+
+    // Set the texture samplers to correspond to different texture units
+    GLint uniform_tex = glGetUniformLocation(program, "tex[0]");
+    if (uniform_tex != -1) {
+        glUniform1i(uniform_tex, TextureUnits::PicaTexture(0).id);
+    }
+    uniform_tex = glGetUniformLocation(program, "tex[1]");
+    if (uniform_tex != -1) {
+        glUniform1i(uniform_tex, TextureUnits::PicaTexture(1).id);
+    }
+    uniform_tex = glGetUniformLocation(program, "tex[2]");
+    if (uniform_tex != -1) {
+        glUniform1i(uniform_tex, TextureUnits::PicaTexture(2).id);
+    }
+
+    // Set the texture samplers to correspond to the lookup table texture buffer units
+    GLint uniform_lut_rg = glGetUniformLocation(program, "texture_buffer_lut_rg");
+    if (uniform_lut_rg != -1) {
+        glUniform1i(uniform_lut_rg, TextureUnits::TextureBufferLUT_RG.id);
+    }
+
+    GLint uniform_lut_rgba = glGetUniformLocation(program, "texture_buffer_lut_rgba");
+    if (uniform_lut_rgba != -1) {
+        glUniform1i(uniform_lut_rgba, TextureUnits::TextureBufferLUT_RGBA.id);
+    }
+
+    GLuint block_index = glGetUniformBlockIndex(program, "shader_data");
+    if (block_index != GL_INVALID_INDEX) {
+        GLint block_size;
+        glGetActiveUniformBlockiv(program, block_index, GL_UNIFORM_BLOCK_DATA_SIZE, &block_size);
+        ASSERT_MSG(block_size == sizeof(UniformData),
+                   "Uniform block size did not match! Got %d, expected %zu",
+                   static_cast<int>(block_size), sizeof(UniformData));
+        glUniformBlockBinding(program, block_index, 0);
+    }
+}
+
+void RasterizerOpenGL::SetUberShader(const GLShader::PicaShaderConfig& config) {
+    current_shader = nullptr;
+
+    state.draw.shader_program = uber_shader.handle;
+    state.Apply();
+
+    if (uber_shader_config && *uber_shader_config == config) {
+        return;
+    }
+
+    uber_shader_config = config;
+    const auto uber_config = GLShader::UberShaderConfig::BuildFromConfig(config);
+    glUniform4iv(uber_config_location, static_cast<GLsizei>(uber_config.ints.size()),
+                 uber_config.ints[0].data());
+    glUniform4fv(uber_config_float_location, static_cast<GLsizei>(uber_config.floats.size()),
+                 uber_config.floats[0].data());
+}
+
+void RasterizerOpenGL::AppendToDiskShaderCache(const GLShader::PicaShaderConfig& config,
+                                               GLuint program) {
+    if (!disk_shader_cache) {
+        return;
+    }
+
+    GLShader::ShaderDiskCache::Entry entry{config};
+    if (GLShader::GetProgramBinary(program, entry.binary_format, entry.binary)) {
+        disk_shader_cache->Append(entry);
+    }
+}
+
+void RasterizerOpenGL::LoadDiskShaderCache() {
+    std::vector<GLShader::ShaderDiskCache::Entry> entries = disk_shader_cache->Load();
+    if (entries.empty()) {
+        return;
+    }
+
+    // Programs whose binary is missing or was rejected by the driver are compiled from source, in
+    // which case the cache file is rewritten with the binaries of the current driver
+    bool rebuilt = false;
+    for (auto& entry : entries) {
+        if (shader_cache.count(entry.config) != 0) {
+            continue;
+        }
+
+        std::unique_ptr<PicaShader> shader = std::make_unique<PicaShader>();
+        if (entry.binary.empty() ||
+            !shader->shader.CreateFromBinary(entry.binary_format, entry.binary)) {
+            shader->shader.Create(GLShader::GenerateVertexShader().c_str(),
+                                  GLShader::GenerateFragmentShader(entry.config).c_str());
+            if (!GLShader::GetProgramBinary(shader->shader.handle, entry.binary_format,
+                                            entry.binary)) {
+                entry.binary.clear();
+            }
+            rebuilt = true;
+        }
+
+        InitShaderProgram(shader->shader.handle);
+        shader_cache.emplace(entry.config, std::move(shader));
+    }
+
+    state.draw.shader_program = 0;
+    state.Apply();
+
+    if (rebuilt) {
+        disk_shader_cache->Save(entries);
+    }
+
+    LOG_INFO(Render_OpenGL, "Precompiled %zu shader programs", shader_cache.size());
+}
+
 void RasterizerOpenGL::SyncCullMode() {
     const auto& regs = Pica::g_state.regs;
 
@@ -1353,21 +1446,6 @@ void RasterizerOpenGL::SyncFogColor() {
     uniform_block_data.dirty = true;
 }
 
-void RasterizerOpenGL::SyncFogLUT() {
-    std::array<GLvec2, 128> new_data;
-
-    std::transform(Pica::g_state.fog.lut.begin(), Pica::g_state.fog.lut.end(), new_data.begin(),
-                   [](const auto& entry) {
-                       return GLvec2{entry.ToFloat(), entry.DiffToFloat()};
-                   });
-
-    if (new_data != fog_lut_data) {
-        fog_lut_data = new_data;
-        glBindBuffer(GL_TEXTURE_BUFFER, fog_lut_buffer.handle);
-        glBufferSubData(GL_TEXTURE_BUFFER, 0, new_data.size() * sizeof(GLvec2), new_data.data());
-    }
-}
-
 void RasterizerOpenGL::SyncProcTexNoise() {
     const auto& regs = Pica::g_state.regs.texturing;
     uniform_block_data.data.proctex_noise_f = {
@@ -1385,70 +1463,6 @@ void RasterizerOpenGL::SyncProcTexNoise() {
     uniform_block_data.dirty = true;
 }
 
-// helper function for SyncProcTexNoiseLUT/ColorMap/AlphaMap
-static void SyncProcTexValueLUT(const std::array<Pica::State::ProcTex::ValueEntry, 128>& lut,
-                                std::array<GLvec2, 128>& lut_data, GLenum texture) {
-    std::array<GLvec2, 128> new_data;
-    std::transform(lut.begin(), lut.end(), new_data.begin(), [](const auto& entry) {
-        return GLvec2{entry.ToFloat(), entry.DiffToFloat()};
-    });
-
-    if (new_data != lut_data) {
-        lut_data = new_data;
-        glActiveTexture(texture);
-        glTexSubImage1D(GL_TEXTURE_1D, 0, 0, 128, GL_RG, GL_FLOAT, lut_data.data());
-    }
-}
-
-void RasterizerOpenGL::SyncProcTexNoiseLUT() {
-    SyncProcTexValueLUT(Pica::g_state.proctex.noise_table, proctex_noise_lut_data,
-                        TextureUnits::ProcTexNoiseLUT.Enum());
-}
-
-void RasterizerOpenGL::SyncProcTexColorMap() {
-    SyncProcTexValueLUT(Pica::g_state.proctex.color_map_table, proctex_color_map_data,
-                        TextureUnits::ProcTexColorMap.Enum());
-}
-
-void RasterizerOpenGL::SyncProcTexAlphaMap() {
-    SyncProcTexValueLUT(Pica::g_state.proctex.alpha_map_table, proctex_alpha_map_data,
-                        TextureUnits::ProcTexAlphaMap.Enum());
-}
-
-void RasterizerOpenGL::SyncProcTexLUT() {
-    std::array<GLvec4, 256> new_data;
-
-    std::transform(Pica::g_state.proctex.color_table.begin(),
-                   Pica::g_state.proctex.color_table.end(), new_data.begin(),
-                   [](const auto& entry) {
-                       auto rgba = entry.ToVector() / 255.0f;
-                       return GLvec4{rgba.r(), rgba.g(), rgba.b(), rgba.a()};
-                   });
-
-    if (new_data != proctex_lut_data) {
-        proctex_lut_data = new_data;
-        glActiveTexture(TextureUnits::ProcTexLUT.Enum());
-        glTexSubImage1D(GL_TEXTURE_1D, 0, 0, 256, GL_RGBA, GL_FLOAT, proctex_lut_data.data());
-    }
-}
-
-void RasterizerOpenGL::SyncProcTexDiffLUT() {
-    std::array<GLvec4, 256> new_data;
-
-    std::transform(Pica::g_state.proctex.color_diff_table.begin(),
-                   Pica::g_state.proctex.color_diff_table.end(), new_data.begin(),
-                   [](const auto& entry) {
-                       auto rgba = entry.ToVector() / 255.0f;
-                       return GLvec4{rgba.r(), rgba.g(), rgba.b(), rgba.a()};
-                   });
-
-    if (new_data != proctex_diff_lut_data) {
-        proctex_diff_lut_data = new_data;
-        glActiveTexture(TextureUnits::ProcTexDiffLUT.Enum());
-        glTexSubImage1D(GL_TEXTURE_1D, 0, 0, 256, GL_RGBA, GL_FLOAT, proctex_diff_lut_data.data());
-    }
-}
-
 void RasterizerOpenGL::SyncAlphaTest() {
     const auto& regs = Pica::g_state.regs;
     if (regs.framebuffer.output_merger.alpha_test.ref != uniform_block_data.data.alphatest_ref) {
@@ -1546,21 +1560,6 @@ void RasterizerOpenGL::SyncGlobalAmbient() {
     }
 }
 
-void RasterizerOpenGL::SyncLightingLUT(unsigned lut_index) {
-    std::array<GLvec2, 256> new_data;
-    const auto& source_lut = Pica::g_state.lighting.luts[lut_index];
-    std::transform(source_lut.begin(), source_lut.end(), new_data.begin(), [](const auto& entry) {
-        return GLvec2{entry.ToFloat(), entry.DiffToFloat()};
-    });
-
-    if (new_data != lighting_lut_data[lut_index]) {
-        lighting_lut_data[lut_index] = new_data;
-        glBindBuffer(GL_TEXTURE_BUFFER, lighting_lut_buffer.handle);
-        glBufferSubData(GL_TEXTURE_BUFFER, lut_index * new_data.size() * sizeof(GLvec2),
-                        new_data.size() * sizeof(GLvec2), new_data.data());
-    }
-}
-
 void RasterizerOpenGL::SyncLightSpecular0(int light_index) {
     auto color = PicaToGL::LightColor(Pica::g_state.regs.lighting.light[light_index].specular_0);
     if (color != uniform_block_data.data.light_src[light_index].specular_0) {
@@ -1637,3 +1636,152 @@ void RasterizerOpenGL::SyncLightDistanceAttenuationScale(int light_index) {
         uniform_block_data.dirty = true;
     }
 }
+
+void RasterizerOpenGL::SyncAndUploadLUTs() {
+    constexpr size_t max_size = sizeof(GLvec2) * 256 * Pica::LightingRegs::NumLightingSampler +
+                                sizeof(GLvec2) * 128 + // fog
+                                sizeof(GLvec2) * 128 * 3 + // proctex: noise + color + alpha
+                                sizeof(GLvec4) * 256 * 2;  // proctex: color + difference
+
+    if (!std::any_of(uniform_block_data.lut_dirty.begin(), uniform_block_data.lut_dirty.end(),
+                     [](bool dirty) { return dirty; }) &&
+        !uniform_block_data.fog_lut_dirty && !uniform_block_data.proctex_noise_lut_dirty &&
+        !uniform_block_data.proctex_color_map_dirty &&
+        !uniform_block_data.proctex_alpha_map_dirty && !uniform_block_data.proctex_lut_dirty &&
+        !uniform_block_data.proctex_diff_lut_dirty) {
+        return;
+    }
+
+    u8* buffer;
+    GLintptr offset;
+    bool invalidate;
+    size_t bytes_used = 0;
+    glBindBuffer(GL_TEXTURE_BUFFER, texture_buffer.GetHandle());
+    std::tie(buffer, offset, invalidate) = texture_buffer.Map(max_size, sizeof(GLvec4));
+
+    // If the buffer was invalidated, every table has to be uploaded again, as the data of the
+    // previous allocations is gone.
+    if (invalidate) {
+        uniform_block_data.lut_dirty.fill(true);
+        uniform_block_data.fog_lut_dirty = true;
+        uniform_block_data.proctex_noise_lut_dirty = true;
+        uniform_block_data.proctex_color_map_dirty = true;
+        uniform_block_data.proctex_alpha_map_dirty = true;
+        uniform_block_data.proctex_lut_dirty = true;
+        uniform_block_data.proctex_diff_lut_dirty = true;
+    }
+
+    // Copies a converted table into the mapped region if it has changed, and returns its offset in
+    // the buffer in units of texels
+    auto upload = [&](auto& cached_data, const auto& new_data, GLint& texel_offset) {
+        using Texel = typename std::decay_t<decltype(new_data)>::value_type;
+        if (new_data != cached_data || invalidate) {
+            cached_data = new_data;
+            std::memcpy(buffer + bytes_used, new_data.data(), new_data.size() * sizeof(Texel));
+            texel_offset = static_cast<GLint>((offset + bytes_used) / sizeof(Texel));
+            uniform_block_data.dirty = true;
+            bytes_used += new_data.size() * sizeof(Texel);
+        }
+    };
+
+    // Sync the lighting luts
+    for (unsigned index = 0; index < uniform_block_data.lut_dirty.size(); index++) {
+        if (uniform_block_data.lut_dirty[index]) {
+            std::array<GLvec2, 256> new_data;
+            const auto& source_lut = Pica::g_state.lighting.luts[index];
+            std::transform(source_lut.begin(), source_lut.end(), new_data.begin(),
+                           [](const auto& entry) {
+                               return GLvec2{entry.ToFloat(), entry.DiffToFloat()};
+                           });
+            upload(lighting_lut_data[index], new_data,
+                   uniform_block_data.data.lighting_lut_offset[index / 4][index % 4]);
+            uniform_block_data.lut_dirty[index] = false;
+        }
+    }
+
+    // Sync the fog lut
+    if (uniform_block_data.fog_lut_dirty) {
+        std::array<GLvec2, 128> new_data;
+        std::transform(Pica::g_state.fog.lut.begin(), Pica::g_state.fog.lut.end(),
+                       new_data.begin(), [](const auto& entry) {
+                           return GLvec2{entry.ToFloat(), entry.DiffToFloat()};
+                       });
+        upload(fog_lut_data, new_data, uniform_block_data.data.fog_lut_offset);
+        uniform_block_data.fog_lut_dirty = false;
+    }
+
+    // helper function for the proctex noise lut, color map and alpha map
+    auto sync_proctex_value_lut =
+        [&](const std::array<Pica::State::ProcTex::ValueEntry, 128>& lut,
+            std::array<GLvec2, 128>& lut_data, GLint& lut_offset) {
+            std::array<GLvec2, 128> new_data;
+            std::transform(lut.begin(), lut.end(), new_data.begin(), [](const auto& entry) {
+                return GLvec2{entry.ToFloat(), entry.DiffToFloat()};
+            });
+            upload(lut_data, new_data, lut_offset);
+        };
+
+    // Sync the proctex noise lut
+    if (uniform_block_data.proctex_noise_lut_dirty) {
+        sync_proctex_value_lut(Pica::g_state.proctex.noise_table, proctex_noise_lut_data,
+                               uniform_block_data.data.proctex_noise_lut_offset);
+        uniform_block_data.proctex_noise_lut_dirty = false;
+    }
+
+    // Sync the proctex color map
+    if (uniform_block_data.proctex_color_map_dirty) {
+        sync_proctex_value_lut(Pica::g_state.proctex.color_map_table, proctex_color_map_data,
+                               uniform_block_data.data.proctex_color_map_offset);
+        uniform_block_data.proctex_color_map_dirty = false;
+    }
+
+    // Sync the proctex alpha map
+    if (uniform_block_data.proctex_alpha_map_dirty) {
+        sync_proctex_value_lut(Pica::g_state.proctex.alpha_map_table, proctex_alpha_map_data,
+                               uniform_block_data.data.proctex_alpha_map_offset);
+        uniform_block_data.proctex_alpha_map_dirty = false;
+    }
+
+    // helper function for the proctex color and color difference luts
+    auto sync_proctex_color_lut =
+        [&](const auto& lut, std::array<GLvec4, 256>& lut_data, GLint& lut_offset) {
+            std::array<GLvec4, 256> new_data;
+            std::transform(lut.begin(), lut.end(), new_data.begin(), [](const auto& entry) {
+                auto rgba = entry.ToVector() / 255.0f;
+                return GLvec4{rgba.r(), rgba.g(), rgba.b(), rgba.a()};
+            });
+            upload(lut_data, new_data, lut_offset);
+        };
+
+    // Sync the proctex lut
+    if (uniform_block_data.proctex_lut_dirty) {
+        sync_proctex_color_lut(Pica::g_state.proctex.color_table, proctex_lut_data,
+                               uniform_block_data.data.proctex_lut_offset);
+        uniform_block_data.proctex_lut_dirty = false;
+    }
+
+    // Sync the proctex difference lut
+    if (uniform_block_data.proctex_diff_lut_dirty) {
+        sync_proctex_color_lut(Pica::g_state.proctex.color_diff_table, proctex_diff_lut_data,
+                               uniform_block_data.data.proctex_diff_lut_offset);
+        uniform_block_data.proctex_diff_lut_dirty = false;
+    }
+
+    texture_buffer.Unmap(bytes_used);
+}
+
+void RasterizerOpenGL::UploadUniforms() {
+    if (!uniform_block_data.dirty)
+        return;
+
+    u8* uniforms;
+    GLintptr offset;
+    std::tie(uniforms, offset, std::ignore) =
+        uniform_buffer.Map(sizeof(UniformData), uniform_buffer_alignment);
+    std::memcpy(uniforms, &uniform_block_data.data, sizeof(UniformData));
+    uniform_buffer.Unmap(sizeof(UniformData));
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, 0, uniform_buffer.GetHandle(), offset,
+                      sizeof(UniformData));
+    uniform_block_data.dirty = false;
+}
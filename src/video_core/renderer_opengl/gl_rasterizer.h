@@ -10,6 +10,7 @@
 #include <memory>
 #include <unordered_map>
 #include <vector>
+#include <boost/optional.hpp>
 #include <glad/glad.h>
 #include "common/bit_field.h"
 #include "common/common_types.h"
@@ -25,8 +26,10 @@
 #include "video_core/regs_texturing.h"
 #include "video_core/renderer_opengl/gl_rasterizer_cache.h"
 #include "video_core/renderer_opengl/gl_resource_manager.h"
+#include "video_core/renderer_opengl/gl_shader_disk_cache.h"
 #include "video_core/renderer_opengl/gl_shader_gen.h"
 #include "video_core/renderer_opengl/gl_state.h"
+#include "video_core/renderer_opengl/gl_stream_buffer.h"
 #include "video_core/renderer_opengl/pica_to_gl.h"
 #include "video_core/shader/shader.h"
 
@@ -40,7 +43,9 @@ public:
     void AddTriangle(const Pica::Shader::OutputVertex& v0, const Pica::Shader::OutputVertex& v1,
                      const Pica::Shader::OutputVertex& v2) override;
     void DrawTriangles() override;
+    void NotifyPicaRegisterWrite(u32 id, u32 old_value, u32 new_value) override;
     void NotifyPicaRegisterChanged(u32 id) override;
+    void NotifyCommandListEnd() override;
     void FlushAll() override;
     void FlushRegion(PAddr addr, u32 size) override;
     void FlushAndInvalidateRegion(PAddr addr, u32 size) override;
@@ -143,18 +148,25 @@ private:
         GLint scissor_y1;
         GLint scissor_x2;
         GLint scissor_y2;
+        GLint fog_lut_offset;
+        GLint proctex_noise_lut_offset;
+        GLint proctex_color_map_offset;
+        GLint proctex_alpha_map_offset;
+        GLint proctex_lut_offset;
+        GLint proctex_diff_lut_offset;
         alignas(16) GLvec3 fog_color;
         alignas(8) GLvec2 proctex_noise_f;
         alignas(8) GLvec2 proctex_noise_a;
         alignas(8) GLvec2 proctex_noise_p;
         alignas(16) GLvec3 lighting_global_ambient;
+        alignas(16) GLivec4 lighting_lut_offset[Pica::LightingRegs::NumLightingSampler / 4];
         LightSrc light_src[8];
         alignas(16) GLvec4 const_color[6]; // A vec4 color for each of the six tev stages
         alignas(16) GLvec4 tev_combiner_buffer_color;
     };
 
     static_assert(
-        sizeof(UniformData) == 0x460,
+        sizeof(UniformData) == 0x4D0,
         "The size of the UniformData structure has changed, update the structure in the shader");
     static_assert(sizeof(UniformData) < 16384,
                   "UniformData structure must be less than 16kb as per the OpenGL spec");
@@ -162,6 +174,18 @@ private:
     /// Sets the OpenGL shader in accordance with the current PICA register state
     void SetShader();
 
+    /// Binds the texture units and uniform block of a newly created shader program
+    void InitShaderProgram(GLuint program);
+
+    /// Creates the shader programs recorded in the disk shader cache of the running title
+    void LoadDiskShaderCache();
+
+    /// Binds the uber shader and configures it to emulate the given shader configuration
+    void SetUberShader(const GLShader::PicaShaderConfig& config);
+
+    /// Stores the program binary of a newly created shader in the disk shader cache
+    void AppendToDiskShaderCache(const GLShader::PicaShaderConfig& config, GLuint program);
+
     /// Syncs the cull mode to match the PICA register
     void SyncCullMode();
 
@@ -182,18 +206,10 @@ private:
 
     /// Syncs the fog states to match the PICA register
     void SyncFogColor();
-    void SyncFogLUT();
 
     /// Sync the procedural texture noise configuration to match the PICA register
     void SyncProcTexNoise();
 
-    /// Sync the procedural texture lookup tables
-    void SyncProcTexNoiseLUT();
-    void SyncProcTexColorMap();
-    void SyncProcTexAlphaMap();
-    void SyncProcTexLUT();
-    void SyncProcTexDiffLUT();
-
     /// Syncs the alpha test states to match the PICA register
     void SyncAlphaTest();
 
@@ -224,9 +240,6 @@ private:
     /// Syncs the lighting global ambient color to match the PICA register
     void SyncGlobalAmbient();
 
-    /// Syncs the lighting lookup tables
-    void SyncLightingLUT(unsigned index);
-
     /// Syncs the specified light's specular 0 color to match the PICA register
     void SyncLightSpecular0(int light_index);
 
@@ -251,16 +264,39 @@ private:
     /// Syncs the specified light's distance attenuation scale to match the PICA register
     void SyncLightDistanceAttenuationScale(int light_index);
 
+    /// Uploads the dirty lighting, fog and proctex lookup tables to the texture buffer
+    void SyncAndUploadLUTs();
+
+    /// Uploads the uniform block data if it has changed
+    void UploadUniforms();
+
+    /// Draws the triangles of all queued Pica draws with a single batch of GL draw calls
+    void FlushBatch();
+
+    /// Forces the framebuffer attachments to be re-bound, e.g. after surfaces were destroyed
+    void InvalidateFramebufferAttachments();
+
     OpenGLState state;
 
     RasterizerCacheOpenGL res_cache;
 
     std::vector<HardwareVertex> vertex_batch;
+    /// Number of Pica draws whose triangles are queued in vertex_batch
+    u32 pending_draws = 0;
 
     std::unordered_map<GLShader::PicaShaderConfig, std::unique_ptr<PicaShader>> shader_cache;
     const PicaShader* current_shader = nullptr;
     bool shader_dirty;
 
+    std::unique_ptr<GLShader::ShaderDiskCache> disk_shader_cache;
+
+    /// Specialized shaders still being compiled by the driver, drawn with the uber shader meanwhile
+    std::unordered_map<GLShader::PicaShaderConfig, std::unique_ptr<PicaShader>> pending_shaders;
+    OGLShader uber_shader;
+    GLint uber_config_location = -1;
+    GLint uber_config_float_location = -1;
+    boost::optional<GLShader::PicaShaderConfig> uber_shader_config;
+
     struct {
         UniformData data;
         std::array<bool, Pica::LightingRegs::NumLightingSampler> lut_dirty;
@@ -275,30 +311,34 @@ private:
 
     std::array<SamplerInfo, 3> texture_samplers;
     OGLVertexArray vertex_array;
-    OGLBuffer vertex_buffer;
-    OGLBuffer uniform_buffer;
+    static constexpr size_t VERTEX_BUFFER_SIZE = 16 * 1024 * 1024;
+    OGLStreamBuffer vertex_buffer;
+    static constexpr size_t UNIFORM_BUFFER_SIZE = 2 * 1024 * 1024;
+    OGLStreamBuffer uniform_buffer;
+    GLint uniform_buffer_alignment;
     OGLFramebuffer framebuffer;
 
-    OGLBuffer lighting_lut_buffer;
-    OGLTexture lighting_lut;
-    std::array<std::array<GLvec2, 256>, Pica::LightingRegs::NumLightingSampler> lighting_lut_data{};
+    /// Textures currently attached to the draw framebuffer
+    struct {
+        GLuint color = 0;
+        GLuint depth = 0;
+        GLuint stencil = 0;
+        bool dirty = true;
+    } framebuffer_attachments;
+
+    // The lookup tables of all the units share a single stream buffer, which is viewed by the
+    // fragment shader through one RG32F and one RGBA32F buffer texture. The offsets of the tables
+    // in the buffer (in texels) are passed through the uniform block.
+    static constexpr size_t TEXTURE_BUFFER_SIZE = 512 * 1024;
+    OGLStreamBuffer texture_buffer;
+    OGLTexture texture_buffer_lut_rg;
+    OGLTexture texture_buffer_lut_rgba;
 
-    OGLBuffer fog_lut_buffer;
-    OGLTexture fog_lut;
+    std::array<std::array<GLvec2, 256>, Pica::LightingRegs::NumLightingSampler> lighting_lut_data{};
     std::array<GLvec2, 128> fog_lut_data{};
-
-    OGLTexture proctex_noise_lut;
     std::array<GLvec2, 128> proctex_noise_lut_data{};
-
-    OGLTexture proctex_color_map;
     std::array<GLvec2, 128> proctex_color_map_data{};
-
-    OGLTexture proctex_alpha_map;
     std::array<GLvec2, 128> proctex_alpha_map_data{};
-
-    OGLTexture proctex_lut;
     std::array<GLvec4, 256> proctex_lut_data{};
-
-    OGLTexture proctex_diff_lut;
     std::array<GLvec4, 256> proctex_diff_lut_data{};
 };
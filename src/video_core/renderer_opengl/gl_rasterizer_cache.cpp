@@ -6,6 +6,7 @@
 #include <atomic>
 #include <cstring>
 #include <iterator>
+#include <memory>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -49,6 +50,10 @@ static const std::array<FormatTuple, 4> depth_format_tuples = {{
 RasterizerCacheOpenGL::RasterizerCacheOpenGL() {
     transfer_framebuffers[0].Create();
     transfer_framebuffers[1].Create();
+
+    if (Settings::values.use_gpu_texture_decode) {
+        texture_decoder = std::make_unique<TextureDecoderOpenGL>();
+    }
 }
 
 RasterizerCacheOpenGL::~RasterizerCacheOpenGL() {
@@ -338,24 +343,36 @@ CachedSurface* RasterizerCacheOpenGL::GetSurface(const CachedSurface& params, bo
                     tuple = {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE};
                 }
 
-                std::vector<Math::Vec4<u8>> tex_buffer(params.width * params.height);
-
-                Pica::Texture::TextureInfo tex_info;
-                tex_info.width = params.width;
-                tex_info.height = params.height;
-                tex_info.format = (Pica::TexturingRegs::TextureFormat)params.pixel_format;
-                tex_info.SetDefaultStride();
-                tex_info.physical_address = params.addr;
+                // Decode on the GPU where possible, otherwise fall back to decoding on the CPU
+                bool decoded = false;
+                if (texture_decoder != nullptr) {
+                    glTexImage2D(GL_TEXTURE_2D, 0, tuple.internal_format, params.width,
+                                 params.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                    decoded = texture_decoder->Decode(
+                        texture_src_data, (Pica::TexturingRegs::TextureFormat)params.pixel_format,
+                        params.width, params.height, new_surface->texture.handle);
+                }
 
-                for (unsigned y = 0; y < params.height; ++y) {
-                    for (unsigned x = 0; x < params.width; ++x) {
-                        tex_buffer[x + params.width * y] = Pica::Texture::LookupTexture(
-                            texture_src_data, x, params.height - 1 - y, tex_info);
+                if (!decoded) {
+                    std::vector<Math::Vec4<u8>> tex_buffer(params.width * params.height);
+
+                    Pica::Texture::TextureInfo tex_info;
+                    tex_info.width = params.width;
+                    tex_info.height = params.height;
+                    tex_info.format = (Pica::TexturingRegs::TextureFormat)params.pixel_format;
+                    tex_info.SetDefaultStride();
+                    tex_info.physical_address = params.addr;
+
+                    for (unsigned y = 0; y < params.height; ++y) {
+                        for (unsigned x = 0; x < params.width; ++x) {
+                            tex_buffer[x + params.width * y] = Pica::Texture::LookupTexture(
+                                texture_src_data, x, params.height - 1 - y, tex_info);
+                        }
                     }
-                }
 
-                glTexImage2D(GL_TEXTURE_2D, 0, tuple.internal_format, params.width, params.height,
-                             0, GL_RGBA, GL_UNSIGNED_BYTE, tex_buffer.data());
+                    glTexImage2D(GL_TEXTURE_2D, 0, tuple.internal_format, params.width,
+                                 params.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex_buffer.data());
+                }
             } else {
                 // Depth/Stencil formats need special treatment since they aren't sampleable using
                 // LookupTexture and can't use RGBA format
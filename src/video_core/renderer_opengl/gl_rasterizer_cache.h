@@ -24,6 +24,7 @@
 #include "video_core/regs_framebuffer.h"
 #include "video_core/regs_texturing.h"
 #include "video_core/renderer_opengl/gl_resource_manager.h"
+#include "video_core/renderer_opengl/gl_texture_decoder.h"
 
 namespace MathUtil {
 template <class T>
@@ -236,4 +237,5 @@ public:
 private:
     SurfaceCache surface_cache;
     OGLFramebuffer transfer_framebuffers[2];
+    std::unique_ptr<TextureDecoderOpenGL> texture_decoder;
 };
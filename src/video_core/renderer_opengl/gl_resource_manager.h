@@ -5,6 +5,7 @@
 #pragma once
 
 #include <utility>
+#include <vector>
 #include <glad/glad.h>
 #include "common/common_types.h"
 #include "video_core/renderer_opengl/gl_shader_util.h"
@@ -97,6 +98,24 @@ public:
         handle = GLShader::LoadProgram(vert_shader, frag_shader);
     }
 
+    /// Creates a new internal OpenGL resource whose compilation may still be in progress
+    void CreateAsync(const char* vert_shader, const char* frag_shader) {
+        if (handle != 0)
+            return;
+        handle = GLShader::LoadProgramAsync(vert_shader, frag_shader);
+    }
+
+    /**
+     * Creates a new internal OpenGL resource from a program binary and stores the handle
+     * @returns False if the driver rejected the binary, in which case no resource is created
+     */
+    bool CreateFromBinary(GLenum binary_format, const std::vector<u8>& binary) {
+        if (handle != 0)
+            return true;
+        handle = GLShader::LoadProgramBinary(binary_format, binary);
+        return handle != 0;
+    }
+
     /// Deletes the internal OpenGL resource
     void Release() {
         if (handle == 0)
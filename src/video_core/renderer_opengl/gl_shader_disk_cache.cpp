@@ -0,0 +1,189 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cinttypes>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "common/common_funcs.h"
+#include "common/common_paths.h"
+#include "common/file_util.h"
+#include "common/hash.h"
+#include "common/logging/log.h"
+#include "common/scm_rev.h"
+#include "common/string_util.h"
+#include "video_core/renderer_opengl/gl_shader_disk_cache.h"
+
+namespace GLShader {
+
+namespace {
+
+constexpr u32 MakeMagic(char a, char b, char c, char d) {
+    return a | b << 8 | c << 16 | d << 24;
+}
+
+constexpr u32 FILE_MAGIC = MakeMagic('C', 'S', 'D', 'C');
+constexpr u32 FILE_VERSION = 2;
+
+struct FileHeader {
+    u32 magic;
+    u32 version;
+    u32 config_size;
+    INSERT_PADDING_WORDS(1);
+    u64 build_hash;
+    u64 driver_hash;
+};
+static_assert(sizeof(FileHeader) == 0x20, "FileHeader has incorrect size");
+
+struct EntryHeader {
+    u32 binary_format;
+    u32 binary_size;
+};
+static_assert(sizeof(EntryHeader) == 0x8, "EntryHeader has incorrect size");
+
+/// Upper bound on the size of a single program binary, guarding against corrupted files
+constexpr u32 MAX_BINARY_SIZE = 16 * 1024 * 1024;
+
+/// Identifies the build which wrote the file, whose shader generators and uniform layouts the
+/// program binaries depend on
+u64 GetBuildHash() {
+    return Common::ComputeHash64(Common::g_scm_rev, std::strlen(Common::g_scm_rev));
+}
+
+u64 GetDriverHash() {
+    std::string driver;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const GLubyte* str = glGetString(name);
+        if (str != nullptr) {
+            driver += reinterpret_cast<const char*>(str);
+        }
+        driver += '\n';
+    }
+    return Common::ComputeHash64(driver.data(), driver.size());
+}
+
+bool WriteHeader(FileUtil::IOFile& file, u64 driver_hash) {
+    FileHeader header{};
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.config_size = sizeof(PicaShaderConfig::State);
+    header.build_hash = GetBuildHash();
+    header.driver_hash = driver_hash;
+    return file.WriteObject(header) == 1;
+}
+
+bool WriteEntry(FileUtil::IOFile& file, const ShaderDiskCache::Entry& entry) {
+    EntryHeader header{};
+    header.binary_format = entry.binary_format;
+    header.binary_size = static_cast<u32>(entry.binary.size());
+    return file.WriteBytes(&entry.config.state, sizeof(PicaShaderConfig::State)) ==
+               sizeof(PicaShaderConfig::State) &&
+           file.WriteObject(header) == 1 &&
+           file.WriteBytes(entry.binary.data(), entry.binary.size()) == entry.binary.size();
+}
+
+} // Anonymous namespace
+
+ShaderDiskCache::ShaderDiskCache(u64 program_id)
+    : path(FileUtil::GetUserPath(D_CACHE_IDX) + "shaders" DIR_SEP +
+           Common::StringFromFormat("%016" PRIX64 ".bin", program_id)),
+      driver_hash(GetDriverHash()) {}
+
+std::vector<ShaderDiskCache::Entry> ShaderDiskCache::Load() {
+    std::vector<Entry> entries;
+
+    FileUtil::IOFile file(path, "r+b");
+    if (!file.IsOpen()) {
+        return entries;
+    }
+
+    FileHeader header;
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) || header.magic != FILE_MAGIC ||
+        header.version != FILE_VERSION ||
+        header.config_size != sizeof(PicaShaderConfig::State) ||
+        header.build_hash != GetBuildHash()) {
+        LOG_INFO(Render_OpenGL, "Discarding outdated shader cache %s", path.c_str());
+        file.Close();
+        FileUtil::Delete(path);
+        return entries;
+    }
+
+    const bool keep_binaries = header.driver_hash == driver_hash;
+    if (!keep_binaries) {
+        LOG_INFO(Render_OpenGL, "Graphics driver changed, shader binaries will be rebuilt");
+    }
+
+    const u64 file_size = file.GetSize();
+    u64 valid_size = file.Tell();
+    while (valid_size < file_size) {
+        Entry entry;
+        EntryHeader entry_header;
+        std::memset(&entry.config, 0, sizeof(entry.config));
+        if (file.ReadBytes(&entry.config.state, sizeof(PicaShaderConfig::State)) !=
+                sizeof(PicaShaderConfig::State) ||
+            file.ReadBytes(&entry_header, sizeof(entry_header)) != sizeof(entry_header) ||
+            entry_header.binary_size > MAX_BINARY_SIZE) {
+            break;
+        }
+
+        entry.binary_format = entry_header.binary_format;
+        entry.binary.resize(entry_header.binary_size);
+        if (file.ReadBytes(entry.binary.data(), entry.binary.size()) != entry.binary.size()) {
+            break;
+        }
+
+        if (!keep_binaries) {
+            entry.binary.clear();
+        }
+
+        entries.push_back(std::move(entry));
+        valid_size = file.Tell();
+    }
+
+    // Drop a partially written trailing entry so that later appends stay readable
+    if (valid_size < file_size) {
+        LOG_WARNING(Render_OpenGL, "Shader cache %s is truncated", path.c_str());
+        file.Resize(valid_size);
+    }
+
+    LOG_INFO(Render_OpenGL, "Loaded %zu entries from shader cache %s", entries.size(),
+             path.c_str());
+    return entries;
+}
+
+void ShaderDiskCache::Save(const std::vector<Entry>& entries) {
+    if (!FileUtil::CreateFullPath(path)) {
+        LOG_ERROR(Render_OpenGL, "Failed to create directory for shader cache %s", path.c_str());
+        return;
+    }
+
+    FileUtil::IOFile file(path, "wb");
+    if (!file.IsOpen() || !WriteHeader(file, driver_hash)) {
+        LOG_ERROR(Render_OpenGL, "Failed to write shader cache %s", path.c_str());
+        return;
+    }
+
+    for (const Entry& entry : entries) {
+        if (!WriteEntry(file, entry)) {
+            LOG_ERROR(Render_OpenGL, "Failed to write shader cache %s", path.c_str());
+            return;
+        }
+    }
+}
+
+void ShaderDiskCache::Append(const Entry& entry) {
+    if (!FileUtil::CreateFullPath(path)) {
+        LOG_ERROR(Render_OpenGL, "Failed to create directory for shader cache %s", path.c_str());
+        return;
+    }
+
+    FileUtil::IOFile file(path, "ab");
+    if (!file.IsOpen() || (file.GetSize() == 0 && !WriteHeader(file, driver_hash)) ||
+        !WriteEntry(file, entry)) {
+        LOG_ERROR(Render_OpenGL, "Failed to write shader cache %s", path.c_str());
+    }
+}
+
+} // namespace GLShader
@@ -0,0 +1,50 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "common/common_types.h"
+#include "video_core/renderer_opengl/gl_shader_gen.h"
+
+namespace GLShader {
+
+/**
+ * Per-title on-disk store of the shader configurations a title has used, along with the program
+ * binaries the driver produced for them. The file is invalidated as a whole when its layout, the
+ * PicaShaderConfig layout or the build of Citra changes, as a new build may generate different
+ * shaders for the same configuration. When the driver changes, the configurations are still
+ * returned without binaries so that the programs can be recompiled from source ahead of time.
+ */
+class ShaderDiskCache {
+public:
+    struct Entry {
+        PicaShaderConfig config;
+        GLenum binary_format;
+        std::vector<u8> binary;
+    };
+
+    explicit ShaderDiskCache(u64 program_id);
+
+    /**
+     * Reads all entries stored in the cache file.
+     * @returns The stored entries, empty if the file does not exist or is invalid. Entries whose
+     *          binary was produced by another driver are returned with an empty binary.
+     */
+    std::vector<Entry> Load();
+
+    /// Replaces the contents of the cache file with the given entries
+    void Save(const std::vector<Entry>& entries);
+
+    /// Appends a single entry to the cache file
+    void Append(const Entry& entry);
+
+private:
+    std::string path;
+    u64 driver_hash;
+};
+
+} // namespace GLShader
@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <cstring>
@@ -143,6 +144,139 @@ PicaShaderConfig PicaShaderConfig::BuildFromRegs(const Pica::Regs& regs) {
     return res;
 }
 
+/// Declarations shared by the specialized and the uber fragment shaders
+constexpr char fragment_shader_header[] = R"(
+#version 330 core
+#define NUM_TEV_STAGES 6
+#define NUM_LIGHTS 8
+#define NUM_LIGHTING_SAMPLERS 24
+
+in vec4 primary_color;
+in vec2 texcoord[3];
+in float texcoord0_w;
+in vec4 normquat;
+in vec3 view;
+
+in vec4 gl_FragCoord;
+
+out vec4 color;
+
+struct LightSrc {
+    vec3 specular_0;
+    vec3 specular_1;
+    vec3 diffuse;
+    vec3 ambient;
+    vec3 position;
+    vec3 spot_direction;
+    float dist_atten_bias;
+    float dist_atten_scale;
+};
+
+layout (std140) uniform shader_data {
+    vec2 framebuffer_scale;
+    int alphatest_ref;
+    float depth_scale;
+    float depth_offset;
+    int scissor_x1;
+    int scissor_y1;
+    int scissor_x2;
+    int scissor_y2;
+    int fog_lut_offset;
+    int proctex_noise_lut_offset;
+    int proctex_color_map_offset;
+    int proctex_alpha_map_offset;
+    int proctex_lut_offset;
+    int proctex_diff_lut_offset;
+    vec3 fog_color;
+    vec2 proctex_noise_f;
+    vec2 proctex_noise_a;
+    vec2 proctex_noise_p;
+    vec3 lighting_global_ambient;
+    ivec4 lighting_lut_offset[NUM_LIGHTING_SAMPLERS / 4];
+    LightSrc light_src[NUM_LIGHTS];
+    vec4 const_color[NUM_TEV_STAGES];
+    vec4 tev_combiner_buffer_color;
+};
+
+uniform sampler2D tex[3];
+uniform samplerBuffer texture_buffer_lut_rg;
+uniform samplerBuffer texture_buffer_lut_rgba;
+
+// Rotate the vector v by the quaternion q
+vec3 quaternion_rotate(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+float LookupLightingLUT(int lut_index, int index, float delta) {
+    vec2 entry = texelFetch(texture_buffer_lut_rg,
+                            lighting_lut_offset[lut_index >> 2][lut_index & 3] + index).rg;
+    return entry.r + entry.g * delta;
+}
+
+float LookupLightingLUTUnsigned(int lut_index, float pos) {
+    int index = clamp(int(pos * 256.0), 0, 255);
+    float delta = pos * 256.0 - index;
+    return LookupLightingLUT(lut_index, index, delta);
+}
+
+float LookupLightingLUTSigned(int lut_index, float pos) {
+    int index = clamp(int(pos * 128.0), -128, 127);
+    float delta = pos * 128.0 - index;
+    if (index < 0) index += 256;
+    return LookupLightingLUT(lut_index, index, delta);
+}
+
+)";
+
+/// ProcTex LUT sampling utility, see AppendProcTexSampler
+constexpr char proctex_lut_lookup[] = R"(
+float ProcTexLookupLUT(int offset, float coord) {
+    coord *= 128;
+    float index_i = clamp(floor(coord), 0.0, 127.0);
+    float index_f = coord - index_i; // fract() cannot be used here because 128.0 needs to be
+                                     // extracted as index_i = 127.0 and index_f = 1.0
+    vec2 entry = texelFetch(texture_buffer_lut_rg, int(index_i) + offset).rg;
+    return clamp(entry.r + entry.g * index_f, 0.0, 1.0);
+}
+)";
+
+/// ProcTex noise utilities, see AppendProcTexSampler
+constexpr char proctex_noise_functions[] = R"(
+int ProcTexNoiseRand1D(int v) {
+    const int table[] = int[](0,4,10,8,4,9,7,12,5,15,13,14,11,15,2,11);
+    return ((v % 9 + 2) * 3 & 0xF) ^ table[(v / 9) & 0xF];
+}
+
+float ProcTexNoiseRand2D(vec2 point) {
+    const int table[] = int[](10,2,15,8,0,7,4,5,5,13,2,6,13,9,3,14);
+    int u2 = ProcTexNoiseRand1D(int(point.x));
+    int v2 = ProcTexNoiseRand1D(int(point.y));
+    v2 += ((u2 & 3) == 1) ? 4 : 0;
+    v2 ^= (u2 & 1) * 6;
+    v2 += 10 + u2;
+    v2 &= 0xF;
+    v2 ^= table[u2];
+    return -1.0 + float(v2) * 2.0/ 15.0;
+}
+
+float ProcTexNoiseCoef(vec2 x) {
+    vec2 grid  = 9.0 * proctex_noise_f * abs(x + proctex_noise_p);
+    vec2 point = floor(grid);
+    vec2 frac  = grid - point;
+
+    float g0 = ProcTexNoiseRand2D(point) * (frac.x + frac.y);
+    float g1 = ProcTexNoiseRand2D(point + vec2(1.0, 0.0)) * (frac.x + frac.y - 1.0);
+    float g2 = ProcTexNoiseRand2D(point + vec2(0.0, 1.0)) * (frac.x + frac.y - 1.0);
+    float g3 = ProcTexNoiseRand2D(point + vec2(1.0, 1.0)) * (frac.x + frac.y - 2.0);
+
+    float x_noise = ProcTexLookupLUT(proctex_noise_lut_offset, frac.x);
+    float y_noise = ProcTexLookupLUT(proctex_noise_lut_offset, frac.y);
+    float x0 = mix(g0, g1, x_noise);
+    float x1 = mix(g2, g3, x_noise);
+    return mix(x0, x1, y_noise);
+}
+)";
+
 /// Detects if a TEV stage is configured to be skipped (to avoid generating unnecessary code)
 static bool IsPassThroughTevStage(const TevStageConfig& stage) {
     return (stage.color_op == TevStageConfig::Operation::Replace &&
@@ -839,7 +973,7 @@ void AppendProcTexClamp(std::string& out, const std::string& var, ProcTexClamp m
 }
 
 void AppendProcTexCombineAndMap(std::string& out, ProcTexCombiner combiner,
-                                const std::string& map_lut) {
+                                const std::string& offset) {
     std::string combined;
     switch (combiner) {
     case ProcTexCombiner::U:
@@ -877,7 +1011,7 @@ void AppendProcTexCombineAndMap(std::string& out, ProcTexCombiner combiner,
         combined = "0.0";
         break;
     }
-    out += "ProcTexLookupLUT(" + map_lut + ", " + combined + ")";
+    out += "ProcTexLookupLUT(" + offset + ", " + combined + ")";
 }
 
 void AppendProcTexSampler(std::string& out, const PicaShaderConfig& config) {
@@ -885,55 +1019,12 @@ void AppendProcTexSampler(std::string& out, const PicaShaderConfig& config) {
     // For NoiseLUT/ColorMap/AlphaMap, coord=0.0 is lut[0], coord=127.0/128.0 is lut[127] and
     // coord=1.0 is lut[127]+lut_diff[127]. For other indices, the result is interpolated using
     // value entries and difference entries.
-    out += R"(
-float ProcTexLookupLUT(sampler1D lut, float coord) {
-    coord *= 128;
-    float index_i = clamp(floor(coord), 0.0, 127.0);
-    float index_f = coord - index_i; // fract() cannot be used here because 128.0 needs to be
-                                     // extracted as index_i = 127.0 and index_f = 1.0
-    vec2 entry = texelFetch(lut, int(index_i), 0).rg;
-    return clamp(entry.r + entry.g * index_f, 0.0, 1.0);
-}
-    )";
+    out += proctex_lut_lookup;
 
     // Noise utility
     if (config.state.proctex.noise_enable) {
         // See swrasterizer/proctex.cpp for more information about these functions
-        out += R"(
-int ProcTexNoiseRand1D(int v) {
-    const int table[] = int[](0,4,10,8,4,9,7,12,5,15,13,14,11,15,2,11);
-    return ((v % 9 + 2) * 3 & 0xF) ^ table[(v / 9) & 0xF];
-}
-
-float ProcTexNoiseRand2D(vec2 point) {
-    const int table[] = int[](10,2,15,8,0,7,4,5,5,13,2,6,13,9,3,14);
-    int u2 = ProcTexNoiseRand1D(int(point.x));
-    int v2 = ProcTexNoiseRand1D(int(point.y));
-    v2 += ((u2 & 3) == 1) ? 4 : 0;
-    v2 ^= (u2 & 1) * 6;
-    v2 += 10 + u2;
-    v2 &= 0xF;
-    v2 ^= table[u2];
-    return -1.0 + float(v2) * 2.0/ 15.0;
-}
-
-float ProcTexNoiseCoef(vec2 x) {
-    vec2 grid  = 9.0 * proctex_noise_f * abs(x + proctex_noise_p);
-    vec2 point = floor(grid);
-    vec2 frac  = grid - point;
-
-    float g0 = ProcTexNoiseRand2D(point) * (frac.x + frac.y);
-    float g1 = ProcTexNoiseRand2D(point + vec2(1.0, 0.0)) * (frac.x + frac.y - 1.0);
-    float g2 = ProcTexNoiseRand2D(point + vec2(0.0, 1.0)) * (frac.x + frac.y - 1.0);
-    float g3 = ProcTexNoiseRand2D(point + vec2(1.0, 1.0)) * (frac.x + frac.y - 2.0);
-
-    float x_noise = ProcTexLookupLUT(proctex_noise_lut, frac.x);
-    float y_noise = ProcTexLookupLUT(proctex_noise_lut, frac.y);
-    float x0 = mix(g0, g1, x_noise);
-    float x1 = mix(g2, g3, x_noise);
-    return mix(x0, x1, y_noise);
-}
-        )";
+        out += proctex_noise_functions;
     }
 
     out += "vec4 ProcTex() {\n";
@@ -965,7 +1056,8 @@ float ProcTexNoiseCoef(vec2 x) {
 
     // Combine and map
     out += "float lut_coord = ";
-    AppendProcTexCombineAndMap(out, config.state.proctex.color_combiner, "proctex_color_map");
+    AppendProcTexCombineAndMap(out, config.state.proctex.color_combiner,
+                               "proctex_color_map_offset");
     out += ";\n";
 
     // Look up color
@@ -979,14 +1071,16 @@ float ProcTexNoiseCoef(vec2 x) {
         out += "int lut_index_i = int(lut_coord) + " +
                std::to_string(config.state.proctex.lut_offset) + ";\n";
         out += "float lut_index_f = fract(lut_coord);\n";
-        out += "vec4 final_color = texelFetch(proctex_lut, lut_index_i, 0) + lut_index_f * "
-               "texelFetch(proctex_diff_lut, lut_index_i, 0);\n";
+        out += "vec4 final_color = texelFetch(texture_buffer_lut_rgba, lut_index_i + "
+               "proctex_lut_offset) + lut_index_f * texelFetch(texture_buffer_lut_rgba, "
+               "lut_index_i + proctex_diff_lut_offset);\n";
         break;
     case ProcTexFilter::Nearest:
     case ProcTexFilter::NearestMipmapLinear:
     case ProcTexFilter::NearestMipmapNearest:
         out += "lut_coord += " + std::to_string(config.state.proctex.lut_offset) + ";\n";
-        out += "vec4 final_color = texelFetch(proctex_lut, int(round(lut_coord)), 0);\n";
+        out += "vec4 final_color = texelFetch(texture_buffer_lut_rgba, int(round(lut_coord)) + "
+               "proctex_lut_offset);\n";
         break;
     }
 
@@ -994,7 +1088,8 @@ float ProcTexNoiseCoef(vec2 x) {
         // Note: in separate alpha mode, the alpha channel skips the color LUT look up stage. It
         // uses the output of CombineAndMap directly instead.
         out += "float final_alpha = ";
-        AppendProcTexCombineAndMap(out, config.state.proctex.alpha_combiner, "proctex_alpha_map");
+        AppendProcTexCombineAndMap(out, config.state.proctex.alpha_combiner,
+                                   "proctex_alpha_map_offset");
         out += ";\n";
         out += "return vec4(final_color.xyz, final_alpha);\n}\n";
     } else {
@@ -1005,84 +1100,7 @@ float ProcTexNoiseCoef(vec2 x) {
 std::string GenerateFragmentShader(const PicaShaderConfig& config) {
     const auto& state = config.state;
 
-    std::string out = R"(
-#version 330 core
-#define NUM_TEV_STAGES 6
-#define NUM_LIGHTS 8
-
-in vec4 primary_color;
-in vec2 texcoord[3];
-in float texcoord0_w;
-in vec4 normquat;
-in vec3 view;
-
-in vec4 gl_FragCoord;
-
-out vec4 color;
-
-struct LightSrc {
-    vec3 specular_0;
-    vec3 specular_1;
-    vec3 diffuse;
-    vec3 ambient;
-    vec3 position;
-    vec3 spot_direction;
-    float dist_atten_bias;
-    float dist_atten_scale;
-};
-
-layout (std140) uniform shader_data {
-    vec2 framebuffer_scale;
-    int alphatest_ref;
-    float depth_scale;
-    float depth_offset;
-    int scissor_x1;
-    int scissor_y1;
-    int scissor_x2;
-    int scissor_y2;
-    vec3 fog_color;
-    vec2 proctex_noise_f;
-    vec2 proctex_noise_a;
-    vec2 proctex_noise_p;
-    vec3 lighting_global_ambient;
-    LightSrc light_src[NUM_LIGHTS];
-    vec4 const_color[NUM_TEV_STAGES];
-    vec4 tev_combiner_buffer_color;
-};
-
-uniform sampler2D tex[3];
-uniform samplerBuffer lighting_lut;
-uniform samplerBuffer fog_lut;
-uniform sampler1D proctex_noise_lut;
-uniform sampler1D proctex_color_map;
-uniform sampler1D proctex_alpha_map;
-uniform sampler1D proctex_lut;
-uniform sampler1D proctex_diff_lut;
-
-// Rotate the vector v by the quaternion q
-vec3 quaternion_rotate(vec4 q, vec3 v) {
-    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
-}
-
-float LookupLightingLUT(int lut_index, int index, float delta) {
-    vec2 entry = texelFetch(lighting_lut, lut_index * 256 + index).rg;
-    return entry.r + entry.g * delta;
-}
-
-float LookupLightingLUTUnsigned(int lut_index, float pos) {
-    int index = clamp(int(pos * 256.0), 0, 255);
-    float delta = pos * 256.0 - index;
-    return LookupLightingLUT(lut_index, index, delta);
-}
-
-float LookupLightingLUTSigned(int lut_index, float pos) {
-    int index = clamp(int(pos * 128.0), -128, 127);
-    float delta = pos * 128.0 - index;
-    if (index < 0) index += 256;
-    return LookupLightingLUT(lut_index, index, delta);
-}
-
-)";
+    std::string out = fragment_shader_header;
 
     if (config.state.proctex.enable)
         AppendProcTexSampler(out, config);
@@ -1145,7 +1163,8 @@ vec4 secondary_fragment_color = vec4(0.0);
         // Generate clamped fog factor from LUT for given fog index
         out += "float fog_i = clamp(floor(fog_index), 0.0, 127.0);\n";
         out += "float fog_f = fog_index - fog_i;\n";
-        out += "vec2 fog_lut_entry = texelFetch(fog_lut, int(fog_i)).rg;\n";
+        out += "vec2 fog_lut_entry = texelFetch(texture_buffer_lut_rg, int(fog_i) + "
+               "fog_lut_offset).rg;\n";
         out += "float fog_factor = fog_lut_entry.r + fog_lut_entry.g * fog_f;\n";
         out += "fog_factor = clamp(fog_factor, 0.0, 1.0);\n";
 
@@ -1161,6 +1180,715 @@ vec4 secondary_fragment_color = vec4(0.0);
     return out;
 }
 
+/// Layout of the integer vectors of UberShaderConfig
+enum UberConfigIndex : size_t {
+    UBER_MISC0,      ///< alpha test func, scissor mode, texture0 projection, texture2 uses coord1
+    UBER_MISC1,      ///< w-buffering, fog enable, fog flip, combiner buffer update mask
+    UBER_TEV,        ///< Per stage: color sources + op, alpha sources + op, color modifiers +
+                     ///< multiplier, alpha modifiers + multiplier
+    UBER_LIGHTING0 = UBER_TEV + 6 * 4, ///< enable, number of lights, bump mode, bump selector
+    UBER_LIGHTING1,                    ///< bump renorm, clamp highlights, is config 7, fresnel
+    UBER_LIGHT,                        ///< Per light: num, directional, two sided, flags
+    UBER_LUT = UBER_LIGHT + 8,         ///< Per LUT: enable, abs input, input type, sampler
+    UBER_PROCTEX0 = UBER_LUT + 7,      ///< enable, coord, u clamp, v clamp
+    UBER_PROCTEX1,                     ///< color combiner, alpha combiner, separate alpha, noise
+    UBER_PROCTEX2,                     ///< u shift, v shift, lut width, lut offset
+    UBER_PROCTEX3,                     ///< linear filter
+    UBER_NUM_INT_VECTORS,
+};
+static_assert(UBER_NUM_INT_VECTORS == UberShaderConfig::NumIntVectors,
+              "UberShaderConfig layout does not match its declaration");
+
+/// Order of the lighting LUTs in UBER_LUT, the scales are stored in the same order
+enum UberLut : unsigned {
+    UBER_LUT_D0,
+    UBER_LUT_D1,
+    UBER_LUT_SP,
+    UBER_LUT_FR,
+    UBER_LUT_RR,
+    UBER_LUT_RG,
+    UBER_LUT_RB,
+};
+
+/// Bits of the attenuation flags of UBER_LIGHT
+enum UberLightFlags : s32 {
+    UBER_LIGHT_DIST_ATTEN = 1 << 0,
+    UBER_LIGHT_SPOT_ATTEN = 1 << 1,
+    UBER_LIGHT_GEOMETRIC_FACTOR_0 = 1 << 2,
+    UBER_LIGHT_GEOMETRIC_FACTOR_1 = 1 << 3,
+};
+
+UberShaderConfig UberShaderConfig::BuildFromConfig(const PicaShaderConfig& config) {
+    const auto& state = config.state;
+    UberShaderConfig res{};
+    auto& ints = res.ints;
+
+    ints[UBER_MISC0] = {static_cast<s32>(state.alpha_test_func),
+                        static_cast<s32>(state.scissor_test_mode),
+                        state.texture0_type == TexturingRegs::TextureConfig::Projection2D,
+                        state.texture2_use_coord1};
+    ints[UBER_MISC1] = {state.depthmap_enable == RasterizerRegs::DepthBuffering::WBuffering,
+                        state.fog_mode == TexturingRegs::FogMode::Fog, state.fog_flip,
+                        state.combiner_buffer_input};
+
+    for (size_t i = 0; i < state.tev_stages.size(); ++i) {
+        const auto stage = static_cast<const TevStageConfig>(state.tev_stages[i]);
+        auto* stage_ints = &ints[UBER_TEV + i * 4];
+        stage_ints[0] = {static_cast<s32>(stage.color_source1.Value()),
+                         static_cast<s32>(stage.color_source2.Value()),
+                         static_cast<s32>(stage.color_source3.Value()),
+                         static_cast<s32>(stage.color_op.Value())};
+        stage_ints[1] = {static_cast<s32>(stage.alpha_source1.Value()),
+                         static_cast<s32>(stage.alpha_source2.Value()),
+                         static_cast<s32>(stage.alpha_source3.Value()),
+                         static_cast<s32>(stage.alpha_op.Value())};
+        stage_ints[2] = {static_cast<s32>(stage.color_modifier1.Value()),
+                         static_cast<s32>(stage.color_modifier2.Value()),
+                         static_cast<s32>(stage.color_modifier3.Value()),
+                         static_cast<s32>(stage.GetColorMultiplier())};
+        stage_ints[3] = {static_cast<s32>(stage.alpha_modifier1.Value()),
+                         static_cast<s32>(stage.alpha_modifier2.Value()),
+                         static_cast<s32>(stage.alpha_modifier3.Value()),
+                         static_cast<s32>(stage.GetAlphaMultiplier())};
+    }
+
+    const auto& lighting = state.lighting;
+    ints[UBER_LIGHTING0] = {lighting.enable, static_cast<s32>(lighting.src_num),
+                            static_cast<s32>(lighting.bump_mode),
+                            static_cast<s32>(lighting.bump_selector)};
+    ints[UBER_LIGHTING1] = {lighting.bump_renorm, lighting.clamp_highlights,
+                            lighting.config == LightingRegs::LightingConfig::Config7,
+                            static_cast<s32>(lighting.fresnel_selector)};
+
+    for (unsigned light_index = 0; light_index < lighting.src_num; ++light_index) {
+        const auto& light = lighting.light[light_index];
+        s32 flags = (light.dist_atten_enable ? UBER_LIGHT_DIST_ATTEN : 0) |
+                    (light.spot_atten_enable ? UBER_LIGHT_SPOT_ATTEN : 0) |
+                    (light.geometric_factor_0 ? UBER_LIGHT_GEOMETRIC_FACTOR_0 : 0) |
+                    (light.geometric_factor_1 ? UBER_LIGHT_GEOMETRIC_FACTOR_1 : 0);
+        ints[UBER_LIGHT + light_index] = {static_cast<s32>(light.num), light.directional,
+                                          light.two_sided_diffuse, flags};
+    }
+
+    // A LUT is only enabled if the lighting configuration supports its sampler. The spotlight LUT
+    // has no enable bit of its own and is selected per light instead.
+    auto set_lut = [&](UberLut lut, const decltype(lighting.lut_d0)& lut_config,
+                       LightingRegs::LightingSampler sampler) {
+        bool enable = (lut == UBER_LUT_SP || lut_config.enable) &&
+                      LightingRegs::IsLightingSamplerSupported(lighting.config, sampler);
+        ints[UBER_LUT + lut] = {enable, lut_config.abs_input, static_cast<s32>(lut_config.type),
+                                static_cast<s32>(sampler)};
+        res.floats[lut / 4][lut % 4] = lut_config.scale;
+    };
+    set_lut(UBER_LUT_D0, lighting.lut_d0, LightingRegs::LightingSampler::Distribution0);
+    set_lut(UBER_LUT_D1, lighting.lut_d1, LightingRegs::LightingSampler::Distribution1);
+    set_lut(UBER_LUT_SP, lighting.lut_sp, LightingRegs::LightingSampler::SpotlightAttenuation);
+    set_lut(UBER_LUT_FR, lighting.lut_fr, LightingRegs::LightingSampler::Fresnel);
+    set_lut(UBER_LUT_RR, lighting.lut_rr, LightingRegs::LightingSampler::ReflectRed);
+    set_lut(UBER_LUT_RG, lighting.lut_rg, LightingRegs::LightingSampler::ReflectGreen);
+    set_lut(UBER_LUT_RB, lighting.lut_rb, LightingRegs::LightingSampler::ReflectBlue);
+
+    const auto& proctex = state.proctex;
+    ints[UBER_PROCTEX0] = {proctex.enable, static_cast<s32>(std::min<u32>(proctex.coord, 2)),
+                           static_cast<s32>(proctex.u_clamp), static_cast<s32>(proctex.v_clamp)};
+    ints[UBER_PROCTEX1] = {static_cast<s32>(proctex.color_combiner),
+                           static_cast<s32>(proctex.alpha_combiner), proctex.separate_alpha,
+                           proctex.noise_enable};
+    ints[UBER_PROCTEX2] = {static_cast<s32>(proctex.u_shift), static_cast<s32>(proctex.v_shift),
+                           static_cast<s32>(proctex.lut_width),
+                           static_cast<s32>(proctex.lut_offset)};
+    bool proctex_linear = proctex.lut_filter == ProcTexFilter::Linear ||
+                          proctex.lut_filter == ProcTexFilter::LinearMipmapLinear ||
+                          proctex.lut_filter == ProcTexFilter::LinearMipmapNearest;
+    ints[UBER_PROCTEX3] = {proctex_linear, 0, 0, 0};
+
+    return res;
+}
+
+std::string GenerateUberFragmentShader() {
+    std::string out = fragment_shader_header;
+
+    auto define = [&out](const char* name, auto value) {
+        out += "#define ";
+        out += name;
+        out += ' ' + std::to_string(static_cast<int>(value)) + '\n';
+    };
+
+    define("UBER_MISC0", UBER_MISC0);
+    define("UBER_MISC1", UBER_MISC1);
+    define("UBER_TEV", UBER_TEV);
+    define("UBER_LIGHTING0", UBER_LIGHTING0);
+    define("UBER_LIGHTING1", UBER_LIGHTING1);
+    define("UBER_LIGHT", UBER_LIGHT);
+    define("UBER_LUT", UBER_LUT);
+    define("UBER_PROCTEX0", UBER_PROCTEX0);
+    define("UBER_PROCTEX1", UBER_PROCTEX1);
+    define("UBER_PROCTEX2", UBER_PROCTEX2);
+    define("UBER_PROCTEX3", UBER_PROCTEX3);
+    define("UBER_NUM_INT_VECTORS", UBER_NUM_INT_VECTORS);
+    define("UBER_NUM_FLOAT_VECTORS", UberShaderConfig::NumFloatVectors);
+
+    define("UBER_LUT_D0", UBER_LUT_D0);
+    define("UBER_LUT_D1", UBER_LUT_D1);
+    define("UBER_LUT_SP", UBER_LUT_SP);
+    define("UBER_LUT_FR", UBER_LUT_FR);
+    define("UBER_LUT_RR", UBER_LUT_RR);
+    define("UBER_LUT_RG", UBER_LUT_RG);
+    define("UBER_LUT_RB", UBER_LUT_RB);
+
+    define("UBER_LIGHT_DIST_ATTEN", UBER_LIGHT_DIST_ATTEN);
+    define("UBER_LIGHT_SPOT_ATTEN", UBER_LIGHT_SPOT_ATTEN);
+    define("UBER_LIGHT_GEOMETRIC_FACTOR_0", UBER_LIGHT_GEOMETRIC_FACTOR_0);
+    define("UBER_LIGHT_GEOMETRIC_FACTOR_1", UBER_LIGHT_GEOMETRIC_FACTOR_1);
+
+    using CompareFunc = FramebufferRegs::CompareFunc;
+    define("COMPARE_NEVER", CompareFunc::Never);
+    define("COMPARE_ALWAYS", CompareFunc::Always);
+    define("COMPARE_EQUAL", CompareFunc::Equal);
+    define("COMPARE_NOT_EQUAL", CompareFunc::NotEqual);
+    define("COMPARE_LESS_THAN", CompareFunc::LessThan);
+    define("COMPARE_LESS_THAN_OR_EQUAL", CompareFunc::LessThanOrEqual);
+    define("COMPARE_GREATER_THAN", CompareFunc::GreaterThan);
+    define("COMPARE_GREATER_THAN_OR_EQUAL", CompareFunc::GreaterThanOrEqual);
+
+    define("SCISSOR_DISABLED", RasterizerRegs::ScissorMode::Disabled);
+    define("SCISSOR_INCLUDE", RasterizerRegs::ScissorMode::Include);
+
+    using Source = TevStageConfig::Source;
+    define("SOURCE_PRIMARY_COLOR", Source::PrimaryColor);
+    define("SOURCE_PRIMARY_FRAGMENT_COLOR", Source::PrimaryFragmentColor);
+    define("SOURCE_SECONDARY_FRAGMENT_COLOR", Source::SecondaryFragmentColor);
+    define("SOURCE_TEXTURE0", Source::Texture0);
+    define("SOURCE_TEXTURE1", Source::Texture1);
+    define("SOURCE_TEXTURE2", Source::Texture2);
+    define("SOURCE_TEXTURE3", Source::Texture3);
+    define("SOURCE_PREVIOUS_BUFFER", Source::PreviousBuffer);
+    define("SOURCE_CONSTANT", Source::Constant);
+    define("SOURCE_PREVIOUS", Source::Previous);
+
+    using ColorModifier = TevStageConfig::ColorModifier;
+    define("COLOR_MODIFIER_SOURCE_COLOR", ColorModifier::SourceColor);
+    define("COLOR_MODIFIER_ONE_MINUS_SOURCE_COLOR", ColorModifier::OneMinusSourceColor);
+    define("COLOR_MODIFIER_SOURCE_ALPHA", ColorModifier::SourceAlpha);
+    define("COLOR_MODIFIER_ONE_MINUS_SOURCE_ALPHA", ColorModifier::OneMinusSourceAlpha);
+    define("COLOR_MODIFIER_SOURCE_RED", ColorModifier::SourceRed);
+    define("COLOR_MODIFIER_ONE_MINUS_SOURCE_RED", ColorModifier::OneMinusSourceRed);
+    define("COLOR_MODIFIER_SOURCE_GREEN", ColorModifier::SourceGreen);
+    define("COLOR_MODIFIER_ONE_MINUS_SOURCE_GREEN", ColorModifier::OneMinusSourceGreen);
+    define("COLOR_MODIFIER_SOURCE_BLUE", ColorModifier::SourceBlue);
+    define("COLOR_MODIFIER_ONE_MINUS_SOURCE_BLUE", ColorModifier::OneMinusSourceBlue);
+
+    using AlphaModifier = TevStageConfig::AlphaModifier;
+    define("ALPHA_MODIFIER_SOURCE_ALPHA", AlphaModifier::SourceAlpha);
+    define("ALPHA_MODIFIER_ONE_MINUS_SOURCE_ALPHA", AlphaModifier::OneMinusSourceAlpha);
+    define("ALPHA_MODIFIER_SOURCE_RED", AlphaModifier::SourceRed);
+    define("ALPHA_MODIFIER_ONE_MINUS_SOURCE_RED", AlphaModifier::OneMinusSourceRed);
+    define("ALPHA_MODIFIER_SOURCE_GREEN", AlphaModifier::SourceGreen);
+    define("ALPHA_MODIFIER_ONE_MINUS_SOURCE_GREEN", AlphaModifier::OneMinusSourceGreen);
+    define("ALPHA_MODIFIER_SOURCE_BLUE", AlphaModifier::SourceBlue);
+    define("ALPHA_MODIFIER_ONE_MINUS_SOURCE_BLUE", AlphaModifier::OneMinusSourceBlue);
+
+    using Operation = TevStageConfig::Operation;
+    define("OPERATION_REPLACE", Operation::Replace);
+    define("OPERATION_MODULATE", Operation::Modulate);
+    define("OPERATION_ADD", Operation::Add);
+    define("OPERATION_ADD_SIGNED", Operation::AddSigned);
+    define("OPERATION_LERP", Operation::Lerp);
+    define("OPERATION_SUBTRACT", Operation::Subtract);
+    define("OPERATION_DOT3_RGB", Operation::Dot3_RGB);
+    define("OPERATION_DOT3_RGBA", Operation::Dot3_RGBA);
+    define("OPERATION_MULTIPLY_THEN_ADD", Operation::MultiplyThenAdd);
+    define("OPERATION_ADD_THEN_MULTIPLY", Operation::AddThenMultiply);
+
+    using LutInput = LightingRegs::LightingLutInput;
+    define("LUT_INPUT_NH", LutInput::NH);
+    define("LUT_INPUT_VH", LutInput::VH);
+    define("LUT_INPUT_NV", LutInput::NV);
+    define("LUT_INPUT_LN", LutInput::LN);
+    define("LUT_INPUT_SP", LutInput::SP);
+    define("LUT_INPUT_CP", LutInput::CP);
+
+    define("BUMP_MODE_NORMAL_MAP", LightingRegs::LightingBumpMode::NormalMap);
+    define("BUMP_MODE_TANGENT_MAP", LightingRegs::LightingBumpMode::TangentMap);
+    define("FRESNEL_PRIMARY_ALPHA", LightingRegs::LightingFresnelSelector::PrimaryAlpha);
+    define("FRESNEL_SECONDARY_ALPHA", LightingRegs::LightingFresnelSelector::SecondaryAlpha);
+    define("LIGHTING_SAMPLER_SPOTLIGHT", LightingRegs::LightingSampler::SpotlightAttenuation);
+    define("LIGHTING_SAMPLER_DISTANCE", LightingRegs::LightingSampler::DistanceAttenuation);
+
+    define("PROCTEX_CLAMP_TO_ZERO", ProcTexClamp::ToZero);
+    define("PROCTEX_CLAMP_TO_EDGE", ProcTexClamp::ToEdge);
+    define("PROCTEX_CLAMP_SYMMETRICAL_REPEAT", ProcTexClamp::SymmetricalRepeat);
+    define("PROCTEX_CLAMP_MIRRORED_REPEAT", ProcTexClamp::MirroredRepeat);
+    define("PROCTEX_CLAMP_PULSE", ProcTexClamp::Pulse);
+    define("PROCTEX_SHIFT_ODD", ProcTexShift::Odd);
+    define("PROCTEX_SHIFT_EVEN", ProcTexShift::Even);
+    define("PROCTEX_COMBINER_U", ProcTexCombiner::U);
+    define("PROCTEX_COMBINER_U2", ProcTexCombiner::U2);
+    define("PROCTEX_COMBINER_V", ProcTexCombiner::V);
+    define("PROCTEX_COMBINER_V2", ProcTexCombiner::V2);
+    define("PROCTEX_COMBINER_ADD", ProcTexCombiner::Add);
+    define("PROCTEX_COMBINER_ADD2", ProcTexCombiner::Add2);
+    define("PROCTEX_COMBINER_SQRT_ADD2", ProcTexCombiner::SqrtAdd2);
+    define("PROCTEX_COMBINER_MIN", ProcTexCombiner::Min);
+    define("PROCTEX_COMBINER_MAX", ProcTexCombiner::Max);
+    define("PROCTEX_COMBINER_RMAX", ProcTexCombiner::RMax);
+
+    out += proctex_lut_lookup;
+    out += proctex_noise_functions;
+
+    out += R"(
+uniform ivec4 pica_config[UBER_NUM_INT_VECTORS];
+uniform vec4 pica_config_float[UBER_NUM_FLOAT_VECTORS];
+
+vec4 primary_fragment_color;
+vec4 secondary_fragment_color;
+vec4 texture_color[4];
+vec4 combiner_buffer;
+vec4 next_combiner_buffer;
+vec4 last_tex_env_out;
+
+float ProcTexShiftOffset(int mode, float v, int clamp_mode) {
+    float offset = (clamp_mode == PROCTEX_CLAMP_MIRRORED_REPEAT) ? 1.0 : 0.5;
+    if (mode == PROCTEX_SHIFT_ODD)
+        return offset * ((int(v) / 2) % 2);
+    if (mode == PROCTEX_SHIFT_EVEN)
+        return offset * (((int(v) + 1) / 2) % 2);
+    return 0.0;
+}
+
+float ProcTexClamp(float v, int mode) {
+    switch (mode) {
+    case PROCTEX_CLAMP_TO_ZERO:
+        return v > 1.0 ? 0.0 : v;
+    case PROCTEX_CLAMP_SYMMETRICAL_REPEAT:
+        return fract(v);
+    case PROCTEX_CLAMP_MIRRORED_REPEAT:
+        return int(v) % 2 == 0 ? fract(v) : 1.0 - fract(v);
+    case PROCTEX_CLAMP_PULSE:
+        return v > 0.5 ? 1.0 : 0.0;
+    default:
+        return min(v, 1.0);
+    }
+}
+
+float ProcTexCombineAndMap(int combiner, float u, float v, int offset) {
+    float combined;
+    switch (combiner) {
+    case PROCTEX_COMBINER_U: combined = u; break;
+    case PROCTEX_COMBINER_U2: combined = u * u; break;
+    case PROCTEX_COMBINER_V: combined = v; break;
+    case PROCTEX_COMBINER_V2: combined = v * v; break;
+    case PROCTEX_COMBINER_ADD: combined = (u + v) * 0.5; break;
+    case PROCTEX_COMBINER_ADD2: combined = (u * u + v * v) * 0.5; break;
+    case PROCTEX_COMBINER_SQRT_ADD2: combined = min(sqrt(u * u + v * v), 1.0); break;
+    case PROCTEX_COMBINER_MIN: combined = min(u, v); break;
+    case PROCTEX_COMBINER_MAX: combined = max(u, v); break;
+    case PROCTEX_COMBINER_RMAX:
+        combined = min(((u + v) * 0.5 + sqrt(u * u + v * v)) * 0.5, 1.0);
+        break;
+    default: combined = 0.0; break;
+    }
+    return ProcTexLookupLUT(offset, combined);
+}
+
+vec4 ProcTex() {
+    ivec4 config0 = pica_config[UBER_PROCTEX0];
+    ivec4 config1 = pica_config[UBER_PROCTEX1];
+    ivec4 config2 = pica_config[UBER_PROCTEX2];
+
+    vec2 uv = abs(config0.y == 0 ? texcoord[0] : (config0.y == 1 ? texcoord[1] : texcoord[2]));
+    float u_shift = ProcTexShiftOffset(config2.x, uv.y, config0.z);
+    float v_shift = ProcTexShiftOffset(config2.y, uv.x, config0.w);
+    if (config1.w != 0) {
+        uv += proctex_noise_a * ProcTexNoiseCoef(uv);
+        uv = abs(uv);
+    }
+
+    float u = ProcTexClamp(uv.x + u_shift, config0.z);
+    float v = ProcTexClamp(uv.y + v_shift, config0.w);
+
+    float lut_coord = ProcTexCombineAndMap(config1.x, u, v, proctex_color_map_offset);
+    lut_coord *= float(config2.z - 1);
+
+    vec4 final_color;
+    if (pica_config[UBER_PROCTEX3].x != 0) {
+        int lut_index_i = int(lut_coord) + config2.w;
+        float lut_index_f = fract(lut_coord);
+        final_color = texelFetch(texture_buffer_lut_rgba, lut_index_i + proctex_lut_offset) +
+                      lut_index_f * texelFetch(texture_buffer_lut_rgba,
+                                               lut_index_i + proctex_diff_lut_offset);
+    } else {
+        lut_coord += float(config2.w);
+        final_color =
+            texelFetch(texture_buffer_lut_rgba, int(round(lut_coord)) + proctex_lut_offset);
+    }
+
+    if (config1.z != 0) {
+        // In separate alpha mode the alpha channel skips the color LUT look up stage
+        float final_alpha = ProcTexCombineAndMap(config1.y, u, v, proctex_alpha_map_offset);
+        return vec4(final_color.xyz, final_alpha);
+    }
+    return final_color;
+}
+
+float GetLightingLutValue(int lut, int light_num, vec3 normal, vec3 tangent, vec3 light_vector,
+                          vec3 spot_dir, vec3 half_vector) {
+    ivec4 config = pica_config[UBER_LUT + lut];
+    float index;
+    switch (config.z) {
+    case LUT_INPUT_NH:
+        index = dot(normal, normalize(half_vector));
+        break;
+    case LUT_INPUT_VH:
+        index = dot(normalize(view), normalize(half_vector));
+        break;
+    case LUT_INPUT_NV:
+        index = dot(normal, normalize(view));
+        break;
+    case LUT_INPUT_LN:
+        index = dot(light_vector, normal);
+        break;
+    case LUT_INPUT_SP:
+        index = dot(light_vector, spot_dir);
+        break;
+    case LUT_INPUT_CP:
+        // CP input is only available with configuration 7
+        if (pica_config[UBER_LIGHTING1].z != 0) {
+            vec3 half_vector_n = normalize(half_vector);
+            vec3 half_angle_proj =
+                half_vector_n - normal / dot(normal, normal) * dot(normal, half_vector_n);
+            index = dot(half_angle_proj, tangent);
+        } else {
+            index = 0.0;
+        }
+        break;
+    default:
+        index = 0.0;
+        break;
+    }
+
+    // The spotlight LUT is selected per light
+    int sampler = config.w + (lut == UBER_LUT_SP ? light_num : 0);
+
+    float value;
+    if (config.y != 0) {
+        // LUT index is in the range of (0.0, 1.0)
+        index = pica_config[UBER_LIGHT + light_num].z != 0 ? abs(index) : max(index, 0.0);
+        value = LookupLightingLUTUnsigned(sampler, index);
+    } else {
+        // LUT index is in the range of (-1.0, 1.0)
+        value = LookupLightingLUTSigned(sampler, index);
+    }
+    return pica_config_float[lut >> 2][lut & 3] * value;
+}
+
+void ComputeLighting() {
+    ivec4 config0 = pica_config[UBER_LIGHTING0];
+    ivec4 config1 = pica_config[UBER_LIGHTING1];
+
+    vec4 diffuse_sum = vec4(0.0, 0.0, 0.0, 1.0);
+    vec4 specular_sum = vec4(0.0, 0.0, 0.0, 1.0);
+
+    // Compute fragment normals and tangents
+    vec3 surface_normal = vec3(0.0, 0.0, 1.0);
+    vec3 surface_tangent = vec3(1.0, 0.0, 0.0);
+    vec3 perturbation = 2.0 * texture_color[config0.w].rgb - 1.0;
+    if (config0.z == BUMP_MODE_NORMAL_MAP) {
+        surface_normal = perturbation;
+        if (config1.x != 0) {
+            float val = 1.0 - (surface_normal.x * surface_normal.x +
+                               surface_normal.y * surface_normal.y);
+            surface_normal.z = sqrt(max(val, 0.0));
+        }
+    } else if (config0.z == BUMP_MODE_TANGENT_MAP) {
+        surface_tangent = perturbation;
+    }
+
+    vec4 normalized_normquat = normalize(normquat);
+    vec3 normal = quaternion_rotate(normalized_normquat, surface_normal);
+    vec3 tangent = quaternion_rotate(normalized_normquat, surface_tangent);
+
+    for (int light_index = 0; light_index < config0.y; ++light_index) {
+        ivec4 light_config = pica_config[UBER_LIGHT + light_index];
+        int num = light_config.x;
+
+        vec3 light_vector = normalize(light_src[num].position +
+                                      (light_config.y != 0 ? vec3(0.0) : view));
+        vec3 spot_dir = light_src[num].spot_direction;
+        vec3 half_vector = normalize(view) + light_vector;
+
+        float dot_product = light_config.z != 0 ? abs(dot(light_vector, normal))
+                                                : max(dot(light_vector, normal), 0.0);
+
+        float spot_atten = 1.0;
+        if ((light_config.w & UBER_LIGHT_SPOT_ATTEN) != 0 &&
+            pica_config[UBER_LUT + UBER_LUT_SP].x != 0) {
+            spot_atten = GetLightingLutValue(UBER_LUT_SP, num, normal, tangent, light_vector,
+                                             spot_dir, half_vector);
+        }
+
+        float dist_atten = 1.0;
+        if ((light_config.w & UBER_LIGHT_DIST_ATTEN) != 0) {
+            float index = clamp(light_src[num].dist_atten_scale *
+                                    length(-view - light_src[num].position) +
+                                    light_src[num].dist_atten_bias, 0.0, 1.0);
+            dist_atten = LookupLightingLUTUnsigned(LIGHTING_SAMPLER_DISTANCE + num, index);
+        }
+
+        float clamp_highlights =
+            (config1.y != 0 && dot(light_vector, normal) <= 0.0) ? 0.0 : 1.0;
+
+        float geo_factor = 1.0;
+        int geo_flags = UBER_LIGHT_GEOMETRIC_FACTOR_0 | UBER_LIGHT_GEOMETRIC_FACTOR_1;
+        if ((light_config.w & geo_flags) != 0) {
+            geo_factor = dot(half_vector, half_vector);
+            geo_factor = geo_factor == 0.0 ? 0.0 : min(dot_product / geo_factor, 1.0);
+        }
+
+        float d0_lut_value = 1.0;
+        if (pica_config[UBER_LUT + UBER_LUT_D0].x != 0) {
+            d0_lut_value = GetLightingLutValue(UBER_LUT_D0, num, normal, tangent, light_vector,
+                                               spot_dir, half_vector);
+        }
+        vec3 specular_0 = d0_lut_value * light_src[num].specular_0;
+        if ((light_config.w & UBER_LIGHT_GEOMETRIC_FACTOR_0) != 0) {
+            specular_0 *= geo_factor;
+        }
+
+        vec3 refl_value;
+        refl_value.r = 1.0;
+        if (pica_config[UBER_LUT + UBER_LUT_RR].x != 0) {
+            refl_value.r = GetLightingLutValue(UBER_LUT_RR, num, normal, tangent, light_vector,
+                                               spot_dir, half_vector);
+        }
+        refl_value.g = refl_value.r;
+        if (pica_config[UBER_LUT + UBER_LUT_RG].x != 0) {
+            refl_value.g = GetLightingLutValue(UBER_LUT_RG, num, normal, tangent, light_vector,
+                                               spot_dir, half_vector);
+        }
+        refl_value.b = refl_value.r;
+        if (pica_config[UBER_LUT + UBER_LUT_RB].x != 0) {
+            refl_value.b = GetLightingLutValue(UBER_LUT_RB, num, normal, tangent, light_vector,
+                                               spot_dir, half_vector);
+        }
+
+        float d1_lut_value = 1.0;
+        if (pica_config[UBER_LUT + UBER_LUT_D1].x != 0) {
+            d1_lut_value = GetLightingLutValue(UBER_LUT_D1, num, normal, tangent, light_vector,
+                                               spot_dir, half_vector);
+        }
+        vec3 specular_1 = d1_lut_value * refl_value * light_src[num].specular_1;
+        if ((light_config.w & UBER_LIGHT_GEOMETRIC_FACTOR_1) != 0) {
+            specular_1 *= geo_factor;
+        }
+
+        if (pica_config[UBER_LUT + UBER_LUT_FR].x != 0) {
+            float value = GetLightingLutValue(UBER_LUT_FR, num, normal, tangent, light_vector,
+                                              spot_dir, half_vector);
+            if ((config1.w & FRESNEL_PRIMARY_ALPHA) != 0)
+                diffuse_sum.a *= value;
+            if ((config1.w & FRESNEL_SECONDARY_ALPHA) != 0)
+                specular_sum.a *= value;
+        }
+
+        diffuse_sum.rgb += ((light_src[num].diffuse * dot_product) + light_src[num].ambient) *
+                           dist_atten * spot_atten;
+        specular_sum.rgb += (specular_0 + specular_1) * clamp_highlights * dist_atten * spot_atten;
+    }
+
+    diffuse_sum.rgb += lighting_global_ambient;
+    primary_fragment_color = clamp(diffuse_sum, vec4(0.0), vec4(1.0));
+    secondary_fragment_color = clamp(specular_sum, vec4(0.0), vec4(1.0));
+}
+
+vec4 GetSource(int source, int stage) {
+    switch (source) {
+    case SOURCE_PRIMARY_COLOR: return primary_color;
+    case SOURCE_PRIMARY_FRAGMENT_COLOR: return primary_fragment_color;
+    case SOURCE_SECONDARY_FRAGMENT_COLOR: return secondary_fragment_color;
+    case SOURCE_TEXTURE0: return texture_color[0];
+    case SOURCE_TEXTURE1: return texture_color[1];
+    case SOURCE_TEXTURE2: return texture_color[2];
+    case SOURCE_TEXTURE3: return texture_color[3];
+    case SOURCE_PREVIOUS_BUFFER: return combiner_buffer;
+    case SOURCE_CONSTANT: return const_color[stage];
+    case SOURCE_PREVIOUS: return last_tex_env_out;
+    default: return vec4(0.0);
+    }
+}
+
+vec3 GetColorModifier(int modifier, vec4 value) {
+    switch (modifier) {
+    case COLOR_MODIFIER_SOURCE_COLOR: return value.rgb;
+    case COLOR_MODIFIER_ONE_MINUS_SOURCE_COLOR: return vec3(1.0) - value.rgb;
+    case COLOR_MODIFIER_SOURCE_ALPHA: return value.aaa;
+    case COLOR_MODIFIER_ONE_MINUS_SOURCE_ALPHA: return vec3(1.0) - value.aaa;
+    case COLOR_MODIFIER_SOURCE_RED: return value.rrr;
+    case COLOR_MODIFIER_ONE_MINUS_SOURCE_RED: return vec3(1.0) - value.rrr;
+    case COLOR_MODIFIER_SOURCE_GREEN: return value.ggg;
+    case COLOR_MODIFIER_ONE_MINUS_SOURCE_GREEN: return vec3(1.0) - value.ggg;
+    case COLOR_MODIFIER_SOURCE_BLUE: return value.bbb;
+    case COLOR_MODIFIER_ONE_MINUS_SOURCE_BLUE: return vec3(1.0) - value.bbb;
+    default: return vec3(0.0);
+    }
+}
+
+float GetAlphaModifier(int modifier, vec4 value) {
+    switch (modifier) {
+    case ALPHA_MODIFIER_SOURCE_ALPHA: return value.a;
+    case ALPHA_MODIFIER_ONE_MINUS_SOURCE_ALPHA: return 1.0 - value.a;
+    case ALPHA_MODIFIER_SOURCE_RED: return value.r;
+    case ALPHA_MODIFIER_ONE_MINUS_SOURCE_RED: return 1.0 - value.r;
+    case ALPHA_MODIFIER_SOURCE_GREEN: return value.g;
+    case ALPHA_MODIFIER_ONE_MINUS_SOURCE_GREEN: return 1.0 - value.g;
+    case ALPHA_MODIFIER_SOURCE_BLUE: return value.b;
+    case ALPHA_MODIFIER_ONE_MINUS_SOURCE_BLUE: return 1.0 - value.b;
+    default: return 0.0;
+    }
+}
+
+vec3 CombineColor(int operation, vec3 i[3]) {
+    vec3 result;
+    switch (operation) {
+    case OPERATION_REPLACE: result = i[0]; break;
+    case OPERATION_MODULATE: result = i[0] * i[1]; break;
+    case OPERATION_ADD: result = i[0] + i[1]; break;
+    case OPERATION_ADD_SIGNED: result = i[0] + i[1] - vec3(0.5); break;
+    case OPERATION_LERP: result = i[0] * i[2] + i[1] * (vec3(1.0) - i[2]); break;
+    case OPERATION_SUBTRACT: result = i[0] - i[1]; break;
+    case OPERATION_MULTIPLY_THEN_ADD: result = i[0] * i[1] + i[2]; break;
+    case OPERATION_ADD_THEN_MULTIPLY: result = min(i[0] + i[1], vec3(1.0)) * i[2]; break;
+    case OPERATION_DOT3_RGB:
+    case OPERATION_DOT3_RGBA:
+        result = vec3(dot(i[0] - vec3(0.5), i[1] - vec3(0.5)) * 4.0);
+        break;
+    default: result = vec3(0.0); break;
+    }
+    return clamp(result, vec3(0.0), vec3(1.0));
+}
+
+float CombineAlpha(int operation, float i[3]) {
+    float result;
+    switch (operation) {
+    case OPERATION_REPLACE: result = i[0]; break;
+    case OPERATION_MODULATE: result = i[0] * i[1]; break;
+    case OPERATION_ADD: result = i[0] + i[1]; break;
+    case OPERATION_ADD_SIGNED: result = i[0] + i[1] - 0.5; break;
+    case OPERATION_LERP: result = i[0] * i[2] + i[1] * (1.0 - i[2]); break;
+    case OPERATION_SUBTRACT: result = i[0] - i[1]; break;
+    case OPERATION_MULTIPLY_THEN_ADD: result = i[0] * i[1] + i[2]; break;
+    case OPERATION_ADD_THEN_MULTIPLY: result = min(i[0] + i[1], 1.0) * i[2]; break;
+    default: result = 0.0; break;
+    }
+    return clamp(result, 0.0, 1.0);
+}
+
+bool PassesAlphaTest(int func, int alpha) {
+    switch (func) {
+    case COMPARE_NEVER: return false;
+    case COMPARE_EQUAL: return alpha == alphatest_ref;
+    case COMPARE_NOT_EQUAL: return alpha != alphatest_ref;
+    case COMPARE_LESS_THAN: return alpha < alphatest_ref;
+    case COMPARE_LESS_THAN_OR_EQUAL: return alpha <= alphatest_ref;
+    case COMPARE_GREATER_THAN: return alpha > alphatest_ref;
+    case COMPARE_GREATER_THAN_OR_EQUAL: return alpha >= alphatest_ref;
+    default: return true;
+    }
+}
+
+void main() {
+    ivec4 misc0 = pica_config[UBER_MISC0];
+    ivec4 misc1 = pica_config[UBER_MISC1];
+
+    if (misc0.x == COMPARE_NEVER)
+        discard;
+
+    if (misc0.y != SCISSOR_DISABLED) {
+        bool inside = gl_FragCoord.x >= scissor_x1 && gl_FragCoord.y >= scissor_y1 &&
+                      gl_FragCoord.x < scissor_x2 && gl_FragCoord.y < scissor_y2;
+        // Include keeps only the pixels inside the scissor box
+        if (inside != (misc0.y == SCISSOR_INCLUDE))
+            discard;
+    }
+
+    float z_over_w = 1.0 - gl_FragCoord.z * 2.0;
+    float depth = z_over_w * depth_scale + depth_offset;
+    if (misc1.x != 0)
+        depth /= gl_FragCoord.w;
+
+    // Sample all textures up front, the stages below select from them at run time
+    if (misc0.z != 0)
+        texture_color[0] = textureProj(tex[0], vec3(texcoord[0], texcoord0_w));
+    else
+        texture_color[0] = texture(tex[0], texcoord[0]);
+    texture_color[1] = texture(tex[1], texcoord[1]);
+    texture_color[2] = texture(tex[2], misc0.w != 0 ? texcoord[1] : texcoord[2]);
+    texture_color[3] = pica_config[UBER_PROCTEX0].x != 0 ? ProcTex() : vec4(0.0);
+
+    primary_fragment_color = vec4(0.0);
+    secondary_fragment_color = vec4(0.0);
+    if (pica_config[UBER_LIGHTING0].x != 0)
+        ComputeLighting();
+
+    combiner_buffer = vec4(0.0);
+    next_combiner_buffer = tev_combiner_buffer_color;
+    last_tex_env_out = vec4(0.0);
+
+    for (int stage = 0; stage < NUM_TEV_STAGES; ++stage) {
+        ivec4 color_config = pica_config[UBER_TEV + stage * 4];
+        ivec4 alpha_config = pica_config[UBER_TEV + stage * 4 + 1];
+        ivec4 color_modifiers = pica_config[UBER_TEV + stage * 4 + 2];
+        ivec4 alpha_modifiers = pica_config[UBER_TEV + stage * 4 + 3];
+
+        vec3 color_results[3] = vec3[3](
+            GetColorModifier(color_modifiers.x, GetSource(color_config.x, stage)),
+            GetColorModifier(color_modifiers.y, GetSource(color_config.y, stage)),
+            GetColorModifier(color_modifiers.z, GetSource(color_config.z, stage)));
+        vec3 color_output = CombineColor(color_config.w, color_results);
+
+        float alpha_output;
+        if (color_config.w == OPERATION_DOT3_RGBA) {
+            // result of Dot3_RGBA operation is also placed to the alpha component
+            alpha_output = color_output[0];
+        } else {
+            float alpha_results[3] = float[3](
+                GetAlphaModifier(alpha_modifiers.x, GetSource(alpha_config.x, stage)),
+                GetAlphaModifier(alpha_modifiers.y, GetSource(alpha_config.y, stage)),
+                GetAlphaModifier(alpha_modifiers.z, GetSource(alpha_config.z, stage)));
+            alpha_output = CombineAlpha(alpha_config.w, alpha_results);
+        }
+
+        last_tex_env_out =
+            vec4(clamp(color_output * float(color_modifiers.w), vec3(0.0), vec3(1.0)),
+                 clamp(alpha_output * float(alpha_modifiers.w), 0.0, 1.0));
+
+        combiner_buffer = next_combiner_buffer;
+        if (stage < 4 && (misc1.w & (1 << stage)) != 0)
+            next_combiner_buffer.rgb = last_tex_env_out.rgb;
+        if (stage < 4 && ((misc1.w >> 4) & (1 << stage)) != 0)
+            next_combiner_buffer.a = last_tex_env_out.a;
+    }
+
+    if (!PassesAlphaTest(misc0.x, int(last_tex_env_out.a * 255.0)))
+        discard;
+
+    if (misc1.y != 0) {
+        float fog_index = (misc1.z != 0 ? 1.0 - depth : depth) * 128.0;
+        float fog_i = clamp(floor(fog_index), 0.0, 127.0);
+        float fog_f = fog_index - fog_i;
+        vec2 fog_lut_entry = texelFetch(texture_buffer_lut_rg, int(fog_i) + fog_lut_offset).rg;
+        float fog_factor = clamp(fog_lut_entry.r + fog_lut_entry.g * fog_f, 0.0, 1.0);
+        last_tex_env_out.rgb = mix(fog_color.rgb, last_tex_env_out.rgb, fog_factor);
+    }
+
+    gl_FragDepth = depth;
+    color = last_tex_env_out;
+}
+)";
+
+    return out;
+}
+
 std::string GenerateVertexShader() {
     std::string out = "#version 330 core\n";
 
@@ -9,6 +9,8 @@
 #include <functional>
 #include <string>
 #include <type_traits>
+#include "common/common_types.h"
+#include "common/hash.h"
 #include "video_core/regs.h"
 
 namespace GLShader {
@@ -150,6 +152,29 @@ std::string GenerateVertexShader();
  */
 std::string GenerateFragmentShader(const PicaShaderConfig& config);
 
+/**
+ * Run-time description of a PicaShaderConfig, consumed by the uber fragment shader. Instead of
+ * being baked into the generated source, the configuration is decoded on the CPU into a flat array
+ * of integer vectors and a few floats that are uploaded as plain uniforms.
+ */
+struct UberShaderConfig {
+    static constexpr size_t NumIntVectors = 47;
+    static constexpr size_t NumFloatVectors = 2;
+
+    /// Construct an UberShaderConfig describing the given shader configuration.
+    static UberShaderConfig BuildFromConfig(const PicaShaderConfig& config);
+
+    std::array<std::array<s32, 4>, NumIntVectors> ints; ///< Uploaded to "pica_config"
+    std::array<std::array<float, 4>, NumFloatVectors> floats; ///< Uploaded to "pica_config_float"
+};
+
+/**
+ * Generates the GLSL source code of the uber fragment shader, which emulates any PicaShaderConfig
+ * described by the UberShaderConfig uniforms, at a higher GPU cost than the specialized shaders.
+ * @returns String of the shader source code
+ */
+std::string GenerateUberFragmentShader();
+
 } // namespace GLShader
 
 namespace std {
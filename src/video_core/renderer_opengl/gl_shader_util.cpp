@@ -64,6 +64,9 @@ GLuint LoadProgram(const char* vertex_shader, const char* fragment_shader) {
     LOG_DEBUG(Render_OpenGL, "Linking program...");
 
     GLuint program_id = glCreateProgram();
+    if (IsProgramBinarySupported()) {
+        glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glAttachShader(program_id, vertex_shader_id);
     glAttachShader(program_id, fragment_shader_id);
 
@@ -96,4 +99,97 @@ GLuint LoadProgram(const char* vertex_shader, const char* fragment_shader) {
     return program_id;
 }
 
+GLuint LoadProgramAsync(const char* vertex_shader, const char* fragment_shader) {
+    GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+    GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+
+    // Querying the compile status here would wait for the driver, errors are reported by
+    // CheckProgramLinkStatus through the program info log instead
+    glShaderSource(vertex_shader_id, 1, &vertex_shader, nullptr);
+    glCompileShader(vertex_shader_id);
+    glShaderSource(fragment_shader_id, 1, &fragment_shader, nullptr);
+    glCompileShader(fragment_shader_id);
+
+    GLuint program_id = glCreateProgram();
+    if (IsProgramBinarySupported()) {
+        glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(program_id, vertex_shader_id);
+    glAttachShader(program_id, fragment_shader_id);
+
+    glLinkProgram(program_id);
+
+    // The shaders are only flagged for deletion while they are still attached to the program
+    glDeleteShader(vertex_shader_id);
+    glDeleteShader(fragment_shader_id);
+
+    return program_id;
+}
+
+bool IsProgramLinkComplete(GLuint program_id) {
+    GLint complete = GL_TRUE;
+    glGetProgramiv(program_id, GL_COMPLETION_STATUS_ARB, &complete);
+    return complete == GL_TRUE;
+}
+
+void CheckProgramLinkStatus(GLuint program_id) {
+    GLint result = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &result);
+    if (result == GL_TRUE) {
+        return;
+    }
+
+    GLint info_log_length = 0;
+    glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &info_log_length);
+    if (info_log_length > 1) {
+        std::vector<char> program_error(info_log_length);
+        glGetProgramInfoLog(program_id, info_log_length, nullptr, &program_error[0]);
+        LOG_ERROR(Render_OpenGL, "Error linking shader:\n%s", &program_error[0]);
+    }
+
+    ASSERT_MSG(false, "Shader not linked");
+}
+
+bool IsParallelShaderCompileSupported() {
+    return GLAD_GL_ARB_parallel_shader_compile != 0;
+}
+
+GLuint LoadProgramBinary(GLenum binary_format, const std::vector<u8>& binary) {
+    GLuint program_id = glCreateProgram();
+    glProgramBinary(program_id, binary_format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    GLint result = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &result);
+    if (result == GL_FALSE) {
+        // The driver may reject binaries at any time, e.g. after it has been updated
+        LOG_WARNING(Render_OpenGL, "Program binary rejected by the driver");
+        glDeleteProgram(program_id);
+        return 0;
+    }
+
+    return program_id;
+}
+
+bool GetProgramBinary(GLuint program_id, GLenum& binary_format, std::vector<u8>& binary) {
+    GLint binary_length = 0;
+    glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+    if (binary_length <= 0) {
+        return false;
+    }
+
+    binary.resize(binary_length);
+    glGetProgramBinary(program_id, binary_length, nullptr, &binary_format, binary.data());
+    return true;
+}
+
+bool IsProgramBinarySupported() {
+    if (!GLAD_GL_ARB_get_program_binary) {
+        return false;
+    }
+
+    GLint num_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+    return num_formats > 0;
+}
+
 } // namespace GLShader
@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <vector>
 #include <glad/glad.h>
+#include "common/common_types.h"
 
 namespace GLShader {
 
@@ -16,4 +18,52 @@ namespace GLShader {
  */
 GLuint LoadProgram(const char* vertex_shader, const char* fragment_shader);
 
+/**
+ * Utility function to start compiling and linking an OpenGL GLSL shader program without waiting for
+ * the driver to finish. The program must not be used before IsProgramLinkComplete returns true,
+ * after which CheckProgramLinkStatus should be called on it.
+ * @param vertex_shader String of the GLSL vertex shader program
+ * @param fragment_shader String of the GLSL fragment shader program
+ * @returns Handle of the newly created OpenGL shader object
+ */
+GLuint LoadProgramAsync(const char* vertex_shader, const char* fragment_shader);
+
+/**
+ * Utility function to poll whether the driver has finished linking a program created with
+ * LoadProgramAsync. Requires ARB_parallel_shader_compile.
+ * @param program_id Handle of the shader program
+ * @returns True if the program can be used without stalling
+ */
+bool IsProgramLinkComplete(GLuint program_id);
+
+/**
+ * Utility function to check that a program created with LoadProgramAsync linked successfully
+ * @param program_id Handle of the shader program
+ */
+void CheckProgramLinkStatus(GLuint program_id);
+
+/// Returns whether the driver supports compiling programs in the background
+bool IsParallelShaderCompileSupported();
+
+/**
+ * Utility function to create an OpenGL shader program from a binary previously retrieved with
+ * GetProgramBinary
+ * @param binary_format Driver specific format of the program binary
+ * @param binary Program binary data
+ * @returns Handle of the newly created OpenGL shader object, or 0 if the driver rejected the binary
+ */
+GLuint LoadProgramBinary(GLenum binary_format, const std::vector<u8>& binary);
+
+/**
+ * Utility function to retrieve the binary representation of a linked OpenGL shader program
+ * @param program_id Handle of the shader program
+ * @param binary_format Output for the driver specific format of the program binary
+ * @param binary Output for the program binary data
+ * @returns True if the driver returned a binary for the program
+ */
+bool GetProgramBinary(GLuint program_id, GLenum& binary_format, std::vector<u8>& binary);
+
+/// Returns whether the driver supports retrieving and loading program binaries
+bool IsProgramBinarySupported();
+
 } // namespace
@@ -19,13 +19,9 @@ constexpr TextureUnit PicaTexture(int unit) {
     return TextureUnit{unit};
 }
 
-constexpr TextureUnit LightingLUT{3};
-constexpr TextureUnit FogLUT{4};
-constexpr TextureUnit ProcTexNoiseLUT{5};
-constexpr TextureUnit ProcTexColorMap{6};
-constexpr TextureUnit ProcTexAlphaMap{7};
-constexpr TextureUnit ProcTexLUT{8};
-constexpr TextureUnit ProcTexDiffLUT{9};
+constexpr TextureUnit TextureBufferLUT_RG{3};
+constexpr TextureUnit TextureBufferLUT_RGBA{4};
+constexpr TextureUnit TextureBufferDecodeData{5};
 
 } // namespace TextureUnits
 
@@ -88,31 +84,11 @@ public:
 
     struct {
         GLuint texture_buffer; // GL_TEXTURE_BINDING_BUFFER
-    } lighting_lut;
+    } texture_buffer_lut_rg;
 
     struct {
         GLuint texture_buffer; // GL_TEXTURE_BINDING_BUFFER
-    } fog_lut;
-
-    struct {
-        GLuint texture_1d; // GL_TEXTURE_BINDING_1D
-    } proctex_noise_lut;
-
-    struct {
-        GLuint texture_1d; // GL_TEXTURE_BINDING_1D
-    } proctex_color_map;
-
-    struct {
-        GLuint texture_1d; // GL_TEXTURE_BINDING_1D
-    } proctex_alpha_map;
-
-    struct {
-        GLuint texture_1d; // GL_TEXTURE_BINDING_1D
-    } proctex_lut;
-
-    struct {
-        GLuint texture_1d; // GL_TEXTURE_BINDING_1D
-    } proctex_diff_lut;
+    } texture_buffer_lut_rgba;
 
     struct {
         GLuint read_framebuffer; // GL_READ_FRAMEBUFFER_BINDING
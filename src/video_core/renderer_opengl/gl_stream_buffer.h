@@ -0,0 +1,62 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <tuple>
+#include <glad/glad.h>
+#include "common/common_types.h"
+#include "video_core/renderer_opengl/gl_resource_manager.h"
+
+/**
+ * Ring buffer used to stream per-draw data (vertices, uniform blocks, lookup tables) to the GPU.
+ *
+ * Where ARB_buffer_storage is available the buffer is allocated as immutable storage and stays
+ * persistently mapped, so sub-allocations are plain memory writes. Otherwise each allocation maps
+ * the unused tail of the buffer unsynchronized, and the buffer is orphaned whenever it wraps.
+ *
+ * The buffer must be bound to its target while calling Map and Unmap.
+ */
+class OGLStreamBuffer : private NonCopyable {
+public:
+    explicit OGLStreamBuffer(GLenum target, GLsizeiptr size, bool prefer_coherent = false);
+    ~OGLStreamBuffer();
+
+    GLuint GetHandle() const {
+        return gl_buffer.handle;
+    }
+
+    GLsizeiptr GetSize() const {
+        return buffer_size;
+    }
+
+    /**
+     * Allocates a region of the buffer for writing.
+     * @param size Maximum number of bytes that will be written to the region
+     * @param alignment Required alignment of the returned offset, or 0 for none
+     * @return Tuple of the pointer to write to, the offset of the region in the buffer, and whether
+     *         the buffer was invalidated, in which case any data written by earlier allocations is
+     *         lost and has to be uploaded again
+     */
+    std::tuple<u8*, GLintptr, bool> Map(GLsizeiptr size, GLintptr alignment = 0);
+
+    /**
+     * Commits the region returned by the last call to Map.
+     * @param size Number of bytes actually written, must not exceed the size passed to Map
+     */
+    void Unmap(GLsizeiptr size);
+
+private:
+    OGLBuffer gl_buffer;
+    GLenum gl_target;
+
+    bool coherent = false;
+    bool persistent = false;
+
+    GLintptr buffer_pos = 0;
+    GLsizeiptr buffer_size = 0;
+    GLintptr mapped_offset = 0;
+    GLsizeiptr mapped_size = 0;
+    u8* mapped_ptr = nullptr;
+};
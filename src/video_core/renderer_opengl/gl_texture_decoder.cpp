@@ -0,0 +1,298 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <glad/glad.h>
+#include "common/microprofile.h"
+#include "video_core/renderer_opengl/gl_state.h"
+#include "video_core/renderer_opengl/gl_texture_decoder.h"
+#include "video_core/texture/texture_decode.h"
+
+using TextureFormat = Pica::TexturingRegs::TextureFormat;
+
+MICROPROFILE_DEFINE(OpenGL_TextureDecode, "OpenGL", "Texture Decode", MP_RGB(128, 64, 255));
+
+static const char vertex_shader[] = R"(
+#version 330 core
+
+void main() {
+    // A single triangle covering the whole viewport
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// The texture format values match Pica::TexturingRegs::TextureFormat, and all the conversions
+// mirror the ones of Pica::Texture::LookupTexture and Color::Decode*.
+static const char fragment_shader[] = R"(
+#version 330 core
+
+uniform usamplerBuffer data;
+uniform int format;
+uniform int width;
+uniform int height;
+uniform int offset;
+
+out vec4 color;
+
+const int tile_sizes[14] = int[](256, 192, 128, 128, 128, 128, 128, 64, 64, 64, 32, 32, 32, 64);
+
+const ivec2 etc1_modifier_table[8] = ivec2[](ivec2(2, 8), ivec2(5, 17), ivec2(9, 29),
+                                             ivec2(13, 42), ivec2(18, 60), ivec2(24, 80),
+                                             ivec2(33, 106), ivec2(47, 183));
+
+uint Fetch8(int address) {
+    return texelFetch(data, offset + address).r;
+}
+
+uint Fetch16(int address) {
+    return Fetch8(address) | (Fetch8(address + 1) << 8);
+}
+
+uint Fetch32(int address) {
+    return Fetch16(address) | (Fetch16(address + 2) << 16);
+}
+
+uint Convert4To8(uint value) {
+    return (value << 4) | value;
+}
+
+uint Convert5To8(uint value) {
+    return ((value << 3) | (value >> 2)) & 0xFFu;
+}
+
+uint Convert6To8(uint value) {
+    return (value << 2) | (value >> 4);
+}
+
+int MortonInterleave(int x, int y) {
+    int i = (x & 7) | ((y & 7) << 8);
+    i = (i ^ (i << 2)) & 0x1313;
+    i = (i ^ (i << 1)) & 0x1515;
+    i = (i | (i >> 7)) & 0x3F;
+    return i;
+}
+
+uvec3 SampleETC1Subtile(uvec2 value, int x, int y) {
+    int texel = 4 * x + y;
+    bool flip = (value.y & 1u) != 0u;
+    bool differential_mode = (value.y & 2u) != 0u;
+    if (flip) {
+        int tmp = x;
+        x = y;
+        y = tmp;
+    }
+
+    ivec3 ret;
+    if (differential_mode) {
+        ivec3 base = ivec3(value.yyy >> uvec3(27, 19, 11)) & 0x1F;
+        if (x >= 2) {
+            // Sign extend the 3-bit deltas
+            base += (ivec3(value.yyy >> uvec3(24, 16, 8)) << 29) >> 29;
+        }
+        // The 5-bit value wraps around as an 8-bit integer before being expanded
+        uvec3 wrapped = uvec3(base) & 0xFFu;
+        ret = ivec3(Convert5To8(wrapped.r), Convert5To8(wrapped.g), Convert5To8(wrapped.b));
+    } else {
+        uvec3 shifts = (x < 2) ? uvec3(28, 20, 12) : uvec3(24, 16, 8);
+        uvec3 base = (value.yyy >> shifts) & 0xFu;
+        ret = ivec3(Convert4To8(base.r), Convert4To8(base.g), Convert4To8(base.b));
+    }
+
+    uint table_index = (x < 2) ? ((value.y >> 5) & 7u) : ((value.y >> 2) & 7u);
+    int modifier = etc1_modifier_table[table_index][(value.x >> texel) & 1u];
+    if (((value.x >> (16 + texel)) & 1u) != 0u)
+        modifier = -modifier;
+
+    return uvec3(clamp(ret + modifier, 0, 255));
+}
+
+uvec4 DecodeTexel(int tile, int x, int y) {
+    int morton = MortonInterleave(x, y);
+    switch (format) {
+    case 0: { // RGBA8
+        int address = tile + morton * 4;
+        return uvec4(Fetch8(address + 3), Fetch8(address + 2), Fetch8(address + 1),
+                     Fetch8(address));
+    }
+    case 1: { // RGB8
+        int address = tile + morton * 3;
+        return uvec4(Fetch8(address + 2), Fetch8(address + 1), Fetch8(address), 255u);
+    }
+    case 2: { // RGB5A1
+        uint pixel = Fetch16(tile + morton * 2);
+        return uvec4(Convert5To8((pixel >> 11) & 0x1Fu), Convert5To8((pixel >> 6) & 0x1Fu),
+                     Convert5To8((pixel >> 1) & 0x1Fu), (pixel & 1u) * 255u);
+    }
+    case 3: { // RGB565
+        uint pixel = Fetch16(tile + morton * 2);
+        return uvec4(Convert5To8((pixel >> 11) & 0x1Fu), Convert6To8((pixel >> 5) & 0x3Fu),
+                     Convert5To8(pixel & 0x1Fu), 255u);
+    }
+    case 4: { // RGBA4
+        uint pixel = Fetch16(tile + morton * 2);
+        return uvec4(Convert4To8((pixel >> 12) & 0xFu), Convert4To8((pixel >> 8) & 0xFu),
+                     Convert4To8((pixel >> 4) & 0xFu), Convert4To8(pixel & 0xFu));
+    }
+    case 5: { // IA8
+        int address = tile + morton * 2;
+        uint i = Fetch8(address + 1);
+        return uvec4(i, i, i, Fetch8(address));
+    }
+    case 6: { // RG8
+        int address = tile + morton * 2;
+        return uvec4(Fetch8(address + 1), Fetch8(address), 0u, 255u);
+    }
+    case 7: { // I8
+        uint i = Fetch8(tile + morton);
+        return uvec4(i, i, i, 255u);
+    }
+    case 8: // A8
+        return uvec4(0u, 0u, 0u, Fetch8(tile + morton));
+    case 9: { // IA4
+        uint value = Fetch8(tile + morton);
+        uint i = Convert4To8(value >> 4);
+        return uvec4(i, i, i, Convert4To8(value & 0xFu));
+    }
+    case 10: { // I4
+        uint i = Convert4To8((Fetch8(tile + morton / 2) >> (4 * (morton % 2))) & 0xFu);
+        return uvec4(i, i, i, 255u);
+    }
+    case 11: { // A4
+        uint a = Convert4To8((Fetch8(tile + morton / 2) >> (4 * (morton % 2))) & 0xFu);
+        return uvec4(0u, 0u, 0u, a);
+    }
+    default: { // ETC1, ETC1A4
+        bool has_alpha = format == 13;
+        int subtile_size = has_alpha ? 16 : 8;
+
+        // ETC1 further subdivides each 8x8 tile into four 4x4 subtiles
+        int subtile = tile + ((x / 4) + 2 * (y / 4)) * subtile_size;
+        x %= 4;
+        y %= 4;
+
+        uint alpha = 255u;
+        if (has_alpha) {
+            int shift = 4 * (x * 4 + y);
+            uint packed_alpha = Fetch32(subtile + (shift / 32) * 4);
+            alpha = Convert4To8((packed_alpha >> (shift % 32)) & 0xFu);
+            subtile += 8;
+        }
+
+        uvec2 subtile_data = uvec2(Fetch32(subtile), Fetch32(subtile + 4));
+        return uvec4(SampleETC1Subtile(subtile_data, x, y), alpha);
+    }
+    }
+}
+
+void main() {
+    // Textures are stored bottom-up in OpenGL
+    int x = int(gl_FragCoord.x);
+    int y = height - 1 - int(gl_FragCoord.y);
+
+    int tile_size = tile_sizes[format];
+    int tile = (y / 8) * (width / 8) * tile_size + (x / 8) * tile_size;
+    color = vec4(DecodeTexel(tile, x % 8, y % 8)) / 255.0;
+}
+)";
+
+/// Size of the buffer the raw texture data is streamed through, which bounds the largest texture
+/// that can be decoded. Large enough for a 1024x1024 RGBA8 texture.
+static GLsizeiptr GetDataBufferSize() {
+    constexpr GLsizeiptr preferred_size = 8 * 1024 * 1024;
+
+    // The buffer is viewed as one texel per byte
+    GLint max_texels;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    return std::min<GLsizeiptr>(preferred_size, max_texels);
+}
+
+TextureDecoderOpenGL::TextureDecoderOpenGL()
+    : data_buffer(GL_TEXTURE_BUFFER, GetDataBufferSize()) {
+    program.Create(vertex_shader, fragment_shader);
+    vertex_array.Create();
+    framebuffer.Create();
+
+    format_location = glGetUniformLocation(program.handle, "format");
+    width_location = glGetUniformLocation(program.handle, "width");
+    height_location = glGetUniformLocation(program.handle, "height");
+    offset_location = glGetUniformLocation(program.handle, "offset");
+
+    OpenGLState state = OpenGLState::GetCurState();
+    GLuint old_program = state.draw.shader_program;
+    state.draw.shader_program = program.handle;
+    state.Apply();
+    glUniform1i(glGetUniformLocation(program.handle, "data"),
+                TextureUnits::TextureBufferDecodeData.id);
+    state.draw.shader_program = old_program;
+    state.Apply();
+
+    // The buffer texture stays bound to its own texture unit, which nothing else uses
+    data_texture.Create();
+    glActiveTexture(TextureUnits::TextureBufferDecodeData.Enum());
+    glBindTexture(GL_TEXTURE_BUFFER, data_texture.handle);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R8UI, data_buffer.GetHandle());
+    glActiveTexture(GL_TEXTURE0);
+}
+
+bool TextureDecoderOpenGL::Decode(const u8* source, TextureFormat format, u32 width, u32 height,
+                                  GLuint texture) {
+    if (static_cast<u32>(format) > static_cast<u32>(TextureFormat::ETC1A4) || width % 8 != 0 ||
+        height % 8 != 0) {
+        return false;
+    }
+
+    GLsizeiptr size = Pica::Texture::CalculateTileSize(format) * (width / 8) * (height / 8);
+    if (size > data_buffer.GetSize()) {
+        return false;
+    }
+
+    MICROPROFILE_SCOPE(OpenGL_TextureDecode);
+
+    u8* data;
+    GLintptr offset;
+    glBindBuffer(GL_TEXTURE_BUFFER, data_buffer.GetHandle());
+    std::tie(data, offset, std::ignore) = data_buffer.Map(size);
+    std::memcpy(data, source, size);
+    data_buffer.Unmap(size);
+
+    OpenGLState prev_state = OpenGLState::GetCurState();
+    OpenGLState state = prev_state;
+    state.cull.enabled = false;
+    state.depth.test_enabled = false;
+    state.stencil.test_enabled = false;
+    state.blend.enabled = false;
+    state.logic_op = GL_COPY;
+    state.color_mask.red_enabled = GL_TRUE;
+    state.color_mask.green_enabled = GL_TRUE;
+    state.color_mask.blue_enabled = GL_TRUE;
+    state.color_mask.alpha_enabled = GL_TRUE;
+    state.draw.draw_framebuffer = framebuffer.handle;
+    state.draw.vertex_array = vertex_array.handle;
+    state.draw.shader_program = program.handle;
+    state.Apply();
+
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+    glUniform1i(format_location, static_cast<GLint>(format));
+    glUniform1i(width_location, static_cast<GLint>(width));
+    glUniform1i(height_location, static_cast<GLint>(height));
+    glUniform1i(offset_location, static_cast<GLint>(offset));
+
+    // The viewport isn't tracked by OpenGLState, and the rasterizer may have set it up for the draw
+    // which samples this texture
+    GLint prev_viewport[4];
+    glGetIntegerv(GL_VIEWPORT, prev_viewport);
+    glViewport(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glViewport(prev_viewport[0], prev_viewport[1], prev_viewport[2], prev_viewport[3]);
+
+    // Detach the texture so that deleting it later actually frees it
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+
+    prev_state.Apply();
+    return true;
+}
@@ -0,0 +1,43 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <glad/glad.h>
+#include "common/common_types.h"
+#include "video_core/regs_texturing.h"
+#include "video_core/renderer_opengl/gl_resource_manager.h"
+#include "video_core/renderer_opengl/gl_stream_buffer.h"
+
+/**
+ * Decodes tiled Pica textures on the GPU. The raw texture data is streamed into a buffer texture
+ * and a fragment shader draws the decoded texels into the target texture, producing the same
+ * result as Pica::Texture::LookupTexture.
+ */
+class TextureDecoderOpenGL : private NonCopyable {
+public:
+    TextureDecoderOpenGL();
+
+    /**
+     * Decodes a tiled texture into the first level of the given texture, which must already be
+     * allocated with the given dimensions and a color-renderable format. The texture is stored
+     * bottom-up, like textures loaded with glTexImage2D.
+     * @param source Tiled texture data in emulated memory
+     * @return False if the texture can't be decoded on the GPU, in which case it is left untouched
+     */
+    bool Decode(const u8* source, Pica::TexturingRegs::TextureFormat format, u32 width, u32 height,
+                GLuint texture);
+
+private:
+    OGLStreamBuffer data_buffer;
+    OGLTexture data_texture;
+    OGLShader program;
+    OGLVertexArray vertex_array;
+    OGLFramebuffer framebuffer;
+
+    GLint format_location = -1;
+    GLint width_location = -1;
+    GLint height_location = -1;
+    GLint offset_location = -1;
+};
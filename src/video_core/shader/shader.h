@@ -6,6 +6,7 @@
 
 #include <array>
 #include <cstddef>
+#include <functional>
 #include <type_traits>
 #include <nihstro/shader_bytecode.h>
 #include "common/assert.h"
@@ -26,6 +27,8 @@ namespace Shader {
 
 constexpr unsigned MAX_PROGRAM_CODE_LENGTH = 4096;
 constexpr unsigned MAX_SWIZZLE_DATA_LENGTH = 4096;
+/// Maximum number of vertices passed to one ShaderEngine::RunBatch call
+constexpr unsigned MAX_BATCH_SIZE = 8;
 
 struct AttributeBuffer {
     alignas(16) Math::Vec4<float24> attr[16];
@@ -43,7 +46,8 @@ struct OutputVertex {
     INSERT_PADDING_WORDS(1);
     Math::Vec2<float24> tc2;
 
-    static OutputVertex FromAttributeBuffer(const RasterizerRegs& regs, AttributeBuffer& output);
+    static OutputVertex FromAttributeBuffer(const RasterizerRegs& regs,
+                                            const AttributeBuffer& output);
 };
 #define ASSERT_POS(var, pos)                                                                       \
     static_assert(offsetof(OutputVertex, var) == pos * sizeof(float24), "Semantic at wrong "       \
@@ -60,6 +64,39 @@ ASSERT_POS(tc2, RasterizerRegs::VSOutputAttributes::TEXCOORD2_U);
 static_assert(std::is_pod<OutputVertex>::value, "Structure is not POD");
 static_assert(sizeof(OutputVertex) == 24 * sizeof(float), "OutputVertex has invalid size");
 
+/// Receives the vertices emitted by a geometry shader
+using VertexHandler = std::function<void(const AttributeBuffer&)>;
+/// Called before a primitive whose winding is reversed by SETEMIT is emitted
+using WindingSetter = std::function<void()>;
+
+/**
+ * Output stage of the geometry shader unit. SETEMIT selects one of the three vertex slots and EMIT
+ * copies the output registers into it, also passing the vertex downstream when SETEMIT flagged it
+ * as completing a primitive.
+ */
+struct GSEmitter {
+    std::array<std::array<Math::Vec4<float24>, 16>, 3> buffer;
+    u8 vertex_id;
+    bool prim_emit;
+    bool winding;
+    u32 output_mask;
+
+    // Function objects are hidden behind a pointer so that the structure stays standard layout,
+    // letting the JIT access the fields above through offsetof.
+    struct Handlers {
+        VertexHandler vertex_handler;
+        WindingSetter winding_setter;
+    } * handlers;
+
+    GSEmitter();
+    ~GSEmitter();
+    GSEmitter(const GSEmitter&) = delete;
+    GSEmitter& operator=(const GSEmitter&) = delete;
+
+    void Emit(Math::Vec4<float24> (&output_regs)[16]);
+};
+static_assert(std::is_standard_layout<GSEmitter>::value, "GSEmitter is not standard layout type");
+
 /**
  * This structure contains the state information that needs to be unique for a shader unit. The 3DS
  * has four shader units that process shaders in parallel. At the present, Citra only implements a
@@ -82,6 +119,11 @@ struct UnitState {
     // TODO: How many bits do these actually have?
     s32 address_registers[3];
 
+    /// Output stage used by EMIT and SETEMIT, only set on the geometry shader unit
+    GSEmitter* emitter_ptr;
+
+    explicit UnitState(GSEmitter* emitter = nullptr);
+
     static size_t InputOffset(const SourceRegister& reg) {
         switch (reg.GetRegisterType()) {
         case RegisterType::Input:
@@ -125,6 +167,18 @@ struct UnitState {
     void WriteOutput(const ShaderRegs& config, AttributeBuffer& output);
 };
 
+/**
+ * Shader unit state of the geometry shader unit, which in addition to the registers holds the
+ * vertices being emitted.
+ */
+struct GSUnitState : public UnitState {
+    GSUnitState();
+    void SetVertexHandler(VertexHandler vertex_handler, WindingSetter winding_setter);
+    void ConfigOutput(const ShaderRegs& config);
+
+    GSEmitter emitter;
+};
+
 struct ShaderSetup {
     struct {
         // The float uniforms are accessed by the shader JIT using SSE instructions, and are
@@ -150,11 +204,18 @@ struct ShaderSetup {
     std::array<u32, MAX_PROGRAM_CODE_LENGTH> program_code;
     std::array<u32, MAX_SWIZZLE_DATA_LENGTH> swizzle_data;
 
+    /// Output registers read once the program ends, engines may skip computing the others
+    u16 output_mask = 0xFFFF;
+
     /// Data private to ShaderEngines
     struct EngineData {
         unsigned int entry_point;
-        /// Used by the JIT, points to a compiled shader object.
+        /// Used by the JIT, points to a compiled shader object, and by the interpreter to a
+        /// pre-decoded program.
         const void* cached_shader = nullptr;
+        /// Used by the JIT, points to a compiled shader processing several vertices at once, if
+        /// the shader could be compiled that way.
+        const void* cached_soa_shader = nullptr;
     } engine_data;
 };
 
@@ -175,6 +236,21 @@ public:
      * @param state Shader unit state, must be setup with input data before each shader invocation.
      */
     virtual void Run(const ShaderSetup& setup, UnitState& state) const = 0;
+
+    /**
+     * Runs the currently setup shader on a batch of vertices. Engines able to process several
+     * vertices at once override this, the default implementation runs them one at a time.
+     *
+     * @param setup Shader engine state, must be setup with SetupBatch on each shader change.
+     * @param state Shader unit state, used by the vertices that are processed one at a time.
+     * @param config Shader configuration registers corresponding to the unit.
+     * @param input Attribute buffers of the input vertices.
+     * @param output Attribute buffers receiving the outputs of the vertices.
+     * @param count Number of vertices, at most MAX_BATCH_SIZE.
+     */
+    virtual void RunBatch(const ShaderSetup& setup, UnitState& state, const ShaderRegs& config,
+                          const AttributeBuffer* input, AttributeBuffer* output,
+                          unsigned count) const;
 };
 
 // TODO(yuriks): Remove and make it non-global state somewhere
@@ -0,0 +1,467 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <nihstro/shader_bytecode.h>
+#include "common/common_types.h"
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_analysis.h"
+
+using nihstro::Instruction;
+using nihstro::OpCode;
+using nihstro::SwizzlePattern;
+
+namespace Pica {
+
+namespace Shader {
+
+namespace {
+
+/// Set of components of the temporary and output registers, bit 4 * i + j standing for component j
+/// of register i
+struct RegisterSet {
+    u64 temporary = 0;
+    u64 output = 0;
+
+    RegisterSet& operator|=(const RegisterSet& other) {
+        temporary |= other.temporary;
+        output |= other.output;
+        return *this;
+    }
+
+    RegisterSet operator&(const RegisterSet& other) const {
+        return {temporary & other.temporary, output & other.output};
+    }
+
+    RegisterSet operator~() const {
+        return {~temporary, ~output};
+    }
+
+    bool operator==(const RegisterSet& other) const {
+        return temporary == other.temporary && output == other.output;
+    }
+
+    bool operator!=(const RegisterSet& other) const {
+        return !(*this == other);
+    }
+
+    bool Empty() const {
+        return temporary == 0 && output == 0;
+    }
+};
+
+/// What an instruction reads and writes, and where the execution may continue after it
+struct Node {
+    RegisterSet uses;
+    RegisterSet kills;
+    /// True if the only effect of the instruction is writing its destination register
+    bool removable = false;
+    /// True if the instruction moves a register onto itself
+    bool redundant = false;
+    /// True if the program may end after the instruction
+    bool exits = false;
+    std::vector<unsigned> successors;
+
+    DestRegister dest;
+    std::array<u8, 3> used_src_components = {{0, 0, 0}};
+    /// Float uniforms read without relative addressing, or -1
+    std::array<int, 3> uniforms = {{-1, -1, -1}};
+};
+
+constexpr u64 ALL_COMPONENTS = 0xF;
+
+RegisterSet DestComponents(DestRegister dest, u8 components) {
+    RegisterSet set;
+    if (dest < 0x10) {
+        set.output = static_cast<u64>(components) << (4 * dest.GetIndex());
+    } else {
+        set.temporary = static_cast<u64>(components) << (4 * dest.GetIndex());
+    }
+    return set;
+}
+
+u8 DestComponentMask(const SwizzlePattern& swizzle) {
+    u8 mask = 0;
+    for (unsigned i = 0; i < 4; ++i) {
+        if (swizzle.DestComponentEnabled(i))
+            mask |= 1 << i;
+    }
+    return mask;
+}
+
+std::array<u8, 4> Selectors(const SwizzlePattern& swizzle, unsigned src_num) {
+    switch (src_num) {
+    case 1:
+        return {{(u8)swizzle.src1_selector_0.Value(), (u8)swizzle.src1_selector_1.Value(),
+                 (u8)swizzle.src1_selector_2.Value(), (u8)swizzle.src1_selector_3.Value()}};
+    case 2:
+        return {{(u8)swizzle.src2_selector_0.Value(), (u8)swizzle.src2_selector_1.Value(),
+                 (u8)swizzle.src2_selector_2.Value(), (u8)swizzle.src2_selector_3.Value()}};
+    default:
+        return {{(u8)swizzle.src3_selector_0.Value(), (u8)swizzle.src3_selector_1.Value(),
+                 (u8)swizzle.src3_selector_2.Value(), (u8)swizzle.src3_selector_3.Value()}};
+    }
+}
+
+/// Records the read of the components `lanes` of a swizzled source operand
+void AddSourceUse(Node& node, unsigned src_num, SourceRegister reg, bool relative,
+                  const SwizzlePattern& swizzle, u8 lanes) {
+    node.used_src_components[src_num - 1] = lanes;
+    if (lanes == 0)
+        return;
+
+    if (relative) {
+        // The address register may move the read to any temporary register
+        node.uses.temporary = ~0ull;
+        return;
+    }
+
+    switch (reg.GetRegisterType()) {
+    case RegisterType::Temporary: {
+        const auto selectors = Selectors(swizzle, src_num);
+        for (unsigned i = 0; i < 4; ++i) {
+            if (lanes & (1 << i))
+                node.uses.temporary |= 1ull << (4 * reg.GetIndex() + selectors[i]);
+        }
+        break;
+    }
+    case RegisterType::FloatUniform:
+        node.uniforms[src_num - 1] = reg.GetIndex();
+        break;
+    default:
+        break;
+    }
+}
+
+/// Returns whether the swizzled components `lanes` of the given operand are those of the register
+bool IsIdentitySwizzle(const SwizzlePattern& swizzle, unsigned src_num, u8 lanes) {
+    const auto selectors = Selectors(swizzle, src_num);
+    for (unsigned i = 0; i < 4; ++i) {
+        if ((lanes & (1 << i)) && selectors[i] != i)
+            return false;
+    }
+    return true;
+}
+
+void DecodeArithmetic(Node& node, Instruction instr,
+                      const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>& swizzle_data) {
+    const SwizzlePattern swizzle = {swizzle_data[instr.common.operand_desc_id]};
+    const bool is_inverted =
+        (0 != (instr.opcode.Value().GetInfo().subtype & OpCode::Info::SrcInversed));
+    const bool has_offset = instr.common.address_register_index != 0;
+    const SourceRegister src1 = instr.common.GetSrc1(is_inverted);
+    const SourceRegister src2 = instr.common.GetSrc2(is_inverted);
+    const u8 dest_mask = DestComponentMask(swizzle);
+
+    // Components of the swizzled sources read by the operation
+    u8 src1_lanes, src2_lanes;
+    bool writes_dest = true;
+
+    switch (instr.opcode.Value().EffectiveOpCode()) {
+    case OpCode::Id::ADD:
+    case OpCode::Id::MUL:
+    case OpCode::Id::SGE:
+    case OpCode::Id::SGEI:
+    case OpCode::Id::SLT:
+    case OpCode::Id::SLTI:
+    case OpCode::Id::MAX:
+    case OpCode::Id::MIN:
+        src1_lanes = src2_lanes = dest_mask;
+        break;
+
+    case OpCode::Id::FLR:
+    case OpCode::Id::MOV:
+        src1_lanes = dest_mask;
+        src2_lanes = 0;
+        break;
+
+    case OpCode::Id::DP3:
+        src1_lanes = src2_lanes = 0x7;
+        break;
+
+    case OpCode::Id::DP4:
+        src1_lanes = src2_lanes = 0xF;
+        break;
+
+    case OpCode::Id::DPH:
+    case OpCode::Id::DPHI:
+        src1_lanes = 0x7;
+        src2_lanes = 0xF;
+        break;
+
+    case OpCode::Id::RCP:
+    case OpCode::Id::RSQ:
+    case OpCode::Id::EX2:
+    case OpCode::Id::LG2:
+        src1_lanes = 0x1;
+        src2_lanes = 0;
+        break;
+
+    case OpCode::Id::MOVA:
+        src1_lanes = dest_mask & 0x3;
+        src2_lanes = 0;
+        writes_dest = false;
+        break;
+
+    case OpCode::Id::CMP:
+        src1_lanes = src2_lanes = 0x3;
+        writes_dest = false;
+        break;
+
+    default:
+        // Unknown instructions are skipped by the engines
+        return;
+    }
+
+    AddSourceUse(node, 1, src1, has_offset && !is_inverted, swizzle, src1_lanes);
+    AddSourceUse(node, 2, src2, has_offset && is_inverted, swizzle, src2_lanes);
+
+    if (!writes_dest)
+        return;
+
+    node.dest = instr.common.dest.Value();
+    node.kills = DestComponents(node.dest, dest_mask);
+    node.removable = true;
+
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MOV && !has_offset &&
+        !swizzle.negate_src1 && src1.GetRegisterType() == RegisterType::Temporary &&
+        node.dest.GetRegisterType() == RegisterType::Temporary &&
+        src1.GetIndex() == node.dest.GetIndex() &&
+        IsIdentitySwizzle(swizzle, 1, dest_mask)) {
+        node.redundant = true;
+        node.uses = node.kills = {};
+    }
+}
+
+void DecodeMultiplyAdd(Node& node, Instruction instr,
+                       const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>& swizzle_data) {
+    const OpCode::Id opcode = instr.opcode.Value().EffectiveOpCode();
+    if (opcode != OpCode::Id::MAD && opcode != OpCode::Id::MADI)
+        return;
+
+    const SwizzlePattern swizzle = {swizzle_data[instr.mad.operand_desc_id]};
+    const bool is_inverted = opcode == OpCode::Id::MADI;
+    const bool has_offset = instr.mad.address_register_index != 0;
+    const u8 dest_mask = DestComponentMask(swizzle);
+
+    AddSourceUse(node, 1, instr.mad.GetSrc1(is_inverted), false, swizzle, dest_mask);
+    AddSourceUse(node, 2, instr.mad.GetSrc2(is_inverted), has_offset && !is_inverted, swizzle,
+                 dest_mask);
+    AddSourceUse(node, 3, instr.mad.GetSrc3(is_inverted), has_offset && is_inverted, swizzle,
+                 dest_mask);
+
+    node.dest = instr.mad.dest.Value();
+    node.kills = DestComponents(node.dest, dest_mask);
+    node.removable = true;
+}
+
+/**
+ * Builds the graph of the program. Besides the branches of each instruction, the execution may
+ * continue at the return address of any call, condition or loop whose end it reaches, so these are
+ * added to the successors of all instructions leading to such an end.
+ */
+std::vector<Node> BuildGraph(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>& program_code,
+                             const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>& swizzle_data) {
+    const unsigned size = static_cast<unsigned>(program_code.size());
+    std::vector<Node> nodes(size);
+
+    // Addresses at which the execution may return to other addresses
+    std::vector<std::vector<unsigned>> returns(size + 1);
+    auto add_return = [&](unsigned end, unsigned return_address) {
+        if (end <= size && end != return_address)
+            returns[end].push_back(return_address);
+    };
+
+    for (unsigned offset = 0; offset < size; ++offset) {
+        const Instruction instr = {program_code[offset]};
+        Node& node = nodes[offset];
+        auto& successors = node.successors;
+        const unsigned dest_offset = instr.flow_control.dest_offset;
+        const unsigned num_instructions = instr.flow_control.num_instructions;
+
+        switch (instr.opcode.Value().GetInfo().type) {
+        case OpCode::Type::Arithmetic:
+            DecodeArithmetic(node, instr, swizzle_data);
+            successors.push_back(offset + 1);
+            continue;
+
+        case OpCode::Type::MultiplyAdd:
+            DecodeMultiplyAdd(node, instr, swizzle_data);
+            successors.push_back(offset + 1);
+            continue;
+
+        default:
+            break;
+        }
+
+        switch (instr.opcode.Value()) {
+        case OpCode::Id::END:
+            node.exits = true;
+            break;
+
+        case OpCode::Id::JMPC:
+        case OpCode::Id::JMPU:
+            successors.push_back(offset + 1);
+            successors.push_back(dest_offset);
+            break;
+
+        case OpCode::Id::CALL:
+        case OpCode::Id::CALLC:
+        case OpCode::Id::CALLU:
+            if (instr.opcode.Value() != OpCode::Id::CALL)
+                successors.push_back(offset + 1);
+            successors.push_back(dest_offset);
+            add_return(dest_offset + num_instructions, offset + 1);
+            break;
+
+        case OpCode::Id::IFU:
+        case OpCode::Id::IFC:
+            successors.push_back(offset + 1);
+            successors.push_back(dest_offset);
+            add_return(dest_offset, dest_offset + num_instructions);
+            break;
+
+        case OpCode::Id::LOOP:
+            successors.push_back(offset + 1);
+            add_return(dest_offset + 1, offset + 1);
+            break;
+
+        case OpCode::Id::EMIT:
+            // The geometry shader passes the output registers downstream
+            node.uses.output = ~0ull;
+            successors.push_back(offset + 1);
+            break;
+
+        default:
+            successors.push_back(offset + 1);
+            break;
+        }
+    }
+
+    for (Node& node : nodes) {
+        // Follow the returns, which may themselves end at other returns
+        for (size_t i = 0; i < node.successors.size(); ++i) {
+            const unsigned successor = node.successors[i];
+            if (successor > size)
+                continue;
+            for (unsigned return_address : returns[successor]) {
+                if (std::find(node.successors.begin(), node.successors.end(), return_address) ==
+                    node.successors.end()) {
+                    node.successors.push_back(return_address);
+                }
+            }
+        }
+
+        // Running past the last instruction ends the program
+        auto past_end = std::remove_if(node.successors.begin(), node.successors.end(),
+                                       [size](unsigned successor) { return successor >= size; });
+        if (past_end != node.successors.end()) {
+            node.exits = true;
+            node.successors.erase(past_end, node.successors.end());
+        }
+    }
+
+    return nodes;
+}
+
+bool IsDead(const Node& node, const RegisterSet& live_out) {
+    return node.redundant || (node.removable && (node.kills & live_out).Empty());
+}
+
+/**
+ * Computes the registers live after each instruction, given those live when the program ends.
+ * Instructions found dead don't make their sources live, so that chains of instructions only
+ * feeding dead ones are dead as well.
+ */
+std::vector<RegisterSet> ComputeLiveness(const std::vector<Node>& nodes,
+                                         const RegisterSet& live_at_exit,
+                                         std::vector<RegisterSet>& live_in) {
+    const size_t size = nodes.size();
+    std::vector<RegisterSet> live_out(size);
+    live_in.assign(size, RegisterSet{});
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t offset = size; offset-- > 0;) {
+            const Node& node = nodes[offset];
+
+            RegisterSet out = node.exits ? live_at_exit : RegisterSet{};
+            for (unsigned successor : node.successors)
+                out |= live_in[successor];
+
+            RegisterSet in = out;
+            if (!IsDead(node, out)) {
+                in = out & ~node.kills;
+                in |= node.uses;
+            }
+
+            live_out[offset] = out;
+            if (in != live_in[offset]) {
+                live_in[offset] = in;
+                changed = true;
+            }
+        }
+    }
+
+    return live_out;
+}
+
+} // namespace
+
+ProgramAnalysis AnalyzeProgram(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>& program_code,
+                               const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>& swizzle_data,
+                               unsigned entry_point, u16 output_mask) {
+    const std::vector<Node> nodes = BuildGraph(program_code, swizzle_data);
+
+    RegisterSet live_at_exit;
+    for (unsigned i = 0; i < 16; ++i) {
+        if (output_mask & (1 << i))
+            live_at_exit.output |= ALL_COMPONENTS << (4 * i);
+    }
+
+    // Temporary registers read before being written are those of the previous run, which makes
+    // them live when the program ends
+    std::vector<RegisterSet> live_in;
+    std::vector<RegisterSet> live_out;
+    while (true) {
+        live_out = ComputeLiveness(nodes, live_at_exit, live_in);
+        const u64 read_temporaries = live_in[entry_point].temporary;
+        if ((read_temporaries & ~live_at_exit.temporary) == 0)
+            break;
+        live_at_exit.temporary |= read_temporaries;
+    }
+
+    ProgramAnalysis analysis;
+    analysis.instructions.resize(nodes.size());
+    for (size_t offset = 0; offset < nodes.size(); ++offset) {
+        const Node& node = nodes[offset];
+        auto& info = analysis.instructions[offset];
+
+        info.dead = IsDead(node, live_out[offset]);
+        info.used_src_components = node.used_src_components;
+
+        if (node.removable) {
+            const RegisterSet live_dest = live_out[offset] & DestComponents(node.dest, 0xF);
+            const u64 bits = node.dest < 0x10 ? live_dest.output : live_dest.temporary;
+            info.live_dest_components = static_cast<u8>(bits >> (4 * node.dest.GetIndex()));
+        }
+
+        if (info.dead)
+            continue;
+
+        for (int uniform : node.uniforms) {
+            if (uniform >= 0)
+                ++analysis.uniform_reads[uniform];
+        }
+    }
+
+    return analysis;
+}
+
+} // namespace Shader
+
+} // namespace Pica
@@ -0,0 +1,55 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include "common/common_types.h"
+#include "video_core/shader/shader.h"
+
+namespace Pica {
+
+namespace Shader {
+
+/**
+ * Results of a data-flow analysis of a shader program, telling which instructions and which parts
+ * of their operands have an effect that can be observed once the program ends.
+ */
+struct ProgramAnalysis {
+    struct InstructionInfo {
+        /// True if the instruction can be skipped, as nothing reads the registers it writes
+        /// before they are overwritten, or as it moves a register onto itself.
+        bool dead = false;
+        /// Components of the destination register that may be read after the instruction, bit i
+        /// standing for component i. Other components may be overwritten.
+        u8 live_dest_components = 0xF;
+        /// Components of each swizzled source operand that the instruction reads, bit i standing
+        /// for component i. Other components of the swizzled operands may hold any value.
+        std::array<u8, 3> used_src_components = {{0xF, 0xF, 0xF}};
+    };
+
+    std::vector<InstructionInfo> instructions;
+
+    /// Number of reads of each float uniform by the instructions which aren't dead, not counting
+    /// those with relative addressing
+    std::array<unsigned, 96> uniform_reads{};
+};
+
+/**
+ * Analyzes which instructions of a program have observable effects.
+ * @param program_code Code of the program.
+ * @param swizzle_data Operand descriptors of the program.
+ * @param entry_point Offset at which the program is started. Temporary registers keep their
+ *                    values across runs, so those read before being written at this offset are
+ *                    considered read when the program ends.
+ * @param output_mask Output registers read once the program ends.
+ */
+ProgramAnalysis AnalyzeProgram(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>& program_code,
+                               const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>& swizzle_data,
+                               unsigned entry_point, u16 output_mask);
+
+} // namespace Shader
+
+} // namespace Pica
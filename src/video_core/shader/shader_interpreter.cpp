@@ -5,12 +5,15 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <memory>
 #include <numeric>
 #include <boost/container/static_vector.hpp>
 #include <boost/range/algorithm/fill.hpp>
 #include <nihstro/shader_bytecode.h>
 #include "common/assert.h"
+#include "common/common_funcs.h"
 #include "common/common_types.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/microprofile.h"
 #include "common/vector_math.h"
@@ -38,6 +41,9 @@ struct CallStackElement {
     u32 loop_address;   // The address where we'll return to after each loop iteration
 };
 
+// Placeholder for invalid inputs and outputs
+static float24 dummy_vec4_float24[4];
+
 template <bool Debug>
 static void RunInterpreter(const ShaderSetup& setup, UnitState& state, DebugData<Debug>& debug_data,
                            unsigned offset) {
@@ -82,9 +88,6 @@ static void RunInterpreter(const ShaderSetup& setup, UnitState& state, DebugData
     const auto& swizzle_data = setup.swizzle_data;
     const auto& program_code = setup.program_code;
 
-    // Placeholder for invalid inputs
-    static float24 dummy_vec4_float24[4];
-
     unsigned iteration = 0;
     bool exit_loop = false;
     while (!exit_loop) {
@@ -636,6 +639,22 @@ static void RunInterpreter(const ShaderSetup& setup, UnitState& state, DebugData
                 break;
             }
 
+            case OpCode::Id::EMIT: {
+                GSEmitter* emitter = state.emitter_ptr;
+                ASSERT_MSG(emitter, "Execute EMIT on VS");
+                emitter->Emit(state.registers.output);
+                break;
+            }
+
+            case OpCode::Id::SETEMIT: {
+                GSEmitter* emitter = state.emitter_ptr;
+                ASSERT_MSG(emitter, "Execute SETEMIT on VS");
+                emitter->vertex_id = instr.setemit.vertex_id;
+                emitter->prim_emit = instr.setemit.prim_emit != 0;
+                emitter->winding = instr.setemit.winding != 0;
+                break;
+            }
+
             default:
                 LOG_ERROR(HW_GPU, "Unhandled instruction: 0x%02x (%s): 0x%08x",
                           (int)instr.opcode.Value().EffectiveOpCode(),
@@ -652,9 +671,769 @@ static void RunInterpreter(const ShaderSetup& setup, UnitState& state, DebugData
     }
 }
 
+// The operations of the pre-decoded interpreter, each with its own handler
+#define DECODED_OPS(X)                                                                             \
+    X(ADD)                                                                                         \
+    X(MUL)                                                                                         \
+    X(FLR)                                                                                         \
+    X(MAX)                                                                                         \
+    X(MIN)                                                                                         \
+    X(DP3)                                                                                         \
+    X(DP4)                                                                                         \
+    X(DPH)                                                                                         \
+    X(RCP)                                                                                         \
+    X(RSQ)                                                                                         \
+    X(MOVA)                                                                                        \
+    X(MOV)                                                                                         \
+    X(SGE)                                                                                         \
+    X(SLT)                                                                                         \
+    X(CMP)                                                                                         \
+    X(EX2)                                                                                         \
+    X(LG2)                                                                                         \
+    X(MAD)                                                                                         \
+    X(END)                                                                                         \
+    X(JMPC)                                                                                        \
+    X(JMPU)                                                                                        \
+    X(CALL)                                                                                        \
+    X(CALLU)                                                                                       \
+    X(CALLC)                                                                                       \
+    X(NOP)                                                                                         \
+    X(IFU)                                                                                         \
+    X(IFC)                                                                                         \
+    X(LOOP)                                                                                        \
+    X(EMIT)                                                                                        \
+    X(SETEMIT)                                                                                     \
+    X(UNHANDLED)
+
+enum class DecodedOp : u8 {
+#define DECODED_OP_ENUM(name) name,
+    DECODED_OPS(DECODED_OP_ENUM)
+#undef DECODED_OP_ENUM
+};
+
+/// Register files the source operands are read from
+enum SourceFile : u8 { SRC_INPUT, SRC_TEMPORARY, SRC_FLOAT_UNIFORM, SRC_DUMMY };
+/// Register files the results are written to
+enum DestFile : u8 { DEST_OUTPUT, DEST_TEMPORARY, DEST_DUMMY };
+
+struct DecodedSource {
+    SourceRegister reg; ///< Register as encoded, used when its address is relative
+    u8 file;            ///< SourceFile of the register
+    u8 index;           ///< Index of the register in its file
+    bool relative;      ///< Whether the register is offset by an address register
+    bool negate;
+    std::array<u8, 4> selector;
+};
+
+/// Instruction with its operands resolved, as far as they can be ahead of execution
+struct DecodedInstruction {
+    DecodedOp op;
+    u8 dest_file;  ///< DestFile of the destination register
+    u8 dest_index; ///< Index of the destination register in its file
+    u8 dest_mask;  ///< Bit i is set if component i of the destination is written
+    u8 address_register_index;
+    std::array<u8, 2> compare_op;
+    std::array<DecodedSource, 3> src;
+
+    // Flow control operands
+    u16 dest_offset;
+    u8 num_instructions;
+    u8 uniform_id; ///< Bool or int uniform, depending on the instruction
+    Instruction::FlowControlType::Op condition_op;
+    bool refx;
+    bool refy;
+
+    // SETEMIT operands
+    u8 vertex_id;
+    bool prim_emit;
+    bool winding;
+
+    u32 hex; ///< Encoded instruction, for logging
+};
+
+struct DecodedProgram {
+    /// The decoded instructions, followed by an END for programs running past the last one
+    std::array<DecodedInstruction, MAX_PROGRAM_CODE_LENGTH + 1> instructions;
+};
+
+static DecodedSource DecodeSource(SourceRegister reg, bool relative, bool negate,
+                                  std::array<u8, 4> selector) {
+    DecodedSource src{};
+    src.reg = reg;
+    src.relative = relative;
+    src.negate = negate;
+    src.selector = selector;
+    src.index = static_cast<u8>(reg.GetIndex());
+
+    switch (reg.GetRegisterType()) {
+    case RegisterType::Input:
+        src.file = SRC_INPUT;
+        break;
+    case RegisterType::Temporary:
+        src.file = SRC_TEMPORARY;
+        break;
+    case RegisterType::FloatUniform:
+        src.file = SRC_FLOAT_UNIFORM;
+        break;
+    default:
+        src.file = SRC_DUMMY;
+        src.index = 0;
+        break;
+    }
+    return src;
+}
+
+static void DecodeDest(DecodedInstruction& decoded, DestRegister dest) {
+    if (dest < 0x10) {
+        decoded.dest_file = DEST_OUTPUT;
+        decoded.dest_index = static_cast<u8>(dest.GetIndex());
+    } else if (dest < 0x20) {
+        decoded.dest_file = DEST_TEMPORARY;
+        decoded.dest_index = static_cast<u8>(dest.GetIndex());
+    } else {
+        decoded.dest_file = DEST_DUMMY;
+        decoded.dest_index = 0;
+    }
+}
+
+static DecodedOp DecodeArithmeticOp(OpCode::Id opcode) {
+    switch (opcode) {
+    case OpCode::Id::ADD:
+        return DecodedOp::ADD;
+    case OpCode::Id::MUL:
+        return DecodedOp::MUL;
+    case OpCode::Id::FLR:
+        return DecodedOp::FLR;
+    case OpCode::Id::MAX:
+        return DecodedOp::MAX;
+    case OpCode::Id::MIN:
+        return DecodedOp::MIN;
+    case OpCode::Id::DP3:
+        return DecodedOp::DP3;
+    case OpCode::Id::DP4:
+        return DecodedOp::DP4;
+    case OpCode::Id::DPH:
+    case OpCode::Id::DPHI:
+        return DecodedOp::DPH;
+    case OpCode::Id::RCP:
+        return DecodedOp::RCP;
+    case OpCode::Id::RSQ:
+        return DecodedOp::RSQ;
+    case OpCode::Id::MOVA:
+        return DecodedOp::MOVA;
+    case OpCode::Id::MOV:
+        return DecodedOp::MOV;
+    case OpCode::Id::SGE:
+    case OpCode::Id::SGEI:
+        return DecodedOp::SGE;
+    case OpCode::Id::SLT:
+    case OpCode::Id::SLTI:
+        return DecodedOp::SLT;
+    case OpCode::Id::CMP:
+        return DecodedOp::CMP;
+    case OpCode::Id::EX2:
+        return DecodedOp::EX2;
+    case OpCode::Id::LG2:
+        return DecodedOp::LG2;
+    default:
+        return DecodedOp::UNHANDLED;
+    }
+}
+
+static DecodedOp DecodeFlowControlOp(OpCode::Id opcode) {
+    switch (opcode) {
+    case OpCode::Id::END:
+        return DecodedOp::END;
+    case OpCode::Id::JMPC:
+        return DecodedOp::JMPC;
+    case OpCode::Id::JMPU:
+        return DecodedOp::JMPU;
+    case OpCode::Id::CALL:
+        return DecodedOp::CALL;
+    case OpCode::Id::CALLU:
+        return DecodedOp::CALLU;
+    case OpCode::Id::CALLC:
+        return DecodedOp::CALLC;
+    case OpCode::Id::NOP:
+        return DecodedOp::NOP;
+    case OpCode::Id::IFU:
+        return DecodedOp::IFU;
+    case OpCode::Id::IFC:
+        return DecodedOp::IFC;
+    case OpCode::Id::LOOP:
+        return DecodedOp::LOOP;
+    case OpCode::Id::EMIT:
+        return DecodedOp::EMIT;
+    case OpCode::Id::SETEMIT:
+        return DecodedOp::SETEMIT;
+    default:
+        return DecodedOp::UNHANDLED;
+    }
+}
+
+static DecodedInstruction DecodeInstruction(
+    Instruction instr, const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>& swizzle_data) {
+    DecodedInstruction decoded{};
+    decoded.hex = instr.hex;
+
+    switch (instr.opcode.Value().GetInfo().type) {
+    case OpCode::Type::Arithmetic: {
+        const SwizzlePattern swizzle = {swizzle_data[instr.common.operand_desc_id]};
+        const bool is_inverted =
+            (0 != (instr.opcode.Value().GetInfo().subtype & OpCode::Info::SrcInversed));
+        const bool has_offset = instr.common.address_register_index != 0;
+
+        decoded.op = DecodeArithmeticOp(instr.opcode.Value().EffectiveOpCode());
+        decoded.address_register_index = instr.common.address_register_index;
+        decoded.src[0] = DecodeSource(instr.common.GetSrc1(is_inverted),
+                                      has_offset && !is_inverted, swizzle.negate_src1 != 0,
+                                      {(u8)swizzle.src1_selector_0.Value(),
+                                       (u8)swizzle.src1_selector_1.Value(),
+                                       (u8)swizzle.src1_selector_2.Value(),
+                                       (u8)swizzle.src1_selector_3.Value()});
+        decoded.src[1] = DecodeSource(instr.common.GetSrc2(is_inverted),
+                                      has_offset && is_inverted, swizzle.negate_src2 != 0,
+                                      {(u8)swizzle.src2_selector_0.Value(),
+                                       (u8)swizzle.src2_selector_1.Value(),
+                                       (u8)swizzle.src2_selector_2.Value(),
+                                       (u8)swizzle.src2_selector_3.Value()});
+        DecodeDest(decoded, instr.common.dest.Value());
+        for (unsigned i = 0; i < 4; ++i) {
+            if (swizzle.DestComponentEnabled(i))
+                decoded.dest_mask |= 1 << i;
+        }
+        decoded.compare_op = {(u8)instr.common.compare_op.x.Value(),
+                              (u8)instr.common.compare_op.y.Value()};
+        break;
+    }
+
+    case OpCode::Type::MultiplyAdd: {
+        if ((instr.opcode.Value().EffectiveOpCode() != OpCode::Id::MAD) &&
+            (instr.opcode.Value().EffectiveOpCode() != OpCode::Id::MADI)) {
+            decoded.op = DecodedOp::UNHANDLED;
+            break;
+        }
+
+        const SwizzlePattern swizzle = {swizzle_data[instr.mad.operand_desc_id]};
+        const bool is_inverted = (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI);
+        const bool has_offset = instr.mad.address_register_index != 0;
+
+        decoded.op = DecodedOp::MAD;
+        decoded.address_register_index = instr.mad.address_register_index;
+        decoded.src[0] = DecodeSource(instr.mad.GetSrc1(is_inverted), false,
+                                      swizzle.negate_src1 != 0,
+                                      {(u8)swizzle.src1_selector_0.Value(),
+                                       (u8)swizzle.src1_selector_1.Value(),
+                                       (u8)swizzle.src1_selector_2.Value(),
+                                       (u8)swizzle.src1_selector_3.Value()});
+        decoded.src[1] = DecodeSource(instr.mad.GetSrc2(is_inverted),
+                                      has_offset && !is_inverted, swizzle.negate_src2 != 0,
+                                      {(u8)swizzle.src2_selector_0.Value(),
+                                       (u8)swizzle.src2_selector_1.Value(),
+                                       (u8)swizzle.src2_selector_2.Value(),
+                                       (u8)swizzle.src2_selector_3.Value()});
+        decoded.src[2] = DecodeSource(instr.mad.GetSrc3(is_inverted),
+                                      has_offset && is_inverted, swizzle.negate_src3 != 0,
+                                      {(u8)swizzle.src3_selector_0.Value(),
+                                       (u8)swizzle.src3_selector_1.Value(),
+                                       (u8)swizzle.src3_selector_2.Value(),
+                                       (u8)swizzle.src3_selector_3.Value()});
+        DecodeDest(decoded, instr.mad.dest.Value());
+        for (unsigned i = 0; i < 4; ++i) {
+            if (swizzle.DestComponentEnabled(i))
+                decoded.dest_mask |= 1 << i;
+        }
+        break;
+    }
+
+    default:
+        decoded.op = DecodeFlowControlOp(instr.opcode.Value());
+        decoded.dest_offset = instr.flow_control.dest_offset;
+        decoded.num_instructions = instr.flow_control.num_instructions;
+        decoded.uniform_id = (instr.opcode.Value() == OpCode::Id::LOOP)
+                                 ? instr.flow_control.int_uniform_id
+                                 : instr.flow_control.bool_uniform_id;
+        decoded.condition_op = instr.flow_control.op;
+        decoded.refx = instr.flow_control.refx.Value();
+        decoded.refy = instr.flow_control.refy.Value();
+        decoded.vertex_id = static_cast<u8>(instr.setemit.vertex_id.Value());
+        decoded.prim_emit = instr.setemit.prim_emit != 0;
+        decoded.winding = instr.setemit.winding != 0;
+        break;
+    }
+
+    return decoded;
+}
+
+static std::unique_ptr<DecodedProgram> DecodeProgram(const ShaderSetup& setup) {
+    auto program = std::make_unique<DecodedProgram>();
+    for (unsigned offset = 0; offset < MAX_PROGRAM_CODE_LENGTH; ++offset) {
+        program->instructions[offset] =
+            DecodeInstruction({setup.program_code[offset]}, setup.swizzle_data);
+    }
+    program->instructions[MAX_PROGRAM_CODE_LENGTH] = {};
+    program->instructions[MAX_PROGRAM_CODE_LENGTH].op = DecodedOp::END;
+    return program;
+}
+
+static const float24* LookupSourceRegister(const UnitState& state, const ShaderSetup& setup,
+                                           const SourceRegister& source_reg) {
+    switch (source_reg.GetRegisterType()) {
+    case RegisterType::Input:
+        return &state.registers.input[source_reg.GetIndex()].x;
+
+    case RegisterType::Temporary:
+        return &state.registers.temporary[source_reg.GetIndex()].x;
+
+    case RegisterType::FloatUniform:
+        return &setup.uniforms.f[source_reg.GetIndex()].x;
+
+    default:
+        return dummy_vec4_float24;
+    }
+}
+
+/// Returns the register read by a source operand, indexed by SourceFile in `files`
+static FORCE_INLINE const float24* GetSourceRegister(const DecodedInstruction& instr,
+                                                     unsigned index,
+                                                     const float24* const* files,
+                                                     const UnitState& state,
+                                                     const ShaderSetup& setup) {
+    const DecodedSource& src = instr.src[index];
+    if (src.relative) {
+        const int address_offset = state.address_registers[instr.address_register_index - 1];
+        return LookupSourceRegister(state, setup, src.reg + address_offset);
+    }
+    return files[src.file] + 4 * src.index;
+}
+
+/// Returns a component of a source operand, swizzled and negated
+static FORCE_INLINE float24 GetSourceComponent(const DecodedSource& src, const float24* reg,
+                                               unsigned component) {
+    const float24 value = reg[src.selector[component]];
+    return src.negate ? -value : value;
+}
+
+/**
+ * Runs a pre-decoded program, which behaves as RunInterpreter without debug data. Instead of
+ * decoding every instruction when it is executed, each one dispatches straight to the handler of
+ * the next, and only the enabled components of the destination are computed.
+ */
+static void RunDecodedProgram(const DecodedProgram& program, const ShaderSetup& setup,
+                              UnitState& state, unsigned offset) {
+    boost::container::static_vector<CallStackElement, 16> call_stack;
+    u32 program_counter = offset;
+
+    // Address at which the innermost call returns, cached out of the call stack
+    constexpr u32 NO_FINAL_ADDRESS = 0xFFFFFFFF;
+    u32 final_address = NO_FINAL_ADDRESS;
+
+    state.conditional_code[0] = false;
+    state.conditional_code[1] = false;
+
+    auto call = [&](u32 offset, u32 num_instructions, u32 return_offset, u8 repeat_count,
+                    u8 loop_increment) {
+        // -1 to make sure when incrementing the PC we end up at the correct offset
+        program_counter = offset - 1;
+        ASSERT(call_stack.size() < call_stack.capacity());
+        call_stack.push_back(
+            {offset + num_instructions, return_offset, repeat_count, loop_increment, offset});
+        final_address = offset + num_instructions;
+    };
+
+    auto evaluate_condition = [&state](const DecodedInstruction& instr) {
+        using Op = Instruction::FlowControlType::Op;
+
+        bool result_x = instr.refx == state.conditional_code[0];
+        bool result_y = instr.refy == state.conditional_code[1];
+
+        switch (instr.condition_op) {
+        case Op::Or:
+            return result_x || result_y;
+        case Op::And:
+            return result_x && result_y;
+        case Op::JustX:
+            return result_x;
+        case Op::JustY:
+            return result_y;
+        default:
+            UNREACHABLE();
+            return false;
+        }
+    };
+
+    const auto& uniforms = setup.uniforms;
+
+    const float24* const source_files[] = {
+        &state.registers.input[0].x, &state.registers.temporary[0].x, &uniforms.f[0].x,
+        dummy_vec4_float24,
+    };
+    float24* const dest_files[] = {
+        &state.registers.output[0].x, &state.registers.temporary[0].x, dummy_vec4_float24,
+    };
+
+    const DecodedInstruction* instr = nullptr;
+    const float24* src1 = nullptr;
+    const float24* src2 = nullptr;
+    const float24* src3 = nullptr;
+    float24* dest = nullptr;
+    float24 result[4];
+    float24 dot;
+
+// GCC and Clang have a C++ extension to support a lookup table of labels. Otherwise, fallback to a
+// switch statement.
+#if defined __GNUC__ || defined __clang__
+#define DECODED_OP_LABEL(name) &&OP_##name,
+    static const void* const op_labels[] = {DECODED_OPS(DECODED_OP_LABEL)};
+#undef DECODED_OP_LABEL
+#define GOTO_OP(op) goto* op_labels[static_cast<size_t>(op)]
+#else
+#define DECODED_OP_CASE(name)                                                                      \
+    case DecodedOp::name:                                                                          \
+        goto OP_##name;
+#define GOTO_OP(op)                                                                                \
+    switch (op) { DECODED_OPS(DECODED_OP_CASE) }                                                   \
+    UNREACHABLE()
+#endif
+
+#define DISPATCH()                                                                                 \
+    if (program_counter == final_address)                                                          \
+        goto RETURN;                                                                               \
+    instr = &program.instructions[program_counter];                                                \
+    GOTO_OP(instr->op)
+
+#define NEXT()                                                                                     \
+    ++program_counter;                                                                             \
+    DISPATCH()
+
+#define LOAD_SOURCES(count)                                                                        \
+    src1 = GetSourceRegister(*instr, 0, source_files, state, setup);                              \
+    if (count > 1)                                                                                 \
+        src2 = GetSourceRegister(*instr, 1, source_files, state, setup);                          \
+    if (count > 2)                                                                                 \
+        src3 = GetSourceRegister(*instr, 2, source_files, state, setup);                          \
+    dest = dest_files[instr->dest_file] + 4 * instr->dest_index
+
+#define SRC1(i) GetSourceComponent(instr->src[0], src1, i)
+#define SRC2(i) GetSourceComponent(instr->src[1], src2, i)
+#define SRC3(i) GetSourceComponent(instr->src[2], src3, i)
+
+// Computes the enabled components of the destination before writing any of them, as they may be
+// read by the sources
+#define FOR_EACH_ENABLED_COMPONENT(i)                                                              \
+    for (unsigned i = 0; i < 4; ++i)                                                               \
+        if (instr->dest_mask & (1 << i))
+
+#define WRITE_RESULT()                                                                             \
+    FOR_EACH_ENABLED_COMPONENT(i) {                                                                \
+        dest[i] = result[i];                                                                       \
+    }                                                                                              \
+    NEXT()
+
+#define WRITE_SCALAR_RESULT(value)                                                                 \
+    dot = value;                                                                                   \
+    FOR_EACH_ENABLED_COMPONENT(i) {                                                                \
+        dest[i] = dot;                                                                             \
+    }                                                                                              \
+    NEXT()
+
+    DISPATCH();
+
+RETURN : {
+    auto& top = call_stack.back();
+    state.address_registers[2] += top.loop_increment;
+
+    if (top.repeat_counter-- == 0) {
+        program_counter = top.return_address;
+        call_stack.pop_back();
+        final_address = call_stack.empty() ? NO_FINAL_ADDRESS : call_stack.back().final_address;
+    } else {
+        program_counter = top.loop_address;
+    }
+
+    // TODO: Is "trying again" accurate to hardware?
+    DISPATCH();
+}
+
+OP_ADD:
+    LOAD_SOURCES(2);
+    FOR_EACH_ENABLED_COMPONENT(i) {
+        result[i] = SRC1(i) + SRC2(i);
+    }
+    WRITE_RESULT();
+
+OP_MUL:
+    LOAD_SOURCES(2);
+    FOR_EACH_ENABLED_COMPONENT(i) {
+        result[i] = SRC1(i) * SRC2(i);
+    }
+    WRITE_RESULT();
+
+OP_FLR:
+    LOAD_SOURCES(1);
+    FOR_EACH_ENABLED_COMPONENT(i) {
+        result[i] = float24::FromFloat32(std::floor(SRC1(i).ToFloat32()));
+    }
+    WRITE_RESULT();
+
+OP_MAX:
+    LOAD_SOURCES(2);
+    FOR_EACH_ENABLED_COMPONENT(i) {
+        // NOTE: Exact form required to match NaN semantics to hardware:
+        //   max(0, NaN) -> NaN
+        //   max(NaN, 0) -> 0
+        float24 a = SRC1(i), b = SRC2(i);
+        result[i] = (a > b) ? a : b;
+    }
+    WRITE_RESULT();
+
+OP_MIN:
+    LOAD_SOURCES(2);
+    FOR_EACH_ENABLED_COMPONENT(i) {
+        // NOTE: Exact form required to match NaN semantics to hardware:
+        //   min(0, NaN) -> NaN
+        //   min(NaN, 0) -> 0
+        float24 a = SRC1(i), b = SRC2(i);
+        result[i] = (a < b) ? a : b;
+    }
+    WRITE_RESULT();
+
+OP_DP3:
+    LOAD_SOURCES(2);
+    WRITE_SCALAR_RESULT(float24::FromFloat32(0.f) + SRC1(0) * SRC2(0) + SRC1(1) * SRC2(1) +
+                        SRC1(2) * SRC2(2));
+
+OP_DP4:
+    LOAD_SOURCES(2);
+    WRITE_SCALAR_RESULT(float24::FromFloat32(0.f) + SRC1(0) * SRC2(0) + SRC1(1) * SRC2(1) +
+                        SRC1(2) * SRC2(2) + SRC1(3) * SRC2(3));
+
+OP_DPH:
+    LOAD_SOURCES(2);
+    WRITE_SCALAR_RESULT(float24::FromFloat32(0.f) + SRC1(0) * SRC2(0) + SRC1(1) * SRC2(1) +
+                        SRC1(2) * SRC2(2) + float24::FromFloat32(1.0f) * SRC2(3));
+
+OP_RCP:
+    LOAD_SOURCES(1);
+    WRITE_SCALAR_RESULT(float24::FromFloat32(1.0f / SRC1(0).ToFloat32()));
+
+OP_RSQ:
+    LOAD_SOURCES(1);
+    WRITE_SCALAR_RESULT(float24::FromFloat32(1.0f / std::sqrt(SRC1(0).ToFloat32())));
+
+OP_MOVA:
+    LOAD_SOURCES(1);
+    for (unsigned i = 0; i < 2; ++i) {
+        if (instr->dest_mask & (1 << i)) {
+            // TODO: Figure out how the rounding is done on hardware
+            state.address_registers[i] = static_cast<s32>(SRC1(i).ToFloat32());
+        }
+    }
+    NEXT();
+
+OP_MOV:
+    LOAD_SOURCES(1);
+    FOR_EACH_ENABLED_COMPONENT(i) {
+        result[i] = SRC1(i);
+    }
+    WRITE_RESULT();
+
+OP_SGE:
+    LOAD_SOURCES(2);
+    FOR_EACH_ENABLED_COMPONENT(i) {
+        result[i] =
+            (SRC1(i) >= SRC2(i)) ? float24::FromFloat32(1.0f) : float24::FromFloat32(0.0f);
+    }
+    WRITE_RESULT();
+
+OP_SLT:
+    LOAD_SOURCES(2);
+    FOR_EACH_ENABLED_COMPONENT(i) {
+        result[i] = (SRC1(i) < SRC2(i)) ? float24::FromFloat32(1.0f) : float24::FromFloat32(0.0f);
+    }
+    WRITE_RESULT();
+
+OP_CMP:
+    LOAD_SOURCES(2);
+    for (unsigned i = 0; i < 2; ++i) {
+        const float24 a = SRC1(i), b = SRC2(i);
+
+        switch (instr->compare_op[i]) {
+        case Instruction::Common::CompareOpType::Equal:
+            state.conditional_code[i] = (a == b);
+            break;
+
+        case Instruction::Common::CompareOpType::NotEqual:
+            state.conditional_code[i] = (a != b);
+            break;
+
+        case Instruction::Common::CompareOpType::LessThan:
+            state.conditional_code[i] = (a < b);
+            break;
+
+        case Instruction::Common::CompareOpType::LessEqual:
+            state.conditional_code[i] = (a <= b);
+            break;
+
+        case Instruction::Common::CompareOpType::GreaterThan:
+            state.conditional_code[i] = (a > b);
+            break;
+
+        case Instruction::Common::CompareOpType::GreaterEqual:
+            state.conditional_code[i] = (a >= b);
+            break;
+
+        default:
+            LOG_ERROR(HW_GPU, "Unknown compare mode %x", static_cast<int>(instr->compare_op[i]));
+            break;
+        }
+    }
+    NEXT();
+
+OP_EX2:
+    // EX2 only takes first component exp2 and writes it to all dest components
+    LOAD_SOURCES(1);
+    WRITE_SCALAR_RESULT(float24::FromFloat32(std::exp2(SRC1(0).ToFloat32())));
+
+OP_LG2:
+    // LG2 only takes the first component log2 and writes it to all dest components
+    LOAD_SOURCES(1);
+    WRITE_SCALAR_RESULT(float24::FromFloat32(std::log2(SRC1(0).ToFloat32())));
+
+OP_MAD:
+    LOAD_SOURCES(3);
+    FOR_EACH_ENABLED_COMPONENT(i) {
+        result[i] = SRC1(i) * SRC2(i) + SRC3(i);
+    }
+    WRITE_RESULT();
+
+OP_END:
+    return;
+
+OP_JMPC:
+    if (evaluate_condition(*instr)) {
+        program_counter = instr->dest_offset - 1;
+    }
+    NEXT();
+
+OP_JMPU:
+    if (uniforms.b[instr->uniform_id] == !(instr->num_instructions & 1)) {
+        program_counter = instr->dest_offset - 1;
+    }
+    NEXT();
+
+OP_CALL:
+    call(instr->dest_offset, instr->num_instructions, program_counter + 1, 0, 0);
+    NEXT();
+
+OP_CALLU:
+    if (uniforms.b[instr->uniform_id]) {
+        call(instr->dest_offset, instr->num_instructions, program_counter + 1, 0, 0);
+    }
+    NEXT();
+
+OP_CALLC:
+    if (evaluate_condition(*instr)) {
+        call(instr->dest_offset, instr->num_instructions, program_counter + 1, 0, 0);
+    }
+    NEXT();
+
+OP_NOP:
+    NEXT();
+
+OP_IFU:
+    if (uniforms.b[instr->uniform_id]) {
+        call(program_counter + 1, instr->dest_offset - program_counter - 1,
+             instr->dest_offset + instr->num_instructions, 0, 0);
+    } else {
+        call(instr->dest_offset, instr->num_instructions,
+             instr->dest_offset + instr->num_instructions, 0, 0);
+    }
+    NEXT();
+
+OP_IFC:
+    if (evaluate_condition(*instr)) {
+        call(program_counter + 1, instr->dest_offset - program_counter - 1,
+             instr->dest_offset + instr->num_instructions, 0, 0);
+    } else {
+        call(instr->dest_offset, instr->num_instructions,
+             instr->dest_offset + instr->num_instructions, 0, 0);
+    }
+    NEXT();
+
+OP_LOOP : {
+    const auto& loop_param = uniforms.i[instr->uniform_id];
+    state.address_registers[2] = loop_param.y;
+
+    call(program_counter + 1, instr->dest_offset - program_counter + 1, instr->dest_offset + 1,
+         loop_param.x, loop_param.z);
+    NEXT();
+}
+
+OP_EMIT : {
+    GSEmitter* emitter = state.emitter_ptr;
+    ASSERT_MSG(emitter, "Execute EMIT on VS");
+    emitter->Emit(state.registers.output);
+    NEXT();
+}
+
+OP_SETEMIT : {
+    GSEmitter* emitter = state.emitter_ptr;
+    ASSERT_MSG(emitter, "Execute SETEMIT on VS");
+    emitter->vertex_id = instr->vertex_id;
+    emitter->prim_emit = instr->prim_emit;
+    emitter->winding = instr->winding;
+    NEXT();
+}
+
+OP_UNHANDLED : {
+    const Instruction raw_instr = {instr->hex};
+    LOG_ERROR(HW_GPU, "Unhandled instruction: 0x%02x (%s): 0x%08x",
+              (int)raw_instr.opcode.Value().EffectiveOpCode(),
+              raw_instr.opcode.Value().GetInfo().name, raw_instr.hex);
+    NEXT();
+}
+
+#undef WRITE_SCALAR_RESULT
+#undef WRITE_RESULT
+#undef FOR_EACH_ENABLED_COMPONENT
+#undef SRC3
+#undef SRC2
+#undef SRC1
+#undef LOAD_SOURCES
+#undef NEXT
+#undef DISPATCH
+#undef GOTO_OP
+#ifdef DECODED_OP_CASE
+#undef DECODED_OP_CASE
+#endif
+}
+
+#undef DECODED_OPS
+
+InterpreterEngine::InterpreterEngine(bool predecode) : predecode(predecode) {}
+InterpreterEngine::~InterpreterEngine() = default;
+
 void InterpreterEngine::SetupBatch(ShaderSetup& setup, unsigned int entry_point) {
     ASSERT(entry_point < MAX_PROGRAM_CODE_LENGTH);
     setup.engine_data.entry_point = entry_point;
+    setup.engine_data.cached_shader = nullptr;
+
+    if (!predecode)
+        return;
+
+    u64 code_hash = Common::ComputeHash64(&setup.program_code, sizeof(setup.program_code));
+    u64 swizzle_hash = Common::ComputeHash64(&setup.swizzle_data, sizeof(setup.swizzle_data));
+
+    u64 cache_key = code_hash ^ swizzle_hash;
+    auto iter = cache.find(cache_key);
+    if (iter != cache.end()) {
+        setup.engine_data.cached_shader = iter->second.get();
+    } else {
+        auto program = DecodeProgram(setup);
+        setup.engine_data.cached_shader = program.get();
+        cache.emplace_hint(iter, cache_key, std::move(program));
+    }
 }
 
 MICROPROFILE_DECLARE(GPU_Shader);
@@ -663,6 +1442,12 @@ void InterpreterEngine::Run(const ShaderSetup& setup, UnitState& state) const {
 
     MICROPROFILE_SCOPE(GPU_Shader);
 
+    if (setup.engine_data.cached_shader != nullptr) {
+        const auto* program = static_cast<const DecodedProgram*>(setup.engine_data.cached_shader);
+        RunDecodedProgram(*program, setup, state, setup.engine_data.entry_point);
+        return;
+    }
+
     DebugData<false> dummy_debug_data;
     RunInterpreter(setup, state, dummy_debug_data, setup.engine_data.entry_point);
 }
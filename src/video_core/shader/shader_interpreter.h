@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <memory>
+#include <unordered_map>
+#include "common/common_types.h"
 #include "video_core/shader/debug_data.h"
 #include "video_core/shader/shader.h"
 
@@ -11,8 +14,17 @@ namespace Pica {
 
 namespace Shader {
 
+struct DecodedProgram;
+
 class InterpreterEngine final : public ShaderEngine {
 public:
+    /**
+     * @param predecode Whether programs are decoded once in SetupBatch rather than on each
+     *                  executed instruction, which is kept as the reference implementation.
+     */
+    explicit InterpreterEngine(bool predecode = true);
+    ~InterpreterEngine() override;
+
     void SetupBatch(ShaderSetup& setup, unsigned int entry_point) override;
     void Run(const ShaderSetup& setup, UnitState& state) const override;
 
@@ -25,6 +37,10 @@ public:
      */
     DebugData<true> ProduceDebugInfo(const ShaderSetup& setup, const AttributeBuffer& input,
                                      const ShaderRegs& config) const;
+
+private:
+    const bool predecode;
+    std::unordered_map<u64, std::unique_ptr<DecodedProgram>> cache;
 };
 
 } // namespace
@@ -2,16 +2,21 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include "common/hash.h"
 #include "common/microprofile.h"
+#include "core/settings.h"
 #include "video_core/shader/shader.h"
 #include "video_core/shader/shader_jit_x64.h"
 #include "video_core/shader/shader_jit_x64_compiler.h"
+#include "video_core/shader/shader_jit_x64_soa_compiler.h"
 
 namespace Pica {
 namespace Shader {
 
-JitX64Engine::JitX64Engine() = default;
+JitX64Engine::JitX64Engine(unsigned soa_lanes)
+    : soa_state(std::make_unique<SoaUnitState>()),
+      soa_lanes(soa_lanes != 0 ? soa_lanes : JitSoaShader::GetMaxLaneCount()) {}
 JitX64Engine::~JitX64Engine() = default;
 
 void JitX64Engine::SetupBatch(ShaderSetup& setup, unsigned int entry_point) {
@@ -21,15 +26,37 @@ void JitX64Engine::SetupBatch(ShaderSetup& setup, unsigned int entry_point) {
     u64 code_hash = Common::ComputeHash64(&setup.program_code, sizeof(setup.program_code));
     u64 swizzle_hash = Common::ComputeHash64(&setup.swizzle_data, sizeof(setup.swizzle_data));
 
+    JitShaderSpecialization specialization{};
+    specialization.entry_point = entry_point;
+    specialization.output_mask = setup.output_mask;
+    if (Settings::values.use_shader_jit_specialization) {
+        specialization.specialize_uniforms = true;
+        std::copy(setup.uniforms.b.begin(), setup.uniforms.b.end(),
+                  specialization.bool_uniforms.begin());
+        specialization.int_uniforms = setup.uniforms.i;
+    }
+
     u64 cache_key = code_hash ^ swizzle_hash;
-    auto iter = cache.find(cache_key);
+    u64 specialized_cache_key = cache_key ^ specialization.Hash();
+    auto iter = cache.find(specialized_cache_key);
     if (iter != cache.end()) {
         setup.engine_data.cached_shader = iter->second.get();
     } else {
         auto shader = std::make_unique<JitShader>();
-        shader->Compile(&setup.program_code, &setup.swizzle_data);
+        shader->Compile(&setup.program_code, &setup.swizzle_data, specialization);
         setup.engine_data.cached_shader = shader.get();
-        cache.emplace_hint(iter, cache_key, std::move(shader));
+        cache.emplace_hint(iter, specialized_cache_key, std::move(shader));
+    }
+
+    setup.engine_data.cached_soa_shader = nullptr;
+    if (JitSoaShader::IsSupported()) {
+        auto soa_iter = soa_cache.find(cache_key);
+        if (soa_iter == soa_cache.end()) {
+            soa_iter = soa_cache.emplace_hint(
+                soa_iter, cache_key,
+                JitSoaShader::Compile(&setup.program_code, &setup.swizzle_data, soa_lanes));
+        }
+        setup.engine_data.cached_soa_shader = soa_iter->second.get();
     }
 }
 
@@ -44,5 +71,40 @@ void JitX64Engine::Run(const ShaderSetup& setup, UnitState& state) const {
     shader->Run(setup, state, setup.engine_data.entry_point);
 }
 
+void JitX64Engine::RunBatch(const ShaderSetup& setup, UnitState& state, const ShaderRegs& config,
+                            const AttributeBuffer* input, AttributeBuffer* output,
+                            unsigned count) const {
+    const JitSoaShader* soa_shader =
+        static_cast<const JitSoaShader*>(setup.engine_data.cached_soa_shader);
+    const unsigned entry_point = setup.engine_data.entry_point;
+
+    if (soa_shader == nullptr || !soa_shader->CanRunFrom(entry_point) ||
+        !soa_shader->IsEfficient()) {
+        ShaderEngine::RunBatch(setup, state, config, input, output, count);
+        return;
+    }
+
+    MICROPROFILE_SCOPE(GPU_Shader);
+
+    const unsigned lanes = soa_shader->GetLaneCount();
+    for (unsigned first = 0; first < count; first += lanes) {
+        const unsigned group_size = std::min(lanes, count - first);
+
+        soa_state->LoadInput(config, input + first, group_size);
+        if (soa_shader->Run(setup, *soa_state, entry_point)) {
+            soa_state->WriteOutput(config, output + first, group_size);
+            continue;
+        }
+
+        // The vertices took different paths, process them one at a time instead
+        const JitShader* shader = static_cast<const JitShader*>(setup.engine_data.cached_shader);
+        for (unsigned i = first; i < first + group_size; ++i) {
+            state.LoadInput(config, input[i]);
+            shader->Run(setup, state, entry_point);
+            state.WriteOutput(config, output[i]);
+        }
+    }
+}
+
 } // namespace Shader
 } // namespace Pica
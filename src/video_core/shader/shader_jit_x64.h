@@ -13,17 +13,30 @@ namespace Pica {
 namespace Shader {
 
 class JitShader;
+class JitSoaShader;
+struct SoaUnitState;
 
 class JitX64Engine final : public ShaderEngine {
 public:
-    JitX64Engine();
+    /**
+     * @param soa_lanes Number of vertices processed per run of the shaders compiled for batches, or
+     *                  0 to process as many as the host CPU supports
+     */
+    explicit JitX64Engine(unsigned soa_lanes = 0);
     ~JitX64Engine() override;
 
     void SetupBatch(ShaderSetup& setup, unsigned int entry_point) override;
     void Run(const ShaderSetup& setup, UnitState& state) const override;
+    void RunBatch(const ShaderSetup& setup, UnitState& state, const ShaderRegs& config,
+                  const AttributeBuffer* input, AttributeBuffer* output,
+                  unsigned count) const override;
 
 private:
     std::unordered_map<u64, std::unique_ptr<JitShader>> cache;
+    /// Shaders compiled to process several vertices at once, null for those that can't be
+    std::unordered_map<u64, std::unique_ptr<JitSoaShader>> soa_cache;
+    std::unique_ptr<SoaUnitState> soa_state;
+    unsigned soa_lanes;
 };
 
 } // namespace Shader
@@ -5,10 +5,12 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <numeric>
 #include <nihstro/shader_bytecode.h>
 #include <smmintrin.h>
 #include <xmmintrin.h>
 #include "common/assert.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/vector_math.h"
 #include "common/x64/cpu_detect.h"
@@ -75,8 +77,8 @@ const JitFunction instr_table[64] = {
     &JitShader::Compile_IF,    // ifu
     &JitShader::Compile_IF,    // ifc
     &JitShader::Compile_LOOP,  // loop
-    nullptr,                   // emit
-    nullptr,                   // sete
+    &JitShader::Compile_EMIT,  // emit
+    &JitShader::Compile_SETE,  // sete
     &JitShader::Compile_JMP,   // jmpc
     &JitShader::Compile_JMP,   // jmpu
     &JitShader::Compile_CMP,   // cmp
@@ -130,6 +132,8 @@ static const Xmm SRC2 = xmm2;
 static const Xmm SRC3 = xmm3;
 /// Additional scratch register
 static const Xmm SCRATCH2 = xmm4;
+/// Registers holding the float uniforms read most often by the program, see Compile_HoistUniforms
+static const Xmm UNIFORM_REGS[] = {xmm5, xmm6, xmm7, xmm8, xmm9, xmm10, xmm11, xmm12, xmm13};
 /// Constant vector of [1.0f, 1.0f, 1.0f, 1.0f], used to efficiently set a vector to one
 static const Xmm ONE = xmm14;
 /// Constant vector of [-0.f, -0.f, -0.f, -0.f], used to efficiently negate a vector with XOR
@@ -137,7 +141,8 @@ static const Xmm NEGBIT = xmm15;
 
 // State registers that must not be modified by external functions calls
 // Scratch registers, e.g., SRC1 and SCRATCH, have to be saved on the side if needed
-static const BitSet32 persistent_regs = BuildRegSet({
+// The registers holding hoisted uniforms are added to these for each program
+static const BitSet32 fixed_persistent_regs = BuildRegSet({
     // Pointers to register blocks
     SETUP, STATE,
     // Cached registers
@@ -153,6 +158,10 @@ static const u8 NO_SRC_REG_SWIZZLE = 0x1b;
 /// Raw constant for the destination register enable mask that indicates all components are enabled
 static const u8 NO_DEST_REG_MASK = 0xf;
 
+u64 JitShaderSpecialization::Hash() const {
+    return Common::ComputeHash64(this, sizeof(*this));
+}
+
 static void LogCritical(const char* msg) {
     LOG_CRITICAL(HW_GPU, "%s", msg);
 }
@@ -206,7 +215,12 @@ void JitShader::Compile_SwizzleSrc(Instruction instr, unsigned src_num, SourceRe
         address_register_index = instr.common.address_register_index;
     }
 
-    if (src_num == offset_src && address_register_index != 0) {
+    const bool relative = src_num == offset_src && address_register_index != 0;
+    const int uniform_reg = src_reg.GetRegisterType() == RegisterType::FloatUniform
+                                ? uniform_registers[src_reg.GetIndex()]
+                                : -1;
+
+    if (relative) {
         switch (address_register_index) {
         case 1: // address offset 1
             movaps(dest, xword[src_ptr + ADDROFFS_REG_0 + src_offset_disp]);
@@ -221,6 +235,9 @@ void JitShader::Compile_SwizzleSrc(Instruction instr, unsigned src_num, SourceRe
             UNREACHABLE();
             break;
         }
+    } else if (uniform_reg >= 0) {
+        // The uniform was loaded on entry to the program
+        movaps(dest, Xmm(uniform_reg));
     } else {
         // Load the source
         movaps(dest, xword[src_ptr + src_offset_disp]);
@@ -228,9 +245,16 @@ void JitShader::Compile_SwizzleSrc(Instruction instr, unsigned src_num, SourceRe
 
     SwizzlePattern swiz = {(*swizzle_data)[operand_desc_id]};
 
-    // Generate instructions for source register swizzling as needed
+    // Generate instructions for source register swizzling as needed. Components which aren't read
+    // by the instruction don't need to be swizzled.
     u8 sel = swiz.GetRawSelector(src_num);
-    if (sel != NO_SRC_REG_SWIZZLE) {
+    const u8 used_components = instr_info->used_src_components[src_num - 1];
+    bool identity = true;
+    for (unsigned i = 0; i < 4; ++i) {
+        if ((used_components & (1 << i)) && ((sel >> (6 - 2 * i)) & 3) != i)
+            identity = false;
+    }
+    if (sel != NO_SRC_REG_SWIZZLE && !identity) {
         // Selector component order needs to be reversed for the SHUFPS instruction
         sel = ((sel & 0xc0) >> 6) | ((sel & 3) << 6) | ((sel & 0xc) << 2) | ((sel & 0x30) >> 2);
 
@@ -261,8 +285,15 @@ void JitShader::Compile_DestEnable(Instruction instr, Xmm src) {
 
     size_t dest_offset_disp = UnitState::OutputOffset(dest);
 
+    // Components which aren't enabled may be overwritten if they are never read afterwards
+    bool overwrite_all = true;
+    for (unsigned i = 0; i < 4; ++i) {
+        if (!swiz.DestComponentEnabled(i) && (instr_info->live_dest_components & (1 << i)))
+            overwrite_all = false;
+    }
+
     // If all components are enabled, write the result to the destination register
-    if (swiz.dest_mask == NO_DEST_REG_MASK) {
+    if (swiz.dest_mask == NO_DEST_REG_MASK || overwrite_all) {
         // Store dest back to memory
         movaps(xword[STATE + dest_offset_disp], src);
 
@@ -351,6 +382,29 @@ void JitShader::Compile_UniformCondition(Instruction instr) {
     cmp(byte[SETUP + offset], 0);
 }
 
+void JitShader::Compile_HoistUniforms() {
+    uniform_registers.fill(-1);
+    persistent_regs = fixed_persistent_regs;
+
+    std::array<unsigned, 96> uniforms;
+    std::iota(uniforms.begin(), uniforms.end(), 0);
+    std::stable_sort(uniforms.begin(), uniforms.end(), [this](unsigned a, unsigned b) {
+        return analysis.uniform_reads[a] > analysis.uniform_reads[b];
+    });
+
+    for (size_t i = 0; i < ARRAY_SIZE(UNIFORM_REGS); ++i) {
+        const unsigned uniform = uniforms[i];
+        // A single read gains nothing from being moved out of the program
+        if (analysis.uniform_reads[uniform] < 2)
+            break;
+
+        const Xmm reg = UNIFORM_REGS[i];
+        movaps(reg, xword[SETUP + ShaderSetup::GetFloatUniformOffset(uniform)]);
+        uniform_registers[uniform] = reg.getIdx();
+        persistent_regs |= BuildRegSet({reg});
+    }
+}
+
 BitSet32 JitShader::PersistentCallerSavedRegs() {
     return persistent_regs & ABI_ALL_CALLER_SAVED;
 }
@@ -621,6 +675,12 @@ void JitShader::Compile_CALLC(Instruction instr) {
 }
 
 void JitShader::Compile_CALLU(Instruction instr) {
+    if (specialization->specialize_uniforms) {
+        if (specialization->bool_uniforms[instr.flow_control.bool_uniform_id])
+            Compile_CALL(instr);
+        return;
+    }
+
     Compile_UniformCondition(instr);
     Label b;
     jz(b);
@@ -694,12 +754,18 @@ void JitShader::Compile_IF(Instruction instr) {
     Label l_else, l_endif;
 
     // Evaluate the "IF" condition
-    if (instr.opcode.Value() == OpCode::Id::IFU) {
-        Compile_UniformCondition(instr);
-    } else if (instr.opcode.Value() == OpCode::Id::IFC) {
-        Compile_EvaluateCondition(instr);
+    if (instr.opcode.Value() == OpCode::Id::IFU && specialization->specialize_uniforms) {
+        // The block which isn't taken is still compiled, as jumps may lead into it
+        if (!specialization->bool_uniforms[instr.flow_control.bool_uniform_id])
+            jmp(l_else, T_NEAR);
+    } else {
+        if (instr.opcode.Value() == OpCode::Id::IFU) {
+            Compile_UniformCondition(instr);
+        } else if (instr.opcode.Value() == OpCode::Id::IFC) {
+            Compile_EvaluateCondition(instr);
+        }
+        jz(l_else, T_NEAR);
     }
-    jz(l_else, T_NEAR);
 
     // Compile the code that corresponds to the condition evaluating as true
     Compile_Block(instr.flow_control.dest_offset);
@@ -730,16 +796,23 @@ void JitShader::Compile_LOOP(Instruction instr) {
     // This decodes the fields from the integer uniform at index instr.flow_control.int_uniform_id.
     // The Y (LOOPCOUNT_REG) and Z (LOOPINC) component are kept multiplied by 16 (Left shifted by
     // 4 bits) to be used as an offset into the 16-byte vector registers later
-    size_t offset = ShaderSetup::GetIntUniformOffset(instr.flow_control.int_uniform_id);
-    mov(LOOPCOUNT, dword[SETUP + offset]);
-    mov(LOOPCOUNT_REG, LOOPCOUNT);
-    shr(LOOPCOUNT_REG, 4);
-    and_(LOOPCOUNT_REG, 0xFF0); // Y-component is the start
-    mov(LOOPINC, LOOPCOUNT);
-    shr(LOOPINC, 12);
-    and_(LOOPINC, 0xFF0);               // Z-component is the incrementer
-    movzx(LOOPCOUNT, LOOPCOUNT.cvt8()); // X-component is iteration count
-    add(LOOPCOUNT, 1);                  // Iteration count is X-component + 1
+    if (specialization->specialize_uniforms) {
+        const auto& loop_param = specialization->int_uniforms[instr.flow_control.int_uniform_id];
+        mov(LOOPCOUNT_REG, loop_param.y * 16);
+        mov(LOOPINC, loop_param.z * 16);
+        mov(LOOPCOUNT, loop_param.x + 1);
+    } else {
+        size_t offset = ShaderSetup::GetIntUniformOffset(instr.flow_control.int_uniform_id);
+        mov(LOOPCOUNT, dword[SETUP + offset]);
+        mov(LOOPCOUNT_REG, LOOPCOUNT);
+        shr(LOOPCOUNT_REG, 4);
+        and_(LOOPCOUNT_REG, 0xFF0); // Y-component is the start
+        mov(LOOPINC, LOOPCOUNT);
+        shr(LOOPINC, 12);
+        and_(LOOPINC, 0xFF0);               // Z-component is the incrementer
+        movzx(LOOPCOUNT, LOOPCOUNT.cvt8()); // X-component is iteration count
+        add(LOOPCOUNT, 1);                  // Iteration count is X-component + 1
+    }
 
     Label l_loop_start;
     L(l_loop_start);
@@ -754,6 +827,13 @@ void JitShader::Compile_LOOP(Instruction instr) {
 }
 
 void JitShader::Compile_JMP(Instruction instr) {
+    if (instr.opcode.Value() == OpCode::Id::JMPU && specialization->specialize_uniforms) {
+        const bool value = specialization->bool_uniforms[instr.flow_control.bool_uniform_id];
+        if (value != (instr.flow_control.num_instructions & 1))
+            jmp(instruction_labels[instr.flow_control.dest_offset], T_NEAR);
+        return;
+    }
+
     if (instr.opcode.Value() == OpCode::Id::JMPC)
         Compile_EvaluateCondition(instr);
     else if (instr.opcode.Value() == OpCode::Id::JMPU)
@@ -772,6 +852,51 @@ void JitShader::Compile_JMP(Instruction instr) {
     }
 }
 
+static void Emit(GSEmitter* emitter, Math::Vec4<float24> (*output)[16]) {
+    emitter->Emit(*output);
+}
+
+void JitShader::Compile_EMIT(Instruction instr) {
+    Label have_emitter, end;
+    mov(rax, qword[STATE + offsetof(UnitState, emitter_ptr)]);
+    test(rax, rax);
+    jnz(have_emitter);
+
+    ABI_PushRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
+    mov(ABI_PARAM1, reinterpret_cast<size_t>("Execute EMIT on VS"));
+    CallFarFunction(*this, LogCritical);
+    ABI_PopRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
+    jmp(end);
+
+    L(have_emitter);
+    ABI_PushRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
+    mov(ABI_PARAM1, rax);
+    mov(ABI_PARAM2, STATE);
+    add(ABI_PARAM2, static_cast<Xbyak::uint32>(offsetof(UnitState, registers.output)));
+    CallFarFunction(*this, Emit);
+    ABI_PopRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
+    L(end);
+}
+
+void JitShader::Compile_SETE(Instruction instr) {
+    Label have_emitter, end;
+    mov(rax, qword[STATE + offsetof(UnitState, emitter_ptr)]);
+    test(rax, rax);
+    jnz(have_emitter);
+
+    ABI_PushRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
+    mov(ABI_PARAM1, reinterpret_cast<size_t>("Execute SETEMIT on VS"));
+    CallFarFunction(*this, LogCritical);
+    ABI_PopRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
+    jmp(end);
+
+    L(have_emitter);
+    mov(byte[rax + offsetof(GSEmitter, vertex_id)], instr.setemit.vertex_id);
+    mov(byte[rax + offsetof(GSEmitter, prim_emit)], instr.setemit.prim_emit);
+    mov(byte[rax + offsetof(GSEmitter, winding)], instr.setemit.winding);
+    L(end);
+}
+
 void JitShader::Compile_Block(unsigned end) {
     while (program_counter < end) {
         Compile_NextInstr();
@@ -797,8 +922,14 @@ void JitShader::Compile_NextInstr() {
 
     L(instruction_labels[program_counter]);
 
+    instr_info = &analysis.instructions[program_counter];
     Instruction instr = {(*program_code)[program_counter++]};
 
+    if (instr_info->dead) {
+        // Nothing reads the result of the instruction
+        return;
+    }
+
     OpCode::Id opcode = instr.opcode.Value();
     auto instr_func = instr_table[static_cast<unsigned>(opcode)];
 
@@ -835,9 +966,14 @@ void JitShader::FindReturnOffsets() {
 }
 
 void JitShader::Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code_,
-                        const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data_) {
+                        const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data_,
+                        const JitShaderSpecialization& specialization_) {
     program_code = program_code_;
     swizzle_data = swizzle_data_;
+    specialization = &specialization_;
+
+    analysis = AnalyzeProgram(*program_code, *swizzle_data, specialization->entry_point,
+                              static_cast<u16>(specialization->output_mask));
 
     // Reset flow control state
     program = (CompiledShader*)getCurr();
@@ -872,6 +1008,8 @@ void JitShader::Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_
     mov(rax, reinterpret_cast<size_t>(&neg));
     movaps(NEGBIT, xword[rax]);
 
+    Compile_HoistUniforms();
+
     // Jump to start of the shader program
     jmp(ABI_PARAM3);
 
@@ -881,6 +1019,9 @@ void JitShader::Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_
     // Free memory that's no longer needed
     program_code = nullptr;
     swizzle_data = nullptr;
+    specialization = nullptr;
+    instr_info = nullptr;
+    analysis = {};
     return_offsets.clear();
     return_offsets.shrink_to_fit();
 
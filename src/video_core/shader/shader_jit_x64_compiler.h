@@ -6,13 +6,17 @@
 
 #include <array>
 #include <cstddef>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <nihstro/shader_bytecode.h>
 #include <xbyak.h>
 #include "common/bit_set.h"
+#include "common/common_funcs.h"
 #include "common/common_types.h"
+#include "common/vector_math.h"
 #include "video_core/shader/shader.h"
+#include "video_core/shader/shader_analysis.h"
 
 using nihstro::Instruction;
 using nihstro::OpCode;
@@ -25,6 +29,24 @@ namespace Shader {
 /// Memory allocated for each compiled shader
 constexpr size_t MAX_SHADER_SIZE = MAX_PROGRAM_CODE_LENGTH * 64;
 
+/// Properties of the context in which a program runs, which its compiled code is specialized on
+struct JitShaderSpecialization {
+    /// Offset at which the program is started
+    u32 entry_point;
+    /// Output registers read once the program ends, the others aren't computed
+    u32 output_mask;
+    /// Values of the bool and int uniforms, compiled in as constants if specialize_uniforms is set
+    std::array<u8, 16> bool_uniforms;
+    std::array<Math::Vec4<u8>, 4> int_uniforms;
+    bool specialize_uniforms;
+    INSERT_PADDING_BYTES(3);
+
+    /// Hash of the properties, to be combined with that of the program in cache keys
+    u64 Hash() const;
+};
+static_assert(std::is_trivially_copyable<JitShaderSpecialization>::value,
+              "JitShaderSpecialization is hashed byte by byte");
+
 /**
  * This class implements the shader JIT compiler. It recompiles a Pica shader program into x86_64
  * code that can be executed on the host machine directly.
@@ -38,7 +60,8 @@ public:
     }
 
     void Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code,
-                 const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data);
+                 const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data,
+                 const JitShaderSpecialization& specialization);
 
     void Compile_ADD(Instruction instr);
     void Compile_DP3(Instruction instr);
@@ -66,6 +89,8 @@ public:
     void Compile_JMP(Instruction instr);
     void Compile_CMP(Instruction instr);
     void Compile_MAD(Instruction instr);
+    void Compile_EMIT(Instruction instr);
+    void Compile_SETE(Instruction instr);
 
 private:
     void Compile_Block(unsigned end);
@@ -84,6 +109,12 @@ private:
     void Compile_EvaluateCondition(Instruction instr);
     void Compile_UniformCondition(Instruction instr);
 
+    /**
+     * Loads the float uniforms read most often into otherwise unused registers, on entry to the
+     * program, so that instructions don't reload them from memory.
+     */
+    void Compile_HoistUniforms();
+
     /**
      * Emits the code to conditionally return from a subroutine envoked by the `CALL` instruction.
      */
@@ -106,6 +137,19 @@ private:
 
     const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code = nullptr;
     const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data = nullptr;
+    const JitShaderSpecialization* specialization = nullptr;
+
+    /// Liveness of the registers, used to skip dead instructions, stores and swizzles
+    ProgramAnalysis analysis;
+    /// Analysis of the instruction being compiled
+    const ProgramAnalysis::InstructionInfo* instr_info = nullptr;
+
+    /// Index of the XMM register holding each float uniform for the whole program, or -1 for
+    /// uniforms which are read from memory
+    std::array<int, 96> uniform_registers;
+
+    /// Registers that must not be modified by external function calls
+    BitSet32 persistent_regs;
 
     /// Mapping of Pica VS instructions to pointers in the emitted code
     std::array<Xbyak::Label, MAX_PROGRAM_CODE_LENGTH> instruction_labels;
@@ -0,0 +1,1296 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <nihstro/shader_bytecode.h>
+#include <smmintrin.h>
+#include <xmmintrin.h>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/vector_math.h"
+#include "common/x64/cpu_detect.h"
+#include "common/x64/xbyak_abi.h"
+#include "common/x64/xbyak_util.h"
+#include "video_core/pica_types.h"
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_jit_x64_soa_compiler.h"
+
+using namespace Common::X64;
+using namespace Xbyak::util;
+using Xbyak::Label;
+using Xbyak::Reg32;
+using Xbyak::Reg64;
+using Xbyak::Xmm;
+
+namespace Pica {
+
+namespace Shader {
+
+void SoaUnitState::LoadInput(const ShaderRegs& config, const AttributeBuffer* input,
+                             unsigned count) {
+    const unsigned max_attribute = config.max_input_attribute_index;
+
+    for (unsigned attr = 0; attr <= max_attribute; ++attr) {
+        auto& reg = registers.input[config.GetRegisterForAttribute(attr)];
+        for (unsigned comp = 0; comp < 4; ++comp) {
+            for (unsigned lane = 0; lane < MAX_SOA_LANES; ++lane) {
+                reg[comp][lane] = input[lane < count ? lane : 0].attr[attr][comp];
+            }
+        }
+    }
+}
+
+void SoaUnitState::WriteOutput(const ShaderRegs& config, AttributeBuffer* output,
+                               unsigned count) const {
+    unsigned int output_i = 0;
+    for (unsigned int reg : Common::BitSet<u32>(config.output_mask)) {
+        for (unsigned comp = 0; comp < 4; ++comp) {
+            for (unsigned lane = 0; lane < count; ++lane) {
+                output[lane].attr[output_i][comp] = registers.output[reg][comp][lane];
+            }
+        }
+        ++output_i;
+    }
+}
+
+typedef void (JitSoaShader::*JitFunction)(Instruction instr);
+
+const JitFunction instr_table[64] = {
+    &JitSoaShader::Compile_ADD,   // add
+    &JitSoaShader::Compile_DP3,   // dp3
+    &JitSoaShader::Compile_DP4,   // dp4
+    &JitSoaShader::Compile_DPH,   // dph
+    nullptr,                      // unknown
+    &JitSoaShader::Compile_EX2,   // ex2
+    &JitSoaShader::Compile_LG2,   // lg2
+    nullptr,                      // unknown
+    &JitSoaShader::Compile_MUL,   // mul
+    &JitSoaShader::Compile_SGE,   // sge
+    &JitSoaShader::Compile_SLT,   // slt
+    &JitSoaShader::Compile_FLR,   // flr
+    &JitSoaShader::Compile_MAX,   // max
+    &JitSoaShader::Compile_MIN,   // min
+    &JitSoaShader::Compile_RCP,   // rcp
+    &JitSoaShader::Compile_RSQ,   // rsq
+    nullptr,                      // unknown
+    nullptr,                      // unknown
+    &JitSoaShader::Compile_MOVA,  // mova
+    &JitSoaShader::Compile_MOV,   // mov
+    nullptr,                      // unknown
+    nullptr,                      // unknown
+    nullptr,                      // unknown
+    nullptr,                      // unknown
+    &JitSoaShader::Compile_DPH,   // dphi
+    nullptr,                      // unknown
+    &JitSoaShader::Compile_SGE,   // sgei
+    &JitSoaShader::Compile_SLT,   // slti
+    nullptr,                      // unknown
+    nullptr,                      // unknown
+    nullptr,                      // unknown
+    nullptr,                      // unknown
+    nullptr,                      // unknown
+    &JitSoaShader::Compile_NOP,   // nop
+    &JitSoaShader::Compile_END,   // end
+    nullptr,                      // break02
+    &JitSoaShader::Compile_CALL,  // call
+    &JitSoaShader::Compile_CALLC, // callc
+    &JitSoaShader::Compile_CALLU, // callu
+    &JitSoaShader::Compile_IF,    // ifu
+    &JitSoaShader::Compile_IF,    // ifc
+    &JitSoaShader::Compile_LOOP,  // loop
+    nullptr,                      // emit
+    nullptr,                      // sete
+    &JitSoaShader::Compile_JMP,   // jmpc
+    &JitSoaShader::Compile_JMP,   // jmpu
+    &JitSoaShader::Compile_CMP,   // cmp
+    &JitSoaShader::Compile_CMP,   // cmp
+    &JitSoaShader::Compile_MAD,   // madi
+    &JitSoaShader::Compile_MAD,   // madi
+    &JitSoaShader::Compile_MAD,   // madi
+    &JitSoaShader::Compile_MAD,   // madi
+    &JitSoaShader::Compile_MAD,   // madi
+    &JitSoaShader::Compile_MAD,   // madi
+    &JitSoaShader::Compile_MAD,   // madi
+    &JitSoaShader::Compile_MAD,   // madi
+    &JitSoaShader::Compile_MAD,   // mad
+    &JitSoaShader::Compile_MAD,   // mad
+    &JitSoaShader::Compile_MAD,   // mad
+    &JitSoaShader::Compile_MAD,   // mad
+    &JitSoaShader::Compile_MAD,   // mad
+    &JitSoaShader::Compile_MAD,   // mad
+    &JitSoaShader::Compile_MAD,   // mad
+    &JitSoaShader::Compile_MAD,   // mad
+};
+
+// The following is used to alias some commonly used registers. Generally, RAX-RDX can be used as
+// scratch registers within a compiler function. The other registers have designated purposes, as
+// documented below:
+
+/// Pointer to the uniform memory
+static const Reg64 SETUP = r9;
+/// VS loop count register (Multiplied by 16), which is the same for all lanes
+static const Reg32 LOOPCOUNT_REG = r12d;
+/// Current VS loop iteration number
+static const Reg32 LOOPCOUNT = esi;
+/// Number to increment LOOPCOUNT_REG by on each loop iteration (Multiplied by 16)
+static const Reg32 LOOPINC = edi;
+/// Offset of the top of the mask stack in SoaUnitState::mask_stack
+static const Reg64 MASK_SP = r13;
+/// Pointer to the SoaUnitState instance
+static const Reg64 STATE = r15;
+
+// Vector registers, used as XMM or YMM registers depending on the lane count
+
+/// SIMD scratch register, also holds the blend mask of SSE4.1 BLENDVPS
+static const int SCRATCH = 0;
+/// Loaded with the first source component, otherwise can be used as a scratch register
+static const int SRC1 = 1;
+/// Loaded with the second source component, otherwise can be used as a scratch register
+static const int SRC2 = 2;
+/// Loaded with the third source component, otherwise can be used as a scratch register
+static const int SRC3 = 3;
+/// Additional scratch register
+static const int SCRATCH2 = 4;
+/// Results of the four components of the destination, stored by Compile_DestEnable
+static const int RESULT[4] = {5, 6, 7, 8};
+/// Constant vector of 1.0f, used to efficiently set a vector to one
+static const int ONE = 14;
+/// Constant vector of -0.f, used to efficiently negate a vector with XOR
+static const int NEGBIT = 15;
+
+// State registers that must not be modified by external functions calls. The vector constants are
+// reloaded after such calls instead.
+static const BitSet32 persistent_regs = BuildRegSet({
+    // Pointers to register blocks
+    SETUP, STATE,
+    // Cached registers
+    LOOPCOUNT_REG, MASK_SP,
+    // Loop variables
+    LOOPCOUNT, LOOPINC,
+});
+
+alignas(32) static const float ones[MAX_SOA_LANES] = {1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f};
+alignas(32) static const float negative_zeros[MAX_SOA_LANES] = {-0.f, -0.f, -0.f, -0.f,
+                                                                -0.f, -0.f, -0.f, -0.f};
+alignas(32) static const u32 all_bits[MAX_SOA_LANES] = {~0u, ~0u, ~0u, ~0u, ~0u, ~0u, ~0u, ~0u};
+
+/// Upper bound of the size of the code emitted for one Pica instruction
+constexpr size_t MAX_INSTRUCTION_CODE_SIZE = 2048;
+
+static const size_t EXECUTION_MASK_OFFSET = offsetof(SoaUnitState, execution_mask);
+static const size_t MASK_STACK_OFFSET = offsetof(SoaUnitState, mask_stack);
+static const size_t SCRATCH_OFFSET = offsetof(SoaUnitState, scratch);
+
+static size_t ConditionalCodeOffset(unsigned index) {
+    return offsetof(SoaUnitState, conditional_code) + index * sizeof(SoaUnitState::Mask);
+}
+
+static size_t AddressRegisterOffset(unsigned index) {
+    return offsetof(SoaUnitState, address_registers) +
+           index * sizeof(SoaUnitState::address_registers[0]);
+}
+
+static void LogCritical(const char* msg) {
+    LOG_CRITICAL(HW_GPU, "%s", msg);
+}
+
+bool JitSoaShader::IsSupported() {
+    return Common::GetCPUCaps().sse4_1;
+}
+
+unsigned JitSoaShader::GetMaxLaneCount() {
+    return Common::GetCPUCaps().avx ? 8 : 4;
+}
+
+Xmm JitSoaShader::V(int index) const {
+    return avx ? Xbyak::Ymm(index) : Xmm(index);
+}
+
+void JitSoaShader::VLoad(Xmm dest, const Xbyak::Address& src) {
+    if (avx) {
+        vmovups(dest, src);
+    } else {
+        movaps(dest, src);
+    }
+}
+
+void JitSoaShader::VStore(const Xbyak::Address& dest, Xmm src) {
+    if (avx) {
+        vmovups(dest, src);
+    } else {
+        movaps(dest, src);
+    }
+}
+
+void JitSoaShader::VMov(Xmm dest, Xmm src) {
+    if (dest.getIdx() == src.getIdx())
+        return;
+
+    if (avx) {
+        vmovaps(dest, src);
+    } else {
+        movaps(dest, src);
+    }
+}
+
+void JitSoaShader::VBroadcast(Xmm dest, const Xbyak::Address& src) {
+    if (avx) {
+        vbroadcastss(dest, src);
+    } else {
+        movss(dest, src);
+        shufps(dest, dest, _MM_SHUFFLE(0, 0, 0, 0));
+    }
+}
+
+void JitSoaShader::VAdd(Xmm dest, Xmm a, const Xbyak::Operand& b) {
+    if (avx) {
+        vaddps(dest, a, b);
+    } else {
+        VMov(dest, a);
+        addps(dest, b);
+    }
+}
+
+void JitSoaShader::VMul(Xmm dest, Xmm a, const Xbyak::Operand& b) {
+    if (avx) {
+        vmulps(dest, a, b);
+    } else {
+        VMov(dest, a);
+        mulps(dest, b);
+    }
+}
+
+void JitSoaShader::VMax(Xmm dest, Xmm a, const Xbyak::Operand& b) {
+    if (avx) {
+        vmaxps(dest, a, b);
+    } else {
+        VMov(dest, a);
+        maxps(dest, b);
+    }
+}
+
+void JitSoaShader::VMin(Xmm dest, Xmm a, const Xbyak::Operand& b) {
+    if (avx) {
+        vminps(dest, a, b);
+    } else {
+        VMov(dest, a);
+        minps(dest, b);
+    }
+}
+
+void JitSoaShader::VAnd(Xmm dest, Xmm a, const Xbyak::Operand& b) {
+    if (avx) {
+        vandps(dest, a, b);
+    } else {
+        VMov(dest, a);
+        andps(dest, b);
+    }
+}
+
+void JitSoaShader::VAndNot(Xmm dest, Xmm a, const Xbyak::Operand& b) {
+    if (avx) {
+        vandnps(dest, a, b);
+    } else {
+        VMov(dest, a);
+        andnps(dest, b);
+    }
+}
+
+void JitSoaShader::VXor(Xmm dest, Xmm a, const Xbyak::Operand& b) {
+    if (avx) {
+        vxorps(dest, a, b);
+    } else {
+        VMov(dest, a);
+        xorps(dest, b);
+    }
+}
+
+void JitSoaShader::VCmp(Xmm dest, Xmm a, const Xbyak::Operand& b, u8 predicate) {
+    if (avx) {
+        vcmpps(dest, a, b, predicate);
+    } else {
+        VMov(dest, a);
+        cmpps(dest, b, predicate);
+    }
+}
+
+void JitSoaShader::VBlend(Xmm dest, Xmm a, Xmm b, Xmm mask) {
+    if (avx) {
+        vblendvps(dest, a, b, mask);
+    } else {
+        ASSERT(mask.getIdx() == 0);
+        VMov(dest, a);
+        blendvps(dest, b);
+    }
+}
+
+void JitSoaShader::VFloor(Xmm dest, Xmm src) {
+    if (avx) {
+        vroundps(dest, src, _MM_FROUND_FLOOR);
+    } else {
+        roundps(dest, src, _MM_FROUND_FLOOR);
+    }
+}
+
+void JitSoaShader::VRcp(Xmm dest, Xmm src) {
+    if (avx) {
+        vrcpps(dest, src);
+    } else {
+        rcpps(dest, src);
+    }
+}
+
+void JitSoaShader::VRsqrt(Xmm dest, Xmm src) {
+    if (avx) {
+        vrsqrtps(dest, src);
+    } else {
+        rsqrtps(dest, src);
+    }
+}
+
+void JitSoaShader::VTruncate(Xmm dest, Xmm src) {
+    if (avx) {
+        vcvttps2dq(dest, src);
+    } else {
+        cvttps2dq(dest, src);
+    }
+}
+
+void JitSoaShader::VMoveMask(Reg32 dest, Xmm src) {
+    if (avx) {
+        vmovmskps(dest, src);
+    } else {
+        movmskps(dest, src);
+    }
+}
+
+void JitSoaShader::Compile_Assert(bool condition, const char* msg) {
+    if (!condition) {
+        mov(ABI_PARAM1, reinterpret_cast<size_t>(msg));
+        CallFarFunction(*this, LogCritical);
+    }
+}
+
+void JitSoaShader::Compile_SwizzleSrc(Instruction instr, unsigned src_num, SourceRegister src_reg,
+                                      unsigned component, Xmm dest) {
+    const bool is_uniform = src_reg.GetRegisterType() == RegisterType::FloatUniform;
+
+    unsigned operand_desc_id;
+
+    const bool is_inverted =
+        (0 != (instr.opcode.Value().GetInfo().subtype & OpCode::Info::SrcInversed));
+
+    unsigned address_register_index;
+    unsigned offset_src;
+
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MAD ||
+        instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI) {
+        operand_desc_id = instr.mad.operand_desc_id;
+        offset_src = is_inverted ? 3 : 2;
+        address_register_index = instr.mad.address_register_index;
+    } else {
+        operand_desc_id = instr.common.operand_desc_id;
+        offset_src = is_inverted ? 2 : 1;
+        address_register_index = instr.common.address_register_index;
+    }
+
+    SwizzlePattern swiz = {(*swizzle_data)[operand_desc_id]};
+
+    // The selector of the first component is in the topmost bits
+    unsigned selector = (swiz.GetRawSelector(src_num) >> (6 - 2 * component)) & 3;
+
+    size_t src_offset =
+        is_uniform ? ShaderSetup::GetFloatUniformOffset(src_reg.GetIndex()) +
+                         selector * sizeof(float24)
+                   : SoaUnitState::InputOffset(src_reg) + selector * sizeof(SoaUnitState::Vector);
+
+    int src_offset_disp = (int)src_offset;
+    ASSERT_MSG(src_offset == src_offset_disp, "Source register offset too large for int type");
+
+    if (src_num != offset_src)
+        address_register_index = 0;
+
+    switch (address_register_index) {
+    case 0:
+        if (is_uniform) {
+            VBroadcast(dest, dword[SETUP + src_offset_disp]);
+        } else {
+            VLoad(dest, ptr[STATE + src_offset_disp]);
+        }
+        break;
+    case 1: // address offset 1
+    case 2: // address offset 2
+        Compile_GatherSrc(dest, is_uniform, src_offset_disp, address_register_index - 1);
+        break;
+    case 3: // address offset 3
+        // Uniforms are 16 bytes apart, registers in SoaUnitState 8 times more
+        if (is_uniform) {
+            VBroadcast(dest, dword[SETUP + LOOPCOUNT_REG.cvt64() + src_offset_disp]);
+        } else {
+            VLoad(dest, ptr[STATE + LOOPCOUNT_REG.cvt64() * 8 + src_offset_disp]);
+        }
+        break;
+    default:
+        UNREACHABLE();
+        break;
+    }
+
+    // If the source register should be negated, flip the negative bit using XOR
+    const bool negate[] = {swiz.negate_src1, swiz.negate_src2, swiz.negate_src3};
+    if (negate[src_num - 1]) {
+        VXor(dest, dest, V(NEGBIT));
+    }
+}
+
+void JitSoaShader::Compile_GatherSrc(Xmm dest, bool uniform, int disp, unsigned address_register) {
+    const int index_disp = (int)AddressRegisterOffset(address_register);
+
+    for (unsigned lane = 0; lane < lanes; ++lane) {
+        movsxd(rax, dword[STATE + index_disp + lane * 4]);
+        if (uniform) {
+            shl(rax, 4);
+            mov(ecx, dword[SETUP + rax + disp]);
+        } else {
+            shl(rax, 7);
+            mov(ecx, dword[STATE + rax + disp + lane * 4]);
+        }
+        mov(dword[STATE + (int)SCRATCH_OFFSET + lane * 4], ecx);
+    }
+    VLoad(dest, ptr[STATE + (int)SCRATCH_OFFSET]);
+}
+
+void JitSoaShader::Compile_DestEnable(Instruction instr, bool broadcast) {
+    DestRegister dest;
+    unsigned operand_desc_id;
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MAD ||
+        instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI) {
+        operand_desc_id = instr.mad.operand_desc_id;
+        dest = instr.mad.dest.Value();
+    } else {
+        operand_desc_id = instr.common.operand_desc_id;
+        dest = instr.common.dest.Value();
+    }
+
+    SwizzlePattern swiz = {(*swizzle_data)[operand_desc_id]};
+
+    size_t dest_offset_disp = SoaUnitState::OutputOffset(dest);
+
+    VLoad(V(SCRATCH), ptr[STATE + (int)EXECUTION_MASK_OFFSET]);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+
+        auto address = ptr[STATE + (int)(dest_offset_disp + comp * sizeof(SoaUnitState::Vector))];
+        VLoad(V(SCRATCH2), address);
+        VBlend(V(SCRATCH2), V(SCRATCH2), V(RESULT[broadcast ? 0 : comp]), V(SCRATCH));
+        VStore(address, V(SCRATCH2));
+    }
+}
+
+void JitSoaShader::Compile_SanitizedMul(Xmm src1, Xmm src2, Xmm scratch) {
+    // 0 * inf and inf * 0 in the PICA should return 0 instead of NaN. This can be implemented by
+    // checking for NaNs before and after the multiplication.  If the multiplication result is NaN
+    // where neither source was, this NaN was generated by a 0 * inf multiplication, and so the
+    // result should be transformed to 0 to match PICA fp rules.
+
+    // Set scratch to mask of (src1 != NaN and src2 != NaN)
+    VCmp(scratch, src1, src2, CMP_ORD);
+
+    VMul(src1, src1, src2);
+
+    // Set src2 to mask of (result == NaN)
+    VCmp(src2, src1, src1, CMP_UNORD);
+
+    // Clear components where scratch != src2 (i.e. if result is NaN where neither source was NaN)
+    VXor(scratch, scratch, src2);
+    VAnd(src1, src1, scratch);
+}
+
+void JitSoaShader::Compile_Not(Xmm value) {
+    mov(rax, reinterpret_cast<size_t>(all_bits));
+    VXor(value, value, ptr[rax]);
+}
+
+void JitSoaShader::Compile_EvaluateCondition(Instruction instr, Xmm dest) {
+    // The X and Y results are the conditional codes, inverted where the reference value is 0
+    auto load_result = [this](unsigned index, bool reference, Xmm result) {
+        VLoad(result, ptr[STATE + (int)ConditionalCodeOffset(index)]);
+        if (!reference) {
+            Compile_Not(result);
+        }
+    };
+
+    switch (instr.flow_control.op) {
+    case Instruction::FlowControlType::Or:
+        // x | y == ~(~x & ~y)
+        load_result(0, !instr.flow_control.refx.Value(), dest);
+        load_result(1, !instr.flow_control.refy.Value(), V(SCRATCH2));
+        VAnd(dest, dest, V(SCRATCH2));
+        Compile_Not(dest);
+        break;
+
+    case Instruction::FlowControlType::And:
+        load_result(0, instr.flow_control.refx.Value(), dest);
+        load_result(1, instr.flow_control.refy.Value(), V(SCRATCH2));
+        VAnd(dest, dest, V(SCRATCH2));
+        break;
+
+    case Instruction::FlowControlType::JustX:
+        load_result(0, instr.flow_control.refx.Value(), dest);
+        break;
+
+    case Instruction::FlowControlType::JustY:
+        load_result(1, instr.flow_control.refy.Value(), dest);
+        break;
+    }
+}
+
+void JitSoaShader::Compile_UniformCondition(Instruction instr) {
+    size_t offset = ShaderSetup::GetBoolUniformOffset(instr.flow_control.bool_uniform_id);
+    cmp(byte[SETUP + offset], 0);
+}
+
+void JitSoaShader::Compile_SetExecutionMask(Xmm mask) {
+    VStore(ptr[STATE + (int)EXECUTION_MASK_OFFSET], mask);
+    VMoveMask(eax, mask);
+    test(eax, eax);
+}
+
+void JitSoaShader::Compile_PushMask(Xmm mask) {
+    cmp(MASK_SP, SOA_MASK_STACK_DEPTH * sizeof(SoaUnitState::Mask));
+    jae(diverged_label, T_NEAR);
+    VStore(ptr[STATE + MASK_SP + (int)MASK_STACK_OFFSET], mask);
+    add(MASK_SP, sizeof(SoaUnitState::Mask));
+}
+
+void JitSoaShader::Compile_PopMasks(unsigned depth) {
+    const int size = static_cast<int>(depth * sizeof(SoaUnitState::Mask));
+    VLoad(V(SCRATCH), ptr[STATE + MASK_SP + ((int)MASK_STACK_OFFSET - size)]);
+    VStore(ptr[STATE + (int)EXECUTION_MASK_OFFSET], V(SCRATCH));
+    sub(MASK_SP, size);
+}
+
+BitSet32 JitSoaShader::PersistentCallerSavedRegs() {
+    return persistent_regs & ABI_ALL_CALLER_SAVED;
+}
+
+void JitSoaShader::Compile_LoadConstants() {
+    mov(rax, reinterpret_cast<size_t>(ones));
+    VLoad(V(ONE), ptr[rax]);
+    mov(rax, reinterpret_cast<size_t>(negative_zeros));
+    VLoad(V(NEGBIT), ptr[rax]);
+}
+
+SwizzlePattern JitSoaShader::GetSwizzlePattern(Instruction instr) const {
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MAD ||
+        instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI) {
+        return {(*swizzle_data)[instr.mad.operand_desc_id]};
+    }
+    return {(*swizzle_data)[instr.common.operand_desc_id]};
+}
+
+void JitSoaShader::Compile_ADD(Instruction instr) {
+    SwizzlePattern swiz = GetSwizzlePattern(instr);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+        Compile_SwizzleSrc(instr, 1, instr.common.src1, comp, V(SRC1));
+        Compile_SwizzleSrc(instr, 2, instr.common.src2, comp, V(SRC2));
+        VAdd(V(RESULT[comp]), V(SRC1), V(SRC2));
+    }
+    Compile_DestEnable(instr);
+}
+
+void JitSoaShader::Compile_DotProduct(Instruction instr, SourceRegister src1, SourceRegister src2,
+                                      unsigned products, unsigned terms) {
+    for (unsigned comp = 0; comp < products; ++comp) {
+        Compile_SwizzleSrc(instr, 1, src1, comp, V(SRC1));
+        Compile_SwizzleSrc(instr, 2, src2, comp, V(SRC2));
+        Compile_SanitizedMul(V(SRC1), V(SRC2), V(SCRATCH));
+        VMov(V(RESULT[comp]), V(SRC1));
+    }
+
+    // Sum the products in the same order as the per-vertex JIT, which sums pairs of components
+    VAdd(V(RESULT[0]), V(RESULT[0]), V(RESULT[1]));
+    if (terms == 4) {
+        VAdd(V(RESULT[2]), V(RESULT[2]), V(RESULT[3]));
+    }
+    VAdd(V(RESULT[0]), V(RESULT[0]), V(RESULT[2]));
+
+    Compile_DestEnable(instr, true);
+}
+
+void JitSoaShader::Compile_DP3(Instruction instr) {
+    Compile_DotProduct(instr, instr.common.src1, instr.common.src2, 3, 3);
+}
+
+void JitSoaShader::Compile_DP4(Instruction instr) {
+    Compile_DotProduct(instr, instr.common.src1, instr.common.src2, 4, 4);
+}
+
+void JitSoaShader::Compile_DPH(Instruction instr) {
+    SourceRegister src1 = instr.common.src1;
+    SourceRegister src2 = instr.common.src2;
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::DPHI) {
+        src1 = instr.common.src1i;
+        src2 = instr.common.src2i;
+    }
+
+    // The 4th component of the first source is 1.0, so its product is the 4th component of the
+    // second source
+    Compile_SwizzleSrc(instr, 2, src2, 3, V(RESULT[3]));
+    Compile_DotProduct(instr, src1, src2, 3, 4);
+}
+
+void JitSoaShader::Compile_CallPerLane(Instruction instr, float (*function)(float)) {
+    Compile_SwizzleSrc(instr, 1, instr.common.src1, 0, V(SRC1));
+    VStore(ptr[STATE + (int)SCRATCH_OFFSET], V(SRC1));
+
+    if (avx)
+        vzeroupper();
+    ABI_PushRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
+    for (unsigned lane = 0; lane < lanes; ++lane) {
+        movss(xmm0, dword[STATE + (int)SCRATCH_OFFSET + lane * 4]); // ABI_PARAM1
+        CallFarFunction(*this, function);
+        movss(dword[STATE + (int)SCRATCH_OFFSET + lane * 4], xmm0); // ABI_RETURN
+    }
+    ABI_PopRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
+
+    // The vector constants are caller-saved, and the upper halves of YMM registers always are
+    Compile_LoadConstants();
+
+    VLoad(V(RESULT[0]), ptr[STATE + (int)SCRATCH_OFFSET]);
+    Compile_DestEnable(instr, true);
+}
+
+void JitSoaShader::Compile_EX2(Instruction instr) {
+    Compile_CallPerLane(instr, exp2f);
+}
+
+void JitSoaShader::Compile_LG2(Instruction instr) {
+    Compile_CallPerLane(instr, log2f);
+}
+
+void JitSoaShader::Compile_MUL(Instruction instr) {
+    SwizzlePattern swiz = GetSwizzlePattern(instr);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+        Compile_SwizzleSrc(instr, 1, instr.common.src1, comp, V(SRC1));
+        Compile_SwizzleSrc(instr, 2, instr.common.src2, comp, V(SRC2));
+        Compile_SanitizedMul(V(SRC1), V(SRC2), V(SCRATCH));
+        VMov(V(RESULT[comp]), V(SRC1));
+    }
+    Compile_DestEnable(instr);
+}
+
+void JitSoaShader::Compile_SGE(Instruction instr) {
+    SourceRegister src1 = instr.common.src1;
+    SourceRegister src2 = instr.common.src2;
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::SGEI) {
+        src1 = instr.common.src1i;
+        src2 = instr.common.src2i;
+    }
+
+    SwizzlePattern swiz = GetSwizzlePattern(instr);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+        Compile_SwizzleSrc(instr, 1, src1, comp, V(SRC1));
+        Compile_SwizzleSrc(instr, 2, src2, comp, V(SRC2));
+        VCmp(V(RESULT[comp]), V(SRC2), V(SRC1), CMP_LE);
+        VAnd(V(RESULT[comp]), V(RESULT[comp]), V(ONE));
+    }
+    Compile_DestEnable(instr);
+}
+
+void JitSoaShader::Compile_SLT(Instruction instr) {
+    SourceRegister src1 = instr.common.src1;
+    SourceRegister src2 = instr.common.src2;
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::SLTI) {
+        src1 = instr.common.src1i;
+        src2 = instr.common.src2i;
+    }
+
+    SwizzlePattern swiz = GetSwizzlePattern(instr);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+        Compile_SwizzleSrc(instr, 1, src1, comp, V(SRC1));
+        Compile_SwizzleSrc(instr, 2, src2, comp, V(SRC2));
+        VCmp(V(RESULT[comp]), V(SRC1), V(SRC2), CMP_LT);
+        VAnd(V(RESULT[comp]), V(RESULT[comp]), V(ONE));
+    }
+    Compile_DestEnable(instr);
+}
+
+void JitSoaShader::Compile_FLR(Instruction instr) {
+    SwizzlePattern swiz = GetSwizzlePattern(instr);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+        Compile_SwizzleSrc(instr, 1, instr.common.src1, comp, V(SRC1));
+        VFloor(V(RESULT[comp]), V(SRC1));
+    }
+    Compile_DestEnable(instr);
+}
+
+void JitSoaShader::Compile_MAX(Instruction instr) {
+    SwizzlePattern swiz = GetSwizzlePattern(instr);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+        Compile_SwizzleSrc(instr, 1, instr.common.src1, comp, V(SRC1));
+        Compile_SwizzleSrc(instr, 2, instr.common.src2, comp, V(SRC2));
+        // SSE semantics match PICA200 ones: In case of NaN, SRC2 is returned.
+        VMax(V(RESULT[comp]), V(SRC1), V(SRC2));
+    }
+    Compile_DestEnable(instr);
+}
+
+void JitSoaShader::Compile_MIN(Instruction instr) {
+    SwizzlePattern swiz = GetSwizzlePattern(instr);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+        Compile_SwizzleSrc(instr, 1, instr.common.src1, comp, V(SRC1));
+        Compile_SwizzleSrc(instr, 2, instr.common.src2, comp, V(SRC2));
+        // SSE semantics match PICA200 ones: In case of NaN, SRC2 is returned.
+        VMin(V(RESULT[comp]), V(SRC1), V(SRC2));
+    }
+    Compile_DestEnable(instr);
+}
+
+void JitSoaShader::Compile_MOVA(Instruction instr) {
+    SwizzlePattern swiz = GetSwizzlePattern(instr);
+
+    // Both components are converted before either address register is written, as the source may
+    // be addressed relative to them
+    for (unsigned comp = 0; comp < 2; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+        Compile_SwizzleSrc(instr, 1, instr.common.src1, comp, V(SRC1));
+        VTruncate(V(RESULT[comp]), V(SRC1));
+    }
+
+    VLoad(V(SCRATCH), ptr[STATE + (int)EXECUTION_MASK_OFFSET]);
+    for (unsigned comp = 0; comp < 2; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+        auto address = ptr[STATE + (int)AddressRegisterOffset(comp)];
+        VLoad(V(SCRATCH2), address);
+        VBlend(V(SCRATCH2), V(SCRATCH2), V(RESULT[comp]), V(SCRATCH));
+        VStore(address, V(SCRATCH2));
+    }
+}
+
+void JitSoaShader::Compile_MOV(Instruction instr) {
+    SwizzlePattern swiz = GetSwizzlePattern(instr);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+        Compile_SwizzleSrc(instr, 1, instr.common.src1, comp, V(RESULT[comp]));
+    }
+    Compile_DestEnable(instr);
+}
+
+void JitSoaShader::Compile_RCP(Instruction instr) {
+    Compile_SwizzleSrc(instr, 1, instr.common.src1, 0, V(SRC1));
+
+    // RCPPS computes the same approximation as the RCPSS of the per-vertex JIT
+    VRcp(V(RESULT[0]), V(SRC1));
+
+    Compile_DestEnable(instr, true);
+}
+
+void JitSoaShader::Compile_RSQ(Instruction instr) {
+    Compile_SwizzleSrc(instr, 1, instr.common.src1, 0, V(SRC1));
+
+    // RSQRTPS computes the same approximation as the RSQRTSS of the per-vertex JIT
+    VRsqrt(V(RESULT[0]), V(SRC1));
+
+    Compile_DestEnable(instr, true);
+}
+
+void JitSoaShader::Compile_NOP(Instruction instr) {}
+
+void JitSoaShader::Compile_END(Instruction instr) {
+    // The lanes that are not active would continue past this instruction
+    VLoad(V(SCRATCH), ptr[STATE + (int)EXECUTION_MASK_OFFSET]);
+    VMoveMask(eax, V(SCRATCH));
+    cmp(eax, (1 << lanes) - 1);
+    jne(diverged_label, T_NEAR);
+    jmp(end_label, T_NEAR);
+}
+
+void JitSoaShader::Compile_CallSubroutine(Instruction instr) {
+    // Save the mask stack pointer, which a subroutine returning from within a conditional block
+    // leaves unbalanced. It is pushed twice to keep the stack aligned for the external calls.
+    push(MASK_SP);
+    push(MASK_SP);
+
+    // Push offset of the return
+    push(qword, (instr.flow_control.dest_offset + instr.flow_control.num_instructions));
+
+    // Call the subroutine
+    call(instruction_labels[instr.flow_control.dest_offset]);
+
+    // Skip over the return offset that's on the stack
+    add(rsp, 8);
+
+    pop(MASK_SP);
+    pop(MASK_SP);
+
+    // Restore the execution mask pushed by the caller
+    Compile_PopMasks(1);
+}
+
+void JitSoaShader::Compile_CALL(Instruction instr) {
+    VLoad(V(SCRATCH), ptr[STATE + (int)EXECUTION_MASK_OFFSET]);
+    Compile_PushMask(V(SCRATCH));
+    Compile_CallSubroutine(instr);
+}
+
+void JitSoaShader::Compile_CALLC(Instruction instr) {
+    Compile_EvaluateCondition(instr, V(SRC1));
+    VLoad(V(SRC2), ptr[STATE + (int)EXECUTION_MASK_OFFSET]);
+    VAnd(V(SRC1), V(SRC1), V(SRC2));
+
+    Label b;
+    VMoveMask(eax, V(SRC1));
+    test(eax, eax);
+    jz(b, T_NEAR);
+
+    // Only the lanes for which the condition is true run the subroutine
+    Compile_PushMask(V(SRC2));
+    Compile_SetExecutionMask(V(SRC1));
+    Compile_CallSubroutine(instr);
+    L(b);
+}
+
+void JitSoaShader::Compile_CALLU(Instruction instr) {
+    Compile_UniformCondition(instr);
+    Label b;
+    jz(b, T_NEAR);
+    Compile_CALL(instr);
+    L(b);
+}
+
+void JitSoaShader::Compile_CMP(Instruction instr) {
+    using Op = Instruction::Common::CompareOpType::Op;
+    const Op ops[] = {instr.common.compare_op.x, instr.common.compare_op.y};
+
+    // SSE doesn't have greater-than (GT) or greater-equal (GE) comparison operators. You need to
+    // emulate them by swapping the lhs and rhs and using LT and LE. NLT and NLE can't be used here
+    // because they don't match when used with NaNs.
+    static const u8 cmp[] = {CMP_EQ, CMP_NEQ, CMP_LT, CMP_LE, CMP_LT, CMP_LE};
+
+    for (unsigned comp = 0; comp < 2; ++comp) {
+        Compile_SwizzleSrc(instr, 1, instr.common.src1, comp, V(SRC1));
+        Compile_SwizzleSrc(instr, 2, instr.common.src2, comp, V(SRC2));
+
+        bool invert_op = (ops[comp] == Op::GreaterThan || ops[comp] == Op::GreaterEqual);
+        Xmm lhs = V(invert_op ? SRC2 : SRC1);
+        Xmm rhs = V(invert_op ? SRC1 : SRC2);
+        VCmp(V(RESULT[comp]), lhs, rhs, cmp[ops[comp]]);
+    }
+
+    VLoad(V(SCRATCH), ptr[STATE + (int)EXECUTION_MASK_OFFSET]);
+    for (unsigned comp = 0; comp < 2; ++comp) {
+        auto address = ptr[STATE + (int)ConditionalCodeOffset(comp)];
+        VLoad(V(SCRATCH2), address);
+        VBlend(V(SCRATCH2), V(SCRATCH2), V(RESULT[comp]), V(SCRATCH));
+        VStore(address, V(SCRATCH2));
+    }
+}
+
+void JitSoaShader::Compile_MAD(Instruction instr) {
+    SourceRegister src2 = instr.mad.src2;
+    SourceRegister src3 = instr.mad.src3;
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI) {
+        src2 = instr.mad.src2i;
+        src3 = instr.mad.src3i;
+    }
+
+    SwizzlePattern swiz = GetSwizzlePattern(instr);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+        Compile_SwizzleSrc(instr, 1, instr.mad.src1, comp, V(SRC1));
+        Compile_SwizzleSrc(instr, 2, src2, comp, V(SRC2));
+        Compile_SwizzleSrc(instr, 3, src3, comp, V(SRC3));
+        Compile_SanitizedMul(V(SRC1), V(SRC2), V(SCRATCH));
+        VAdd(V(RESULT[comp]), V(SRC1), V(SRC3));
+    }
+    Compile_DestEnable(instr);
+}
+
+void JitSoaShader::Compile_IF(Instruction instr) {
+    Compile_Assert(instr.flow_control.dest_offset >= program_counter,
+                   "Backwards if-statements not supported");
+    Label l_else, l_endif;
+
+    if (instr.opcode.Value() == OpCode::Id::IFU) {
+        // The condition is the same for all lanes, compile as the per-vertex JIT does
+        Compile_UniformCondition(instr);
+        jz(l_else, T_NEAR);
+
+        Compile_Block(instr.flow_control.dest_offset);
+
+        if (instr.flow_control.num_instructions == 0) {
+            L(l_else);
+            return;
+        }
+
+        jmp(l_endif, T_NEAR);
+
+        L(l_else);
+        Compile_Block(instr.flow_control.dest_offset + instr.flow_control.num_instructions);
+
+        L(l_endif);
+        return;
+    }
+
+    // Save the execution mask, followed by the mask of the lanes running the "ELSE" block
+    Compile_EvaluateCondition(instr, V(SRC1));
+    VLoad(V(SRC2), ptr[STATE + (int)EXECUTION_MASK_OFFSET]);
+    Compile_PushMask(V(SRC2));
+    VAndNot(V(SRC3), V(SRC1), V(SRC2));
+    Compile_PushMask(V(SRC3));
+
+    // Compile the code that corresponds to the condition evaluating as true, skipped if no lane
+    // takes it
+    VAnd(V(SRC1), V(SRC1), V(SRC2));
+    Compile_SetExecutionMask(V(SRC1));
+    jz(l_else, T_NEAR);
+    Compile_Block(instr.flow_control.dest_offset);
+    L(l_else);
+
+    if (instr.flow_control.num_instructions != 0) {
+        // Compile the code that corresponds to the condition evaluating as false
+        const int else_mask_disp = (int)(MASK_STACK_OFFSET - sizeof(SoaUnitState::Mask));
+        VLoad(V(SCRATCH), ptr[STATE + MASK_SP + else_mask_disp]);
+        Compile_SetExecutionMask(V(SCRATCH));
+        jz(l_endif, T_NEAR);
+        Compile_Block(instr.flow_control.dest_offset + instr.flow_control.num_instructions);
+    }
+
+    L(l_endif);
+    Compile_PopMasks(2);
+}
+
+void JitSoaShader::Compile_LOOP(Instruction instr) {
+    Compile_Assert(instr.flow_control.dest_offset >= program_counter,
+                   "Backwards loops not supported");
+    Compile_Assert(!looping, "Nested loops not supported");
+
+    looping = true;
+
+    // The loop parameters come from an integer uniform, so all lanes iterate together. See the
+    // per-vertex JIT for the encoding of the registers.
+    size_t offset = ShaderSetup::GetIntUniformOffset(instr.flow_control.int_uniform_id);
+    mov(LOOPCOUNT, dword[SETUP + offset]);
+    mov(LOOPCOUNT_REG, LOOPCOUNT);
+    shr(LOOPCOUNT_REG, 4);
+    and_(LOOPCOUNT_REG, 0xFF0); // Y-component is the start
+    mov(LOOPINC, LOOPCOUNT);
+    shr(LOOPINC, 12);
+    and_(LOOPINC, 0xFF0);               // Z-component is the incrementer
+    movzx(LOOPCOUNT, LOOPCOUNT.cvt8()); // X-component is iteration count
+    add(LOOPCOUNT, 1);                  // Iteration count is X-component + 1
+
+    Label l_loop_start;
+    L(l_loop_start);
+
+    Compile_Block(instr.flow_control.dest_offset + 1);
+
+    add(LOOPCOUNT_REG, LOOPINC); // Increment LOOPCOUNT_REG by Z-component
+    sub(LOOPCOUNT, 1);           // Increment loop count by 1
+    jnz(l_loop_start, T_NEAR);   // Loop if not equal
+
+    looping = false;
+}
+
+void JitSoaShader::Compile_JMP(Instruction instr) {
+    Label& b = instruction_labels[instr.flow_control.dest_offset];
+
+    if (instr.opcode.Value() == OpCode::Id::JMPU) {
+        Compile_UniformCondition(instr);
+
+        bool inverted_condition = (instr.flow_control.num_instructions & 1) != 0;
+        if (inverted_condition) {
+            jz(b, T_NEAR);
+        } else {
+            jnz(b, T_NEAR);
+        }
+        return;
+    }
+
+    // The jump is only followed if all active lanes take it, or none of them
+    Compile_EvaluateCondition(instr, V(SRC1));
+    VLoad(V(SRC2), ptr[STATE + (int)EXECUTION_MASK_OFFSET]);
+    VAnd(V(SRC1), V(SRC1), V(SRC2));
+    VMoveMask(eax, V(SRC1));
+    VMoveMask(ecx, V(SRC2));
+
+    Label l_not_taken;
+    test(eax, eax);
+    jz(l_not_taken);
+    cmp(eax, ecx);
+    jne(diverged_label, T_NEAR);
+    jmp(b, T_NEAR);
+    L(l_not_taken);
+}
+
+void JitSoaShader::Compile_Block(unsigned end) {
+    while (program_counter < end) {
+        Compile_NextInstr();
+    }
+}
+
+void JitSoaShader::Compile_Return() {
+    // Peek return offset on the stack and check if we're at that offset
+    mov(rax, qword[rsp + 8]);
+    cmp(eax, (program_counter));
+
+    // If so, jump back to before CALL
+    Label b;
+    jnz(b);
+    ret();
+    L(b);
+}
+
+void JitSoaShader::Compile_NextInstr() {
+    if (std::binary_search(return_offsets.begin(), return_offsets.end(), program_counter)) {
+        Compile_Return();
+    }
+
+    L(instruction_labels[program_counter]);
+
+    Instruction instr = {(*program_code)[program_counter++]};
+
+    OpCode::Id opcode = instr.opcode.Value();
+    auto instr_func = instr_table[static_cast<unsigned>(opcode)];
+
+    if (instr_func) {
+        // JIT the instruction!
+        ((*this).*instr_func)(instr);
+    } else {
+        // Unhandled instruction
+        LOG_CRITICAL(HW_GPU, "Unhandled instruction: 0x%02x (0x%08x)",
+                     instr.opcode.Value().EffectiveOpCode(), instr.hex);
+    }
+}
+
+void JitSoaShader::FindReturnOffsets() {
+    return_offsets.clear();
+
+    for (size_t offset = 0; offset < program_end; ++offset) {
+        Instruction instr = {(*program_code)[offset]};
+
+        switch (instr.opcode.Value()) {
+        case OpCode::Id::CALL:
+        case OpCode::Id::CALLC:
+        case OpCode::Id::CALLU:
+            return_offsets.push_back(instr.flow_control.dest_offset +
+                                     instr.flow_control.num_instructions);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Sort for efficient binary search later
+    std::sort(return_offsets.begin(), return_offsets.end());
+}
+
+unsigned JitSoaShader::FindProgramEnd(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>& code) {
+    unsigned end = 0;
+    for (unsigned offset = 0; offset < code.size(); ++offset) {
+        Instruction instr = {code[offset]};
+        if (instr.opcode.Value() == OpCode::Id::END)
+            end = offset + 1;
+    }
+    if (end == 0)
+        return static_cast<unsigned>(code.size());
+
+    // Extend the program to the subroutines and jump targets placed after the last END
+    unsigned previous_end;
+    do {
+        previous_end = end;
+        for (unsigned offset = 0; offset < previous_end; ++offset) {
+            Instruction instr = {code[offset]};
+            unsigned target_end = 0;
+
+            switch (instr.opcode.Value()) {
+            case OpCode::Id::CALL:
+            case OpCode::Id::CALLC:
+            case OpCode::Id::CALLU:
+            case OpCode::Id::IFU:
+            case OpCode::Id::IFC:
+                target_end = instr.flow_control.dest_offset + instr.flow_control.num_instructions;
+                break;
+            case OpCode::Id::JMPC:
+            case OpCode::Id::JMPU:
+            case OpCode::Id::LOOP:
+                target_end = instr.flow_control.dest_offset + 1;
+                break;
+            default:
+                break;
+            }
+
+            end = std::max(end, target_end);
+        }
+    } while (end != previous_end);
+
+    return std::min(end, static_cast<unsigned>(code.size()));
+}
+
+bool JitSoaShader::HasStructuredJumps(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>& code,
+                                      unsigned end) {
+    struct Range {
+        unsigned begin, end;
+        bool Contains(unsigned offset) const {
+            return offset >= begin && offset < end;
+        }
+    };
+
+    // Blocks of the IFC instructions, which push and pop execution masks
+    std::vector<Range> blocks;
+    for (unsigned offset = 0; offset < end; ++offset) {
+        Instruction instr = {code[offset]};
+        if (instr.opcode.Value() == OpCode::Id::IFC) {
+            unsigned else_offset = instr.flow_control.dest_offset;
+            blocks.push_back({offset + 1, else_offset});
+            blocks.push_back({else_offset, else_offset + instr.flow_control.num_instructions});
+        }
+    }
+
+    for (unsigned offset = 0; offset < end; ++offset) {
+        Instruction instr = {code[offset]};
+        if (instr.opcode.Value() != OpCode::Id::JMPC && instr.opcode.Value() != OpCode::Id::JMPU)
+            continue;
+
+        const unsigned target = instr.flow_control.dest_offset;
+        for (const Range& block : blocks) {
+            if (block.Contains(offset) != block.Contains(target))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+std::unique_ptr<JitSoaShader> JitSoaShader::Compile(
+    const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code_,
+    const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data_, unsigned lanes) {
+    ASSERT(lanes == 4 || (lanes == 8 && Common::GetCPUCaps().avx));
+
+    const unsigned program_end = FindProgramEnd(*program_code_);
+    if (!HasStructuredJumps(*program_code_, program_end)) {
+        LOG_DEBUG(HW_GPU, "Shader has jumps across conditional blocks, not compiling SoA variant");
+        return nullptr;
+    }
+
+    for (unsigned offset = 0; offset < program_end; ++offset) {
+        const OpCode::Id opcode = Instruction{(*program_code_)[offset]}.opcode.Value();
+        if (opcode == OpCode::Id::EMIT || opcode == OpCode::Id::SETEMIT) {
+            // Geometry shaders are run one primitive at a time
+            LOG_DEBUG(HW_GPU, "Shader emits vertices, not compiling SoA variant");
+            return nullptr;
+        }
+    }
+
+    std::unique_ptr<JitSoaShader> shader(new JitSoaShader(program_end, lanes));
+    shader->program_code = program_code_;
+    shader->swizzle_data = swizzle_data_;
+    shader->Compile_Program();
+    return shader;
+}
+
+void JitSoaShader::Compile_Program() {
+    program = (CompiledShader*)getCurr();
+    program_counter = 0;
+    looping = false;
+
+    // Find all `CALL` instructions and identify return locations
+    FindReturnOffsets();
+
+    // The stack pointer is 8 modulo 16 at the entry of a procedure
+    // We reserve 16 bytes and assign a dummy value to the first 8 bytes, to catch any potential
+    // return checks (see Compile_Return) that happen in shader main routine.
+    ABI_PushRegistersAndAdjustStack(*this, ABI_ALL_CALLEE_SAVED, 8, 16);
+    mov(qword[rsp + 8], 0xFFFFFFFFFFFFFFFFULL);
+
+    mov(SETUP, ABI_PARAM1);
+    mov(STATE, ABI_PARAM2);
+    mov(qword[STATE + (int)offsetof(SoaUnitState, entry_stack_pointer)], rsp);
+
+    // Zero loop register and mask stack
+    xor_(LOOPCOUNT_REG, LOOPCOUNT_REG);
+    xor_(MASK_SP.cvt32(), MASK_SP.cvt32());
+
+    Compile_LoadConstants();
+
+    // All lanes start active, with cleared conditional codes and address registers
+    mov(rax, reinterpret_cast<size_t>(all_bits));
+    VLoad(V(SCRATCH), ptr[rax]);
+    VStore(ptr[STATE + (int)EXECUTION_MASK_OFFSET], V(SCRATCH));
+    VXor(V(SCRATCH), V(SCRATCH), V(SCRATCH));
+    for (unsigned index = 0; index < 2; ++index) {
+        VStore(ptr[STATE + (int)ConditionalCodeOffset(index)], V(SCRATCH));
+        VStore(ptr[STATE + (int)AddressRegisterOffset(index)], V(SCRATCH));
+    }
+
+    // Jump to start of the shader program
+    jmp(ABI_PARAM3);
+
+    // Compile entire program
+    Compile_Block(program_end);
+
+    // Running past the last instruction ends the program, possibly returning from a subroutine
+    // first
+    if (std::binary_search(return_offsets.begin(), return_offsets.end(), program_counter)) {
+        Compile_Return();
+    }
+    Compile_END({});
+
+    Label l_leave;
+    L(diverged_label);
+    mov(eax, 1);
+    jmp(l_leave);
+
+    L(end_label);
+    xor_(eax, eax);
+
+    // Subroutines may still be on the stack
+    L(l_leave);
+    mov(rsp, qword[STATE + (int)offsetof(SoaUnitState, entry_stack_pointer)]);
+    if (avx)
+        vzeroupper();
+    ABI_PopRegistersAndAdjustStack(*this, ABI_ALL_CALLEE_SAVED, 8, 16);
+    ret();
+
+    // Free memory that's no longer needed
+    program_code = nullptr;
+    swizzle_data = nullptr;
+    return_offsets.clear();
+    return_offsets.shrink_to_fit();
+
+    ready();
+
+    ASSERT_MSG(getSize() <= program_end * MAX_INSTRUCTION_CODE_SIZE + 4096,
+               "Compiled a shader that exceeds the allocated size!");
+    LOG_DEBUG(HW_GPU, "Compiled SoA shader size=%lu lanes=%u", getSize(), lanes);
+}
+
+JitSoaShader::JitSoaShader(unsigned program_end, unsigned lanes)
+    : Xbyak::CodeGenerator(program_end * MAX_INSTRUCTION_CODE_SIZE + 4096),
+      program_end(program_end), lanes(lanes), avx(lanes == 8) {}
+
+} // namespace Shader
+
+} // namespace Pica
@@ -0,0 +1,333 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <nihstro/shader_bytecode.h>
+#include <xbyak.h>
+#include "common/bit_set.h"
+#include "common/common_types.h"
+#include "video_core/shader/shader.h"
+
+using nihstro::Instruction;
+using nihstro::OpCode;
+using nihstro::SwizzlePattern;
+
+namespace Pica {
+
+namespace Shader {
+
+/// Maximum number of vertices processed by one run of a JitSoaShader
+constexpr unsigned MAX_SOA_LANES = 8;
+
+/// Maximum nesting depth of conditional blocks and calls in a JitSoaShader
+constexpr unsigned SOA_MASK_STACK_DEPTH = 32;
+
+/**
+ * Shader unit state holding several vertices at once. Each component of each register is stored as
+ * a vector with one lane per vertex (structure of arrays), so that a JitSoaShader can process all
+ * the vertices with the same instructions.
+ */
+struct SoaUnitState {
+    using Vector = std::array<float24, MAX_SOA_LANES>;
+    using Mask = std::array<u32, MAX_SOA_LANES>;
+
+    struct Registers {
+        alignas(16) Vector input[16][4];
+        alignas(16) Vector temporary[16][4];
+        alignas(16) Vector output[16][4];
+    } registers;
+    static_assert(std::is_pod<Registers>::value, "Structure is not POD");
+
+    /// Results of the last CMP instruction, with all bits set in the lanes where they are true
+    alignas(16) Mask conditional_code[2];
+
+    /// The two address registers set by the MOVA instruction. The loop counter is the same for all
+    /// vertices and stays in a host register.
+    alignas(16) std::array<s32, MAX_SOA_LANES> address_registers[2];
+
+    /// Lanes executing the current instruction, with all bits set
+    alignas(16) Mask execution_mask;
+
+    /// Execution masks saved when entering conditional blocks and subroutines
+    alignas(16) Mask mask_stack[SOA_MASK_STACK_DEPTH];
+
+    /// Temporary storage for the values processed one lane at a time
+    alignas(16) Vector scratch;
+
+    /// Stack pointer at the entry of the shader, used to leave it from within subroutines
+    u64 entry_stack_pointer;
+
+    static size_t InputOffset(const SourceRegister& reg) {
+        switch (reg.GetRegisterType()) {
+        case RegisterType::Input:
+            return offsetof(SoaUnitState, registers.input) +
+                   reg.GetIndex() * sizeof(registers.input[0]);
+
+        case RegisterType::Temporary:
+            return offsetof(SoaUnitState, registers.temporary) +
+                   reg.GetIndex() * sizeof(registers.temporary[0]);
+
+        default:
+            UNREACHABLE();
+            return 0;
+        }
+    }
+
+    static size_t OutputOffset(const DestRegister& reg) {
+        switch (reg.GetRegisterType()) {
+        case RegisterType::Output:
+            return offsetof(SoaUnitState, registers.output) +
+                   reg.GetIndex() * sizeof(registers.output[0]);
+
+        case RegisterType::Temporary:
+            return offsetof(SoaUnitState, registers.temporary) +
+                   reg.GetIndex() * sizeof(registers.temporary[0]);
+
+        default:
+            UNREACHABLE();
+            return 0;
+        }
+    }
+
+    /**
+     * Loads the input registers with a batch of vertices. Lanes past `count` repeat the first
+     * vertex, so that they follow the same control flow.
+     */
+    void LoadInput(const ShaderRegs& config, const AttributeBuffer* input, unsigned count);
+
+    void WriteOutput(const ShaderRegs& config, AttributeBuffer* output, unsigned count) const;
+};
+
+/**
+ * Shader JIT compiler that processes several vertices per run: 8 with AVX, 4 with SSE4.1. Registers
+ * are kept in structure-of-arrays layout, which resolves swizzles and write masks at compile time.
+ *
+ * Per-vertex conditions (IFC and CALLC) update an execution mask, and results are only written to
+ * the active lanes. Control flow that masks can't follow, like a JMPC taken by only some of the
+ * active vertices or an END reached by only some of them, fails the run: the caller then has to
+ * process these vertices with the per-vertex JIT.
+ */
+class JitSoaShader : public Xbyak::CodeGenerator {
+public:
+    /// Returns whether the host CPU supports the instructions this compiler emits
+    static bool IsSupported();
+
+    /// Returns the largest lane count the host CPU supports
+    static unsigned GetMaxLaneCount();
+
+    /**
+     * Compiles a shader program.
+     * @param lanes Number of vertices processed per run, 4 or 8. 8 lanes require AVX.
+     * @return The compiled shader, or nullptr if its control flow can't be followed with execution
+     *         masks
+     */
+    static std::unique_ptr<JitSoaShader> Compile(
+        const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code,
+        const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data, unsigned lanes);
+
+    /// Number of vertices processed per run
+    unsigned GetLaneCount() const {
+        return lanes;
+    }
+
+    /// Returns whether the shader can start at the given offset
+    bool CanRunFrom(unsigned offset) const {
+        return offset < program_end;
+    }
+
+    /// Returns whether running the shader is worthwhile, which it isn't if most of its runs fail
+    bool IsEfficient() const {
+        return runs < 64 || failed_runs * 8 < runs;
+    }
+
+    /**
+     * Runs the shader on the vertices loaded into the unit state.
+     * @return False if the vertices took paths the shader can't follow, in which case the outputs
+     *         are invalid
+     */
+    bool Run(const ShaderSetup& setup, SoaUnitState& state, unsigned offset) const {
+        bool success = program(&setup, &state, instruction_labels[offset].getAddress()) == 0;
+        ++runs;
+        if (!success)
+            ++failed_runs;
+        return success;
+    }
+
+    void Compile_ADD(Instruction instr);
+    void Compile_DP3(Instruction instr);
+    void Compile_DP4(Instruction instr);
+    void Compile_DPH(Instruction instr);
+    void Compile_EX2(Instruction instr);
+    void Compile_LG2(Instruction instr);
+    void Compile_MUL(Instruction instr);
+    void Compile_SGE(Instruction instr);
+    void Compile_SLT(Instruction instr);
+    void Compile_FLR(Instruction instr);
+    void Compile_MAX(Instruction instr);
+    void Compile_MIN(Instruction instr);
+    void Compile_RCP(Instruction instr);
+    void Compile_RSQ(Instruction instr);
+    void Compile_MOVA(Instruction instr);
+    void Compile_MOV(Instruction instr);
+    void Compile_NOP(Instruction instr);
+    void Compile_END(Instruction instr);
+    void Compile_CALL(Instruction instr);
+    void Compile_CALLC(Instruction instr);
+    void Compile_CALLU(Instruction instr);
+    void Compile_IF(Instruction instr);
+    void Compile_LOOP(Instruction instr);
+    void Compile_JMP(Instruction instr);
+    void Compile_CMP(Instruction instr);
+    void Compile_MAD(Instruction instr);
+
+private:
+    JitSoaShader(unsigned program_end, unsigned lanes);
+
+    void Compile_Program();
+    void Compile_Block(unsigned end);
+    void Compile_NextInstr();
+
+    /**
+     * Loads one component of a swizzled source register into all lanes of `dest`.
+     * @param component Component of the swizzled register, from 0 (x) to 3 (w)
+     */
+    void Compile_SwizzleSrc(Instruction instr, unsigned src_num, SourceRegister src_reg,
+                            unsigned component, Xbyak::Xmm dest);
+
+    /**
+     * Loads a source component addressed with a per-lane address register, one lane at a time.
+     * @param uniform True for float uniforms, false for input and temporary registers
+     * @param disp Offset of the component of the register relative to which it is addressed
+     */
+    void Compile_GatherSrc(Xbyak::Xmm dest, bool uniform, int disp, unsigned address_register);
+
+    /**
+     * Stores the results to the enabled components of the destination register, in the active
+     * lanes only. The result of component i is taken from result[i], or result[0] if `broadcast`.
+     */
+    void Compile_DestEnable(Instruction instr, bool broadcast = false);
+
+    /**
+     * Compiles a `MUL src1, src2` operation, properly handling the PICA semantics when multiplying
+     * zero by inf. Clobbers `src2` and `scratch`.
+     */
+    void Compile_SanitizedMul(Xbyak::Xmm src1, Xbyak::Xmm src2, Xbyak::Xmm scratch);
+
+    /// Returns the swizzle pattern of an arithmetic instruction
+    SwizzlePattern GetSwizzlePattern(Instruction instr) const;
+
+    /**
+     * Compiles a dot product, storing the sum to result[0].
+     * @param products Number of components multiplied
+     * @param terms    Number of terms summed, the 4th being loaded to result[3] beforehand if it
+     *                 isn't a product
+     */
+    void Compile_DotProduct(Instruction instr, SourceRegister src1, SourceRegister src2,
+                            unsigned products, unsigned terms);
+
+    /// Calls a float function on the x component of the first source, one lane at a time
+    void Compile_CallPerLane(Instruction instr, float (*function)(float));
+
+    /// Sets all bits of `dest` in the lanes where the condition of the instruction is true
+    void Compile_EvaluateCondition(Instruction instr, Xbyak::Xmm dest);
+    void Compile_UniformCondition(Instruction instr);
+
+    /// Sets the execution mask, and the ZF flag if no lane is active
+    void Compile_SetExecutionMask(Xbyak::Xmm mask);
+    void Compile_PushMask(Xbyak::Xmm mask);
+    /// Restores the execution mask saved `depth` entries below the top of the mask stack
+    void Compile_PopMasks(unsigned depth);
+
+    /// Calls a subroutine, restoring the execution mask and mask stack when it returns
+    void Compile_CallSubroutine(Instruction instr);
+
+    /// Emits the code to conditionally return from a subroutine invoked by the `CALL` instruction
+    void Compile_Return();
+
+    void Compile_LoadConstants();
+    void Compile_Not(Xbyak::Xmm value);
+
+    BitSet32 PersistentCallerSavedRegs();
+
+    /**
+     * Assertion evaluated at compile-time, but only triggered if executed at runtime.
+     * @param condition Condition to be evaluated.
+     * @param msg       Message to be logged if the assertion fails.
+     */
+    void Compile_Assert(bool condition, const char* msg);
+
+    void FindReturnOffsets();
+
+    /**
+     * Returns the offset past the last instruction that can be reached from the start of the
+     * program, with its subroutines and jump targets.
+     */
+    static unsigned FindProgramEnd(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>& program_code);
+
+    /**
+     * Returns whether jumps stay within the conditional blocks they are in, which execution masks
+     * require.
+     */
+    static bool HasStructuredJumps(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>& program_code,
+                                   unsigned program_end);
+
+    // Vector operations emitted as SSE or AVX instructions depending on the lane count. With SSE,
+    // `dest` must not be `b` unless it is also `a`.
+    Xbyak::Xmm V(int index) const;
+    void VLoad(Xbyak::Xmm dest, const Xbyak::Address& src);
+    void VStore(const Xbyak::Address& dest, Xbyak::Xmm src);
+    void VMov(Xbyak::Xmm dest, Xbyak::Xmm src);
+    void VBroadcast(Xbyak::Xmm dest, const Xbyak::Address& src);
+    void VAdd(Xbyak::Xmm dest, Xbyak::Xmm a, const Xbyak::Operand& b);
+    void VMul(Xbyak::Xmm dest, Xbyak::Xmm a, const Xbyak::Operand& b);
+    void VMax(Xbyak::Xmm dest, Xbyak::Xmm a, const Xbyak::Operand& b);
+    void VMin(Xbyak::Xmm dest, Xbyak::Xmm a, const Xbyak::Operand& b);
+    void VAnd(Xbyak::Xmm dest, Xbyak::Xmm a, const Xbyak::Operand& b);
+    /// dest = ~a & b
+    void VAndNot(Xbyak::Xmm dest, Xbyak::Xmm a, const Xbyak::Operand& b);
+    void VXor(Xbyak::Xmm dest, Xbyak::Xmm a, const Xbyak::Operand& b);
+    void VCmp(Xbyak::Xmm dest, Xbyak::Xmm a, const Xbyak::Operand& b, u8 predicate);
+    /// dest = mask ? b : a, per lane. With SSE, `mask` must be xmm0.
+    void VBlend(Xbyak::Xmm dest, Xbyak::Xmm a, Xbyak::Xmm b, Xbyak::Xmm mask);
+    void VFloor(Xbyak::Xmm dest, Xbyak::Xmm src);
+    void VRcp(Xbyak::Xmm dest, Xbyak::Xmm src);
+    void VRsqrt(Xbyak::Xmm dest, Xbyak::Xmm src);
+    void VTruncate(Xbyak::Xmm dest, Xbyak::Xmm src);
+    void VMoveMask(Xbyak::Reg32 dest, Xbyak::Xmm src);
+
+    const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code = nullptr;
+    const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data = nullptr;
+
+    /// Mapping of Pica VS instructions to pointers in the emitted code
+    std::array<Xbyak::Label, MAX_PROGRAM_CODE_LENGTH> instruction_labels;
+
+    /// Offsets in code where a return needs to be inserted
+    std::vector<unsigned> return_offsets;
+
+    Xbyak::Label end_label;      ///< Leaves the shader successfully
+    Xbyak::Label diverged_label; ///< Leaves the shader reporting that the run failed
+
+    const unsigned program_end; ///< Offset past the last compiled instruction
+    const unsigned lanes;       ///< Number of vertices processed per run
+    const bool avx;             ///< Whether AVX instructions on YMM registers are emitted
+
+    unsigned program_counter = 0; ///< Offset of the next instruction to decode
+    bool looping = false;         ///< True if compiling a loop, used to check for nested loops
+
+    // Statistics deciding whether the shader is worth running
+    mutable unsigned runs = 0;
+    mutable unsigned failed_runs = 0;
+
+    using CompiledShader = u32(const void* setup, void* state, const u8* start_addr);
+    CompiledShader* program = nullptr;
+};
+
+} // Shader
+
+} // Pica
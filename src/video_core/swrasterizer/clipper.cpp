@@ -4,7 +4,9 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstddef>
+#include <utility>
 #include <boost/container/static_vector.hpp>
 #include <boost/container/vector.hpp>
 #include "common/bit_field.h"
@@ -52,22 +54,25 @@ private:
     Math::Vec4<float24> bias;
 };
 
-static void InitScreenCoordinates(Vertex& vtx) {
-    struct {
-        float24 halfsize_x;
-        float24 offset_x;
-        float24 halfsize_y;
-        float24 offset_y;
-        float24 zscale;
-        float24 offset_z;
-    } viewport;
+/// Transformation from normalized device coordinates to screen coordinates
+struct Viewport {
+    float24 halfsize_x;
+    float24 offset_x;
+    float24 halfsize_y;
+    float24 offset_y;
+};
 
+static Viewport GetViewport() {
     const auto& regs = g_state.regs;
+    Viewport viewport;
     viewport.halfsize_x = float24::FromRaw(regs.rasterizer.viewport_size_x);
     viewport.halfsize_y = float24::FromRaw(regs.rasterizer.viewport_size_y);
     viewport.offset_x = float24::FromFloat32(static_cast<float>(regs.rasterizer.viewport_corner.x));
     viewport.offset_y = float24::FromFloat32(static_cast<float>(regs.rasterizer.viewport_corner.y));
+    return viewport;
+}
 
+static void InitScreenCoordinates(Vertex& vtx, const Viewport& viewport) {
     float24 inv_w = float24::FromFloat32(1.f) / vtx.pos.w;
     vtx.pos.w = inv_w;
     vtx.quat *= inv_w;
@@ -85,42 +90,139 @@ static void InitScreenCoordinates(Vertex& vtx) {
     vtx.screenpos[2] = vtx.pos.z * inv_w;
 }
 
+/**
+ * Returns the largest factor k such that the points with normalized device coordinates in [-k, k]
+ * along an axis are mapped to screen coordinates the rasterizer can represent, and at least 1.
+ */
+static float GuardBandFactor(float24 offset, float24 halfsize) {
+    const float center = offset.ToFloat32() + halfsize.ToFloat32();
+    const float extent = std::fabs(halfsize.ToFloat32());
+    if (!(extent > 0.f))
+        return 1.f;
+
+    const float k = std::min((center - Rasterizer::GUARD_BAND_MIN) / extent,
+                             (Rasterizer::GUARD_BAND_MAX - center) / extent);
+    return std::max(k, 1.f);
+}
+
+// Outcode bits, set for a vertex outside the corresponding clipping plane
+constexpr u32 OUTSIDE_POS_X = 1 << 0;     // x = +w
+constexpr u32 OUTSIDE_NEG_X = 1 << 1;     // x = -w
+constexpr u32 OUTSIDE_POS_Y = 1 << 2;     // y = +w
+constexpr u32 OUTSIDE_NEG_Y = 1 << 3;     // y = -w
+constexpr u32 OUTSIDE_Z = 1 << 4;         // z =  0
+constexpr u32 OUTSIDE_NEG_Z = 1 << 5;     // z = -w
+constexpr u32 OUTSIDE_W = 1 << 6;         // w = EPSILON
+constexpr u32 OUTSIDE_GB_POS_X = 1 << 7;  // x = +k_x * w
+constexpr u32 OUTSIDE_GB_NEG_X = 1 << 8;  // x = -k_x * w
+constexpr u32 OUTSIDE_GB_POS_Y = 1 << 9;  // y = +k_y * w
+constexpr u32 OUTSIDE_GB_NEG_Y = 1 << 10; // y = -k_y * w
+
+constexpr u32 VIEW_VOLUME_PLANES = OUTSIDE_POS_X | OUTSIDE_NEG_X | OUTSIDE_POS_Y | OUTSIDE_NEG_Y |
+                                   OUTSIDE_Z | OUTSIDE_NEG_Z | OUTSIDE_W;
+// Planes that are clipped against, the rasterizer scissors the guard band to the viewport
+constexpr u32 CLIPPED_PLANES = OUTSIDE_Z | OUTSIDE_NEG_Z | OUTSIDE_W | OUTSIDE_GB_POS_X |
+                               OUTSIDE_GB_NEG_X | OUTSIDE_GB_POS_Y | OUTSIDE_GB_NEG_Y;
+
+// NOTE: We clip against a w=epsilon plane to guarantee that the output has a positive w value.
+// TODO: Not sure if this is a valid approach. Also should probably instead use the smallest
+//       epsilon possible within float24 accuracy.
+static const float EPSILON = 0.00001f;
+
+/**
+ * Classifies a vertex against the clipping planes. The comparisons are written so that a NaN
+ * coordinate puts the vertex outside.
+ */
+static u32 ComputeOutcode(const Math::Vec4<float24>& pos, float guard_band_x,
+                          float guard_band_y) {
+    const float x = pos.x.ToFloat32();
+    const float y = pos.y.ToFloat32();
+    const float z = pos.z.ToFloat32();
+    const float w = pos.w.ToFloat32();
+    const float gb_x = guard_band_x * w;
+    const float gb_y = guard_band_y * w;
+
+    u32 outcode = 0;
+    outcode |= !(x <= w) ? OUTSIDE_POS_X : 0;
+    outcode |= !(-x <= w) ? OUTSIDE_NEG_X : 0;
+    outcode |= !(y <= w) ? OUTSIDE_POS_Y : 0;
+    outcode |= !(-y <= w) ? OUTSIDE_NEG_Y : 0;
+    outcode |= !(z <= 0.f) ? OUTSIDE_Z : 0;
+    outcode |= !(-z <= w) ? OUTSIDE_NEG_Z : 0;
+    outcode |= !(w >= EPSILON) ? OUTSIDE_W : 0;
+    outcode |= !(x <= gb_x) ? OUTSIDE_GB_POS_X : 0;
+    outcode |= !(-x <= gb_x) ? OUTSIDE_GB_NEG_X : 0;
+    outcode |= !(y <= gb_y) ? OUTSIDE_GB_POS_Y : 0;
+    outcode |= !(-y <= gb_y) ? OUTSIDE_GB_NEG_Y : 0;
+    return outcode;
+}
+
 void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2) {
+    ClipTriangle(v0, v1, v2, true, Rasterizer::ProcessTriangle);
+}
+
+void ClipTriangle(const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2,
+                  bool use_guard_band, const TriangleHandler& rasterize) {
     using boost::container::static_vector;
 
+    // Without the guard band, its planes are those of the view volume
+    const Viewport viewport = GetViewport();
+    const float guard_band_x =
+        use_guard_band ? GuardBandFactor(viewport.offset_x, viewport.halfsize_x) : 1.f;
+    const float guard_band_y =
+        use_guard_band ? GuardBandFactor(viewport.offset_y, viewport.halfsize_y) : 1.f;
+
+    const u32 outcode0 = ComputeOutcode(v0.pos, guard_band_x, guard_band_y);
+    const u32 outcode1 = ComputeOutcode(v1.pos, guard_band_x, guard_band_y);
+    const u32 outcode2 = ComputeOutcode(v2.pos, guard_band_x, guard_band_y);
+
+    // Trivial reject: all vertices are outside of the same plane of the view volume
+    if ((outcode0 & outcode1 & outcode2 & VIEW_VOLUME_PLANES) != 0)
+        return;
+
+    // Planes crossed by the triangle. Those it doesn't cross can't be crossed by the polygon
+    // clipped against the others either, as its vertices lie on the edges of the triangle. A
+    // triangle crossing none of them lies within the depth range and the guard band, whatever
+    // exceeds the viewport is left to the scissoring of the rasterizer.
+    const u32 crossed_planes = (outcode0 | outcode1 | outcode2) & CLIPPED_PLANES;
+
     // Clipping a planar n-gon against a plane will remove at least 1 vertex and introduces 2 at
     // the new edge (or less in degenerate cases). As such, we can say that each clipping plane
     // introduces at most 1 new vertex to the polygon. Since we start with a triangle and have a
-    // fixed 6 clipping planes, the maximum number of vertices of the clipped polygon is 3 + 6 = 9.
-    static const size_t MAX_VERTICES = 9;
+    // fixed 7 clipping planes, the maximum number of vertices of the clipped polygon is 3 + 7 = 10.
+    static const size_t MAX_VERTICES = 10;
     static_vector<Vertex, MAX_VERTICES> buffer_a = {v0, v1, v2};
     static_vector<Vertex, MAX_VERTICES> buffer_b;
     auto* output_list = &buffer_a;
     auto* input_list = &buffer_b;
 
-    // NOTE: We clip against a w=epsilon plane to guarantee that the output has a positive w value.
-    // TODO: Not sure if this is a valid approach. Also should probably instead use the smallest
-    //       epsilon possible within float24 accuracy.
-    static const float24 EPSILON = float24::FromFloat32(0.00001f);
     static const float24 f0 = float24::FromFloat32(0.0);
     static const float24 f1 = float24::FromFloat32(1.0);
-    static const std::array<ClippingEdge, 7> clipping_edges = {{
-        {Math::MakeVec(f1, f0, f0, -f1)},                                           // x = +w
-        {Math::MakeVec(-f1, f0, f0, -f1)},                                          // x = -w
-        {Math::MakeVec(f0, f1, f0, -f1)},                                           // y = +w
-        {Math::MakeVec(f0, -f1, f0, -f1)},                                          // y = -w
-        {Math::MakeVec(f0, f0, f1, f0)},                                            // z =  0
-        {Math::MakeVec(f0, f0, -f1, -f1)},                                          // z = -w
-        {Math::MakeVec(f0, f0, f0, -f1), Math::Vec4<float24>(f0, f0, f0, EPSILON)}, // w = EPSILON
+    const float24 gb_x = float24::FromFloat32(guard_band_x);
+    const float24 gb_y = float24::FromFloat32(guard_band_y);
+    const std::array<std::pair<u32, ClippingEdge>, 7> clipping_edges = {{
+        {OUTSIDE_GB_POS_X, {Math::MakeVec(f1, f0, f0, -gb_x)}},  // x = +k_x * w
+        {OUTSIDE_GB_NEG_X, {Math::MakeVec(-f1, f0, f0, -gb_x)}}, // x = -k_x * w
+        {OUTSIDE_GB_POS_Y, {Math::MakeVec(f0, f1, f0, -gb_y)}},  // y = +k_y * w
+        {OUTSIDE_GB_NEG_Y, {Math::MakeVec(f0, -f1, f0, -gb_y)}}, // y = -k_y * w
+        {OUTSIDE_Z, {Math::MakeVec(f0, f0, f1, f0)}},            // z =  0
+        {OUTSIDE_NEG_Z, {Math::MakeVec(f0, f0, -f1, -f1)}},      // z = -w
+        {OUTSIDE_W,
+         {Math::MakeVec(f0, f0, f0, -f1),
+          Math::Vec4<float24>(f0, f0, f0, float24::FromFloat32(-EPSILON))}}, // w = EPSILON
     }};
 
     // TODO: If one vertex lies outside one of the depth clipping planes, some platforms (e.g. Wii)
     //       drop the whole primitive instead of clipping the primitive properly. We should test if
     //       this happens on the 3DS, too.
 
-    // Simple implementation of the Sutherland-Hodgman clipping algorithm.
-    // TODO: Make this less inefficient (currently lots of useless buffering overhead happens here)
-    for (auto edge : clipping_edges) {
+    // Simple implementation of the Sutherland-Hodgman clipping algorithm, only run against the
+    // planes crossed by the triangle.
+    for (const auto& plane : clipping_edges) {
+        if ((crossed_planes & plane.first) == 0)
+            continue;
+
+        const ClippingEdge& edge = plane.second;
 
         std::swap(input_list, output_list);
         output_list->clear();
@@ -146,15 +248,14 @@ void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const Outpu
             return;
     }
 
-    InitScreenCoordinates((*output_list)[0]);
-    InitScreenCoordinates((*output_list)[1]);
+    for (auto& vertex : *output_list) {
+        InitScreenCoordinates(vertex, viewport);
+    }
 
     for (size_t i = 0; i < output_list->size() - 2; i++) {
-        Vertex& vtx0 = (*output_list)[0];
-        Vertex& vtx1 = (*output_list)[i + 1];
-        Vertex& vtx2 = (*output_list)[i + 2];
-
-        InitScreenCoordinates(vtx2);
+        const Vertex& vtx0 = (*output_list)[0];
+        const Vertex& vtx1 = (*output_list)[i + 1];
+        const Vertex& vtx2 = (*output_list)[i + 2];
 
         LOG_TRACE(Render_Software,
                   "Triangle %lu/%lu at position (%.3f, %.3f, %.3f, %.3f), "
@@ -170,7 +271,7 @@ void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const Outpu
                   vtx1.screenpos.z.ToFloat32(), vtx2.screenpos.x.ToFloat32(),
                   vtx2.screenpos.y.ToFloat32(), vtx2.screenpos.z.ToFloat32());
 
-        Rasterizer::ProcessTriangle(vtx0, vtx1, vtx2);
+        rasterize(vtx0, vtx1, vtx2);
     }
 }
 
@@ -4,18 +4,36 @@
 
 #pragma once
 
+#include <functional>
+
 namespace Pica {
 
 namespace Shader {
 struct OutputVertex;
 }
 
+namespace Rasterizer {
+struct Vertex;
+}
+
 namespace Clipper {
 
 using Shader::OutputVertex;
 
 void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2);
 
+/// Receives the clipped triangles, with their screen coordinates set up
+using TriangleHandler = std::function<void(const Rasterizer::Vertex&, const Rasterizer::Vertex&,
+                                           const Rasterizer::Vertex&)>;
+
+/**
+ * Clips a triangle against the view volume and passes the resulting triangles to the handler.
+ * ProcessTriangle uses the guard band, only clipping against it the x and y sides of the view
+ * volume. Without it, every plane of the view volume is clipped against.
+ */
+void ClipTriangle(const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2,
+                  bool use_guard_band, const TriangleHandler& rasterize);
+
 } // namespace
 
 } // namespace
@@ -0,0 +1,39 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "video_core/swrasterizer/coverage.h"
+
+namespace Pica {
+namespace Rasterizer {
+
+// Triangle filling rules: Pixels on the right-sided edge or on flat bottom edges are not
+// drawn. Pixels on any other triangle border are drawn. This is implemented with three bias
+// values which are added to the barycentric coordinates w0, w1 and w2, respectively.
+// NOTE: These are the PSP filling rules. Not sure if the 3DS uses the same ones...
+static bool IsRightSideOrFlatBottomEdge(const Math::Vec2<int>& vtx, const Math::Vec2<int>& line1,
+                                        const Math::Vec2<int>& line2) {
+    if (line1.y == line2.y) {
+        // just check if vertex is above us => bottom line parallel to x-axis
+        return vtx.y < line1.y;
+    } else {
+        // check if vertex is on our left => right side
+        // TODO: Not sure how likely this is to overflow
+        return vtx.x < line1.x + (line2.x - line1.x) * (vtx.y - line1.y) / (line2.y - line1.y);
+    }
+}
+
+TriangleEdges::TriangleEdges(const Math::Vec2<int>& vtx0, const Math::Vec2<int>& vtx1,
+                             const Math::Vec2<int>& vtx2)
+    : vtx{{vtx0, vtx1, vtx2}} {
+    for (int i = 0; i < 3; ++i) {
+        const Math::Vec2<int>& from = vtx[(i + 1) % 3];
+        const Math::Vec2<int>& to = vtx[(i + 2) % 3];
+        bias[i] = IsRightSideOrFlatBottomEdge(vtx[i], from, to) ? -1 : 0;
+        step_x[i] = -(to.y - from.y) * 16;
+        step_y[i] = (to.x - from.x) * 16;
+    }
+}
+
+} // namespace Rasterizer
+} // namespace Pica
@@ -0,0 +1,162 @@
+// Copyright 2017 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include "common/common_types.h"
+#include "common/vector_math.h"
+
+namespace Pica {
+namespace Rasterizer {
+
+/// Width and height in pixels of the blocks which the coverage of a triangle is classified for
+constexpr int COVERAGE_BLOCK_SIZE = 8;
+
+/**
+ * Edge functions of a triangle with vertices in 12.4 fixed point screen coordinates, wound
+ * counter-clockwise. The edge function opposite to a vertex is the signed area spanned by the edge
+ * and a point, which is the unnormalized barycentric coordinate of the point for that vertex. It
+ * includes the bias implementing the fill rule, so that a pixel is covered if and only if all the
+ * edge functions are non-negative at its center.
+ */
+class TriangleEdges {
+public:
+    TriangleEdges(const Math::Vec2<int>& vtx0, const Math::Vec2<int>& vtx1,
+                  const Math::Vec2<int>& vtx2);
+
+    /// Evaluates the edge functions at the given point in 12.4 fixed point
+    Math::Vec3<int> Evaluate(int x, int y) const {
+        return {bias[0] + Edge(vtx[1], vtx[2], x, y), bias[1] + Edge(vtx[2], vtx[0], x, y),
+                bias[2] + Edge(vtx[0], vtx[1], x, y)};
+    }
+
+    /// Increment of the edge functions when moving one pixel to the right
+    const Math::Vec3<int>& StepX() const {
+        return step_x;
+    }
+
+    /// Increment of the edge functions when moving one pixel down
+    const Math::Vec3<int>& StepY() const {
+        return step_y;
+    }
+
+private:
+    static int Edge(const Math::Vec2<int>& from, const Math::Vec2<int>& to, int x, int y) {
+        // The guard band keeps the coordinates within 2048 pixels of each other, for which this
+        // fits, also for points up to one pixel outside of the triangle bounding box
+        return (to.x - from.x) * (y - from.y) - (to.y - from.y) * (x - from.x);
+    }
+
+    std::array<Math::Vec2<int>, 3> vtx;
+    std::array<int, 3> bias;
+    Math::Vec3<int> step_x;
+    Math::Vec3<int> step_y;
+};
+
+/// A 2x2 quad of pixels of a triangle, as produced by ForEachCoveredQuad
+struct CoverageQuad {
+    /// Center of the top-left pixel of the quad in 12.4 fixed point
+    int x;
+    int y;
+    /// Edge functions at the pixel centers, in order top-left, top-right, bottom-left, bottom-right
+    std::array<Math::Vec3<int>, 4> w;
+    /// Bit i is set if pixel i is covered by the triangle
+    unsigned mask;
+};
+
+/**
+ * Walks the pixels of a triangle within a bounding box, by blocks of COVERAGE_BLOCK_SIZE pixels
+ * which are classified as fully covered, partially covered or not covered at all from the edge
+ * functions at their corners, and then by 2x2 quads of pixels. The edge functions are stepped
+ * incrementally, and give the same values as evaluating them at each pixel center.
+ * @param min_x, min_y, max_x, max_y Bounding box in 12.4 fixed point, aligned to whole pixels
+ * @param block_func Called as block_func(block_x, block_y) for each block with covered pixels, in
+ *                   block units. The block is skipped if it returns false.
+ * @param quad_func Called as quad_func(quad) for each CoverageQuad with covered pixels
+ */
+template <typename BlockFunc, typename QuadFunc>
+void ForEachCoveredQuad(const TriangleEdges& edges, int min_x, int min_y, int max_x, int max_y,
+                        BlockFunc&& block_func, QuadFunc&& quad_func) {
+    const int pixel_min_x = min_x >> 4;
+    const int pixel_min_y = min_y >> 4;
+    const int pixel_max_x = max_x >> 4;
+    const int pixel_max_y = max_y >> 4;
+    if (pixel_min_x >= pixel_max_x || pixel_min_y >= pixel_max_y)
+        return;
+
+    auto Center = [](int pixel) { return (pixel << 4) + 8; };
+
+    const Math::Vec3<int>& step_x = edges.StepX();
+    const Math::Vec3<int>& step_y = edges.StepY();
+    const Math::Vec3<int> quad_step_x = step_x * 2;
+    const Math::Vec3<int> quad_step_y = step_y * 2;
+
+    for (int block_y = pixel_min_y / COVERAGE_BLOCK_SIZE;
+         block_y * COVERAGE_BLOCK_SIZE < pixel_max_y; ++block_y) {
+        const int y_begin = std::max(block_y * COVERAGE_BLOCK_SIZE, pixel_min_y);
+        const int y_end = std::min((block_y + 1) * COVERAGE_BLOCK_SIZE, pixel_max_y);
+
+        for (int block_x = pixel_min_x / COVERAGE_BLOCK_SIZE;
+             block_x * COVERAGE_BLOCK_SIZE < pixel_max_x; ++block_x) {
+            const int x_begin = std::max(block_x * COVERAGE_BLOCK_SIZE, pixel_min_x);
+            const int x_end = std::min((block_x + 1) * COVERAGE_BLOCK_SIZE, pixel_max_x);
+
+            // The edge functions being affine, their extrema over the pixel centers of the block
+            // are at the corner pixels
+            const Math::Vec3<int> corners[4] = {
+                edges.Evaluate(Center(x_begin), Center(y_begin)),
+                edges.Evaluate(Center(x_end - 1), Center(y_begin)),
+                edges.Evaluate(Center(x_begin), Center(y_end - 1)),
+                edges.Evaluate(Center(x_end - 1), Center(y_end - 1)),
+            };
+            bool fully_covered = true;
+            bool not_covered = false;
+            for (int i = 0; i < 3; ++i) {
+                const auto minmax = std::minmax(
+                    {corners[0][i], corners[1][i], corners[2][i], corners[3][i]});
+                fully_covered &= minmax.first >= 0;
+                not_covered |= minmax.second < 0;
+            }
+            if (not_covered || !block_func(block_x, block_y))
+                continue;
+
+            // Quads are aligned to even pixels, so they may start one pixel before the block
+            const int quad_x_begin = x_begin & ~1;
+            const int quad_y_begin = y_begin & ~1;
+            Math::Vec3<int> row_w = edges.Evaluate(Center(quad_x_begin), Center(quad_y_begin));
+
+            for (int y = quad_y_begin; y < y_end; y += 2, row_w += quad_step_y) {
+                Math::Vec3<int> quad_w = row_w;
+
+                for (int x = quad_x_begin; x < x_end; x += 2, quad_w += quad_step_x) {
+                    CoverageQuad quad;
+                    quad.x = Center(x);
+                    quad.y = Center(y);
+                    quad.w = {{quad_w, quad_w + step_x, quad_w + step_y, quad_w + step_x + step_y}};
+                    quad.mask = 0;
+
+                    for (int i = 0; i < 4; ++i) {
+                        const int pixel_x = x + (i & 1);
+                        const int pixel_y = y + (i >> 1);
+                        if (pixel_x < x_begin || pixel_x >= x_end || pixel_y < y_begin ||
+                            pixel_y >= y_end)
+                            continue;
+
+                        const Math::Vec3<int>& w = quad.w[i];
+                        if (fully_covered || (w[0] >= 0 && w[1] >= 0 && w[2] >= 0))
+                            quad.mask |= 1 << i;
+                    }
+
+                    if (quad.mask != 0)
+                        quad_func(quad);
+                }
+            }
+        }
+    }
+}
+
+} // namespace Rasterizer
+} // namespace Pica
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <vector>
 
 #include "common/assert.h"
 #include "common/color.h"
@@ -20,6 +21,25 @@
 namespace Pica {
 namespace Rasterizer {
 
+namespace {
+
+/// Tile bounds marking a tile whose depth values have not been read yet
+constexpr DepthTileBounds INVALID_DEPTH_TILE = {0xFFFFFFFF, 0};
+
+/// Coarse depth buffer, holding the depth bounds of each tile of the depth buffer it was built for
+struct DepthTileCache {
+    PAddr address = 0;
+    FramebufferRegs::DepthFormat format = FramebufferRegs::DepthFormat::D16;
+    u32 width = 0;
+    u32 height = 0;
+    int tiles_per_row = 0;
+    std::vector<DepthTileBounds> tiles;
+};
+
+DepthTileCache depth_tiles;
+
+} // namespace
+
 void DrawPixel(int x, int y, const Math::Vec4<u8>& color) {
     const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
     const PAddr addr = framebuffer.GetColorBufferPhysicalAddress();
@@ -161,6 +181,19 @@ void SetDepth(int x, int y, u32 value) {
     const PAddr addr = framebuffer.GetDepthBufferPhysicalAddress();
     u8* depth_buffer = Memory::GetPhysicalPointer(addr);
 
+    // Widen the bounds of the coarse depth buffer tile to keep them conservative. If the coarse
+    // depth buffer was built for another depth buffer, this only loosens bounds which are still
+    // valid, as that depth buffer is not written here.
+    const size_t tile_index =
+        (y / DEPTH_TILE_SIZE) * depth_tiles.tiles_per_row + x / DEPTH_TILE_SIZE;
+    if (x >= 0 && y >= 0 && tile_index < depth_tiles.tiles.size()) {
+        DepthTileBounds& tile = depth_tiles.tiles[tile_index];
+        if (tile.min <= tile.max) {
+            tile.min = std::min(tile.min, value);
+            tile.max = std::max(tile.max, value);
+        }
+    }
+
     y = framebuffer.height - y;
 
     const u32 coarse_y = y & ~7;
@@ -221,6 +254,106 @@ void SetStencil(int x, int y, u8 value) {
     }
 }
 
+DepthTileBounds GetDepthTileBounds(int tile_x, int tile_y) {
+    const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
+    const PAddr address = framebuffer.GetDepthBufferPhysicalAddress();
+    const u32 width = framebuffer.GetWidth();
+    const u32 height = framebuffer.GetHeight();
+
+    if (depth_tiles.address != address || depth_tiles.format != framebuffer.depth_format ||
+        depth_tiles.width != width || depth_tiles.height != height || depth_tiles.tiles.empty()) {
+        depth_tiles.address = address;
+        depth_tiles.format = framebuffer.depth_format;
+        depth_tiles.width = width;
+        depth_tiles.height = height;
+        depth_tiles.tiles_per_row = (width + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+        const int tiles_per_column = (height + DEPTH_TILE_SIZE - 1) / DEPTH_TILE_SIZE;
+        depth_tiles.tiles.assign(depth_tiles.tiles_per_row * tiles_per_column, INVALID_DEPTH_TILE);
+    }
+
+    const int x_begin = tile_x * DEPTH_TILE_SIZE;
+    const int y_begin = tile_y * DEPTH_TILE_SIZE;
+    if (tile_x < 0 || tile_y < 0 || x_begin >= static_cast<int>(width) ||
+        y_begin >= static_cast<int>(height)) {
+        // Nothing is known about pixels outside of the depth buffer
+        return {0, 0xFFFFFFFF};
+    }
+
+    DepthTileBounds& tile = depth_tiles.tiles[tile_y * depth_tiles.tiles_per_row + tile_x];
+    if (tile.min > tile.max) {
+        const int x_end = std::min<int>(x_begin + DEPTH_TILE_SIZE, width);
+        const int y_end = std::min<int>(y_begin + DEPTH_TILE_SIZE, height);
+        for (int y = y_begin; y < y_end; ++y) {
+            for (int x = x_begin; x < x_end; ++x) {
+                const u32 depth = GetDepth(x, y);
+                tile.min = std::min(tile.min, depth);
+                tile.max = std::max(tile.max, depth);
+            }
+        }
+    }
+
+    return tile;
+}
+
+void InvalidateDepthTiles() {
+    depth_tiles.tiles.clear();
+}
+
+void InvalidateDepthTiles(PAddr addr, u32 size) {
+    if (depth_tiles.tiles.empty())
+        return;
+
+    const u32 buffer_size = depth_tiles.width * depth_tiles.height *
+                            FramebufferRegs::BytesPerDepthPixel(depth_tiles.format);
+    if (addr < depth_tiles.address + buffer_size && depth_tiles.address < addr + size)
+        InvalidateDepthTiles();
+}
+
+bool EvaluateCompareFunc(FramebufferRegs::CompareFunc func, u32 lhs, u32 rhs) {
+    switch (func) {
+    case FramebufferRegs::CompareFunc::Never:
+        return false;
+    case FramebufferRegs::CompareFunc::Always:
+        return true;
+    case FramebufferRegs::CompareFunc::Equal:
+        return lhs == rhs;
+    case FramebufferRegs::CompareFunc::NotEqual:
+        return lhs != rhs;
+    case FramebufferRegs::CompareFunc::LessThan:
+        return lhs < rhs;
+    case FramebufferRegs::CompareFunc::LessThanOrEqual:
+        return lhs <= rhs;
+    case FramebufferRegs::CompareFunc::GreaterThan:
+        return lhs > rhs;
+    case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
+        return lhs >= rhs;
+    }
+    return false;
+}
+
+bool DepthTestFailsForRange(FramebufferRegs::CompareFunc func, u32 min_z, u32 max_z,
+                            const DepthTileBounds& ref) {
+    switch (func) {
+    case FramebufferRegs::CompareFunc::Never:
+        return true;
+    case FramebufferRegs::CompareFunc::Always:
+        return false;
+    case FramebufferRegs::CompareFunc::Equal:
+        return max_z < ref.min || min_z > ref.max;
+    case FramebufferRegs::CompareFunc::NotEqual:
+        return min_z == max_z && ref.min == ref.max && min_z == ref.min;
+    case FramebufferRegs::CompareFunc::LessThan:
+        return min_z >= ref.max;
+    case FramebufferRegs::CompareFunc::LessThanOrEqual:
+        return min_z > ref.max;
+    case FramebufferRegs::CompareFunc::GreaterThan:
+        return max_z <= ref.min;
+    case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
+        return max_z < ref.min;
+    }
+    return false;
+}
+
 u8 PerformStencilAction(FramebufferRegs::StencilAction action, u8 old_stencil, u8 ref) {
     switch (action) {
     case FramebufferRegs::StencilAction::Keep:
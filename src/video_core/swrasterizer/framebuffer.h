@@ -19,6 +19,39 @@ void SetDepth(int x, int y, u32 value);
 void SetStencil(int x, int y, u8 value);
 u8 PerformStencilAction(FramebufferRegs::StencilAction action, u8 old_stencil, u8 ref);
 
+/// Size in pixels of the square tiles of the coarse depth buffer
+constexpr int DEPTH_TILE_SIZE = 8;
+
+/// Conservative bounds of the depth values stored in a tile of the depth buffer
+struct DepthTileBounds {
+    u32 min;
+    u32 max;
+};
+
+/**
+ * Returns conservative bounds of the depth values in the given tile of the current depth buffer.
+ * The bounds of a tile are read from the depth buffer on first use, and only widened by SetDepth
+ * afterwards, so they stay valid until the depth buffer is written by anything else.
+ */
+DepthTileBounds GetDepthTileBounds(int tile_x, int tile_y);
+
+/// Discards the coarse depth buffer, to be called when the depth buffer may have been modified
+/// outside of SetDepth
+void InvalidateDepthTiles();
+
+/// Discards the coarse depth buffer if the given memory region overlaps the depth buffer
+void InvalidateDepthTiles(PAddr addr, u32 size);
+
+/// Evaluates a comparison function of the output merger
+bool EvaluateCompareFunc(FramebufferRegs::CompareFunc func, u32 lhs, u32 rhs);
+
+/**
+ * Checks whether the depth test fails for every fragment depth in [min_z, max_z] compared against
+ * every depth buffer value within the given tile bounds.
+ */
+bool DepthTestFailsForRange(FramebufferRegs::CompareFunc func, u32 min_z, u32 max_z,
+                            const DepthTileBounds& ref);
+
 Math::Vec4<u8> EvaluateBlendEquation(const Math::Vec4<u8>& src, const Math::Vec4<u8>& srcfactor,
                                      const Math::Vec4<u8>& dest, const Math::Vec4<u8>& destfactor,
                                      FramebufferRegs::BlendEquation equation);
@@ -4,6 +4,7 @@
 
 #include <array>
 #include <cmath>
+#include <cstring>
 #include "common/math_util.h"
 #include "video_core/swrasterizer/proctex.h"
 
@@ -15,14 +16,65 @@ using ProcTexShift = TexturingRegs::ProcTexShift;
 using ProcTexCombiner = TexturingRegs::ProcTexCombiner;
 using ProcTexFilter = TexturingRegs::ProcTexFilter;
 
-static float LookupLUT(const std::array<State::ProcTex::ValueEntry, 128>& lut, float coord) {
+/// A NoiseLUT/ColorMap/AlphaMap lookup table with its entries converted to float
+struct ValueLUT {
+    std::array<float, 128> value;
+    std::array<float, 128> diff;
+
+    void Decode(const std::array<State::ProcTex::ValueEntry, 128>& lut) {
+        for (size_t i = 0; i < lut.size(); ++i) {
+            value[i] = lut[i].ToFloat();
+            diff[i] = lut[i].DiffToFloat();
+        }
+    }
+};
+
+/// Period of NoiseRand1D, which only depends on v % 9 and (v / 9) % 16
+constexpr unsigned NOISE_RAND_PERIOD = 9 * 16;
+
+/**
+ * ProcTex registers and lookup tables decoded to the values used to generate the texture, along
+ * with the raw registers and tables they were decoded from.
+ */
+struct DecodedProcTex {
+    /// ProcTex registers 0xa8-0xad
+    std::array<u32, 6> raw_regs;
+    std::array<u8, sizeof(State::ProcTex)> raw_tables;
+
+    ProcTexClamp u_clamp;
+    ProcTexClamp v_clamp;
+    ProcTexCombiner color_combiner;
+    ProcTexCombiner alpha_combiner;
+    bool separate_alpha;
+    bool noise_enable;
+    ProcTexShift u_shift;
+    ProcTexShift v_shift;
+    ProcTexFilter lut_filter;
+    u32 lut_width;
+    u32 lut_offset;
+    float freq_u;
+    float freq_v;
+    float phase_u;
+    float phase_v;
+    float amplitude_u;
+    float amplitude_v;
+    ValueLUT noise_table;
+    ValueLUT color_map_table;
+    ValueLUT alpha_map_table;
+    std::array<Math::Vec4<float>, 256> color_table;
+    std::array<Math::Vec4<float>, 256> color_diff_table;
+    std::array<u8, NOISE_RAND_PERIOD> noise_rand_1d;
+    std::array<std::array<float, 16>, 16> noise_rand_2d;
+};
+
+static float LookupLUT(const ValueLUT& lut, float coord) {
     // For NoiseLUT/ColorMap/AlphaMap, coord=0.0 is lut[0], coord=127.0/128.0 is lut[127] and
     // coord=1.0 is lut[127]+lut_diff[127]. For other indices, the result is interpolated using
     // value entries and difference entries.
     coord *= 128;
     const int index_int = std::min(static_cast<int>(coord), 127);
     const float frac = coord - index_int;
-    return lut[index_int].ToFloat() + frac * lut[index_int].DiffToFloat();
+    return lut.value[index_int] + frac * lut.diff[index_int];
 }
 
 // These function are used to generate random noise for procedural texture. Their results are
@@ -33,11 +85,9 @@ static unsigned int NoiseRand1D(unsigned int v) {
     return ((v % 9 + 2) * 3 & 0xF) ^ table[(v / 9) & 0xF];
 }
 
-static float NoiseRand2D(unsigned int x, unsigned int y) {
+static float NoiseRand2D(unsigned int u2, unsigned int v2) {
     static constexpr std::array<unsigned int, 16> table{
         {10, 2, 15, 8, 0, 7, 4, 5, 5, 13, 2, 6, 13, 9, 3, 14}};
-    unsigned int u2 = NoiseRand1D(x);
-    unsigned int v2 = NoiseRand1D(y);
     v2 += ((u2 & 3) == 1) ? 4 : 0;
     v2 ^= (u2 & 1) * 6;
     v2 += 10 + u2;
@@ -46,24 +96,26 @@ static float NoiseRand2D(unsigned int x, unsigned int y) {
     return -1.0f + v2 * 2.0f / 15.0f;
 }
 
-static float NoiseCoef(float u, float v, TexturingRegs regs, State::ProcTex state) {
-    const float freq_u = float16::FromRaw(regs.proctex_noise_frequency.u).ToFloat32();
-    const float freq_v = float16::FromRaw(regs.proctex_noise_frequency.v).ToFloat32();
-    const float phase_u = float16::FromRaw(regs.proctex_noise_u.phase).ToFloat32();
-    const float phase_v = float16::FromRaw(regs.proctex_noise_v.phase).ToFloat32();
-    const float x = 9 * freq_u * std::abs(u + phase_u);
-    const float y = 9 * freq_v * std::abs(v + phase_v);
+/// Looks up NoiseRand2D(NoiseRand1D(x), NoiseRand1D(y)) in the decoded tables
+static float NoiseRand(const DecodedProcTex& proctex, unsigned int x, unsigned int y) {
+    return proctex.noise_rand_2d[proctex.noise_rand_1d[x % NOISE_RAND_PERIOD]]
+                                [proctex.noise_rand_1d[y % NOISE_RAND_PERIOD]];
+}
+
+static float NoiseCoef(float u, float v, const DecodedProcTex& proctex) {
+    const float x = 9 * proctex.freq_u * std::abs(u + proctex.phase_u);
+    const float y = 9 * proctex.freq_v * std::abs(v + proctex.phase_v);
     const int x_int = static_cast<int>(x);
     const int y_int = static_cast<int>(y);
     const float x_frac = x - x_int;
     const float y_frac = y - y_int;
 
-    const float g0 = NoiseRand2D(x_int, y_int) * (x_frac + y_frac);
-    const float g1 = NoiseRand2D(x_int + 1, y_int) * (x_frac + y_frac - 1);
-    const float g2 = NoiseRand2D(x_int, y_int + 1) * (x_frac + y_frac - 1);
-    const float g3 = NoiseRand2D(x_int + 1, y_int + 1) * (x_frac + y_frac - 2);
-    const float x_noise = LookupLUT(state.noise_table, x_frac);
-    const float y_noise = LookupLUT(state.noise_table, y_frac);
+    const float g0 = NoiseRand(proctex, x_int, y_int) * (x_frac + y_frac);
+    const float g1 = NoiseRand(proctex, x_int + 1, y_int) * (x_frac + y_frac - 1);
+    const float g2 = NoiseRand(proctex, x_int, y_int + 1) * (x_frac + y_frac - 1);
+    const float g3 = NoiseRand(proctex, x_int + 1, y_int + 1) * (x_frac + y_frac - 2);
+    const float x_noise = LookupLUT(proctex.noise_table, x_frac);
+    const float y_noise = LookupLUT(proctex.noise_table, y_frac);
     return Math::BilinearInterp(g0, g1, g2, g3, x_noise, y_noise);
 }
 
@@ -113,8 +165,7 @@ static void ClampCoord(float& coord, ProcTexClamp mode) {
     }
 }
 
-float CombineAndMap(float u, float v, ProcTexCombiner combiner,
-                    const std::array<State::ProcTex::ValueEntry, 128>& map_table) {
+static float CombineAndMap(float u, float v, ProcTexCombiner combiner, const ValueLUT& map_table) {
     float f;
     switch (combiner) {
     case ProcTexCombiner::U:
@@ -155,19 +206,77 @@ float CombineAndMap(float u, float v, ProcTexCombiner combiner,
     return LookupLUT(map_table, f);
 }
 
-Math::Vec4<u8> ProcTex(float u, float v, TexturingRegs regs, State::ProcTex state) {
+const DecodedProcTex& DecodeProcTex(const TexturingRegs& regs, const State::ProcTex& state) {
+    static DecodedProcTex proctex;
+    static bool decoded = false;
+
+    std::array<u32, 6> raw_regs;
+    std::memcpy(raw_regs.data(), &regs.proctex, sizeof(raw_regs));
+    static_assert(offsetof(TexturingRegs, proctex_lut_offset) - offsetof(TexturingRegs, proctex) ==
+                      sizeof(raw_regs) - sizeof(u32),
+                  "ProcTex registers are not contiguous");
+
+    if (decoded && raw_regs == proctex.raw_regs &&
+        std::memcmp(&state, proctex.raw_tables.data(), sizeof(state)) == 0) {
+        return proctex;
+    }
+
+    proctex.raw_regs = raw_regs;
+    std::memcpy(proctex.raw_tables.data(), &state, sizeof(state));
+
+    proctex.u_clamp = regs.proctex.u_clamp;
+    proctex.v_clamp = regs.proctex.v_clamp;
+    proctex.color_combiner = regs.proctex.color_combiner;
+    proctex.alpha_combiner = regs.proctex.alpha_combiner;
+    proctex.separate_alpha = regs.proctex.separate_alpha != 0;
+    proctex.noise_enable = regs.proctex.noise_enable != 0;
+    proctex.u_shift = regs.proctex.u_shift;
+    proctex.v_shift = regs.proctex.v_shift;
+    proctex.lut_filter = regs.proctex_lut.filter;
+    proctex.lut_width = regs.proctex_lut.width;
+    proctex.lut_offset = regs.proctex_lut_offset;
+    proctex.freq_u = float16::FromRaw(regs.proctex_noise_frequency.u).ToFloat32();
+    proctex.freq_v = float16::FromRaw(regs.proctex_noise_frequency.v).ToFloat32();
+    proctex.phase_u = float16::FromRaw(regs.proctex_noise_u.phase).ToFloat32();
+    proctex.phase_v = float16::FromRaw(regs.proctex_noise_v.phase).ToFloat32();
+    proctex.amplitude_u = static_cast<float>(regs.proctex_noise_u.amplitude);
+    proctex.amplitude_v = static_cast<float>(regs.proctex_noise_v.amplitude);
+
+    proctex.noise_table.Decode(state.noise_table);
+    proctex.color_map_table.Decode(state.color_map_table);
+    proctex.alpha_map_table.Decode(state.alpha_map_table);
+    for (size_t i = 0; i < state.color_table.size(); ++i) {
+        proctex.color_table[i] = state.color_table[i].ToVector().Cast<float>();
+        proctex.color_diff_table[i] = state.color_diff_table[i].ToVector().Cast<float>();
+    }
+
+    // The noise tables do not depend on the configuration, but are kept along for locality
+    if (!decoded) {
+        for (unsigned i = 0; i < NOISE_RAND_PERIOD; ++i)
+            proctex.noise_rand_1d[i] = static_cast<u8>(NoiseRand1D(i));
+        for (unsigned u2 = 0; u2 < 16; ++u2) {
+            for (unsigned v2 = 0; v2 < 16; ++v2)
+                proctex.noise_rand_2d[u2][v2] = NoiseRand2D(u2, v2);
+        }
+    }
+
+    decoded = true;
+    return proctex;
+}
+
+Math::Vec4<u8> ProcTex(float u, float v, const DecodedProcTex& proctex) {
     u = std::abs(u);
     v = std::abs(v);
 
     // Get shift offset before noise generation
-    const float u_shift = GetShiftOffset(v, regs.proctex.u_shift, regs.proctex.u_clamp);
-    const float v_shift = GetShiftOffset(u, regs.proctex.v_shift, regs.proctex.v_clamp);
+    const float u_shift = GetShiftOffset(v, proctex.u_shift, proctex.u_clamp);
+    const float v_shift = GetShiftOffset(u, proctex.v_shift, proctex.v_clamp);
 
     // Generate noise
-    if (regs.proctex.noise_enable) {
-        float noise = NoiseCoef(u, v, regs, state);
-        u += noise * regs.proctex_noise_u.amplitude / 4095.0f;
-        v += noise * regs.proctex_noise_v.amplitude / 4095.0f;
+    if (proctex.noise_enable) {
+        float noise = NoiseCoef(u, v, proctex);
+        u += noise * proctex.amplitude_u / 4095.0f;
+        v += noise * proctex.amplitude_v / 4095.0f;
         u = std::abs(u);
         v = std::abs(v);
     }
@@ -177,42 +286,42 @@ Math::Vec4<u8> ProcTex(float u, float v, TexturingRegs regs, State::ProcTex stat
     v += v_shift;
 
     // Clamp
-    ClampCoord(u, regs.proctex.u_clamp);
-    ClampCoord(v, regs.proctex.v_clamp);
+    ClampCoord(u, proctex.u_clamp);
+    ClampCoord(v, proctex.v_clamp);
 
     // Combine and map
-    const float lut_coord = CombineAndMap(u, v, regs.proctex.color_combiner, state.color_map_table);
+    const float lut_coord = CombineAndMap(u, v, proctex.color_combiner, proctex.color_map_table);
 
     // Look up the color
     // For the color lut, coord=0.0 is lut[offset] and coord=1.0 is lut[offset+width-1]
-    const u32 offset = regs.proctex_lut_offset;
-    const u32 width = regs.proctex_lut.width;
+    const u32 offset = proctex.lut_offset;
+    const u32 width = proctex.lut_width;
     const float index = offset + (lut_coord * (width - 1));
     Math::Vec4<u8> final_color;
     // TODO(wwylele): implement mipmap
-    switch (regs.proctex_lut.filter) {
+    switch (proctex.lut_filter) {
     case ProcTexFilter::Linear:
     case ProcTexFilter::LinearMipmapLinear:
     case ProcTexFilter::LinearMipmapNearest: {
         const int index_int = static_cast<int>(index);
         const float frac = index - index_int;
-        const auto color_value = state.color_table[index_int].ToVector().Cast<float>();
-        const auto color_diff = state.color_diff_table[index_int].ToVector().Cast<float>();
+        const auto& color_value = proctex.color_table[index_int];
+        const auto& color_diff = proctex.color_diff_table[index_int];
         final_color = (color_value + frac * color_diff).Cast<u8>();
         break;
     }
     case ProcTexFilter::Nearest:
     case ProcTexFilter::NearestMipmapLinear:
     case ProcTexFilter::NearestMipmapNearest:
-        final_color = state.color_table[static_cast<int>(std::round(index))].ToVector();
+        final_color = proctex.color_table[static_cast<int>(std::round(index))].Cast<u8>();
         break;
     }
 
-    if (regs.proctex.separate_alpha) {
+    if (proctex.separate_alpha) {
         // Note: in separate alpha mode, the alpha channel skips the color LUT look up stage. It
         // uses the output of CombineAndMap directly instead.
         const float final_alpha =
-            CombineAndMap(u, v, regs.proctex.alpha_combiner, state.alpha_map_table);
+            CombineAndMap(u, v, proctex.alpha_combiner, proctex.alpha_map_table);
         return Math::MakeVec<u8>(final_color.rgb(), static_cast<u8>(final_alpha * 255));
     } else {
         return final_color;
@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#pragma once
+
 #include "common/common_types.h"
 #include "common/vector_math.h"
 #include "video_core/pica_state.h"
@@ -9,8 +11,16 @@
 namespace Pica {
 namespace Rasterizer {
 
+struct DecodedProcTex;
+
+/**
+ * Decodes the ProcTex registers and lookup tables to the values used to generate the texture. The
+ * result is cached, and only decoded again when the registers or the lookup tables change.
+ */
+const DecodedProcTex& DecodeProcTex(const TexturingRegs& regs, const State::ProcTex& state);
+
 /// Generates procedural texture color for the given coordinates
-Math::Vec4<u8> ProcTex(float u, float v, TexturingRegs regs, State::ProcTex state);
+Math::Vec4<u8> ProcTex(float u, float v, const DecodedProcTex& proctex);
 
 } // namespace Rasterizer
 } // namespace Pica
@@ -23,6 +23,7 @@
 #include "video_core/regs_rasterizer.h"
 #include "video_core/regs_texturing.h"
 #include "video_core/shader/shader.h"
+#include "video_core/swrasterizer/coverage.h"
 #include "video_core/swrasterizer/framebuffer.h"
 #include "video_core/swrasterizer/proctex.h"
 #include "video_core/swrasterizer/rasterizer.h"
@@ -33,28 +34,29 @@
 namespace Pica {
 namespace Rasterizer {
 
-// NOTE: Assuming that rasterizer coordinates are 12.4 fixed-point values
+// NOTE: Assuming that rasterizer coordinates are 12.4 fixed-point values. They are signed, as
+//       triangles may extend past the left and top viewport edges within the guard band.
 struct Fix12P4 {
     Fix12P4() {}
-    Fix12P4(u16 val) : val(val) {}
+    Fix12P4(s16 val) : val(val) {}
 
-    static u16 FracMask() {
+    static s16 FracMask() {
         return 0xF;
     }
-    static u16 IntMask() {
-        return (u16)~0xF;
+    static s16 IntMask() {
+        return (s16)~0xF;
     }
 
-    operator u16() const {
+    operator s16() const {
         return val;
     }
 
     bool operator<(const Fix12P4& oth) const {
-        return (u16) * this < (u16)oth;
+        return (s16) * this < (s16)oth;
     }
 
 private:
-    u16 val;
+    s16 val;
 };
 
 /**
@@ -67,7 +69,7 @@ static int SignedArea(const Math::Vec2<Fix12P4>& vtx1, const Math::Vec2<Fix12P4>
                       const Math::Vec2<Fix12P4>& vtx3) {
     const auto vec1 = Math::MakeVec(vtx2 - vtx1, 0);
     const auto vec2 = Math::MakeVec(vtx3 - vtx1, 0);
-    // TODO: There is a very small chance this will overflow for sizeof(int) == 4
+    // The guard band keeps the coordinates within 2048 pixels of each other, for which this fits
     return Math::Cross(vec1, vec2).z;
 };
 
@@ -129,7 +131,7 @@ static void ProcessTriangleInternal(const Vertex& v0, const Vertex& v1, const Ve
     static auto FloatToFix = [](float24 flt) {
         // TODO: Rounding here is necessary to prevent garbage pixels at
         //       triangle borders. Is it that the correct solution, though?
-        return Fix12P4(static_cast<unsigned short>(round(flt.ToFloat32() * 16.0f)));
+        return Fix12P4(static_cast<s16>(round(flt.ToFloat32() * 16.0f)));
     };
     static auto ScreenToRasterizerCoordinates = [](const Math::Vec3<float24>& vec) {
         return Math::Vec3<Fix12P4>{FloatToFix(vec.x), FloatToFix(vec.y), FloatToFix(vec.z)};
@@ -157,17 +159,30 @@ static void ProcessTriangleInternal(const Vertex& v0, const Vertex& v1, const Ve
             return;
     }
 
-    u16 min_x = std::min({vtxpos[0].x, vtxpos[1].x, vtxpos[2].x});
-    u16 min_y = std::min({vtxpos[0].y, vtxpos[1].y, vtxpos[2].y});
-    u16 max_x = std::max({vtxpos[0].x, vtxpos[1].x, vtxpos[2].x});
-    u16 max_y = std::max({vtxpos[0].y, vtxpos[1].y, vtxpos[2].y});
+    int min_x = std::min({vtxpos[0].x, vtxpos[1].x, vtxpos[2].x});
+    int min_y = std::min({vtxpos[0].y, vtxpos[1].y, vtxpos[2].y});
+    int max_x = std::max({vtxpos[0].x, vtxpos[1].x, vtxpos[2].x});
+    int max_y = std::max({vtxpos[0].y, vtxpos[1].y, vtxpos[2].y});
+
+    // The clipper only clips triangles against the guard band, discard the pixels outside of the
+    // viewport here. The viewport may be flipped by negative sizes.
+    const float viewport_x1 = static_cast<float>(regs.rasterizer.viewport_corner.x);
+    const float viewport_y1 = static_cast<float>(regs.rasterizer.viewport_corner.y);
+    const float viewport_x2 =
+        viewport_x1 + 2.f * float24::FromRaw(regs.rasterizer.viewport_size_x).ToFloat32();
+    const float viewport_y2 =
+        viewport_y1 + 2.f * float24::FromRaw(regs.rasterizer.viewport_size_y).ToFloat32();
+    min_x = std::max({min_x, 0, static_cast<int>(std::min(viewport_x1, viewport_x2) * 16.f)});
+    min_y = std::max({min_y, 0, static_cast<int>(std::min(viewport_y1, viewport_y2) * 16.f)});
+    max_x = std::min(max_x, static_cast<int>(std::max(viewport_x1, viewport_x2) * 16.f));
+    max_y = std::min(max_y, static_cast<int>(std::max(viewport_y1, viewport_y2) * 16.f));
 
     // Convert the scissor box coordinates to 12.4 fixed point
-    u16 scissor_x1 = (u16)(regs.rasterizer.scissor_test.x1 << 4);
-    u16 scissor_y1 = (u16)(regs.rasterizer.scissor_test.y1 << 4);
+    int scissor_x1 = static_cast<int>(regs.rasterizer.scissor_test.x1 << 4);
+    int scissor_y1 = static_cast<int>(regs.rasterizer.scissor_test.y1 << 4);
     // x2,y2 have +1 added to cover the entire sub-pixel area
-    u16 scissor_x2 = (u16)((regs.rasterizer.scissor_test.x2 + 1) << 4);
-    u16 scissor_y2 = (u16)((regs.rasterizer.scissor_test.y2 + 1) << 4);
+    int scissor_x2 = static_cast<int>((regs.rasterizer.scissor_test.x2 + 1) << 4);
+    int scissor_y2 = static_cast<int>((regs.rasterizer.scissor_test.y2 + 1) << 4);
 
     if (regs.rasterizer.scissor_test.mode == RasterizerRegs::ScissorMode::Include) {
         // Calculate the new bounds
@@ -182,645 +197,656 @@ static void ProcessTriangleInternal(const Vertex& v0, const Vertex& v1, const Ve
     max_x = ((max_x + Fix12P4::FracMask()) & Fix12P4::IntMask());
     max_y = ((max_y + Fix12P4::FracMask()) & Fix12P4::IntMask());
 
-    // Triangle filling rules: Pixels on the right-sided edge or on flat bottom edges are not
-    // drawn. Pixels on any other triangle border are drawn. This is implemented with three bias
-    // values which are added to the barycentric coordinates w0, w1 and w2, respectively.
-    // NOTE: These are the PSP filling rules. Not sure if the 3DS uses the same ones...
-    auto IsRightSideOrFlatBottomEdge = [](const Math::Vec2<Fix12P4>& vtx,
-                                          const Math::Vec2<Fix12P4>& line1,
-                                          const Math::Vec2<Fix12P4>& line2) {
-        if (line1.y == line2.y) {
-            // just check if vertex is above us => bottom line parallel to x-axis
-            return vtx.y < line1.y;
-        } else {
-            // check if vertex is on our left => right side
-            // TODO: Not sure how likely this is to overflow
-            return (int)vtx.x < (int)line1.x +
-                                    ((int)line2.x - (int)line1.x) * ((int)vtx.y - (int)line1.y) /
-                                        ((int)line2.y - (int)line1.y);
-        }
-    };
-    int bias0 =
-        IsRightSideOrFlatBottomEdge(vtxpos[0].xy(), vtxpos[1].xy(), vtxpos[2].xy()) ? -1 : 0;
-    int bias1 =
-        IsRightSideOrFlatBottomEdge(vtxpos[1].xy(), vtxpos[2].xy(), vtxpos[0].xy()) ? -1 : 0;
-    int bias2 =
-        IsRightSideOrFlatBottomEdge(vtxpos[2].xy(), vtxpos[0].xy(), vtxpos[1].xy()) ? -1 : 0;
+    const TriangleEdges edges(vtxpos[0].xy().Cast<int>(), vtxpos[1].xy().Cast<int>(),
+                              vtxpos[2].xy().Cast<int>());
 
     auto w_inverse = Math::MakeVec(v0.pos.w, v1.pos.w, v2.pos.w);
 
     auto textures = regs.texturing.GetTextures();
     auto tev_stages = regs.texturing.GetTevStages();
 
+    const DecodedProcTex* proctex = nullptr;
+    if (regs.texturing.main_config.texture3_enable)
+        proctex = &DecodeProcTex(regs.texturing, g_state.proctex);
+
     bool stencil_action_enable =
         g_state.regs.framebuffer.output_merger.stencil_test.enable &&
         g_state.regs.framebuffer.framebuffer.depth_format == FramebufferRegs::DepthFormat::D24S8;
     const auto stencil_test = g_state.regs.framebuffer.output_merger.stencil_test;
-
-    // Enter rasterization loop, starting at the center of the topleft bounding box corner.
-    // TODO: Not sure if looping through x first might be faster
-    for (u16 y = min_y + 8; y < max_y; y += 0x10) {
-        for (u16 x = min_x + 8; x < max_x; x += 0x10) {
-
-            // Do not process the pixel if it's inside the scissor box and the scissor mode is set
-            // to Exclude
-            if (regs.rasterizer.scissor_test.mode == RasterizerRegs::ScissorMode::Exclude) {
-                if (x >= scissor_x1 && x < scissor_x2 && y >= scissor_y1 && y < scissor_y2)
-                    continue;
+    const auto& output_merger = regs.framebuffer.output_merger;
+    const bool allow_depth_stencil_write =
+        regs.framebuffer.framebuffer.allow_depth_stencil_write != 0;
+
+    const unsigned num_bits =
+        FramebufferRegs::DepthBitsPerPixel(regs.framebuffer.framebuffer.depth_format);
+    const float depth_scale = float24::FromRaw(regs.rasterizer.viewport_depth_range).ToFloat32();
+    const float depth_offset =
+        float24::FromRaw(regs.rasterizer.viewport_depth_near_plane).ToFloat32();
+
+    // Runs the stencil and depth tests for the fragment at the given position, and updates the
+    // stencil and depth buffers accordingly. Returns whether the fragment passed both tests.
+    auto DepthStencilTest = [&](s16 x, s16 y, u32 z) {
+        u8 old_stencil = 0;
+
+        auto UpdateStencil = [&](FramebufferRegs::StencilAction action) {
+            u8 new_stencil =
+                PerformStencilAction(action, old_stencil, stencil_test.reference_value);
+            if (allow_depth_stencil_write)
+                SetStencil(x >> 4, y >> 4, (new_stencil & stencil_test.write_mask) |
+                                               (old_stencil & ~stencil_test.write_mask));
+        };
+
+        if (stencil_action_enable) {
+            old_stencil = GetStencil(x >> 4, y >> 4);
+            u8 dest = old_stencil & stencil_test.input_mask;
+            u8 ref = stencil_test.reference_value & stencil_test.input_mask;
+
+            if (!EvaluateCompareFunc(stencil_test.func, ref, dest)) {
+                UpdateStencil(stencil_test.action_stencil_fail);
+                return false;
             }
+        }
 
-            // Calculate the barycentric coordinates w0, w1 and w2
-            int w0 = bias0 + SignedArea(vtxpos[1].xy(), vtxpos[2].xy(), {x, y});
-            int w1 = bias1 + SignedArea(vtxpos[2].xy(), vtxpos[0].xy(), {x, y});
-            int w2 = bias2 + SignedArea(vtxpos[0].xy(), vtxpos[1].xy(), {x, y});
-            int wsum = w0 + w1 + w2;
-
-            // If current pixel is not covered by the current primitive
-            if (w0 < 0 || w1 < 0 || w2 < 0)
-                continue;
+        if (output_merger.depth_test_enable) {
+            u32 ref_z = GetDepth(x >> 4, y >> 4);
 
-            auto baricentric_coordinates =
-                Math::MakeVec(float24::FromFloat32(static_cast<float>(w0)),
-                              float24::FromFloat32(static_cast<float>(w1)),
-                              float24::FromFloat32(static_cast<float>(w2)));
-            float24 interpolated_w_inverse =
-                float24::FromFloat32(1.0f) / Math::Dot(w_inverse, baricentric_coordinates);
-
-            // interpolated_z = z / w
-            float interpolated_z_over_w =
-                (v0.screenpos[2].ToFloat32() * w0 + v1.screenpos[2].ToFloat32() * w1 +
-                 v2.screenpos[2].ToFloat32() * w2) /
-                wsum;
-
-            // Not fully accurate. About 3 bits in precision are missing.
-            // Z-Buffer (z / w * scale + offset)
-            float depth_scale = float24::FromRaw(regs.rasterizer.viewport_depth_range).ToFloat32();
-            float depth_offset =
-                float24::FromRaw(regs.rasterizer.viewport_depth_near_plane).ToFloat32();
-            float depth = interpolated_z_over_w * depth_scale + depth_offset;
-
-            // Potentially switch to W-Buffer
-            if (regs.rasterizer.depthmap_enable ==
-                Pica::RasterizerRegs::DepthBuffering::WBuffering) {
-                // W-Buffer (z * scale + w * offset = (z / w * scale + offset) * w)
-                depth *= interpolated_w_inverse.ToFloat32() * wsum;
+            if (!EvaluateCompareFunc(output_merger.depth_test_func, z, ref_z)) {
+                if (stencil_action_enable)
+                    UpdateStencil(stencil_test.action_depth_fail);
+                return false;
             }
+        }
 
-            // Clamp the result
-            depth = MathUtil::Clamp(depth, 0.0f, 1.0f);
-
-            // Perspective correct attribute interpolation:
-            // Attribute values cannot be calculated by simple linear interpolation since
-            // they are not linear in screen space. For example, when interpolating a
-            // texture coordinate across two vertices, something simple like
-            //     u = (u0*w0 + u1*w1)/(w0+w1)
-            // will not work. However, the attribute value divided by the
-            // clipspace w-coordinate (u/w) and and the inverse w-coordinate (1/w) are linear
-            // in screenspace. Hence, we can linearly interpolate these two independently and
-            // calculate the interpolated attribute by dividing the results.
-            // I.e.
-            //     u_over_w   = ((u0/v0.pos.w)*w0 + (u1/v1.pos.w)*w1)/(w0+w1)
-            //     one_over_w = (( 1/v0.pos.w)*w0 + ( 1/v1.pos.w)*w1)/(w0+w1)
-            //     u = u_over_w / one_over_w
-            //
-            // The generalization to three vertices is straightforward in baricentric coordinates.
-            auto GetInterpolatedAttribute = [&](float24 attr0, float24 attr1, float24 attr2) {
-                auto attr_over_w = Math::MakeVec(attr0, attr1, attr2);
-                float24 interpolated_attr_over_w = Math::Dot(attr_over_w, baricentric_coordinates);
-                return interpolated_attr_over_w * interpolated_w_inverse;
-            };
-
-            Math::Vec4<u8> primary_color{
-                (u8)(
-                    GetInterpolatedAttribute(v0.color.r(), v1.color.r(), v2.color.r()).ToFloat32() *
-                    255),
-                (u8)(
-                    GetInterpolatedAttribute(v0.color.g(), v1.color.g(), v2.color.g()).ToFloat32() *
-                    255),
-                (u8)(
-                    GetInterpolatedAttribute(v0.color.b(), v1.color.b(), v2.color.b()).ToFloat32() *
-                    255),
-                (u8)(
-                    GetInterpolatedAttribute(v0.color.a(), v1.color.a(), v2.color.a()).ToFloat32() *
-                    255),
-            };
-
-            Math::Vec2<float24> uv[3];
-            uv[0].u() = GetInterpolatedAttribute(v0.tc0.u(), v1.tc0.u(), v2.tc0.u());
-            uv[0].v() = GetInterpolatedAttribute(v0.tc0.v(), v1.tc0.v(), v2.tc0.v());
-            uv[1].u() = GetInterpolatedAttribute(v0.tc1.u(), v1.tc1.u(), v2.tc1.u());
-            uv[1].v() = GetInterpolatedAttribute(v0.tc1.v(), v1.tc1.v(), v2.tc1.v());
-            uv[2].u() = GetInterpolatedAttribute(v0.tc2.u(), v1.tc2.u(), v2.tc2.u());
-            uv[2].v() = GetInterpolatedAttribute(v0.tc2.v(), v1.tc2.v(), v2.tc2.v());
-
-            Math::Vec4<u8> texture_color[4]{};
-            for (int i = 0; i < 3; ++i) {
-                const auto& texture = textures[i];
-                if (!texture.enabled)
-                    continue;
-
-                DEBUG_ASSERT(0 != texture.config.address);
-
-                int coordinate_i =
-                    (i == 2 && regs.texturing.main_config.texture2_use_coord1) ? 1 : i;
-                float24 u = uv[coordinate_i].u();
-                float24 v = uv[coordinate_i].v();
-
-                // Only unit 0 respects the texturing type (according to 3DBrew)
-                // TODO: Refactor so cubemaps and shadowmaps can be handled
-                PAddr texture_address = texture.config.GetPhysicalAddress();
-                if (i == 0) {
-                    switch (texture.config.type) {
-                    case TexturingRegs::TextureConfig::Texture2D:
-                        break;
-                    case TexturingRegs::TextureConfig::TextureCube: {
-                        auto w = GetInterpolatedAttribute(v0.tc0_w, v1.tc0_w, v2.tc0_w);
-                        std::tie(u, v, texture_address) = ConvertCubeCoord(u, v, w, regs.texturing);
-                        break;
-                    }
-                    case TexturingRegs::TextureConfig::Projection2D: {
-                        auto tc0_w = GetInterpolatedAttribute(v0.tc0_w, v1.tc0_w, v2.tc0_w);
-                        u /= tc0_w;
-                        v /= tc0_w;
-                        break;
-                    }
-                    default:
-                        // TODO: Change to LOG_ERROR when more types are handled.
-                        LOG_DEBUG(HW_GPU, "Unhandled texture type %x", (int)texture.config.type);
-                        UNIMPLEMENTED();
-                        break;
-                    }
-                }
-
-                int s = (int)(u * float24::FromFloat32(static_cast<float>(texture.config.width)))
-                            .ToFloat32();
-                int t = (int)(v * float24::FromFloat32(static_cast<float>(texture.config.height)))
-                            .ToFloat32();
-
-                bool use_border_s = false;
-                bool use_border_t = false;
-
-                if (texture.config.wrap_s == TexturingRegs::TextureConfig::ClampToBorder) {
-                    use_border_s = s < 0 || s >= static_cast<int>(texture.config.width);
-                } else if (texture.config.wrap_s == TexturingRegs::TextureConfig::ClampToBorder2) {
-                    use_border_s = s >= static_cast<int>(texture.config.width);
-                }
-
-                if (texture.config.wrap_t == TexturingRegs::TextureConfig::ClampToBorder) {
-                    use_border_t = t < 0 || t >= static_cast<int>(texture.config.height);
-                } else if (texture.config.wrap_t == TexturingRegs::TextureConfig::ClampToBorder2) {
-                    use_border_t = t >= static_cast<int>(texture.config.height);
-                }
-
-                if (use_border_s || use_border_t) {
-                    auto border_color = texture.config.border_color;
-                    texture_color[i] = {border_color.r, border_color.g, border_color.b,
-                                        border_color.a};
-                } else {
-                    // Textures are laid out from bottom to top, hence we invert the t coordinate.
-                    // NOTE: This may not be the right place for the inversion.
-                    // TODO: Check if this applies to ETC textures, too.
-                    s = GetWrappedTexCoord(texture.config.wrap_s, s, texture.config.width);
-                    t = texture.config.height - 1 -
-                        GetWrappedTexCoord(texture.config.wrap_t, t, texture.config.height);
-
-                    const u8* texture_data = Memory::GetPhysicalPointer(texture_address);
-                    auto info =
-                        Texture::TextureInfo::FromPicaRegister(texture.config, texture.format);
-
-                    // TODO: Apply the min and mag filters to the texture
-                    texture_color[i] = Texture::LookupTexture(texture_data, s, t, info);
-#if PICA_DUMP_TEXTURES
-                    DebugUtils::DumpTexture(texture.config, texture_data);
-#endif
-                }
-            }
+        if (allow_depth_stencil_write && output_merger.depth_write_enable)
+            SetDepth(x >> 4, y >> 4, z);
 
-            // sample procedural texture
-            if (regs.texturing.main_config.texture3_enable) {
-                const auto& proctex_uv = uv[regs.texturing.main_config.texture3_coordinates];
-                texture_color[3] = ProcTex(proctex_uv.u().ToFloat32(), proctex_uv.v().ToFloat32(),
-                                           g_state.regs.texturing, g_state.proctex);
-            }
+        // The stencil depth_pass action is executed even if depth testing is disabled
+        if (stencil_action_enable)
+            UpdateStencil(stencil_test.action_depth_pass);
 
-            // Texture environment - consists of 6 stages of color and alpha combining.
-            //
-            // Color combiners take three input color values from some source (e.g. interpolated
-            // vertex color, texture color, previous stage, etc), perform some very simple
-            // operations on each of them (e.g. inversion) and then calculate the output color
-            // with some basic arithmetic. Alpha combiners can be configured separately but work
-            // analogously.
-            Math::Vec4<u8> combiner_output;
-            Math::Vec4<u8> combiner_buffer = {0, 0, 0, 0};
-            Math::Vec4<u8> next_combiner_buffer = {
-                regs.texturing.tev_combiner_buffer_color.r,
-                regs.texturing.tev_combiner_buffer_color.g,
-                regs.texturing.tev_combiner_buffer_color.b,
-                regs.texturing.tev_combiner_buffer_color.a,
-            };
+        return true;
+    };
 
-            for (unsigned tev_stage_index = 0; tev_stage_index < tev_stages.size();
-                 ++tev_stage_index) {
-                const auto& tev_stage = tev_stages[tev_stage_index];
-                using Source = TexturingRegs::TevStageConfig::Source;
+    // Same as DepthStencilTest, without updating the stencil and depth buffers
+    auto PassesDepthStencilTest = [&](s16 x, s16 y, u32 z) {
+        if (stencil_action_enable) {
+            u8 dest = GetStencil(x >> 4, y >> 4) & stencil_test.input_mask;
+            u8 ref = stencil_test.reference_value & stencil_test.input_mask;
+            if (!EvaluateCompareFunc(stencil_test.func, ref, dest))
+                return false;
+        }
 
-                auto GetSource = [&](Source source) -> Math::Vec4<u8> {
-                    switch (source) {
-                    case Source::PrimaryColor:
+        return !output_merger.depth_test_enable ||
+               EvaluateCompareFunc(output_merger.depth_test_func, z, GetDepth(x >> 4, y >> 4));
+    };
 
-                    // HACK: Until we implement fragment lighting, use primary_color
-                    case Source::PrimaryFragmentColor:
-                        return primary_color;
+    // Fragments failing the stencil or depth test can be discarded before being shaded, unless
+    // the failure updates the stencil buffer.
+    const bool discard_has_no_side_effect =
+        !stencil_action_enable || !allow_depth_stencil_write || stencil_test.write_mask == 0 ||
+        (stencil_test.action_stencil_fail == FramebufferRegs::StencilAction::Keep &&
+         stencil_test.action_depth_fail == FramebufferRegs::StencilAction::Keep);
+
+    // Without alpha test, no fragment is discarded between shading and the stencil and depth
+    // tests, so those can be run, buffer updates included, before shading the fragment.
+    const bool early_depth_stencil =
+        !output_merger.alpha_test.enable ||
+        output_merger.alpha_test.func == FramebufferRegs::CompareFunc::Always;
+
+    // Hierarchical depth rejection: whole tiles of the depth buffer are skipped when the depth
+    // test fails for every depth the triangle can take within them, according to the coarse depth
+    // buffer. The depth being an affine function of the screen position with Z-buffering, its
+    // range over a tile is given by its values at the tile corners. Those are computed in double
+    // precision, and widened by a margin covering the rounding errors of the per-pixel depth.
+    const float vertex_z[3] = {v0.screenpos[2].ToFloat32(), v1.screenpos[2].ToFloat32(),
+                               v2.screenpos[2].ToFloat32()};
+    const float min_vertex_z = std::min({vertex_z[0], vertex_z[1], vertex_z[2]});
+    const float max_vertex_z = std::max({vertex_z[0], vertex_z[1], vertex_z[2]});
+    // The sum of the barycentric coordinates is the same for all pixels
+    const Math::Vec3<int> vertex0_w = edges.Evaluate(vtxpos[0].x, vtxpos[0].y);
+    const int biased_area = vertex0_w[0] + vertex0_w[1] + vertex0_w[2];
+    const bool hierarchical_depth =
+        output_merger.depth_test_enable && discard_has_no_side_effect && biased_area > 0 &&
+        regs.rasterizer.depthmap_enable != RasterizerRegs::DepthBuffering::WBuffering;
+    const float depth_margin =
+        1e-5f * (1.0f + std::abs(depth_scale) *
+                            std::max(std::abs(min_vertex_z), std::abs(max_vertex_z)));
+
+    auto InterpolateZOverW = [&](int x, int y) {
+        const Math::Vec3<int> w = edges.Evaluate(x, y);
+        return (vertex_z[0] * static_cast<double>(w[0]) + vertex_z[1] * static_cast<double>(w[1]) +
+                vertex_z[2] * static_cast<double>(w[2])) /
+               biased_area;
+    };
 
-                    // HACK: Until we implement fragment lighting, use zero
-                    case Source::SecondaryFragmentColor:
-                        return {0, 0, 0, 0};
+    auto IsTileRejected = [&](int tile_x, int tile_y) {
+        constexpr int tile_size = DEPTH_TILE_SIZE << 4;
+        const int x1 = std::max(tile_x * tile_size, min_x) + 8;
+        const int x2 = std::min((tile_x + 1) * tile_size, max_x) - 8;
+        const int y1 = std::max(tile_y * tile_size, min_y) + 8;
+        const int y2 = std::min((tile_y + 1) * tile_size, max_y) - 8;
+        const double corners[4] = {InterpolateZOverW(x1, y1), InterpolateZOverW(x2, y1),
+                                   InterpolateZOverW(x1, y2), InterpolateZOverW(x2, y2)};
+        const double min_z_over_w =
+            std::max<double>(min_vertex_z, *std::min_element(corners, corners + 4));
+        const double max_z_over_w =
+            std::min<double>(max_vertex_z, *std::max_element(corners, corners + 4));
+
+        const float depth1 = static_cast<float>(min_z_over_w * depth_scale + depth_offset);
+        const float depth2 = static_cast<float>(max_z_over_w * depth_scale + depth_offset);
+        const float min_depth = MathUtil::Clamp(std::min(depth1, depth2) - depth_margin, 0.f, 1.f);
+        const float max_depth = MathUtil::Clamp(std::max(depth1, depth2) + depth_margin, 0.f, 1.f);
+        if (!(min_depth <= max_depth))
+            return false;
+
+        const u32 min_z = (u32)(min_depth * ((1 << num_bits) - 1));
+        const u32 max_z = (u32)(max_depth * ((1 << num_bits) - 1));
+        return DepthTestFailsForRange(output_merger.depth_test_func, min_z, max_z,
+                                      GetDepthTileBounds(tile_x, tile_y));
+    };
 
-                    case Source::Texture0:
-                        return texture_color[0];
+    // Shades the pixel centered at the given position, with the given barycentric coordinates
+    auto ProcessPixel = [&](s16 x, s16 y, int w0, int w1, int w2) {
+        // Do not process the pixel if it's inside the scissor box and the scissor mode is set to
+        // Exclude
+        if (regs.rasterizer.scissor_test.mode == RasterizerRegs::ScissorMode::Exclude) {
+            if (x >= scissor_x1 && x < scissor_x2 && y >= scissor_y1 && y < scissor_y2)
+                return;
+        }
 
-                    case Source::Texture1:
-                        return texture_color[1];
+        int wsum = w0 + w1 + w2;
+
+        auto baricentric_coordinates =
+            Math::MakeVec(float24::FromFloat32(static_cast<float>(w0)),
+                          float24::FromFloat32(static_cast<float>(w1)),
+                          float24::FromFloat32(static_cast<float>(w2)));
+        float24 interpolated_w_inverse =
+            float24::FromFloat32(1.0f) / Math::Dot(w_inverse, baricentric_coordinates);
+
+        // interpolated_z = z / w
+        float interpolated_z_over_w =
+            (v0.screenpos[2].ToFloat32() * w0 + v1.screenpos[2].ToFloat32() * w1 +
+             v2.screenpos[2].ToFloat32() * w2) /
+            wsum;
+
+        // Not fully accurate. About 3 bits in precision are missing.
+        // Z-Buffer (z / w * scale + offset)
+        float depth = interpolated_z_over_w * depth_scale + depth_offset;
+
+        // Potentially switch to W-Buffer
+        if (regs.rasterizer.depthmap_enable ==
+            Pica::RasterizerRegs::DepthBuffering::WBuffering) {
+            // W-Buffer (z * scale + w * offset = (z / w * scale + offset) * w)
+            depth *= interpolated_w_inverse.ToFloat32() * wsum;
+        }
 
-                    case Source::Texture2:
-                        return texture_color[2];
+        // Clamp the result
+        depth = MathUtil::Clamp(depth, 0.0f, 1.0f);
 
-                    case Source::Texture3:
-                        return texture_color[3];
+        // Convert float to integer
+        u32 z = (u32)(depth * ((1 << num_bits) - 1));
 
-                    case Source::PreviousBuffer:
-                        return combiner_buffer;
+        if (early_depth_stencil) {
+            if (!DepthStencilTest(x, y, z))
+                return;
+        } else if (discard_has_no_side_effect && !PassesDepthStencilTest(x, y, z)) {
+            return;
+        }
 
-                    case Source::Constant:
-                        return {tev_stage.const_r, tev_stage.const_g, tev_stage.const_b,
-                                tev_stage.const_a};
+        // Perspective correct attribute interpolation:
+        // Attribute values cannot be calculated by simple linear interpolation since
+        // they are not linear in screen space. For example, when interpolating a
+        // texture coordinate across two vertices, something simple like
+        //     u = (u0*w0 + u1*w1)/(w0+w1)
+        // will not work. However, the attribute value divided by the
+        // clipspace w-coordinate (u/w) and and the inverse w-coordinate (1/w) are linear
+        // in screenspace. Hence, we can linearly interpolate these two independently and
+        // calculate the interpolated attribute by dividing the results.
+        // I.e.
+        //     u_over_w   = ((u0/v0.pos.w)*w0 + (u1/v1.pos.w)*w1)/(w0+w1)
+        //     one_over_w = (( 1/v0.pos.w)*w0 + ( 1/v1.pos.w)*w1)/(w0+w1)
+        //     u = u_over_w / one_over_w
+        //
+        // The generalization to three vertices is straightforward in baricentric coordinates.
+        auto GetInterpolatedAttribute = [&](float24 attr0, float24 attr1, float24 attr2) {
+            auto attr_over_w = Math::MakeVec(attr0, attr1, attr2);
+            float24 interpolated_attr_over_w = Math::Dot(attr_over_w, baricentric_coordinates);
+            return interpolated_attr_over_w * interpolated_w_inverse;
+        };
+
+        Math::Vec4<u8> primary_color{
+            (u8)(
+                GetInterpolatedAttribute(v0.color.r(), v1.color.r(), v2.color.r()).ToFloat32() *
+                255),
+            (u8)(
+                GetInterpolatedAttribute(v0.color.g(), v1.color.g(), v2.color.g()).ToFloat32() *
+                255),
+            (u8)(
+                GetInterpolatedAttribute(v0.color.b(), v1.color.b(), v2.color.b()).ToFloat32() *
+                255),
+            (u8)(
+                GetInterpolatedAttribute(v0.color.a(), v1.color.a(), v2.color.a()).ToFloat32() *
+                255),
+        };
+
+        Math::Vec2<float24> uv[3];
+        uv[0].u() = GetInterpolatedAttribute(v0.tc0.u(), v1.tc0.u(), v2.tc0.u());
+        uv[0].v() = GetInterpolatedAttribute(v0.tc0.v(), v1.tc0.v(), v2.tc0.v());
+        uv[1].u() = GetInterpolatedAttribute(v0.tc1.u(), v1.tc1.u(), v2.tc1.u());
+        uv[1].v() = GetInterpolatedAttribute(v0.tc1.v(), v1.tc1.v(), v2.tc1.v());
+        uv[2].u() = GetInterpolatedAttribute(v0.tc2.u(), v1.tc2.u(), v2.tc2.u());
+        uv[2].v() = GetInterpolatedAttribute(v0.tc2.v(), v1.tc2.v(), v2.tc2.v());
+
+        Math::Vec4<u8> texture_color[4]{};
+        for (int i = 0; i < 3; ++i) {
+            const auto& texture = textures[i];
+            if (!texture.enabled)
+                continue;
 
-                    case Source::Previous:
-                        return combiner_output;
+            DEBUG_ASSERT(0 != texture.config.address);
 
-                    default:
-                        LOG_ERROR(HW_GPU, "Unknown color combiner source %d", (int)source);
-                        UNIMPLEMENTED();
-                        return {0, 0, 0, 0};
-                    }
-                };
+            int coordinate_i =
+                (i == 2 && regs.texturing.main_config.texture2_use_coord1) ? 1 : i;
+            float24 u = uv[coordinate_i].u();
+            float24 v = uv[coordinate_i].v();
 
-                // color combiner
-                // NOTE: Not sure if the alpha combiner might use the color output of the previous
-                //       stage as input. Hence, we currently don't directly write the result to
-                //       combiner_output.rgb(), but instead store it in a temporary variable until
-                //       alpha combining has been done.
-                Math::Vec3<u8> color_result[3] = {
-                    GetColorModifier(tev_stage.color_modifier1, GetSource(tev_stage.color_source1)),
-                    GetColorModifier(tev_stage.color_modifier2, GetSource(tev_stage.color_source2)),
-                    GetColorModifier(tev_stage.color_modifier3, GetSource(tev_stage.color_source3)),
-                };
-                auto color_output = ColorCombine(tev_stage.color_op, color_result);
-
-                u8 alpha_output;
-                if (tev_stage.color_op == TexturingRegs::TevStageConfig::Operation::Dot3_RGBA) {
-                    // result of Dot3_RGBA operation is also placed to the alpha component
-                    alpha_output = color_output.x;
-                } else {
-                    // alpha combiner
-                    std::array<u8, 3> alpha_result = {{
-                        GetAlphaModifier(tev_stage.alpha_modifier1,
-                                         GetSource(tev_stage.alpha_source1)),
-                        GetAlphaModifier(tev_stage.alpha_modifier2,
-                                         GetSource(tev_stage.alpha_source2)),
-                        GetAlphaModifier(tev_stage.alpha_modifier3,
-                                         GetSource(tev_stage.alpha_source3)),
-                    }};
-                    alpha_output = AlphaCombine(tev_stage.alpha_op, alpha_result);
+            // Only unit 0 respects the texturing type (according to 3DBrew)
+            // TODO: Refactor so cubemaps and shadowmaps can be handled
+            PAddr texture_address = texture.config.GetPhysicalAddress();
+            if (i == 0) {
+                switch (texture.config.type) {
+                case TexturingRegs::TextureConfig::Texture2D:
+                    break;
+                case TexturingRegs::TextureConfig::TextureCube: {
+                    auto w = GetInterpolatedAttribute(v0.tc0_w, v1.tc0_w, v2.tc0_w);
+                    std::tie(u, v, texture_address) = ConvertCubeCoord(u, v, w, regs.texturing);
+                    break;
                 }
-
-                combiner_output[0] =
-                    std::min((unsigned)255, color_output.r() * tev_stage.GetColorMultiplier());
-                combiner_output[1] =
-                    std::min((unsigned)255, color_output.g() * tev_stage.GetColorMultiplier());
-                combiner_output[2] =
-                    std::min((unsigned)255, color_output.b() * tev_stage.GetColorMultiplier());
-                combiner_output[3] =
-                    std::min((unsigned)255, alpha_output * tev_stage.GetAlphaMultiplier());
-
-                combiner_buffer = next_combiner_buffer;
-
-                if (regs.texturing.tev_combiner_buffer_input.TevStageUpdatesCombinerBufferColor(
-                        tev_stage_index)) {
-                    next_combiner_buffer.r() = combiner_output.r();
-                    next_combiner_buffer.g() = combiner_output.g();
-                    next_combiner_buffer.b() = combiner_output.b();
+                case TexturingRegs::TextureConfig::Projection2D: {
+                    auto tc0_w = GetInterpolatedAttribute(v0.tc0_w, v1.tc0_w, v2.tc0_w);
+                    u /= tc0_w;
+                    v /= tc0_w;
+                    break;
                 }
-
-                if (regs.texturing.tev_combiner_buffer_input.TevStageUpdatesCombinerBufferAlpha(
-                        tev_stage_index)) {
-                    next_combiner_buffer.a() = combiner_output.a();
+                default:
+                    // TODO: Change to LOG_ERROR when more types are handled.
+                    LOG_DEBUG(HW_GPU, "Unhandled texture type %x", (int)texture.config.type);
+                    UNIMPLEMENTED();
+                    break;
                 }
             }
 
-            const auto& output_merger = regs.framebuffer.output_merger;
-            // TODO: Does alpha testing happen before or after stencil?
-            if (output_merger.alpha_test.enable) {
-                bool pass = false;
+            int s = (int)(u * float24::FromFloat32(static_cast<float>(texture.config.width)))
+                        .ToFloat32();
+            int t = (int)(v * float24::FromFloat32(static_cast<float>(texture.config.height)))
+                        .ToFloat32();
 
-                switch (output_merger.alpha_test.func) {
-                case FramebufferRegs::CompareFunc::Never:
-                    pass = false;
-                    break;
-
-                case FramebufferRegs::CompareFunc::Always:
-                    pass = true;
-                    break;
+            bool use_border_s = false;
+            bool use_border_t = false;
 
-                case FramebufferRegs::CompareFunc::Equal:
-                    pass = combiner_output.a() == output_merger.alpha_test.ref;
-                    break;
-
-                case FramebufferRegs::CompareFunc::NotEqual:
-                    pass = combiner_output.a() != output_merger.alpha_test.ref;
-                    break;
+            if (texture.config.wrap_s == TexturingRegs::TextureConfig::ClampToBorder) {
+                use_border_s = s < 0 || s >= static_cast<int>(texture.config.width);
+            } else if (texture.config.wrap_s == TexturingRegs::TextureConfig::ClampToBorder2) {
+                use_border_s = s >= static_cast<int>(texture.config.width);
+            }
 
-                case FramebufferRegs::CompareFunc::LessThan:
-                    pass = combiner_output.a() < output_merger.alpha_test.ref;
-                    break;
+            if (texture.config.wrap_t == TexturingRegs::TextureConfig::ClampToBorder) {
+                use_border_t = t < 0 || t >= static_cast<int>(texture.config.height);
+            } else if (texture.config.wrap_t == TexturingRegs::TextureConfig::ClampToBorder2) {
+                use_border_t = t >= static_cast<int>(texture.config.height);
+            }
 
-                case FramebufferRegs::CompareFunc::LessThanOrEqual:
-                    pass = combiner_output.a() <= output_merger.alpha_test.ref;
-                    break;
+            if (use_border_s || use_border_t) {
+                auto border_color = texture.config.border_color;
+                texture_color[i] = {border_color.r, border_color.g, border_color.b,
+                                    border_color.a};
+            } else {
+                // Textures are laid out from bottom to top, hence we invert the t coordinate.
+                // NOTE: This may not be the right place for the inversion.
+                // TODO: Check if this applies to ETC textures, too.
+                s = GetWrappedTexCoord(texture.config.wrap_s, s, texture.config.width);
+                t = texture.config.height - 1 -
+                    GetWrappedTexCoord(texture.config.wrap_t, t, texture.config.height);
+
+                const u8* texture_data = Memory::GetPhysicalPointer(texture_address);
+                auto info =
+                    Texture::TextureInfo::FromPicaRegister(texture.config, texture.format);
+
+                // TODO: Apply the min and mag filters to the texture
+                texture_color[i] = Texture::LookupTexture(texture_data, s, t, info);
+#if PICA_DUMP_TEXTURES
+                DebugUtils::DumpTexture(texture.config, texture_data);
+#endif
+            }
+        }
 
-                case FramebufferRegs::CompareFunc::GreaterThan:
-                    pass = combiner_output.a() > output_merger.alpha_test.ref;
-                    break;
+        // sample procedural texture
+        if (regs.texturing.main_config.texture3_enable) {
+            const auto& proctex_uv = uv[regs.texturing.main_config.texture3_coordinates];
+            texture_color[3] =
+                ProcTex(proctex_uv.u().ToFloat32(), proctex_uv.v().ToFloat32(), *proctex);
+        }
 
-                case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
-                    pass = combiner_output.a() >= output_merger.alpha_test.ref;
-                    break;
+        // Texture environment - consists of 6 stages of color and alpha combining.
+        //
+        // Color combiners take three input color values from some source (e.g. interpolated
+        // vertex color, texture color, previous stage, etc), perform some very simple
+        // operations on each of them (e.g. inversion) and then calculate the output color
+        // with some basic arithmetic. Alpha combiners can be configured separately but work
+        // analogously.
+        Math::Vec4<u8> combiner_output;
+        Math::Vec4<u8> combiner_buffer = {0, 0, 0, 0};
+        Math::Vec4<u8> next_combiner_buffer = {
+            regs.texturing.tev_combiner_buffer_color.r,
+            regs.texturing.tev_combiner_buffer_color.g,
+            regs.texturing.tev_combiner_buffer_color.b,
+            regs.texturing.tev_combiner_buffer_color.a,
+        };
+
+        for (unsigned tev_stage_index = 0; tev_stage_index < tev_stages.size();
+             ++tev_stage_index) {
+            const auto& tev_stage = tev_stages[tev_stage_index];
+            using Source = TexturingRegs::TevStageConfig::Source;
+
+            auto GetSource = [&](Source source) -> Math::Vec4<u8> {
+                switch (source) {
+                case Source::PrimaryColor:
+
+                // HACK: Until we implement fragment lighting, use primary_color
+                case Source::PrimaryFragmentColor:
+                    return primary_color;
+
+                // HACK: Until we implement fragment lighting, use zero
+                case Source::SecondaryFragmentColor:
+                    return {0, 0, 0, 0};
+
+                case Source::Texture0:
+                    return texture_color[0];
+
+                case Source::Texture1:
+                    return texture_color[1];
+
+                case Source::Texture2:
+                    return texture_color[2];
+
+                case Source::Texture3:
+                    return texture_color[3];
+
+                case Source::PreviousBuffer:
+                    return combiner_buffer;
+
+                case Source::Constant:
+                    return {tev_stage.const_r, tev_stage.const_g, tev_stage.const_b,
+                            tev_stage.const_a};
+
+                case Source::Previous:
+                    return combiner_output;
+
+                default:
+                    LOG_ERROR(HW_GPU, "Unknown color combiner source %d", (int)source);
+                    UNIMPLEMENTED();
+                    return {0, 0, 0, 0};
                 }
+            };
 
-                if (!pass)
-                    continue;
-            }
+            // color combiner
+            // NOTE: Not sure if the alpha combiner might use the color output of the previous
+            //       stage as input. Hence, we currently don't directly write the result to
+            //       combiner_output.rgb(), but instead store it in a temporary variable until
+            //       alpha combining has been done.
+            Math::Vec3<u8> color_result[3] = {
+                GetColorModifier(tev_stage.color_modifier1, GetSource(tev_stage.color_source1)),
+                GetColorModifier(tev_stage.color_modifier2, GetSource(tev_stage.color_source2)),
+                GetColorModifier(tev_stage.color_modifier3, GetSource(tev_stage.color_source3)),
+            };
+            auto color_output = ColorCombine(tev_stage.color_op, color_result);
 
-            // Apply fog combiner
-            // Not fully accurate. We'd have to know what data type is used to
-            // store the depth etc. Using float for now until we know more
-            // about Pica datatypes
-            if (regs.texturing.fog_mode == TexturingRegs::FogMode::Fog) {
-                const Math::Vec3<u8> fog_color = {
-                    static_cast<u8>(regs.texturing.fog_color.r.Value()),
-                    static_cast<u8>(regs.texturing.fog_color.g.Value()),
-                    static_cast<u8>(regs.texturing.fog_color.b.Value()),
-                };
+            u8 alpha_output;
+            if (tev_stage.color_op == TexturingRegs::TevStageConfig::Operation::Dot3_RGBA) {
+                // result of Dot3_RGBA operation is also placed to the alpha component
+                alpha_output = color_output.x;
+            } else {
+                // alpha combiner
+                std::array<u8, 3> alpha_result = {{
+                    GetAlphaModifier(tev_stage.alpha_modifier1,
+                                     GetSource(tev_stage.alpha_source1)),
+                    GetAlphaModifier(tev_stage.alpha_modifier2,
+                                     GetSource(tev_stage.alpha_source2)),
+                    GetAlphaModifier(tev_stage.alpha_modifier3,
+                                     GetSource(tev_stage.alpha_source3)),
+                }};
+                alpha_output = AlphaCombine(tev_stage.alpha_op, alpha_result);
+            }
 
-                // Get index into fog LUT
-                float fog_index;
-                if (g_state.regs.texturing.fog_flip) {
-                    fog_index = (1.0f - depth) * 128.0f;
-                } else {
-                    fog_index = depth * 128.0f;
-                }
+            combiner_output[0] =
+                std::min((unsigned)255, color_output.r() * tev_stage.GetColorMultiplier());
+            combiner_output[1] =
+                std::min((unsigned)255, color_output.g() * tev_stage.GetColorMultiplier());
+            combiner_output[2] =
+                std::min((unsigned)255, color_output.b() * tev_stage.GetColorMultiplier());
+            combiner_output[3] =
+                std::min((unsigned)255, alpha_output * tev_stage.GetAlphaMultiplier());
+
+            combiner_buffer = next_combiner_buffer;
+
+            if (regs.texturing.tev_combiner_buffer_input.TevStageUpdatesCombinerBufferColor(
+                    tev_stage_index)) {
+                next_combiner_buffer.r() = combiner_output.r();
+                next_combiner_buffer.g() = combiner_output.g();
+                next_combiner_buffer.b() = combiner_output.b();
+            }
 
-                // Generate clamped fog factor from LUT for given fog index
-                float fog_i = MathUtil::Clamp(floorf(fog_index), 0.0f, 127.0f);
-                float fog_f = fog_index - fog_i;
-                const auto& fog_lut_entry = g_state.fog.lut[static_cast<unsigned int>(fog_i)];
-                float fog_factor = fog_lut_entry.ToFloat() + fog_lut_entry.DiffToFloat() * fog_f;
-                fog_factor = MathUtil::Clamp(fog_factor, 0.0f, 1.0f);
-
-                // Blend the fog
-                for (unsigned i = 0; i < 3; i++) {
-                    combiner_output[i] = static_cast<u8>(fog_factor * combiner_output[i] +
-                                                         (1.0f - fog_factor) * fog_color[i]);
-                }
+            if (regs.texturing.tev_combiner_buffer_input.TevStageUpdatesCombinerBufferAlpha(
+                    tev_stage_index)) {
+                next_combiner_buffer.a() = combiner_output.a();
             }
+        }
 
-            u8 old_stencil = 0;
+        // TODO: Does alpha testing happen before or after stencil?
+        if (output_merger.alpha_test.enable) {
+            bool pass = false;
 
-            auto UpdateStencil = [stencil_test, x, y,
-                                  &old_stencil](Pica::FramebufferRegs::StencilAction action) {
-                u8 new_stencil =
-                    PerformStencilAction(action, old_stencil, stencil_test.reference_value);
-                if (g_state.regs.framebuffer.framebuffer.allow_depth_stencil_write != 0)
-                    SetStencil(x >> 4, y >> 4, (new_stencil & stencil_test.write_mask) |
-                                                   (old_stencil & ~stencil_test.write_mask));
-            };
+            switch (output_merger.alpha_test.func) {
+            case FramebufferRegs::CompareFunc::Never:
+                pass = false;
+                break;
 
-            if (stencil_action_enable) {
-                old_stencil = GetStencil(x >> 4, y >> 4);
-                u8 dest = old_stencil & stencil_test.input_mask;
-                u8 ref = stencil_test.reference_value & stencil_test.input_mask;
+            case FramebufferRegs::CompareFunc::Always:
+                pass = true;
+                break;
 
-                bool pass = false;
-                switch (stencil_test.func) {
-                case FramebufferRegs::CompareFunc::Never:
-                    pass = false;
-                    break;
+            case FramebufferRegs::CompareFunc::Equal:
+                pass = combiner_output.a() == output_merger.alpha_test.ref;
+                break;
 
-                case FramebufferRegs::CompareFunc::Always:
-                    pass = true;
-                    break;
+            case FramebufferRegs::CompareFunc::NotEqual:
+                pass = combiner_output.a() != output_merger.alpha_test.ref;
+                break;
 
-                case FramebufferRegs::CompareFunc::Equal:
-                    pass = (ref == dest);
-                    break;
+            case FramebufferRegs::CompareFunc::LessThan:
+                pass = combiner_output.a() < output_merger.alpha_test.ref;
+                break;
 
-                case FramebufferRegs::CompareFunc::NotEqual:
-                    pass = (ref != dest);
-                    break;
+            case FramebufferRegs::CompareFunc::LessThanOrEqual:
+                pass = combiner_output.a() <= output_merger.alpha_test.ref;
+                break;
 
-                case FramebufferRegs::CompareFunc::LessThan:
-                    pass = (ref < dest);
-                    break;
+            case FramebufferRegs::CompareFunc::GreaterThan:
+                pass = combiner_output.a() > output_merger.alpha_test.ref;
+                break;
 
-                case FramebufferRegs::CompareFunc::LessThanOrEqual:
-                    pass = (ref <= dest);
-                    break;
+            case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
+                pass = combiner_output.a() >= output_merger.alpha_test.ref;
+                break;
+            }
 
-                case FramebufferRegs::CompareFunc::GreaterThan:
-                    pass = (ref > dest);
-                    break;
+            if (!pass)
+                return;
+        }
 
-                case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
-                    pass = (ref >= dest);
-                    break;
-                }
+        // Apply fog combiner
+        // Not fully accurate. We'd have to know what data type is used to
+        // store the depth etc. Using float for now until we know more
+        // about Pica datatypes
+        if (regs.texturing.fog_mode == TexturingRegs::FogMode::Fog) {
+            const Math::Vec3<u8> fog_color = {
+                static_cast<u8>(regs.texturing.fog_color.r.Value()),
+                static_cast<u8>(regs.texturing.fog_color.g.Value()),
+                static_cast<u8>(regs.texturing.fog_color.b.Value()),
+            };
 
-                if (!pass) {
-                    UpdateStencil(stencil_test.action_stencil_fail);
-                    continue;
-                }
+            // Get index into fog LUT
+            float fog_index;
+            if (g_state.regs.texturing.fog_flip) {
+                fog_index = (1.0f - depth) * 128.0f;
+            } else {
+                fog_index = depth * 128.0f;
             }
 
-            // Convert float to integer
-            unsigned num_bits =
-                FramebufferRegs::DepthBitsPerPixel(regs.framebuffer.framebuffer.depth_format);
-            u32 z = (u32)(depth * ((1 << num_bits) - 1));
+            // Generate clamped fog factor from LUT for given fog index
+            float fog_i = MathUtil::Clamp(floorf(fog_index), 0.0f, 127.0f);
+            float fog_f = fog_index - fog_i;
+            const auto& fog_lut_entry = g_state.fog.lut[static_cast<unsigned int>(fog_i)];
+            float fog_factor = fog_lut_entry.ToFloat() + fog_lut_entry.DiffToFloat() * fog_f;
+            fog_factor = MathUtil::Clamp(fog_factor, 0.0f, 1.0f);
+
+            // Blend the fog
+            for (unsigned i = 0; i < 3; i++) {
+                combiner_output[i] = static_cast<u8>(fog_factor * combiner_output[i] +
+                                                     (1.0f - fog_factor) * fog_color[i]);
+            }
+        }
 
-            if (output_merger.depth_test_enable) {
-                u32 ref_z = GetDepth(x >> 4, y >> 4);
+        if (!early_depth_stencil && !DepthStencilTest(x, y, z))
+            return;
 
-                bool pass = false;
+        auto dest = GetPixel(x >> 4, y >> 4);
+        Math::Vec4<u8> blend_output = combiner_output;
 
-                switch (output_merger.depth_test_func) {
-                case FramebufferRegs::CompareFunc::Never:
-                    pass = false;
-                    break;
+        if (output_merger.alphablend_enable) {
+            auto params = output_merger.alpha_blending;
 
-                case FramebufferRegs::CompareFunc::Always:
-                    pass = true;
-                    break;
+            auto LookupFactor = [&](unsigned channel,
+                                    FramebufferRegs::BlendFactor factor) -> u8 {
+                DEBUG_ASSERT(channel < 4);
 
-                case FramebufferRegs::CompareFunc::Equal:
-                    pass = z == ref_z;
-                    break;
+                const Math::Vec4<u8> blend_const = {
+                    static_cast<u8>(output_merger.blend_const.r),
+                    static_cast<u8>(output_merger.blend_const.g),
+                    static_cast<u8>(output_merger.blend_const.b),
+                    static_cast<u8>(output_merger.blend_const.a),
+                };
 
-                case FramebufferRegs::CompareFunc::NotEqual:
-                    pass = z != ref_z;
-                    break;
+                switch (factor) {
+                case FramebufferRegs::BlendFactor::Zero:
+                    return 0;
 
-                case FramebufferRegs::CompareFunc::LessThan:
-                    pass = z < ref_z;
-                    break;
+                case FramebufferRegs::BlendFactor::One:
+                    return 255;
 
-                case FramebufferRegs::CompareFunc::LessThanOrEqual:
-                    pass = z <= ref_z;
-                    break;
+                case FramebufferRegs::BlendFactor::SourceColor:
+                    return combiner_output[channel];
 
-                case FramebufferRegs::CompareFunc::GreaterThan:
-                    pass = z > ref_z;
-                    break;
+                case FramebufferRegs::BlendFactor::OneMinusSourceColor:
+                    return 255 - combiner_output[channel];
 
-                case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
-                    pass = z >= ref_z;
-                    break;
-                }
+                case FramebufferRegs::BlendFactor::DestColor:
+                    return dest[channel];
 
-                if (!pass) {
-                    if (stencil_action_enable)
-                        UpdateStencil(stencil_test.action_depth_fail);
-                    continue;
-                }
-            }
+                case FramebufferRegs::BlendFactor::OneMinusDestColor:
+                    return 255 - dest[channel];
 
-            if (regs.framebuffer.framebuffer.allow_depth_stencil_write != 0 &&
-                output_merger.depth_write_enable) {
+                case FramebufferRegs::BlendFactor::SourceAlpha:
+                    return combiner_output.a();
 
-                SetDepth(x >> 4, y >> 4, z);
-            }
+                case FramebufferRegs::BlendFactor::OneMinusSourceAlpha:
+                    return 255 - combiner_output.a();
 
-            // The stencil depth_pass action is executed even if depth testing is disabled
-            if (stencil_action_enable)
-                UpdateStencil(stencil_test.action_depth_pass);
+                case FramebufferRegs::BlendFactor::DestAlpha:
+                    return dest.a();
 
-            auto dest = GetPixel(x >> 4, y >> 4);
-            Math::Vec4<u8> blend_output = combiner_output;
+                case FramebufferRegs::BlendFactor::OneMinusDestAlpha:
+                    return 255 - dest.a();
 
-            if (output_merger.alphablend_enable) {
-                auto params = output_merger.alpha_blending;
+                case FramebufferRegs::BlendFactor::ConstantColor:
+                    return blend_const[channel];
 
-                auto LookupFactor = [&](unsigned channel,
-                                        FramebufferRegs::BlendFactor factor) -> u8 {
-                    DEBUG_ASSERT(channel < 4);
+                case FramebufferRegs::BlendFactor::OneMinusConstantColor:
+                    return 255 - blend_const[channel];
 
-                    const Math::Vec4<u8> blend_const = {
-                        static_cast<u8>(output_merger.blend_const.r),
-                        static_cast<u8>(output_merger.blend_const.g),
-                        static_cast<u8>(output_merger.blend_const.b),
-                        static_cast<u8>(output_merger.blend_const.a),
-                    };
+                case FramebufferRegs::BlendFactor::ConstantAlpha:
+                    return blend_const.a();
 
-                    switch (factor) {
-                    case FramebufferRegs::BlendFactor::Zero:
-                        return 0;
+                case FramebufferRegs::BlendFactor::OneMinusConstantAlpha:
+                    return 255 - blend_const.a();
 
-                    case FramebufferRegs::BlendFactor::One:
+                case FramebufferRegs::BlendFactor::SourceAlphaSaturate:
+                    // Returns 1.0 for the alpha channel
+                    if (channel == 3)
                         return 255;
+                    return std::min(combiner_output.a(), static_cast<u8>(255 - dest.a()));
 
-                    case FramebufferRegs::BlendFactor::SourceColor:
-                        return combiner_output[channel];
-
-                    case FramebufferRegs::BlendFactor::OneMinusSourceColor:
-                        return 255 - combiner_output[channel];
-
-                    case FramebufferRegs::BlendFactor::DestColor:
-                        return dest[channel];
-
-                    case FramebufferRegs::BlendFactor::OneMinusDestColor:
-                        return 255 - dest[channel];
-
-                    case FramebufferRegs::BlendFactor::SourceAlpha:
-                        return combiner_output.a();
-
-                    case FramebufferRegs::BlendFactor::OneMinusSourceAlpha:
-                        return 255 - combiner_output.a();
-
-                    case FramebufferRegs::BlendFactor::DestAlpha:
-                        return dest.a();
-
-                    case FramebufferRegs::BlendFactor::OneMinusDestAlpha:
-                        return 255 - dest.a();
-
-                    case FramebufferRegs::BlendFactor::ConstantColor:
-                        return blend_const[channel];
-
-                    case FramebufferRegs::BlendFactor::OneMinusConstantColor:
-                        return 255 - blend_const[channel];
-
-                    case FramebufferRegs::BlendFactor::ConstantAlpha:
-                        return blend_const.a();
+                default:
+                    LOG_CRITICAL(HW_GPU, "Unknown blend factor %x", factor);
+                    UNIMPLEMENTED();
+                    break;
+                }
 
-                    case FramebufferRegs::BlendFactor::OneMinusConstantAlpha:
-                        return 255 - blend_const.a();
+                return combiner_output[channel];
+            };
 
-                    case FramebufferRegs::BlendFactor::SourceAlphaSaturate:
-                        // Returns 1.0 for the alpha channel
-                        if (channel == 3)
-                            return 255;
-                        return std::min(combiner_output.a(), static_cast<u8>(255 - dest.a()));
+            auto srcfactor = Math::MakeVec(LookupFactor(0, params.factor_source_rgb),
+                                           LookupFactor(1, params.factor_source_rgb),
+                                           LookupFactor(2, params.factor_source_rgb),
+                                           LookupFactor(3, params.factor_source_a));
+
+            auto dstfactor = Math::MakeVec(LookupFactor(0, params.factor_dest_rgb),
+                                           LookupFactor(1, params.factor_dest_rgb),
+                                           LookupFactor(2, params.factor_dest_rgb),
+                                           LookupFactor(3, params.factor_dest_a));
+
+            blend_output = EvaluateBlendEquation(combiner_output, srcfactor, dest, dstfactor,
+                                                 params.blend_equation_rgb);
+            blend_output.a() = EvaluateBlendEquation(combiner_output, srcfactor, dest,
+                                                     dstfactor, params.blend_equation_a)
+                                   .a();
+        } else {
+            blend_output =
+                Math::MakeVec(LogicOp(combiner_output.r(), dest.r(), output_merger.logic_op),
+                              LogicOp(combiner_output.g(), dest.g(), output_merger.logic_op),
+                              LogicOp(combiner_output.b(), dest.b(), output_merger.logic_op),
+                              LogicOp(combiner_output.a(), dest.a(), output_merger.logic_op));
+        }
 
-                    default:
-                        LOG_CRITICAL(HW_GPU, "Unknown blend factor %x", factor);
-                        UNIMPLEMENTED();
-                        break;
-                    }
+        const Math::Vec4<u8> result = {
+            output_merger.red_enable ? blend_output.r() : dest.r(),
+            output_merger.green_enable ? blend_output.g() : dest.g(),
+            output_merger.blue_enable ? blend_output.b() : dest.b(),
+            output_merger.alpha_enable ? blend_output.a() : dest.a(),
+        };
 
-                    return combiner_output[channel];
-                };
+        if (regs.framebuffer.framebuffer.allow_color_write != 0)
+            DrawPixel(x >> 4, y >> 4, result);
+    };
 
-                auto srcfactor = Math::MakeVec(LookupFactor(0, params.factor_source_rgb),
-                                               LookupFactor(1, params.factor_source_rgb),
-                                               LookupFactor(2, params.factor_source_rgb),
-                                               LookupFactor(3, params.factor_source_a));
-
-                auto dstfactor = Math::MakeVec(LookupFactor(0, params.factor_dest_rgb),
-                                               LookupFactor(1, params.factor_dest_rgb),
-                                               LookupFactor(2, params.factor_dest_rgb),
-                                               LookupFactor(3, params.factor_dest_a));
-
-                blend_output = EvaluateBlendEquation(combiner_output, srcfactor, dest, dstfactor,
-                                                     params.blend_equation_rgb);
-                blend_output.a() = EvaluateBlendEquation(combiner_output, srcfactor, dest,
-                                                         dstfactor, params.blend_equation_a)
-                                       .a();
-            } else {
-                blend_output =
-                    Math::MakeVec(LogicOp(combiner_output.r(), dest.r(), output_merger.logic_op),
-                                  LogicOp(combiner_output.g(), dest.g(), output_merger.logic_op),
-                                  LogicOp(combiner_output.b(), dest.b(), output_merger.logic_op),
-                                  LogicOp(combiner_output.a(), dest.a(), output_merger.logic_op));
-            }
+    // Blocks rejected by the hierarchical depth test are skipped
+    auto ShouldRasterizeBlock = [&](int block_x, int block_y) {
+        return !hierarchical_depth || !IsTileRejected(block_x, block_y);
+    };
+    static_assert(COVERAGE_BLOCK_SIZE == DEPTH_TILE_SIZE,
+                  "Coverage blocks must match the tiles of the coarse depth buffer");
 
-            const Math::Vec4<u8> result = {
-                output_merger.red_enable ? blend_output.r() : dest.r(),
-                output_merger.green_enable ? blend_output.g() : dest.g(),
-                output_merger.blue_enable ? blend_output.b() : dest.b(),
-                output_merger.alpha_enable ? blend_output.a() : dest.a(),
-            };
+    auto ProcessQuad = [&](const CoverageQuad& quad) {
+        for (int i = 0; i < 4; ++i) {
+            if (!(quad.mask & (1 << i)))
+                continue;
 
-            if (regs.framebuffer.framebuffer.allow_color_write != 0)
-                DrawPixel(x >> 4, y >> 4, result);
+            const Math::Vec3<int>& w = quad.w[i];
+            ProcessPixel(quad.x + (i & 1) * 16, quad.y + (i >> 1) * 16, w[0], w[1], w[2]);
         }
-    }
+    };
+
+    ForEachCoveredQuad(edges, min_x, min_y, max_x, max_y, ShouldRasterizeBlock, ProcessQuad);
 }
 
 void ProcessTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2) {
@@ -43,6 +43,13 @@ struct Vertex : Shader::OutputVertex {
     }
 };
 
+/**
+ * Range of screen coordinates, in pixels, the rasterizer can process. Triangles may extend past the
+ * viewport within this range, the pixels outside of the viewport being discarded.
+ */
+constexpr float GUARD_BAND_MIN = -512.f;
+constexpr float GUARD_BAND_MAX = 1535.f;
+
 void ProcessTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2);
 
 } // namespace Rasterizer
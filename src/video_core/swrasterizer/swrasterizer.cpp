@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include "video_core/swrasterizer/clipper.h"
+#include "video_core/swrasterizer/framebuffer.h"
 #include "video_core/swrasterizer/swrasterizer.h"
 
 namespace VideoCore {
@@ -12,4 +13,17 @@ void SWRasterizer::AddTriangle(const Pica::Shader::OutputVertex& v0,
                                const Pica::Shader::OutputVertex& v2) {
     Pica::Clipper::ProcessTriangle(v0, v1, v2);
 }
+
+void SWRasterizer::NotifyCommandListStart() {
+    // The CPU may have written to the depth buffer without going through the rasterizer cache
+    Pica::Rasterizer::InvalidateDepthTiles();
+}
+
+void SWRasterizer::FlushAll() {
+    Pica::Rasterizer::InvalidateDepthTiles();
+}
+
+void SWRasterizer::FlushAndInvalidateRegion(PAddr addr, u32 size) {
+    Pica::Rasterizer::InvalidateDepthTiles(addr, size);
+}
 }
@@ -19,9 +19,11 @@ class SWRasterizer : public RasterizerInterface {
     void AddTriangle(const Pica::Shader::OutputVertex& v0, const Pica::Shader::OutputVertex& v1,
                      const Pica::Shader::OutputVertex& v2) override;
     void DrawTriangles() override {}
+    void NotifyPicaRegisterWrite(u32 id, u32 old_value, u32 new_value) override {}
     void NotifyPicaRegisterChanged(u32 id) override {}
-    void FlushAll() override {}
+    void NotifyCommandListStart() override;
+    void FlushAll() override;
     void FlushRegion(PAddr addr, u32 size) override {}
-    void FlushAndInvalidateRegion(PAddr addr, u32 size) override {}
+    void FlushAndInvalidateRegion(PAddr addr, u32 size) override;
 };
 }